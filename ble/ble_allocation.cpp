@@ -0,0 +1,279 @@
+/**
+ * @file   ble_allocation.cpp
+ *
+ * @brief  Heap allocation audit for the event dispatch path.
+ * @detail When CONFIG_BLE_REDUX_ALLOCATION_AUDIT is enabled the global operator new is replaced
+ *         and every allocation made by a task inside an audit scope (dispatch, read, write,
+ *         prepared write, notify) is attributed to that scope. Scopes can be marked as zero
+ *         allocation, any allocation inside such a scope is counted as a violation and reported to
+ *         a handler. When disabled the scope macros compile to nothing.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#include "ble_allocation.hpp"
+
+namespace BLE
+{
+
+constexpr const size_t ALLOCATION_SCOPE_COUNT = static_cast<size_t>(
+                                                    BLE_Allocation_Audit::Scope::COUNT);
+
+// Indexed by BLE_Allocation_Audit::Scope.
+constexpr const std::array<const char*, ALLOCATION_SCOPE_COUNT> ALLOCATION_SCOPE_NAMES = {
+    "none", "dispatch", "read", "write", "prepared_write", "notify", "scan",
+};
+
+
+struct allocation_slot_t
+{
+    std::atomic<TaskHandle_t>       owner;
+    BLE_Allocation_Audit::Scope     scope;
+    uint32_t                        depth;
+};
+
+struct allocation_counters_t
+{
+    std::atomic<uint32_t>   allocations;
+    std::atomic<uint32_t>   bytes;
+    std::atomic<uint32_t>   violations;
+    std::atomic<bool>       zero_allocation;
+};
+
+static std::array<allocation_slot_t, BLE_Allocation_Audit::TASK_SLOTS>     allocation_slots = {};
+static std::array<allocation_counters_t, ALLOCATION_SCOPE_COUNT>           allocation_counters = {};
+static std::atomic<uint32_t>                                allocation_slots_active(0);
+static std::atomic<uint32_t>                                allocation_total(0);
+
+#ifdef CONFIG_BLE_REDUX_ALLOCATION_AUDIT_ABORT
+static void allocation_violation_abort(BLE_Allocation_Audit::Scope, size_t) { abort(); }
+static std::atomic<BLE_Allocation_Audit::Violation_Handler> allocation_violation_handler(
+                                                                &allocation_violation_abort);
+#else
+static std::atomic<BLE_Allocation_Audit::Violation_Handler> allocation_violation_handler(nullptr);
+#endif
+
+
+/***************************************************************************************************
+* Scope Guard
+***************************************************************************************************/
+BLE_Allocation_Audit::Guard::Guard(Scope scope)
+    : m_slot(TASK_SLOTS), m_previous(Scope::NONE)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+
+    // Reuse the slot of the current task if it is already inside a scope, otherwise claim a free
+    // one. Tasks that do not find a slot are simply not audited.
+    for (size_t i = 0; i < TASK_SLOTS; i++)
+    {
+        if (allocation_slots[i].owner.load(std::memory_order_acquire) == task)
+        {
+            m_slot = i;
+            break;
+        }
+    }
+
+    for (size_t i = 0; (m_slot == TASK_SLOTS) && (i < TASK_SLOTS); i++)
+    {
+        TaskHandle_t expected = nullptr;
+        if (allocation_slots[i].owner.compare_exchange_strong(expected, task))
+        {
+            m_slot = i;
+            allocation_slots_active.fetch_add(1);
+        }
+    }
+
+    if (m_slot == TASK_SLOTS)
+        return;
+
+    allocation_slot_t& slot = allocation_slots[m_slot];
+    m_previous = slot.scope;
+    slot.scope = scope;
+    slot.depth++;
+}
+
+
+BLE_Allocation_Audit::Guard::~Guard()
+{
+    if (m_slot == TASK_SLOTS)
+        return;
+
+    allocation_slot_t& slot = allocation_slots[m_slot];
+    slot.scope = m_previous;
+    if (--slot.depth == 0)
+    {
+        slot.owner.store(nullptr, std::memory_order_release);
+        allocation_slots_active.fetch_sub(1);
+    }
+}
+
+
+/***************************************************************************************************
+* Audit Control
+***************************************************************************************************/
+/**
+ * @brief Marks a scope as zero allocation, or clears the mark.
+ * @param [in] scope The scope of interest.
+ * @param [in] zero_allocation Whether allocations inside the scope are violations.
+ */
+void
+BLE_Allocation_Audit::zero_allocation_set(Scope scope, bool zero_allocation)
+{
+    allocation_counters[static_cast<size_t>(scope)].zero_allocation.store(zero_allocation);
+}
+
+
+/**
+ * @brief Sets the function called on every violation.
+ * @param [in] handler The handler to call, nullptr only counts violations.
+ */
+void
+BLE_Allocation_Audit::violation_handler_set(Violation_Handler handler)
+{
+    allocation_violation_handler.store(handler);
+}
+
+
+/**
+ * @brief Retrieves the counters of a scope.
+ * @param [in] scope The scope of interest.
+ * @param [in] reset (default=false) Clears the counters after reading them.
+ * @return The allocations, bytes and violations attributed to the scope.
+ */
+BLE_Allocation_Audit::counters_t
+BLE_Allocation_Audit::counters(Scope scope, bool reset)
+{
+    allocation_counters_t& counters = allocation_counters[static_cast<size_t>(scope)];
+    if (reset)
+    {
+        return {counters.allocations.exchange(0), counters.bytes.exchange(0),
+                counters.violations.exchange(0)};
+    }
+
+    return {counters.allocations.load(), counters.bytes.load(), counters.violations.load()};
+}
+
+
+/**
+ * @brief Retrieves the total number of allocations made through operator new since boot.
+ * @return The number of allocations, from all tasks and regardless of scope.
+ */
+uint32_t
+BLE_Allocation_Audit::allocations_total(void)
+{
+    return allocation_total.load(std::memory_order_relaxed);
+}
+
+
+/**
+ * @brief Retrieves a human readable name for a scope.
+ * @param [in] scope The scope of interest.
+ * @return The name of the scope.
+ */
+const char*
+BLE_Allocation_Audit::scope_name(Scope scope)
+{
+    size_t index = static_cast<size_t>(scope);
+    return index < ALLOCATION_SCOPE_NAMES.size() ? ALLOCATION_SCOPE_NAMES[index] : "unknown";
+}
+
+
+/**
+ * @brief Attributes an allocation to the scope of the calling task.
+ * @warning Only called by the replacement operator new.
+ */
+void
+BLE_Allocation_Audit::allocation_record(size_t size)
+{
+    allocation_total.fetch_add(1, std::memory_order_relaxed);
+
+    // Keep allocations outside of any scope as cheap as possible.
+    if (allocation_slots_active.load(std::memory_order_relaxed) == 0)
+        return;
+
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    for (allocation_slot_t& slot : allocation_slots)
+    {
+        if (slot.owner.load(std::memory_order_acquire) != task)
+            continue;
+
+        if (slot.scope == Scope::NONE)
+            return;
+
+        allocation_counters_t& counters = allocation_counters[static_cast<size_t>(slot.scope)];
+        counters.allocations.fetch_add(1, std::memory_order_relaxed);
+        counters.bytes.fetch_add(size, std::memory_order_relaxed);
+
+        if (counters.zero_allocation.load(std::memory_order_relaxed))
+        {
+            counters.violations.fetch_add(1, std::memory_order_relaxed);
+            Violation_Handler handler = allocation_violation_handler.load();
+            if (handler)
+                handler(slot.scope, size);
+        }
+        return;
+    }
+}
+
+};
+
+
+/***************************************************************************************************
+* Replacement Allocation Functions
+***************************************************************************************************/
+#ifdef CONFIG_BLE_REDUX_ALLOCATION_AUDIT
+static void*
+allocation_audited(size_t size)
+{
+    BLE::BLE_Allocation_Audit::allocation_record(size);
+    return malloc(size ? size : 1);
+}
+
+
+static void*
+allocation_audited_throwing(size_t size)
+{
+    void* memory = allocation_audited(size);
+    if (!memory)
+    {
+#ifdef __cpp_exceptions
+        throw std::bad_alloc();
+#else
+        abort();
+#endif
+    }
+
+    return memory;
+}
+
+
+void* operator new(size_t size) { return allocation_audited_throwing(size); }
+void* operator new[](size_t size) { return allocation_audited_throwing(size); }
+void* operator new(size_t size, const std::nothrow_t&) noexcept { return allocation_audited(size); }
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return allocation_audited(size);
+}
+
+void operator delete(void* memory) noexcept { free(memory); }
+void operator delete[](void* memory) noexcept { free(memory); }
+void operator delete(void* memory, size_t) noexcept { free(memory); }
+void operator delete[](void* memory, size_t) noexcept { free(memory); }
+void operator delete(void* memory, const std::nothrow_t&) noexcept { free(memory); }
+void operator delete[](void* memory, const std::nothrow_t&) noexcept { free(memory); }
+#endif // CONFIG_BLE_REDUX_ALLOCATION_AUDIT
@@ -0,0 +1,142 @@
+/**
+ * @file   ble_allocation.hpp
+ *
+ * @brief  Heap allocation audit for the event dispatch path.
+ * @detail When CONFIG_BLE_REDUX_ALLOCATION_AUDIT is enabled the global operator new is replaced
+ *         and every allocation made by a task inside an audit scope (dispatch, read, write,
+ *         prepared write, notify) is attributed to that scope. Scopes can be marked as zero
+ *         allocation, any allocation inside such a scope is counted as a violation and reported to
+ *         a handler. When disabled the scope macros compile to nothing.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_ALLOCATION_HPP
+#define COMPONENTS_BLE_BLE_ALLOCATION_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+namespace BLE
+{
+
+class BLE_Allocation_Audit
+{
+public:
+    enum class Scope : uint8_t
+    {
+        NONE,
+        DISPATCH,
+        READ,
+        WRITE,
+        PREPARED_WRITE,
+        NOTIFY,
+        SCAN,
+        COUNT,
+    };
+
+    struct counters_t
+    {
+        uint32_t    allocations;
+        uint32_t    bytes;
+        uint32_t    violations;
+    };
+
+    /**
+     * @brief Called from within operator new whenever a zero allocation scope allocates.
+     * @warning The handler must not allocate, it may abort or record the violation.
+     */
+    using Violation_Handler = void (*)(Scope scope, size_t size);
+
+
+    /**
+     * @brief RAII helper which attributes the allocations of the current task to a scope.
+     * @detail Scopes nest, the innermost scope receives the allocations and the enclosing scope is
+     *         restored on destruction.
+     */
+    class Guard
+    {
+    public:
+        explicit Guard(Scope scope);
+        ~Guard();
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        size_t  m_slot;
+        Scope   m_previous;
+    };
+
+
+    /**
+     * @brief Marks a scope as zero allocation, or clears the mark.
+     * @param [in] scope The scope of interest.
+     * @param [in] zero_allocation Whether allocations inside the scope are violations.
+     */
+    static void zero_allocation_set(Scope scope, bool zero_allocation);
+
+    /**
+     * @brief Sets the function called on every violation.
+     * @param [in] handler The handler to call, nullptr only counts violations.
+     */
+    static void violation_handler_set(Violation_Handler handler);
+
+    /**
+     * @brief Retrieves the counters of a scope.
+     * @param [in] scope The scope of interest.
+     * @param [in] reset (default=false) Clears the counters after reading them.
+     * @return The allocations, bytes and violations attributed to the scope.
+     */
+    static counters_t counters(Scope scope, bool reset=false);
+
+    /**
+     * @brief Retrieves the total number of allocations made through operator new since boot.
+     * @return The number of allocations, from all tasks and regardless of scope.
+     */
+    static uint32_t allocations_total(void);
+
+    /**
+     * @brief Attributes an allocation to the scope of the calling task.
+     * @warning Only called by the replacement operator new.
+     */
+    static void allocation_record(size_t size);
+
+    /**
+     * @brief Retrieves a human readable name for a scope.
+     * @param [in] scope The scope of interest.
+     * @return The name of the scope.
+     */
+    static const char* scope_name(Scope scope);
+
+    // The number of tasks which can be inside a scope at the same time.
+    static constexpr const size_t TASK_SLOTS = 4;
+};
+
+};
+
+
+#ifdef CONFIG_BLE_REDUX_ALLOCATION_AUDIT
+#define BLE_ALLOCATION_CONCAT_INNER(A, B) A##B
+#define BLE_ALLOCATION_CONCAT(A, B) BLE_ALLOCATION_CONCAT_INNER(A, B)
+
+#define BLE_ALLOCATION_SCOPE(SCOPE)\
+    BLE::BLE_Allocation_Audit::Guard BLE_ALLOCATION_CONCAT(ble_allocation_scope_, __LINE__)(\
+        BLE::BLE_Allocation_Audit::Scope::SCOPE)
+
+#define BLE_ALLOCATION_SCOPE_DYNAMIC(SCOPE)\
+    BLE::BLE_Allocation_Audit::Guard BLE_ALLOCATION_CONCAT(ble_allocation_scope_, __LINE__)(SCOPE)
+#else
+#define BLE_ALLOCATION_SCOPE(SCOPE) do {} while (0)
+#define BLE_ALLOCATION_SCOPE_DYNAMIC(SCOPE) do { (void) sizeof(SCOPE); } while (0)
+#endif
+
+#endif // COMPONENTS_BLE_BLE_ALLOCATION_HPP
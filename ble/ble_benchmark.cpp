@@ -0,0 +1,545 @@
+/**
+ * @file   ble_benchmark.cpp
+ *
+ * @brief  Micro-benchmark suite for the library's hot paths.
+ * @detail The suite builds a private GATT table (profile, service and characteristics) that is not
+ *         registered with the BLE stack and drives synthetic events through it. Results are
+ *         emitted as JSON with a fixed key order so that they can be diffed across releases.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "esp_gatts_api.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+#include "utilities.hpp"
+
+#include "ble_allocation.hpp"
+#include "ble_benchmark.hpp"
+#include "ble_characteristic.hpp"
+#include "ble_log.hpp"
+#include "ble_profile.hpp"
+#include "ble_queue.hpp"
+#include "ble_server.hpp"
+#include "ble_service.hpp"
+#include "ble_timeseries_packer.hpp"
+#include "ble_transaction.hpp"
+#include "ble_utilities.hpp"
+#include "ble_value.hpp"
+#include "uuid.hpp"
+
+namespace BLE
+{
+
+// The benchmark GATT table is never registered with the stack, these values only have to be
+// consistent with each other.
+constexpr const esp_gatt_if_t BENCHMARK_GATTS_IF = 0xB0;
+constexpr const uint16_t BENCHMARK_PROFILE_ID = 0xB000;
+constexpr const uint16_t BENCHMARK_SERVICE_HANDLE = 0x0100;
+constexpr const uint16_t BENCHMARK_SERVICE_UUID = 0xB000;
+constexpr const uint16_t BENCHMARK_CHARACTERISTIC_UUID = 0xC000;
+constexpr const uint16_t BENCHMARK_CONNECTION_ID = 0x0000;
+
+constexpr const std::array<size_t, 4> BENCHMARK_TABLE_SIZES = {1, 8, 32, 64};
+constexpr const std::array<uint16_t, 3> BENCHMARK_MTUS = {MTU_DEFAULT_BLE_CLIENT, 185,
+                                                          MTU_DEFAULT_BLE_SERVER};
+constexpr const size_t BENCHMARK_LONG_VALUE_LEN = 512;
+constexpr const char* LOG_TAG_BLE_BENCHMARK = "BLE Benchmark";
+constexpr const uint32_t BENCHMARK_STACK_PROBE_SIZE = 8192;
+
+// The ATT Prepare Write Request carries a 2 byte handle and a 2 byte offset after the opcode.
+constexpr const size_t ATT_FIELD_LENGTH_PREPARE_WRITE_HEADER = 4;
+
+
+// Results are accumulated here so that the compiler cannot discard the measured operations.
+static volatile uint32_t benchmark_sink = 0;
+
+
+/***************************************************************************************************
+* Benchmark Helpers
+***************************************************************************************************/
+template<typename F>
+BLE_Benchmark::result_t
+BLE_Benchmark::measure(std::string name, std::vector<std::pair<std::string, int64_t>> params, F op)
+{
+    // Warm up caches and any lazily allocated containers before measuring.
+    op();
+
+    uint32_t allocations = BLE_Allocation_Audit::allocations_total();
+    int64_t start = esp_timer_get_time();
+    for (uint32_t i = 0; i < m_iterations; i++)
+        op();
+    int64_t end = esp_timer_get_time();
+    allocations = BLE_Allocation_Audit::allocations_total() - allocations;
+
+    return {name, params, m_iterations, end - start, allocations, 0};
+}
+
+
+/**
+ * @brief Measures an operation whose effects must be undone before it can run again.
+ * @note Each iteration is timed on its own so that the reset stays out of the result, which adds
+ *       the cost of reading the timer to every iteration.
+ * @param [in] name The name of the benchmark.
+ * @param [in] params The parameters of the benchmark.
+ * @param [in] op The operation of interest.
+ * @param [in] reset Undoes the effects of the operation.
+ * @return The result of the benchmark.
+ */
+template<typename F, typename R>
+BLE_Benchmark::result_t
+BLE_Benchmark::measure(std::string name, std::vector<std::pair<std::string, int64_t>> params, F op,
+                       R reset)
+{
+    op();
+    reset();
+
+    uint32_t allocations = 0;
+    int64_t elapsed = 0;
+    for (uint32_t i = 0; i < m_iterations; i++)
+    {
+        uint32_t allocations_start = BLE_Allocation_Audit::allocations_total();
+        int64_t start = esp_timer_get_time();
+        op();
+        elapsed += esp_timer_get_time() - start;
+        allocations += BLE_Allocation_Audit::allocations_total() - allocations_start;
+        reset();
+    }
+
+    return {name, params, m_iterations, elapsed, allocations, 0};
+}
+
+
+struct stack_probe_t
+{
+    std::function<void()>   op;
+    UBaseType_t             high_water;
+    SemaphoreHandle_t       done;
+};
+
+
+static void
+benchmark_stack_probe(void* parameters)
+{
+    stack_probe_t* probe = static_cast<stack_probe_t*>(parameters);
+    probe->op();
+    probe->high_water = uxTaskGetStackHighWaterMark(nullptr);
+    xSemaphoreGive(probe->done);
+    vTaskDelete(nullptr);
+}
+
+
+/**
+ * @brief Measures the peak stack usage of an operation by running it once on a fresh task.
+ * @note The result includes the small fixed overhead of the probe task itself.
+ * @param [in] op The operation of interest.
+ * @return The peak stack usage in bytes or 0 if the probe task could not be created.
+ */
+uint32_t
+BLE_Benchmark::stack_measure(std::function<void()> op)
+{
+    stack_probe_t probe = {op, 0, xSemaphoreCreateBinary()};
+    if (xTaskCreate(&benchmark_stack_probe, "ble_bench_stack", BENCHMARK_STACK_PROBE_SIZE, &probe,
+                    uxTaskPriorityGet(nullptr), nullptr) != pdPASS)
+    {
+        vSemaphoreDelete(probe.done);
+        return 0;
+    }
+
+    xSemaphoreTake(probe.done, portMAX_DELAY);
+    vSemaphoreDelete(probe.done);
+
+    // The ESP32 port of FreeRTOS reports the high water mark in bytes.
+    return BENCHMARK_STACK_PROBE_SIZE - probe.high_water;
+}
+
+
+std::shared_ptr<BLE_Server>
+BLE_Benchmark::server_build(size_t characteristic_count)
+{
+    std::shared_ptr<BLE_Server> server = std::shared_ptr<BLE_Server>(new BLE_Server());
+    auto profile = std::make_shared<BLE_Profile>(BENCHMARK_PROFILE_ID, BENCHMARK_GATTS_IF, server);
+    server->m_profiles.insert(std::make_pair(BENCHMARK_PROFILE_ID, profile));
+
+    esp_gatt_srvc_id_t service_id = {};
+    service_id.is_primary = true;
+    service_id.id.inst_id = 0x00;
+    service_id.id.uuid = UUID(BENCHMARK_SERVICE_UUID).to_esp_uuid();
+
+    auto service = std::make_shared<BLE_Service>(service_id, BENCHMARK_SERVICE_HANDLE,
+                                                 BENCHMARK_GATTS_IF, true, profile);
+    profile->m_services_uuid.insert(std::make_pair(service->uuid, service));
+    profile->m_services_handle.insert(std::make_pair(service->handle, service));
+
+    for (size_t i = 0; i < characteristic_count; i++)
+    {
+        // Each characteristic occupies a declaration and a value attribute.
+        uint16_t handle = BENCHMARK_SERVICE_HANDLE + 2 + (2 * i);
+        UUID uuid(static_cast<uint16_t>(BENCHMARK_CHARACTERISTIC_UUID + i));
+        auto characteristic = std::make_shared<BLE_Characteristic>(uuid, handle,
+                                                                   BENCHMARK_GATTS_IF, service,
+                                                                   ESP_GATT_CHAR_PROP_BIT_READ |
+                                                                   ESP_GATT_CHAR_PROP_BIT_WRITE);
+        characteristic->value_set<uint32_t>(i);
+        service->m_characteristics_uuid.insert(std::make_pair(uuid, characteristic));
+        service->m_characteristics_handle.insert(std::make_pair(handle, characteristic));
+    }
+
+    connection_t connection = {};
+    connection.mtu = MTU_DEFAULT_BLE_CLIENT;
+    server->m_connections.insert(std::make_pair(BENCHMARK_CONNECTION_ID, connection));
+
+    return server;
+}
+
+
+/***************************************************************************************************
+* Benchmarks
+***************************************************************************************************/
+void
+BLE_Benchmark::bench_dispatch(std::vector<result_t>& results)
+{
+    for (size_t table_size : BENCHMARK_TABLE_SIZES)
+    {
+        auto server = server_build(table_size);
+
+        // Target the last characteristic so that the lookup cost is not flattered by ordering.
+        esp_ble_gatts_cb_param_t param = {};
+        param.read.conn_id = BENCHMARK_CONNECTION_ID;
+        param.read.handle = BENCHMARK_SERVICE_HANDLE + (2 * table_size);
+        param.read.offset = 0;
+        param.read.is_long = false;
+        param.read.need_rsp = true;
+
+        results.push_back(measure("dispatch.read", {{"characteristics", table_size}}, [&](){
+            param.read.trans_id++;
+            server->event_handler_gatts(ESP_GATTS_READ_EVT, BENCHMARK_GATTS_IF, &param);
+        }));
+
+        std::array<uint8_t, sizeof(uint32_t)> data = {0x01, 0x02, 0x03, 0x04};
+        param = {};
+        param.write.conn_id = BENCHMARK_CONNECTION_ID;
+        param.write.handle = BENCHMARK_SERVICE_HANDLE + (2 * table_size);
+        param.write.need_rsp = false;
+        param.write.is_prep = false;
+        param.write.len = data.size();
+        param.write.value = data.data();
+
+        auto write = [&](){
+            param.write.trans_id++;
+            server->event_handler_gatts(ESP_GATTS_WRITE_EVT, BENCHMARK_GATTS_IF, &param);
+        };
+
+        results.push_back(measure("dispatch.write_no_rsp", {{"characteristics", table_size}},
+                                  write));
+        results.back().stack_bytes = stack_measure(write);
+
+        param.write.need_rsp = true;
+        results.push_back(measure("dispatch.write_rsp", {{"characteristics", table_size}}, write));
+        results.back().stack_bytes = stack_measure(write);
+
+        // Every prepare appends a chunk, the queue is dropped after each one so that the limits of
+        // the transaction manager are never reached and each call takes the buffering path.
+        auto cancel = [&](){
+            server->m_transactions.abort(BENCHMARK_CONNECTION_ID);
+        };
+
+        param.write.is_prep = true;
+        param.write.offset = 0;
+        results.push_back(measure("dispatch.write_prepare", {{"characteristics", table_size}},
+                                  write, cancel));
+        results.back().stack_bytes = stack_measure(write);
+        cancel();
+    }
+}
+
+
+void
+BLE_Benchmark::bench_value(std::vector<result_t>& results)
+{
+    BLE_Value value;
+    uint32_t counter = 0;
+
+    results.push_back(measure("value.set_u32", {}, [&](){
+        value.value_set<uint32_t>(counter++, BLE_Value::default_serializer<uint32_t>);
+    }));
+
+    results.push_back(measure("value.get_u32", {}, [&](){
+        benchmark_sink += value.value_get<uint32_t>(BLE_Value::default_deserializer<uint32_t>);
+    }));
+
+    results.push_back(measure("value.set_u64", {}, [&](){
+        value.value_set<uint64_t>(counter++, BLE_Value::default_serializer<uint64_t>);
+    }));
+
+    results.push_back(measure("value.get_u64", {}, [&](){
+        benchmark_sink += value.value_get<uint64_t>(BLE_Value::default_deserializer<uint64_t>);
+    }));
+}
+
+
+void
+BLE_Benchmark::bench_read_long(std::vector<result_t>& results)
+{
+    BLE_Value value;
+    value.from_raw(std::vector<uint8_t>(BENCHMARK_LONG_VALUE_LEN, 0xA5));
+
+    for (uint16_t mtu : BENCHMARK_MTUS)
+    {
+        size_t max_length = mtu - ATT_FIELD_LENGTH_OPCODE;
+
+        // One operation is a complete long read of the value, a Read Request followed by Read Blob
+        // Requests until a short chunk is returned.
+        results.push_back(measure("value.read_long", {{"mtu", mtu},
+                                                      {"length", BENCHMARK_LONG_VALUE_LEN}}, [&](){
+            std::array<uint8_t, ESP_GATT_MAX_ATTR_LEN> chunk;
+            size_t offset = 0;
+            size_t length;
+            do
+            {
+                length = value.read(offset, chunk.data(), max_length);
+                offset += length;
+                benchmark_sink += length;
+            } while (length == max_length);
+        }));
+    }
+}
+
+
+void
+BLE_Benchmark::bench_write_prepared(std::vector<result_t>& results)
+{
+    BLE_Value value;
+    BLE_Transaction_Manager transactions;
+    std::vector<uint8_t> data(BENCHMARK_LONG_VALUE_LEN, 0x5A);
+
+    for (uint16_t mtu : BENCHMARK_MTUS)
+    {
+        size_t chunk_length = mtu - ATT_FIELD_LENGTH_OPCODE - ATT_FIELD_LENGTH_PREPARE_WRITE_HEADER;
+
+        // One operation is a complete queued write of the value, from first prepare to execute.
+        results.push_back(measure("value.write_prepared", {{"mtu", mtu},
+                                                           {"length", data.size()}}, [&](){
+            for (size_t offset = 0; offset < data.size(); offset += chunk_length)
+            {
+                size_t length = std::min(chunk_length, data.size() - offset);
+                transactions.prepare(BENCHMARK_CONNECTION_ID, BENCHMARK_SERVICE_HANDLE + 2,
+                                     offset, data.data() + offset, length);
+            }
+            value.from_raw(*transactions.commit(BENCHMARK_CONNECTION_ID,
+                                                BENCHMARK_SERVICE_HANDLE + 2));
+        }));
+    }
+}
+
+
+void
+BLE_Benchmark::bench_uuid(std::vector<result_t>& results)
+{
+    const UUID uuid_16(static_cast<uint16_t>(0x180F));
+    const UUID uuid_128(absl::MakeUint128(0x6E400001B5A3F393, 0xE0A9E50E24DCCA9E));
+    std::hash<UUID> hasher;
+
+    results.push_back(measure("uuid.hash", {{"bits", 16}}, [&](){
+        benchmark_sink += hasher(uuid_16);
+    }));
+
+    results.push_back(measure("uuid.hash", {{"bits", 128}}, [&](){
+        benchmark_sink += hasher(uuid_128);
+    }));
+
+    results.push_back(measure("uuid.equal", {{"bits", 128}}, [&](){
+        benchmark_sink += (uuid_16 == uuid_128);
+    }));
+
+    results.push_back(measure("uuid.to_string", {{"bits", 128}}, [&](){
+        benchmark_sink += uuid_128.to_string().size();
+    }));
+}
+
+
+void
+BLE_Benchmark::bench_adv_data(std::vector<result_t>& results)
+{
+    for (size_t table_size : BENCHMARK_TABLE_SIZES)
+    {
+        auto server = server_build(table_size);
+        results.push_back(measure("server.adv_data_gen", {{"characteristics", table_size}}, [&](){
+            benchmark_sink += server->adv_data_gen().service_uuid_len;
+        }));
+    }
+}
+
+
+void
+BLE_Benchmark::bench_log(std::vector<result_t>& results)
+{
+    // A statement that is compiled in but rejected by the runtime level check.
+    esp_log_level_set(LOG_TAG_BLE_BENCHMARK, ESP_LOG_INFO);
+    results.push_back(measure("log.runtime_filtered", {}, [&](){
+        esp_log_write(ESP_LOG_DEBUG, LOG_TAG_BLE_BENCHMARK, "Value: %u", benchmark_sink);
+    }));
+
+    // The same statement above a compile-time threshold of 0, this should measure as an empty loop.
+    results.push_back(measure("log.elided", {}, [&](){
+        BLE_LOG(0, ESP_LOG_DEBUG, LOG_TAG_BLE_BENCHMARK, "%s", "", "Value: %u", benchmark_sink);
+        benchmark_sink++;
+    }));
+
+    // The hand-off cost of a deferred statement, a record is queued and drained by the consumer.
+    static BLE_Queue<BLE_Deferred_Log::record_t, 64> queue;
+    results.push_back(measure("log.deferred_record", {}, [&](){
+        BLE_Deferred_Log::record_t record = {LOG_TAG_BLE_BENCHMARK, "Value: %u",
+                                             esp_log_timestamp(), ESP_LOG_DEBUG,
+                                             {benchmark_sink}};
+        queue.push(record);
+        queue.pop(record);
+        benchmark_sink += record.args[0];
+    }));
+}
+
+
+void
+BLE_Benchmark::bench_timeseries(std::vector<result_t>& results)
+{
+    // A slowly drifting three axis signal with noise, close to what an IMU sampled at 100 Hz
+    // produces. Recorded traces are measured on the host with tools/ble_timeseries_bench.cpp.
+    uint32_t state = 1;
+    auto sample_next = [&state](uint32_t i){
+        state = state * 1103515245 + 12345;
+        int32_t noise = static_cast<int32_t>((state >> 16) & 0x0F) - 8;
+        return timeseries_sample_t{i * 10, {static_cast<int32_t>(i % 2000) + noise,
+                                            -static_cast<int32_t>(i % 700), 16384 + noise}};
+    };
+
+    for (uint16_t mtu : BENCHMARK_MTUS)
+    {
+        size_t capacity = mtu - ATT_FIELD_LENGTH_OPCODE - sizeof(uint16_t);
+        BLE_TimeSeries_Packer packer(3);
+
+        // The packing efficiency over a fixed trace, reported alongside the timing.
+        size_t packets = 0;
+        size_t bytes = 0;
+        constexpr const uint32_t trace_length = 1000;
+        packer.begin(capacity, 0);
+        for (uint32_t i = 0; i < trace_length; i++)
+        {
+            timeseries_sample_t sample = sample_next(i);
+            if (packer.append(sample))
+                continue;
+
+            bytes += packer.length();
+            packets++;
+            packer.begin(capacity, packets);
+            packer.append(sample);
+        }
+
+        bytes += packer.length();
+        packets++;
+
+        uint32_t i = 0;
+        packer.begin(capacity, 0);
+        results.push_back(measure("timeseries.pack",
+                                  {{"mtu", mtu}, {"channels", 3},
+                                   {"samples_per_packet", trace_length / packets},
+                                   {"compression_pct",
+                                    (trace_length * packer.sample_length() * 100) / bytes}},
+                                  [&](){
+            timeseries_sample_t sample = sample_next(i++);
+            if (!packer.append(sample))
+            {
+                benchmark_sink += packer.length();
+                packer.begin(capacity, 0);
+                packer.append(sample);
+            }
+        }));
+    }
+}
+
+
+/***************************************************************************************************
+* Benchmark Suite
+***************************************************************************************************/
+/**
+ * @brief Runs every benchmark in the suite.
+ * @note Calls into the BLE stack (responses, service start) are made against handles that the
+ *       stack does not know about. For stack independent numbers run the suite before
+ *       BLE_Server::server_start.
+ * @return The results of each benchmark in a stable order.
+ */
+std::vector<BLE_Benchmark::result_t>
+BLE_Benchmark::run(void)
+{
+    std::vector<result_t> results;
+    bench_dispatch(results);
+    bench_value(results);
+    bench_read_long(results);
+    bench_write_prepared(results);
+    bench_uuid(results);
+    bench_adv_data(results);
+    bench_log(results);
+    bench_timeseries(results);
+
+    return results;
+}
+
+
+/**
+ * @brief Writes a set of benchmark results as JSON.
+ * @param [in] results The results to be written.
+ * @param [in] out (default=stdout) The stream to write to, stdout is routed to the UART console.
+ */
+void
+BLE_Benchmark::report_json(const std::vector<result_t>& results, FILE* out)
+{
+    fprintf(out, "{\"format\":\"esp32-ble-redux-benchmark\",\"version\":%" PRIu32 ",\"results\":[",
+            BLE_BENCHMARK_FORMAT_VERSION);
+
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const result_t& result = results[i];
+        fprintf(out, "%s\n{\"name\":\"%s\",\"params\":{", i ? "," : "", result.name.c_str());
+        for (size_t j = 0; j < result.params.size(); j++)
+            fprintf(out, "%s\"%s\":%" PRId64, j ? "," : "", result.params[j].first.c_str(),
+                                              result.params[j].second);
+
+        int64_t ns_per_op = result.iterations ? (result.total_us * 1000) / result.iterations : 0;
+        fprintf(out, "},\"iterations\":%" PRIu32 ",\"total_us\":%" PRId64 ",\"ns_per_op\":%" PRId64,
+                result.iterations, result.total_us, ns_per_op);
+#ifdef CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ
+        // The CPU runs at a fixed frequency unless dynamic frequency scaling is enabled.
+        fprintf(out, ",\"cycles_per_op\":%" PRId64,
+                (ns_per_op * CONFIG_ESP32_DEFAULT_CPU_FREQ_MHZ) / 1000);
+#endif
+        if (result.stack_bytes)
+            fprintf(out, ",\"stack_bytes\":%" PRIu32, result.stack_bytes);
+#ifdef CONFIG_BLE_REDUX_ALLOCATION_AUDIT
+        fprintf(out, ",\"allocations\":%" PRIu32, result.allocations);
+#endif
+        fprintf(out, "}");
+    }
+
+    fprintf(out, "\n]}\n");
+    fflush(out);
+}
+
+};
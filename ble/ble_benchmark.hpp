@@ -0,0 +1,101 @@
+/**
+ * @file   ble_benchmark.hpp
+ *
+ * @brief  Micro-benchmark suite for the library's hot paths.
+ * @detail The suite builds a private GATT table (profile, service and characteristics) that is not
+ *         registered with the BLE stack and drives synthetic events through it. Results are
+ *         emitted as JSON with a fixed key order so that they can be diffed across releases.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_BENCHMARK_HPP
+#define COMPONENTS_BLE_BLE_BENCHMARK_HPP
+
+#include <cstdint>
+#include <cstdio>
+#include <functional>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace BLE
+{
+
+class BLE_Server;
+
+
+class BLE_Benchmark
+{
+public:
+    static constexpr const uint32_t BLE_BENCHMARK_FORMAT_VERSION = 1;
+
+    struct result_t
+    {
+        std::string                                     name;
+        std::vector<std::pair<std::string, int64_t>>    params;
+        uint32_t                                        iterations;
+        int64_t                                         total_us;
+        // Only counted when CONFIG_BLE_REDUX_ALLOCATION_AUDIT is enabled.
+        uint32_t                                        allocations;
+        // The peak stack usage of a single operation, 0 if it was not measured.
+        uint32_t                                        stack_bytes;
+    };
+
+
+    /**
+     * @brief Creates a benchmark suite.
+     * @param [in] iterations (default=2000) The number of times each measured operation is
+     *                                      repeated.
+     */
+    explicit BLE_Benchmark(uint32_t iterations=2000) : m_iterations(iterations) {}
+
+    /**
+     * @brief Runs every benchmark in the suite.
+     * @note Calls into the BLE stack (responses, service start) are made against handles that the
+     *       stack does not know about. For stack independent numbers run the suite before
+     *       BLE_Server::server_start.
+     * @return The results of each benchmark in a stable order.
+     */
+    std::vector<result_t> run(void);
+
+    /**
+     * @brief Writes a set of benchmark results as JSON.
+     * @param [in] results The results to be written.
+     * @param [in] out (default=stdout) The stream to write to, stdout is routed to the UART console.
+     */
+    static void report_json(const std::vector<result_t>& results, FILE* out=stdout);
+
+private:
+    template<typename F>
+    result_t measure(std::string name, std::vector<std::pair<std::string, int64_t>> params,
+                     F op);
+
+    template<typename F, typename R>
+    result_t measure(std::string name, std::vector<std::pair<std::string, int64_t>> params,
+                     F op, R reset);
+
+    uint32_t stack_measure(std::function<void()> op);
+
+    std::shared_ptr<BLE_Server> server_build(size_t characteristic_count);
+
+    void bench_dispatch(std::vector<result_t>& results);
+    void bench_value(std::vector<result_t>& results);
+    void bench_read_long(std::vector<result_t>& results);
+    void bench_write_prepared(std::vector<result_t>& results);
+    void bench_uuid(std::vector<result_t>& results);
+    void bench_adv_data(std::vector<result_t>& results);
+    void bench_log(std::vector<result_t>& results);
+    void bench_timeseries(std::vector<result_t>& results);
+
+    const uint32_t m_iterations;
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_BENCHMARK_HPP
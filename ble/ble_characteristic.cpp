@@ -10,34 +10,53 @@
  *            License, v. 2.0. If a copy of the MPL was not distributed with this
  *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
  * @TODO Add event system
- * @TODO Add notify
- * @TODO Add indicate
- * @TODO Add descriptors
+ * @TODO Add descriptors other than the Client Characteristic Configuration
  * @TODO Move some LOGEs to throws
  */
 
+#include <algorithm>
 #include <cstdint>
+#include <optional>
 #include <utility>
+#include <vector>
 
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "utilities.hpp"
 
+#include "ble_allocation.hpp"
 #include "ble_characteristic.hpp"
 #include "ble_profile.hpp"
 #include "ble_service.hpp"
 #include "ble_server.hpp"
+#include "ble_log.hpp"
+#include "ble_trace.hpp"
 #include "ble_utilities.hpp"
 
 namespace BLE
 {
 
+using Utilities::AnchorSemaphore;
+
+
 constexpr const char* LOG_TAG_BLE_CHARACTERISTIC = "BLE Characteristic";
 
 /***************************************************************************************************
 * Logging Macros
 ***************************************************************************************************/
+#define CHARACTERISTIC_LOG_LEVEL CONFIG_BLE_REDUX_LOG_LEVEL_CHARACTERISTIC
+
 #define CHARACTERISTIC_LOG(LVL, MSG, ...)\
-    INTANCE_LOG(LVL, LOG_TAG_BLE_CHARACTERISTIC, "%04X --", this->handle, MSG, ##__VA_ARGS__)
+    BLE_LOG(CHARACTERISTIC_LOG_LEVEL, LVL, LOG_TAG_BLE_CHARACTERISTIC, "%04X --", this->handle,\
+            MSG, ##__VA_ARGS__)
+
+#ifdef CONFIG_BLE_REDUX_LOG_DEFERRED
+#define CHARACTERISTIC_LOG_DEFERRED(LVL, MSG, ...)\
+    BLE_LOG_DEFERRED(CHARACTERISTIC_LOG_LEVEL, LVL, LOG_TAG_BLE_CHARACTERISTIC,\
+                     "%04X -- " MSG, this->handle, ##__VA_ARGS__)
+#else
+#define CHARACTERISTIC_LOG_DEFERRED(LVL, MSG, ...) CHARACTERISTIC_LOG(LVL, MSG, ##__VA_ARGS__)
+#endif
 
 #define CHARACTERISTIC_LOGE(MSG, ...) CHARACTERISTIC_LOG(ESP_LOG_ERROR, MSG, ##__VA_ARGS__)
 #define CHARACTERISTIC_LOGW(MSG, ...) CHARACTERISTIC_LOG(ESP_LOG_WARN, MSG, ##__VA_ARGS__)
@@ -45,6 +64,11 @@ constexpr const char* LOG_TAG_BLE_CHARACTERISTIC = "BLE Characteristic";
 #define CHARACTERISTIC_LOGD(MSG, ...) CHARACTERISTIC_LOG(ESP_LOG_DEBUG, MSG, ##__VA_ARGS__)
 #define CHARACTERISTIC_LOGV(MSG, ...) CHARACTERISTIC_LOG(ESP_LOG_VERBOSE, MSG, ##__VA_ARGS__)
 
+#define CHARACTERISTIC_LOGD_DEFERRED(MSG, ...)\
+    CHARACTERISTIC_LOG_DEFERRED(ESP_LOG_DEBUG, MSG, ##__VA_ARGS__)
+#define CHARACTERISTIC_LOGV_DEFERRED(MSG, ...)\
+    CHARACTERISTIC_LOG_DEFERRED(ESP_LOG_VERBOSE, MSG, ##__VA_ARGS__)
+
 
 /***************************************************************************************************
 * Characteristic Member Functions
@@ -62,6 +86,21 @@ BLE_Characteristic::callback_write_set(BLE_Characteristic::RW_Callback callback)
 }
 
 
+/**
+ * @brief Sets a callback function receiving the raw value of every write.
+ * @detail While set, written values are handed to the callback in place instead of being stored in
+ *         the characteristic, and the write callback is not executed. Suited to streams where each
+ *         write is consumed once. Prepared writes are unaffected.
+ * @param callback A callback function of type Write_Raw_Callback, nullptr restores storing.
+ * @note This function will be executed before the response to the device is sent.
+ */
+void
+BLE_Characteristic::callback_write_raw_set(BLE_Characteristic::Write_Raw_Callback callback)
+{
+    m_callback_write_raw = callback;
+}
+
+
 /**
  * @brief Sets a callback function to be executed whenever a read operation is completed.
  * @param callback A callback function of type RW_Callback that will be executed;
@@ -74,6 +113,239 @@ BLE_Characteristic::callback_read_set(BLE_Characteristic::RW_Callback callback)
 }
 
 
+/**
+ * @brief Enables or disables request-to-response latency tracking.
+ * @detail When enabled, the time from the arrival of a GATTS event at the server to the response
+ *         being handed to the stack is recorded in a histogram per operation. Requests which do
+ *         not require a response are measured until their handling completes.
+ * @note The histograms are allocated the first time tracking is enabled and retained after.
+ * @param [in] enabled Whether latencies should be recorded.
+ */
+void
+BLE_Characteristic::latency_tracking_set(bool enabled)
+{
+    // The histograms are never released so that the BT task cannot observe a dangling pointer.
+    if (enabled && !m_latency)
+        m_latency = std::make_unique<Latency_Histograms>();
+
+    m_latency_enabled.store(enabled, std::memory_order_release);
+}
+
+
+/**
+ * @brief Retrieves the recorded latencies for an operation.
+ * @param [in] operation The operation of interest.
+ * @param [in] reset (default=false) Clears the histogram once it has been captured.
+ * @return A snapshot of the latency histogram or std::nullopt if tracking was never enabled.
+ */
+std::optional<BLE_Latency_Histogram::snapshot_t>
+BLE_Characteristic::latency_snapshot(Operation operation, bool reset)
+{
+    if (!m_latency)
+        return {};
+
+    return m_latency->at(static_cast<size_t>(operation)).snapshot(reset);
+}
+
+
+/**
+ * @brief Sends the current value to every client subscribed to this characteristic.
+ * @detail Clients that enabled indications are indicated, all others are notified. The value is
+ *         truncated to fit the MTU of each connection.
+ * @note This function is thread safe.
+ * @return The number of clients the value was sent to.
+ */
+size_t
+BLE_Characteristic::notify(void)
+{
+    BLE_ALLOCATION_SCOPE(NOTIFY);
+
+    auto server = server_get();
+    if (!server)
+        return 0;
+
+    size_t sent = 0;
+    AnchorSemaphore anchor(m_subscriptions_semaphore);
+    AnchorSemaphore value_anchor(m_value_semaphore);
+    for (auto& subscription : m_subscriptions)
+    {
+        auto connection = server->connection_get(subscription.first);
+        if (!connection)
+            continue;
+
+        // Notifications and indications carry the opcode and the handle ahead of the value.
+        size_t length = std::min<size_t>(m_value.size(),
+                                         connection->mtu - ATT_FIELD_LENGTH_OPCODE -
+                                         sizeof(uint16_t));
+        bool indicate = subscription.second & CONFIGURATION_INDICATE;
+
+        // The stack copies the value before the call returns.
+        esp_err_t err = esp_ble_gatts_send_indicate(gatts_if, subscription.first, handle, length,
+                                                    const_cast<uint8_t*>(m_value.data()),
+                                                    indicate);
+        if (err)
+            CHARACTERISTIC_LOGE("Notification to 0x%04X failed: %s (%d)", subscription.first,
+                                esp_err_to_name(err), err);
+        else
+            sent++;
+    }
+
+    return sent;
+}
+
+
+/**
+ * @brief Sends a value to a single subscribed client without storing it in the characteristic.
+ * @detail The client is indicated if it enabled indications and notified otherwise. Unlike notify,
+ *         a value longer than the MTU allows is refused rather than truncated.
+ * @note This function is thread safe.
+ * @param [in] connection_id The connection of the client.
+ * @param [in] data The value to send, the stack copies it before the call returns.
+ * @param [in] length The length of the value.
+ * @param [in] quiet (default=false) Does not log a value the stack refused, for callers which count
+ *             failures themselves or whose own output is being streamed.
+ * @return True if the value was handed to the stack, false if the client is not subscribed, the
+ *         value does not fit or the stack refused it.
+ */
+bool
+BLE_Characteristic::notify(uint16_t connection_id, const uint8_t* data, size_t length, bool quiet)
+{
+    BLE_ALLOCATION_SCOPE(NOTIFY);
+
+    uint16_t configuration = subscription_get(connection_id);
+    if (!configuration)
+        return false;
+
+    auto server = server_get();
+    auto connection = server ? server->connection_get(connection_id) : std::nullopt;
+    if (!connection ||
+        (length + ATT_FIELD_LENGTH_OPCODE + sizeof(uint16_t) > connection->mtu))
+        return false;
+
+    esp_err_t err = esp_ble_gatts_send_indicate(gatts_if, connection_id, handle, length,
+                                                const_cast<uint8_t*>(data),
+                                                configuration & CONFIGURATION_INDICATE);
+    if (err)
+    {
+        if (!quiet)
+            CHARACTERISTIC_LOGE("Notification to 0x%04X failed: %s (%d)", connection_id,
+                                esp_err_to_name(err), err);
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Retrieves the Client Characteristic Configuration of a connection.
+ * @note This function is thread safe.
+ * @param [in] connection_id The connection of interest.
+ * @return The configuration written by the client, 0 if it is not subscribed.
+ */
+uint16_t
+BLE_Characteristic::subscription_get(uint16_t connection_id)
+{
+    AnchorSemaphore anchor(m_subscriptions_semaphore);
+    auto subscription = m_subscriptions.find(connection_id);
+    return subscription != m_subscriptions.end() ? subscription->second : 0;
+}
+
+
+/**
+ * @brief Retrieves the connections subscribed to this characteristic.
+ * @note This function is thread safe.
+ * @return The IDs of the connections that enabled notifications or indications.
+ */
+std::vector<uint16_t>
+BLE_Characteristic::subscribers_get(void)
+{
+    std::vector<uint16_t> subscribers;
+    AnchorSemaphore anchor(m_subscriptions_semaphore);
+    subscribers.reserve(m_subscriptions.size());
+    for (auto& subscription : m_subscriptions)
+        subscribers.push_back(subscription.first);
+
+    return subscribers;
+}
+
+
+/**
+ * @brief Computes the longest value a notification can carry to a client.
+ * @note This function is thread safe.
+ * @param [in] connection_id The connection of the client.
+ * @return The length allowed by the MTU of the connection, or by the default MTU if it is unknown,
+ *         at most ATT_ATTRIBUTE_LENGTH_MAX.
+ */
+size_t
+BLE_Characteristic::notification_capacity_get(uint16_t connection_id) const
+{
+    auto server = server_get();
+    auto connection = server ? server->connection_get(connection_id) : std::nullopt;
+    size_t mtu = connection ? connection->mtu : MTU_DEFAULT_BLE_CLIENT;
+
+    // Notifications carry the opcode and the handle ahead of the value.
+    return std::min(mtu - ATT_FIELD_LENGTH_OPCODE - sizeof(uint16_t), ATT_ATTRIBUTE_LENGTH_MAX);
+}
+
+
+/**
+ * @brief Computes the longest value a notification can carry to every one of a set of clients.
+ * @note This function is thread safe.
+ * @param [in] connection_ids The connections of the clients, unknown ones are skipped.
+ * @return The length allowed by the smallest MTU among the connections, at most
+ *         ATT_ATTRIBUTE_LENGTH_MAX.
+ */
+size_t
+BLE_Characteristic::notification_capacity_get(const std::vector<uint16_t>& connection_ids) const
+{
+    auto server = server_get();
+    if (!server)
+        return MTU_DEFAULT_BLE_CLIENT - ATT_FIELD_LENGTH_OPCODE - sizeof(uint16_t);
+
+    size_t capacity = ATT_ATTRIBUTE_LENGTH_MAX;
+    for (uint16_t connection_id : connection_ids)
+    {
+        auto connection = server->connection_get(connection_id);
+        if (connection)
+            capacity = std::min<size_t>(capacity, connection->mtu - ATT_FIELD_LENGTH_OPCODE -
+                                                  sizeof(uint16_t));
+    }
+
+    return capacity;
+}
+
+
+void
+BLE_Characteristic::subscription_set(uint16_t connection_id, uint16_t configuration)
+{
+    AnchorSemaphore anchor(m_subscriptions_semaphore);
+    if (configuration)
+        m_subscriptions[connection_id] = configuration;
+    else
+        m_subscriptions.erase(connection_id);
+}
+
+
+void
+BLE_Characteristic::subscription_clear(uint16_t connection_id)
+{
+    subscription_set(connection_id, 0);
+}
+
+
+inline
+void
+BLE_Characteristic::latency_record(Operation operation)
+{
+    if (!m_latency_enabled.load(std::memory_order_acquire))
+        return;
+
+    int64_t latency = esp_timer_get_time() - BLE_Server::event_timestamp_get();
+    (*m_latency)[static_cast<size_t>(operation)].record(static_cast<uint32_t>(latency));
+}
+
+
 /***************************************************************************************************
 * Event Handling
 ***************************************************************************************************/
@@ -87,64 +359,152 @@ BLE_Characteristic::handle_request_write(const esp_ble_gatts_cb_param_t::gatts_w
     if (param.handle != handle)
         return;
 
-    CHARACTERISTIC_LOGD("Write ID from: %04X, transaction: %d%s",
-                        param.conn_id,
-                        param.trans_id,
-                        param.is_prep ? " (prep)" : "");
-
-    ESP_LOG_BUFFER_HEXDUMP(LOG_TAG_BLE_CHARACTERISTIC, param.value, param.len, ESP_LOG_DEBUG);
-
-    // Only start a transaction if this is not a preparation request or if we got the first chunk
-    // of a preparation request.
-    if (!param.is_prep || param.offset == 0)
-        m_value.transaction_write_start(param.conn_id);
+    BLE_TRACE_SCOPE(ESP_GATTS_WRITE_EVT, handle, param.conn_id, param.trans_id);
+    BLE_ALLOCATION_SCOPE_DYNAMIC(param.is_prep ? BLE_Allocation_Audit::Scope::PREPARED_WRITE
+                                               : BLE_Allocation_Audit::Scope::WRITE);
+    CHARACTERISTIC_LOGD_DEFERRED("Write ID from: %04X, transaction: %u prep: %d",
+                                 param.conn_id,
+                                 param.trans_id,
+                                 param.is_prep);
 
-    m_value.transaction_write_add(param.conn_id,
-                            std::vector<uint8_t>(param.value, param.value + param.len));
+    if constexpr (BLE_LOG_ENABLED(CHARACTERISTIC_LOG_LEVEL, ESP_LOG_DEBUG))
+        ESP_LOG_BUFFER_HEXDUMP(LOG_TAG_BLE_CHARACTERISTIC, param.value, param.len, ESP_LOG_DEBUG);
 
-    // Preparation transactions go through the ESP_GATTS_EXEC_WRITE_EVT to commit.
-    if (!param.is_prep)
+    // Under auto response the stack queues and executes prepared writes itself, the value is read
+    // back once the server sees the Execute Write Request.
+    if (param.is_prep)
     {
-        m_value.transaction_write_commit(param.conn_id);
-        if (m_callback_write)
-            m_callback_write();
+        if (!auto_response)
+            handle_request_prepare_write(param);
+        else if (std::find(m_stack_prepared.begin(), m_stack_prepared.end(),
+                           param.conn_id) == m_stack_prepared.end())
+            m_stack_prepared.push_back(param.conn_id);
     }
-
-    if (param.need_rsp)
+    else
     {
-        esp_gatt_rsp_t response;
-        response.attr_value.len = param.len;
-        response.attr_value.handle = handle;
-        response.attr_value.offset = param.offset;
-        response.attr_value.auth_req = ESP_GATT_AUTH_REQ_NONE;
-        memcpy(response.attr_value.value, param.value, param.len);
-
-        esp_err_t err = esp_ble_gatts_send_response(gatts_if, param.conn_id, param.trans_id,
-                                                    ESP_GATT_OK, &response);
-        if (err)
-            CHARACTERISTIC_LOGE("Write response failed: %s (%d)", esp_err_to_name(err), err);
+        if (m_callback_write_raw)
+        {
+            m_callback_write_raw(param.conn_id, param.value, param.len);
+        }
+        else
+        {
+            {
+                AnchorSemaphore anchor(m_value_semaphore);
+                m_value.from_raw(param.value, param.len);
+            }
+
+            if (m_callback_write)
+                m_callback_write();
+        }
+
+        // An ATT Write Response carries no parameters, so no response body is built.
+        if (param.need_rsp)
+        {
+            esp_err_t err = esp_ble_gatts_send_response(gatts_if, param.conn_id, param.trans_id,
+                                                        ESP_GATT_OK, nullptr);
+            BLE_TRACE(RESPONSE_SENT, ESP_GATTS_WRITE_EVT, handle, param.conn_id, err);
+            if (err)
+                CHARACTERISTIC_LOGE("Write response failed: %s (%d)", esp_err_to_name(err), err);
+        }
     }
+
+    latency_record(Operation::WRITE);
 }
 
 
-inline
+// Kept out of line so that the response buffer, which is larger than the largest attribute, only
+// occupies the stack while handling Prepare Write Requests.
+__attribute__((noinline))
 void
-BLE_Characteristic::handle_request_exec_write(const esp_ble_gatts_cb_param_t::gatts_exec_write_evt_param& param)
+BLE_Characteristic::handle_request_prepare_write(
+    const esp_ble_gatts_cb_param_t::gatts_write_evt_param& param)
 {
-    // TODO Check BDA and Conn ID
-    // TODO Error checking on transactions
-    CHARACTERISTIC_LOGI("GATT_EXEC_WRITE_EVT, conn_id %d, trans_id %d\n",
-                        param.conn_id,
-                        param.trans_id);
-    m_value.transaction_write_commit(param.conn_id);
+    // Prepared writes are buffered by the server until the ESP_GATTS_EXEC_WRITE_EVT commits them.
+    auto server = server_get();
+    esp_gatt_status_t status = ESP_GATT_INTERNAL_ERROR;
+    if (server)
+        status = server->m_transactions.prepare(param.conn_id, handle, param.offset, param.value,
+                                                param.len);
+
+    if (!param.need_rsp)
+        return;
+
+    // An ATT Prepare Write Response echoes the handle, offset and value of the request.
+    esp_gatt_rsp_t response;
+    response.attr_value.len = param.len;
+    response.attr_value.handle = handle;
+    response.attr_value.offset = param.offset;
+    response.attr_value.auth_req = ESP_GATT_AUTH_REQ_NONE;
+    memcpy(response.attr_value.value, param.value, param.len);
+
+    esp_err_t err = esp_ble_gatts_send_response(gatts_if, param.conn_id, param.trans_id, status,
+                                                &response);
+    BLE_TRACE(RESPONSE_SENT, ESP_GATTS_WRITE_EVT, handle, param.conn_id, err);
+    if (err)
+        CHARACTERISTIC_LOGE("Prepare write response failed: %s (%d)", esp_err_to_name(err), err);
+}
+
+
+std::shared_ptr<BLE_Server>
+BLE_Characteristic::server_get(void) const
+{
+    auto service_instance = service.lock();
+    auto profile_instance = service_instance ? service_instance->profile.lock() : nullptr;
+    return profile_instance ? profile_instance->server.lock() : nullptr;
+}
+
 
+void
+BLE_Characteristic::value_mirror(void)
+{
+    esp_err_t err = esp_ble_gatts_set_attr_value(handle, m_value.size(), m_value.data());
+    if (err)
+        CHARACTERISTIC_LOGE("Attribute value update failed: %s (%d)", esp_err_to_name(err), err);
+}
+
+
+void
+BLE_Characteristic::handle_exec_write_apply(std::vector<uint8_t> value)
+{
+    AnchorSemaphore anchor(m_value_semaphore);
+    m_value.from_raw(std::move(value));
+}
+
+
+void
+BLE_Characteristic::handle_exec_write_complete(void)
+{
     if (m_callback_write)
         m_callback_write();
+}
+
+
+bool
+BLE_Characteristic::stack_prepared_take(uint16_t connection_id)
+{
+    auto connection = std::find(m_stack_prepared.begin(), m_stack_prepared.end(), connection_id);
+    if (connection == m_stack_prepared.end())
+        return false;
+
+    m_stack_prepared.erase(connection);
+    return true;
+}
+
 
-    esp_err_t err = esp_ble_gatts_send_response(gatts_if, param.conn_id, param.trans_id,
-                                                ESP_GATT_OK, nullptr);
+void
+BLE_Characteristic::handle_exec_write_pull(void)
+{
+    uint16_t length = 0;
+    const uint8_t* value = nullptr;
+    esp_err_t err = esp_ble_gatts_get_attr_value(handle, &length, &value);
     if (err)
-        CHARACTERISTIC_LOGE("Write exec response failed: %s (%d)", esp_err_to_name(err), err);
+    {
+        CHARACTERISTIC_LOGE("Attribute value read back failed: %s (%d)", esp_err_to_name(err), err);
+        return;
+    }
+
+    AnchorSemaphore anchor(m_value_semaphore);
+    m_value.from_raw(value, length);
 }
 
 
@@ -155,40 +515,145 @@ BLE_Characteristic::handle_request_read(const esp_ble_gatts_cb_param_t::gatts_re
     if (param.handle != handle)
         return;
 
-    CHARACTERISTIC_LOGD("Read ID from: %04X, transaction: %d offt:%d rsp:%d%s",
-                        param.conn_id,
-                        param.trans_id,
-                        param.offset,
-                        param.need_rsp,
-                        param.is_long ? " (long)" : "");
+    BLE_TRACE_SCOPE(ESP_GATTS_READ_EVT, handle, param.conn_id, param.trans_id);
+    BLE_ALLOCATION_SCOPE(READ);
+    CHARACTERISTIC_LOGD_DEFERRED("Read ID from: %04X, transaction: %u offt:%d rsp:%d long:%d",
+                                 param.conn_id,
+                                 param.trans_id,
+                                 param.offset,
+                                 param.need_rsp,
+                                 param.is_long);
 
     if (!param.need_rsp)
         return;
 
+    esp_gatt_rsp_t response;
+    response.attr_value.handle = handle;
+    response.attr_value.offset = param.offset;
+    response.attr_value.auth_req = ESP_GATT_AUTH_REQ_NONE;
+    response.attr_value.len = 0;
+
+    // Reads are served straight from the offset in the request, a Read Blob Request that is
+    // retried or abandoned by the client leaves no state behind.
+    auto server = server_get();
+    auto info = server ? server->connection_get(param.conn_id) : std::nullopt;
+
+    esp_gatt_status_t status = ESP_GATT_OK;
+    size_t max_size = info ? std::min<size_t>(info->mtu - ATT_FIELD_LENGTH_OPCODE,
+                                              ESP_GATT_MAX_ATTR_LEN)
+                           : 0;
+    if (!info)
+    {
+        status = ESP_GATT_INTERNAL_ERROR;
+    }
+    else
+    {
+        AnchorSemaphore anchor(m_value_semaphore);
+        if (param.offset > m_value.size())
+            status = ESP_GATT_INVALID_OFFSET;
+        else
+            response.attr_value.len = m_value.read(param.offset, response.attr_value.value,
+                                                   max_size);
+    }
 
-    // As mentioned in a post the is_long will inform us if this is an existing transaction
-    if (!param.is_long)
-         m_value.transaction_read_start(param.conn_id);
+    // A chunk shorter than the MTU allows tells the client that the value has been read in full.
+    if ((status == ESP_GATT_OK) && (response.attr_value.len < max_size) && m_callback_read)
+        m_callback_read();
 
-    // TODO Error checking
-    auto info = service.lock()->profile.lock()->server.lock()->connection_get(param.conn_id);
-    auto max_size = info->mtu - ATT_FIELD_LENGTH_OPCODE;
+    esp_err_t err = esp_ble_gatts_send_response(gatts_if,
+            param.conn_id,
+            param.trans_id,
+            status, &response);
+    BLE_TRACE(RESPONSE_SENT, ESP_GATTS_READ_EVT, handle, param.conn_id, err);
+    latency_record(Operation::READ);
+}
 
-    std::vector<uint8_t> data = m_value.transaction_read_advance(param.conn_id, max_size);
-    if (data.size() < max_size)
+
+void
+BLE_Characteristic::handle_descriptor_read(const esp_ble_gatts_cb_param_t::gatts_read_evt_param& param)
+{
+    if (!param.need_rsp)
+        return;
+
+    uint16_t configuration = subscription_get(param.conn_id);
+
+    esp_gatt_rsp_t response;
+    response.attr_value.handle = m_configuration_handle;
+    response.attr_value.offset = param.offset;
+    response.attr_value.auth_req = ESP_GATT_AUTH_REQ_NONE;
+    response.attr_value.len = 0;
+
+    esp_gatt_status_t status = ESP_GATT_OK;
+    if (param.offset > sizeof(configuration))
     {
-        m_value.transaction_read_abort(param.conn_id);
-        if (m_callback_read)
-            m_callback_read();
+        status = ESP_GATT_INVALID_OFFSET;
+    }
+    else
+    {
+        std::array<uint8_t, 2> value = {static_cast<uint8_t>(configuration & 0xFF),
+                                        static_cast<uint8_t>(configuration >> 8)};
+        response.attr_value.len = value.size() - param.offset;
+        std::copy(value.begin() + param.offset, value.end(), response.attr_value.value);
     }
 
-    esp_gatt_rsp_t response;
-    response.attr_value.len = data.size();
-    std::copy(data.begin(), data.end(), response.attr_value.value);
-    esp_ble_gatts_send_response(gatts_if,
-            param.conn_id,
-            param.trans_id,
-            ESP_GATT_OK, &response);
+    esp_err_t err = esp_ble_gatts_send_response(gatts_if, param.conn_id, param.trans_id, status,
+                                                &response);
+    if (err)
+        CHARACTERISTIC_LOGE("Descriptor read response failed: %s (%d)", esp_err_to_name(err), err);
+}
+
+
+void
+BLE_Characteristic::handle_descriptor_write(
+    const esp_ble_gatts_cb_param_t::gatts_write_evt_param& param)
+{
+    // Only the bits backed by a property of the characteristic may be set.
+    uint16_t permitted = 0;
+    if (properties & ESP_GATT_CHAR_PROP_BIT_NOTIFY)
+        permitted |= CONFIGURATION_NOTIFY;
+    if (properties & ESP_GATT_CHAR_PROP_BIT_INDICATE)
+        permitted |= CONFIGURATION_INDICATE;
+
+    esp_gatt_status_t status = ESP_GATT_OK;
+    uint16_t configuration = 0;
+    if (param.is_prep)
+    {
+        status = ESP_GATT_REQ_NOT_SUPPORTED;
+    }
+    else if ((param.offset != 0) || (param.len != sizeof(configuration)))
+    {
+        status = ESP_GATT_INVALID_ATTR_LEN;
+    }
+    else
+    {
+        configuration = param.value[0] | (param.value[1] << 8);
+        if (configuration & ~permitted)
+            status = ESP_GATT_CCC_CFG_ERR;
+    }
+
+    if (status == ESP_GATT_OK)
+    {
+        subscription_set(param.conn_id, configuration);
+        CHARACTERISTIC_LOGI("Connection 0x%04X configuration: 0x%04X", param.conn_id,
+                            configuration);
+    }
+
+    if (param.need_rsp)
+    {
+        esp_err_t err = esp_ble_gatts_send_response(gatts_if, param.conn_id, param.trans_id,
+                                                    status, nullptr);
+        if (err)
+            CHARACTERISTIC_LOGE("Descriptor write response failed: %s (%d)", esp_err_to_name(err),
+                                err);
+    }
+
+    // Bonded peers keep their subscriptions across connections.
+    if (status == ESP_GATT_OK)
+    {
+        auto server = server_get();
+        if (server)
+            server->peer_state_save(param.conn_id);
+    }
 }
 
 
@@ -197,7 +662,7 @@ BLE_Characteristic::characteristic_event_handler_gatts(esp_gatts_cb_event_t even
                                                        esp_gatt_if_t gatts_if,
                                                        esp_ble_gatts_cb_param_t *param)
 {
-    CHARACTERISTIC_LOGV("GATTS event = %d, inf = 0x%04X", event, gatts_if);
+    CHARACTERISTIC_LOGV_DEFERRED("GATTS event = %d, inf = 0x%04X", event, gatts_if);
     if (gatts_if != this->gatts_if)
     {
         CHARACTERISTIC_LOGE("Invalid inf received: %x %x", this->gatts_if, gatts_if);
@@ -209,18 +674,20 @@ BLE_Characteristic::characteristic_event_handler_gatts(esp_gatts_cb_event_t even
         case ESP_GATTS_READ_EVT:
             if (param->read.handle == handle)
                 handle_request_read(param->read);
+            else if (m_configuration_handle && (param->read.handle == m_configuration_handle))
+                handle_descriptor_read(param->read);
         break;
         case ESP_GATTS_WRITE_EVT:
             if (param->write.handle == handle)
                 handle_request_write(param->write);
+            else if (m_configuration_handle && (param->write.handle == m_configuration_handle))
+                handle_descriptor_write(param->write);
         break;
-        case ESP_GATTS_EXEC_WRITE_EVT:
-            if (m_value.transaction_write_ongoing(param->exec_write.conn_id))
-                handle_request_exec_write(param->exec_write);
-        break;
-        case ESP_GATTS_DISCONNECT_EVT:
-            m_value.transaction_read_abort(param->disconnect.conn_id);
-            m_value.transaction_write_abort(param->disconnect.conn_id);
+        case ESP_GATTS_SET_ATTR_VAL_EVT:
+            if ((param->set_attr_val.attr_handle == handle) &&
+                (param->set_attr_val.status != ESP_GATT_OK))
+                CHARACTERISTIC_LOGE("Attribute value update rejected: 0x%02X",
+                                    param->set_attr_val.status);
         break;
         default:
         break;
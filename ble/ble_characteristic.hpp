@@ -10,27 +10,37 @@
  *            License, v. 2.0. If a copy of the MPL was not distributed with this
  *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
  * @TODO Add event system
- * @TODO Add notify
- * @TODO Add indicate
- * @TODO Add descriptors
+ * @TODO Add descriptors other than the Client Characteristic Configuration
  * @TODO Move some LOGEs to throws
  */
 
 #ifndef COMPONENTS_BLE_BLE_CHARACTERISTIC_HPP
 #define COMPONENTS_BLE_BLE_CHARACTERISTIC_HPP
 
+#include <array>
+#include <atomic>
 #include <cstdint>
 #include <functional>
+#include <memory>
+#include <new>
+#include <optional>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "utilities.hpp"
+
+#include "ble_histogram.hpp"
 #include "ble_value.hpp"
 #include "types.hpp"
 
 namespace BLE
 {
 
+class BLE_Server;
 class BLE_Service;
 
 
@@ -38,18 +48,40 @@ class BLE_Characteristic
 {
 public:
     using RW_Callback = std::function<void()>;
+    // Receives the connection and the value of a write, the value is only valid during the call.
+    using Write_Raw_Callback = std::function<void(uint16_t, const uint8_t*, size_t)>;
+
+    enum class Operation : uint8_t
+    {
+        READ,
+        WRITE,
+        EXEC_WRITE,
+    };
+
+    // The bits of the Client Characteristic Configuration descriptor.
+    static constexpr const uint16_t CONFIGURATION_NOTIFY = 0x0001;
+    static constexpr const uint16_t CONFIGURATION_INDICATE = 0x0002;
 
 
     BLE_Characteristic(UUID uuid, uint16_t handle, esp_gatt_if_t gatts_if,
                        std::weak_ptr<BLE_Service> service,
                        esp_gatt_char_prop_t properties = 0,
-                       esp_gatt_perm_t permissions = ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE)
+                       esp_gatt_perm_t permissions = ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                       bool auto_response = false)
         : uuid(uuid),
           handle(handle),
           gatts_if(gatts_if),
           service(service),
           properties(properties),
-          permissions(permissions) {}
+          permissions(permissions),
+          auto_response(auto_response)
+    {
+        if ((m_subscriptions_semaphore == nullptr) || (m_value_semaphore == nullptr))
+            throw std::bad_alloc();
+
+        xSemaphoreGive(m_subscriptions_semaphore);
+        xSemaphoreGive(m_value_semaphore);
+    }
 
     /**
      * @brief Sets a callback function to be executed whenever a write operation is completed.
@@ -58,6 +90,16 @@ public:
      */
     void callback_write_set(RW_Callback callback);
 
+    /**
+     * @brief Sets a callback function receiving the raw value of every write.
+     * @detail While set, written values are handed to the callback in place instead of being
+     *         stored in the characteristic, and the write callback is not executed. Suited to
+     *         streams where each write is consumed once. Prepared writes are unaffected.
+     * @param callback A callback function of type Write_Raw_Callback, nullptr restores storing.
+     * @note This function will be executed before the response to the device is sent.
+     */
+    void callback_write_raw_set(Write_Raw_Callback callback);
+
     /**
      * @brief Sets a callback function to be executed whenever a read operation is completed.
      * @param callback A callback function of type RW_Callback that will be executed;
@@ -67,6 +109,8 @@ public:
 
     /**
      * @brief Sets the value of the characteristic.
+     * @note For auto response characteristics a changed value is also pushed to the attribute
+     *       storage of the BLE stack, setting an unchanged value is free.
      * @tparam T The type of the value to set.
      * @param [in] value A value of type T to set on the characteristic.
      * @param [in] serializer (default=BLE_Value::default_serializer<T>) A serializer function which
@@ -89,6 +133,107 @@ public:
     template<typename T>
     T value_get(BLE_Value::Deserializer<T> deserializer=BLE_Value::default_deserializer<T>) const;
 
+    /**
+     * @brief Rewrites the value of the characteristic in place, without a serializer or an
+     *        intermediate vector.
+     * @note For auto response characteristics the value is also pushed to the attribute storage
+     *       of the BLE stack.
+     * @note The value is locked while the function runs, it must not call back into this
+     *       characteristic.
+     * @tparam F A callable of signature void(uint8_t* data, size_t length).
+     * @param [in] length The length of the new value in bytes.
+     * @param [in] update The function writing the value, e.g. through a generated payload view.
+     */
+    template<typename F>
+    void value_update(size_t length, F update);
+
+    /**
+     * @brief Reads the value of the characteristic in place, e.g. from a write callback.
+     * @note The value is locked while the function runs, it must not call back into this
+     *       characteristic.
+     * @tparam F A callable of signature R(const uint8_t* data, size_t length).
+     * @param [in] view The function reading the value, the pointer is only valid during the call.
+     * @return The result of the function.
+     */
+    template<typename F>
+    auto value_view(F view) const;
+
+    /**
+     * @brief Enables or disables request-to-response latency tracking.
+     * @detail When enabled, the time from the arrival of a GATTS event at the server to the
+     *         response being handed to the stack is recorded in a histogram per operation. Requests
+     *         which do not require a response are measured until their handling completes.
+     * @note The histograms are allocated the first time tracking is enabled and retained after.
+     * @param [in] enabled Whether latencies should be recorded.
+     */
+    void latency_tracking_set(bool enabled);
+
+    /**
+     * @brief Retrieves the recorded latencies for an operation.
+     * @param [in] operation The operation of interest.
+     * @param [in] reset (default=false) Clears the histogram once it has been captured.
+     * @return A snapshot of the latency histogram or std::nullopt if tracking was never enabled.
+     */
+    std::optional<BLE_Latency_Histogram::snapshot_t> latency_snapshot(Operation operation,
+                                                                      bool reset=false);
+
+    /**
+     * @brief Sends the current value to every client subscribed to this characteristic.
+     * @detail Clients that enabled indications are indicated, all others are notified. The value
+     *         is truncated to fit the MTU of each connection.
+     * @note This function is thread safe.
+     * @return The number of clients the value was sent to.
+     */
+    size_t notify(void);
+
+    /**
+     * @brief Sends a value to a single subscribed client without storing it in the characteristic.
+     * @detail The client is indicated if it enabled indications and notified otherwise. Unlike
+     *         notify, a value longer than the MTU allows is refused rather than truncated.
+     * @note This function is thread safe.
+     * @param [in] connection_id The connection of the client.
+     * @param [in] data The value to send, the stack copies it before the call returns.
+     * @param [in] length The length of the value.
+     * @param [in] quiet (default=false) Does not log a value the stack refused, for callers which
+     *             count failures themselves or whose own output is being streamed.
+     * @return True if the value was handed to the stack, false if the client is not subscribed,
+     *         the value does not fit or the stack refused it.
+     */
+    bool notify(uint16_t connection_id, const uint8_t* data, size_t length, bool quiet=false);
+
+    /**
+     * @brief Retrieves the Client Characteristic Configuration of a connection.
+     * @note This function is thread safe.
+     * @param [in] connection_id The connection of interest.
+     * @return The configuration written by the client, 0 if it is not subscribed.
+     */
+    uint16_t subscription_get(uint16_t connection_id);
+
+    /**
+     * @brief Retrieves the connections subscribed to this characteristic.
+     * @note This function is thread safe.
+     * @return The IDs of the connections that enabled notifications or indications.
+     */
+    std::vector<uint16_t> subscribers_get(void);
+
+    /**
+     * @brief Computes the longest value a notification can carry to a client.
+     * @note This function is thread safe.
+     * @param [in] connection_id The connection of the client.
+     * @return The length allowed by the MTU of the connection, or by the default MTU if it is
+     *         unknown, at most ATT_ATTRIBUTE_LENGTH_MAX.
+     */
+    size_t notification_capacity_get(uint16_t connection_id) const;
+
+    /**
+     * @brief Computes the longest value a notification can carry to every one of a set of clients.
+     * @note This function is thread safe.
+     * @param [in] connection_ids The connections of the clients, unknown ones are skipped.
+     * @return The length allowed by the smallest MTU among the connections, at most
+     *         ATT_ATTRIBUTE_LENGTH_MAX.
+     */
+    size_t notification_capacity_get(const std::vector<uint16_t>& connection_ids) const;
+
     void characteristic_event_handler_gatts(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
                                             esp_ble_gatts_cb_param_t *param);
 
@@ -100,16 +245,64 @@ public:
 
     const esp_gatt_char_prop_t          properties;
     const esp_gatt_perm_t               permissions;
+    // The BLE stack answers requests from its own copy of the value, see characteristic_add.
+    const bool                          auto_response;
 
 private:
+    friend class BLE_Server;
+    friend class BLE_Service;
+
     void handle_request_write(const esp_ble_gatts_cb_param_t::gatts_write_evt_param& param);
-    void handle_request_exec_write(const esp_ble_gatts_cb_param_t::gatts_exec_write_evt_param& param);
+    void handle_request_prepare_write(const esp_ble_gatts_cb_param_t::gatts_write_evt_param& param);
     void handle_request_read(const esp_ble_gatts_cb_param_t::gatts_read_evt_param& param);
 
+    // Execute Write Requests are handled by the server, which applies the queued writes of every
+    // characteristic before any of their callbacks run.
+    void handle_exec_write_apply(std::vector<uint8_t> value);
+    void handle_exec_write_complete(void);
+
+    // Prepared writes to auto response characteristics are queued and executed by the stack, the
+    // connections that queued some are tracked so that the executed value can be read back.
+    bool stack_prepared_take(uint16_t connection_id);
+    void handle_exec_write_pull(void);
+
+    // Requests to the Client Characteristic Configuration descriptor of this characteristic.
+    void handle_descriptor_read(const esp_ble_gatts_cb_param_t::gatts_read_evt_param& param);
+    void handle_descriptor_write(const esp_ble_gatts_cb_param_t::gatts_write_evt_param& param);
+
+    // Subscriptions are also restored and cleared by the server as peers come and go.
+    void subscription_set(uint16_t connection_id, uint16_t configuration);
+    void subscription_clear(uint16_t connection_id);
+
+    // The server this characteristic is registered with, nullptr while it is being torn down.
+    std::shared_ptr<BLE_Server> server_get(void) const;
+
+    void latency_record(Operation operation);
+    // Called with the value semaphore held.
+    void value_mirror(void);
+
+    using Latency_Histograms = std::array<BLE_Latency_Histogram, 3>;
+    using Subscription_Map = std::unordered_map<uint16_t, uint16_t>;
+
+
+    // Written by client requests on the BT task and by the application on any other.
     BLE_Value                           m_value;
+    SemaphoreHandle_t                   m_value_semaphore = xSemaphoreCreateBinary();
+
+    std::unique_ptr<Latency_Histograms> m_latency;
+    std::atomic<bool>                   m_latency_enabled = {false};
 
     RW_Callback                         m_callback_read;
     RW_Callback                         m_callback_write;
+    Write_Raw_Callback                  m_callback_write_raw;
+
+    // Set by the service once the descriptor is created, 0 if the characteristic has none.
+    uint16_t                            m_configuration_handle = 0;
+    Subscription_Map                    m_subscriptions;
+    SemaphoreHandle_t                   m_subscriptions_semaphore = xSemaphoreCreateBinary();
+
+    // Only accessed from the GATTS event handler.
+    std::vector<uint16_t>               m_stack_prepared;
 };
 
 #include "ble_characteristic.tpp"
@@ -10,9 +10,7 @@
  *            License, v. 2.0. If a copy of the MPL was not distributed with this
  *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
  * @TODO Add event system
- * @TODO Add notify
- * @TODO Add indicate
- * @TODO Add descriptors
+ * @TODO Add descriptors other than the Client Characteristic Configuration
  * @TODO Move some LOGEs to throws
  */
 
@@ -33,7 +31,9 @@ inline
 void
 BLE_Characteristic::value_set(T value, BLE_Value::Serializer<T> serializer)
 {
-    m_value.value_set(value, serializer);
+    Utilities::AnchorSemaphore anchor(m_value_semaphore);
+    if (m_value.value_set(value, serializer) && auto_response)
+        value_mirror();
 }
 
 
@@ -51,8 +51,46 @@ inline
 T
 BLE_Characteristic::value_get(BLE_Value::Deserializer<T> deserializer) const
 {
+    Utilities::AnchorSemaphore anchor(m_value_semaphore);
     return m_value.value_get<T>(deserializer);
 }
 
+
+/**
+ * @brief Rewrites the value of the characteristic in place, without a serializer or an
+ *        intermediate vector.
+ * @note For auto response characteristics the value is also pushed to the attribute storage of
+ *       the BLE stack.
+ * @tparam F A callable of signature void(uint8_t* data, size_t length).
+ * @param [in] length The length of the new value in bytes.
+ * @param [in] update The function writing the value, e.g. through a generated payload view.
+ */
+template<typename F>
+inline
+void
+BLE_Characteristic::value_update(size_t length, F update)
+{
+    Utilities::AnchorSemaphore anchor(m_value_semaphore);
+    m_value.value_update(length, update);
+    if (auto_response)
+        value_mirror();
+}
+
+
+/**
+ * @brief Reads the value of the characteristic in place, e.g. from a write callback.
+ * @tparam F A callable of signature R(const uint8_t* data, size_t length).
+ * @param [in] view The function reading the value, the pointer is only valid during the call.
+ * @return The result of the function.
+ */
+template<typename F>
+inline
+auto
+BLE_Characteristic::value_view(F view) const
+{
+    Utilities::AnchorSemaphore anchor(m_value_semaphore);
+    return m_value.value_view(view);
+}
+
 #endif // BLE_BLE_CHARACTERISTIC_TPP
 
@@ -0,0 +1,418 @@
+/**
+ * @file   ble_client.cpp
+ *
+ * @brief  ESP32 Bluetooth Low Energy client abstraction.
+ * @detail The client connects to peripherals and exposes their GATT databases through remote
+ *         profile, service and characteristic proxies mirroring the server's object model. It
+ *         shares the BLE stack with the server, both roles may run at the same time.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstdint>
+#include <memory>
+#include <utility>
+
+#include "esp_gap_ble_api.h"
+#include "esp_gattc_api.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "utilities.hpp"
+
+#include "ble_client.hpp"
+#include "ble_gattc.hpp"
+#include "ble_log.hpp"
+#include "ble_remote_profile.hpp"
+#include "ble_utilities.hpp"
+
+namespace BLE
+{
+
+using Utilities::AnchorSemaphore;
+
+
+constexpr const char* LOG_TAG_BLE_CLIENT = "BLE Client";
+
+/***************************************************************************************************
+* Logging Macros
+***************************************************************************************************/
+#define CLIENT_LOG_LEVEL CONFIG_BLE_REDUX_LOG_LEVEL_CLIENT
+
+#define CLIENT_LOG(LVL, MSG, ...)\
+    BLE_LOG(CLIENT_LOG_LEVEL, LVL, LOG_TAG_BLE_CLIENT, "%s", "", MSG, ##__VA_ARGS__)
+
+#define CLIENT_LOGE(MSG, ...) CLIENT_LOG(ESP_LOG_ERROR, MSG, ##__VA_ARGS__)
+#define CLIENT_LOGW(MSG, ...) CLIENT_LOG(ESP_LOG_WARN, MSG, ##__VA_ARGS__)
+#define CLIENT_LOGI(MSG, ...) CLIENT_LOG(ESP_LOG_INFO, MSG, ##__VA_ARGS__)
+#define CLIENT_LOGD(MSG, ...) CLIENT_LOG(ESP_LOG_DEBUG, MSG, ##__VA_ARGS__)
+#define CLIENT_LOGV(MSG, ...) CLIENT_LOG(ESP_LOG_VERBOSE, MSG, ##__VA_ARGS__)
+
+/***************************************************************************************************
+* Static Singleton Functions
+***************************************************************************************************/
+std::weak_ptr<BLE_Client> BLE_Client::instance;
+
+
+/**
+ * @brief Retrieve an instance of the current active BLE GATTC client or create and return a new
+ *        one if none exist.
+ * @note  The first caller will get the only shared pointer to the client. Therefore, in order to
+ *        avoid the client being destroyed, you must keep it alive.
+ * @return A shared pointer to the BLE GATTC client
+ */
+std::shared_ptr<BLE_Client>
+BLE_Client::get_instance(void)
+{
+    auto instance_shared_ptr = instance.lock();
+    if (instance_shared_ptr)
+        return instance_shared_ptr;
+
+    std::shared_ptr<BLE_Client> client = std::shared_ptr<BLE_Client>(new BLE_Client());
+    instance = client;
+    return client;
+}
+
+
+/***************************************************************************************************
+* Client management
+***************************************************************************************************/
+/**
+ * @brief Starts the BLE GATTC client, enabling the BLE stack if the server has not already.
+ * @param [in] gattc (default=nullptr) The GATT client layer to use, nullptr selects the Bluedroid
+ *             implementation.
+ * @return True if the operation succeeds, false otherwise.
+ */
+bool
+BLE_Client::client_start(std::shared_ptr<BLE_GATTC_Interface> gattc)
+{
+    if (m_state != BLE_Client::State::STOPPED)
+    {
+        CLIENT_LOGE("Client already started");
+        return false;
+    }
+
+    if (!gattc)
+    {
+        if (!stack_enable(m_client_mtu))
+            return false;
+
+        gattc = std::make_shared<BLE_GATTC_ESP>();
+    }
+
+    m_gattc = std::move(gattc);
+
+    // As with the server, the callback always resolves the active instance.
+    esp_err_t err = m_gattc->callback_register([](esp_gattc_cb_event_t event,
+                                                  esp_gatt_if_t gattc_if,
+                                                  esp_ble_gattc_cb_param_t *param)
+                                               {
+                                                   auto active_client = BLE_Client::get_instance();
+                                                   active_client->event_handler_gattc(event,
+                                                                                      gattc_if,
+                                                                                      param);
+                                               });
+    if (err)
+    {
+        CLIENT_LOGE("Callback registration failed: %s (%d)", esp_err_to_name(err), err);
+        return false;
+    }
+
+    auto registration_function = [this](){
+        esp_err_t err = m_gattc->app_register(BLE_CLIENT_APP_ID);
+        if (err)
+        {
+            CLIENT_LOGE("App registration failed: %s (%d)", esp_err_to_name(err), err);
+            return false;
+        }
+        return true;
+    };
+
+    auto result_async = m_notification_mgr.wait(BLE_CLIENT_APP_ID, OP::APP_REGISTER,
+                                                 registration_function);
+    if (!result_async || !*result_async)
+        return false;
+
+    m_state = BLE_Client::State::IDLE;
+    return true;
+}
+
+
+/***************************************************************************************************
+* Connection management
+***************************************************************************************************/
+/**
+ * @brief Connects to a peripheral and discovers its GATT database.
+ * @detail The MTU exchange is started as soon as the link is open and runs alongside the
+ *         discovery performed by the stack, the services and characteristics are then read from
+ *         the stack's cache in a single pass.
+ * @param [in] address The address of the peripheral.
+ * @param [in] address_type (default=BLE_ADDR_TYPE_PUBLIC) The type of the address.
+ * @param [in] blocking (default=true) Blocks the call until the discovery completes. If this
+ *                                     value is set to false the function is not guaranteed to
+ *                                     complete by the time the call completes, in that case
+ *                                     callers should poll the state of the profile.
+ * @return True on success, false otherwise.
+ */
+bool
+BLE_Client::connect(const esp_bd_addr_t address, esp_ble_addr_type_t address_type, bool blocking)
+{
+    if (m_state == BLE_Client::State::STOPPED)
+        return false;
+
+    if (!profile_get(address).expired())
+        return false;
+
+    auto connection_function = [&, this](){
+        esp_err_t err = m_gattc->open(m_gattc_if, address, address_type);
+        if (err)
+        {
+            CLIENT_LOGE("Connect failed: %s (%d)", esp_err_to_name(err), err);
+            return false;
+        }
+        return true;
+    };
+
+    if (!blocking)
+        return connection_function();
+
+    auto result_async = m_notification_mgr.wait(address_key(address), OP::CONNECT,
+                                                 connection_function);
+    if (!result_async)
+        return false;
+
+    return *result_async;
+}
+
+
+/**
+ * @brief Disconnects from a peripheral, pending operations complete with ESP_GATT_CANCEL.
+ * @param [in] address The address of the peripheral.
+ * @param [in] blocking (default=true) Blocks the call until the operation completes. If this
+ *                                     value is set to false the function is not guaranteed to
+ *                                     complete by the time the call completes.
+ */
+void
+BLE_Client::disconnect(const esp_bd_addr_t address, bool blocking)
+{
+    auto profile = profile_get(address).lock();
+    if (!profile)
+        return;
+
+    auto disconnection_function = [&, this](){
+        esp_err_t err = m_gattc->close(m_gattc_if, profile->connection_id);
+        if (err)
+        {
+            CLIENT_LOGE("Disconnect failed: %s (%d)", esp_err_to_name(err), err);
+            return false;
+        }
+        return true;
+    };
+
+    if (blocking)
+        m_notification_mgr.wait(address_key(address), OP::DISCONNECT, disconnection_function);
+    else
+        disconnection_function();
+}
+
+
+/**
+ * @brief Retrieves the remote profile of a connected peripheral.
+ * @note This function is thread safe.
+ * @param [in] address The address of the peripheral.
+ * @return A weak pointer to the profile if the peripheral is connected, else a default
+ *         constructed weak pointer (nullptr).
+ */
+std::weak_ptr<BLE_Remote_Profile>
+BLE_Client::profile_get(const esp_bd_addr_t address)
+{
+    AnchorSemaphore anchor(m_profiles_semaphore);
+    for (const auto& [connection_id, profile] : m_profiles)
+    {
+        if (!memcmp(profile->address.data(), address, ESP_BD_ADDR_LEN))
+            return profile;
+    }
+
+    return {};
+}
+
+
+/**
+ * @brief Retrieves the remote profile of a connection.
+ * @note This function is thread safe.
+ * @param [in] connection_id The connection of interest.
+ * @return A weak pointer to the profile if the connection exists, else a default constructed weak
+ *         pointer (nullptr).
+ */
+std::weak_ptr<BLE_Remote_Profile>
+BLE_Client::profile_get(uint16_t connection_id)
+{
+    AnchorSemaphore anchor(m_profiles_semaphore);
+    auto profile = m_profiles.find(connection_id);
+    if (profile == m_profiles.end())
+        return {};
+
+    return profile->second;
+}
+
+
+uint64_t
+BLE_Client::address_key(const esp_bd_addr_t address)
+{
+    uint64_t key = 0;
+    for (size_t i = 0; i < ESP_BD_ADDR_LEN; i++)
+        key = (key << 8) | address[i];
+
+    return key;
+}
+
+
+/***************************************************************************************************
+* Event Handling
+***************************************************************************************************/
+void
+BLE_Client::handle_connection_open(const esp_ble_gattc_cb_param_t::gattc_open_evt_param& param)
+{
+    if (param.status != ESP_GATT_OK)
+    {
+        CLIENT_LOGE("Connection failed, status: %d", param.status);
+        m_notification_mgr.notify(address_key(param.remote_bda), OP::CONNECT, false);
+        return;
+    }
+
+    auto profile = std::make_shared<BLE_Remote_Profile>(param.conn_id, param.remote_bda,
+                                                        m_gattc_if, param.mtu, m_gattc,
+                                                        get_instance());
+    {
+        AnchorSemaphore anchor(m_profiles_semaphore);
+        m_profiles[param.conn_id] = profile;
+    }
+
+    // The stack discovers the database on its own once the link is open, the MTU exchange is
+    // started right away so that both share the connection events instead of running in turn.
+    esp_err_t err = m_gattc->mtu_request(m_gattc_if, param.conn_id);
+    if (err)
+        CLIENT_LOGW("MTU request failed: %s (%d)", esp_err_to_name(err), err);
+
+    CLIENT_LOGI("Connection open: id %d, MTU %d", param.conn_id, param.mtu);
+}
+
+
+void
+BLE_Client::handle_connection_close(
+    const esp_ble_gattc_cb_param_t::gattc_disconnect_evt_param& param)
+{
+    std::shared_ptr<BLE_Remote_Profile> profile;
+    {
+        AnchorSemaphore anchor(m_profiles_semaphore);
+        auto profile_entry = m_profiles.find(param.conn_id);
+        if (profile_entry != m_profiles.end())
+        {
+            profile = profile_entry->second;
+            m_profiles.erase(profile_entry);
+        }
+    }
+
+    if (profile)
+    {
+        bool discovering = profile->state_get() == BLE_Remote_Profile::State::DISCOVERING;
+        profile->handle_disconnect();
+
+        if (discovering)
+            m_notification_mgr.notify(address_key(param.remote_bda), OP::CONNECT, false);
+    }
+
+    CLIENT_LOGI("Connection closed: id %d, reason 0x%02X", param.conn_id, param.reason);
+    m_notification_mgr.notify(address_key(param.remote_bda), OP::DISCONNECT, true);
+}
+
+
+void
+BLE_Client::event_handler_gattc(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if,
+                                esp_ble_gattc_cb_param_t *param)
+{
+    switch (event)
+    {
+        case ESP_GATTC_REG_EVT:
+            if (param->reg.app_id != BLE_CLIENT_APP_ID)
+                return;
+
+            if (param->reg.status == ESP_GATT_OK)
+                m_gattc_if = gattc_if;
+            else
+                CLIENT_LOGE("App registration failed, status: %d", param->reg.status);
+
+            m_notification_mgr.notify(BLE_CLIENT_APP_ID, OP::APP_REGISTER,
+                                      param->reg.status == ESP_GATT_OK);
+            return;
+        case ESP_GATTC_OPEN_EVT:
+            if (gattc_if == m_gattc_if)
+                handle_connection_open(param->open);
+            return;
+        case ESP_GATTC_DISCONNECT_EVT:
+            handle_connection_close(param->disconnect);
+            return;
+        default:
+        break;
+    }
+
+    if (gattc_if != m_gattc_if)
+        return;
+
+    // Every remaining event concerns a single connection, see BLE_Remote_Profile.
+    uint16_t connection_id;
+    switch (event)
+    {
+        case ESP_GATTC_CFG_MTU_EVT:
+            connection_id = param->cfg_mtu.conn_id;
+        break;
+        case ESP_GATTC_DIS_SRVC_CMPL_EVT:
+            connection_id = param->dis_srvc_cmpl.conn_id;
+        break;
+        case ESP_GATTC_SEARCH_RES_EVT:
+            connection_id = param->search_res.conn_id;
+        break;
+        case ESP_GATTC_SEARCH_CMPL_EVT:
+            connection_id = param->search_cmpl.conn_id;
+        break;
+        case ESP_GATTC_READ_CHAR_EVT:
+            connection_id = param->read.conn_id;
+        break;
+        case ESP_GATTC_WRITE_CHAR_EVT:
+        case ESP_GATTC_WRITE_DESCR_EVT:
+            connection_id = param->write.conn_id;
+        break;
+        case ESP_GATTC_NOTIFY_EVT:
+            connection_id = param->notify.conn_id;
+        break;
+        default:
+            CLIENT_LOGV("Unhandled GATTC event: %d", event);
+        return;
+    }
+
+    auto profile = profile_get(connection_id).lock();
+    if (!profile)
+    {
+        CLIENT_LOGW("Event %d for unknown connection %d", event, connection_id);
+        return;
+    }
+
+    // A connection is only reported once its database has been discovered.
+    if (event == ESP_GATTC_SEARCH_CMPL_EVT)
+    {
+        bool discovered = profile->handle_discovery_complete(param->search_cmpl);
+        if (!discovered)
+            m_gattc->close(m_gattc_if, connection_id);
+
+        m_notification_mgr.notify(address_key(profile->address.data()), OP::CONNECT, discovered);
+        return;
+    }
+
+    profile->profile_event_handler_gattc(event, gattc_if, param);
+}
+
+};
@@ -0,0 +1,154 @@
+/**
+ * @file   ble_client.hpp
+ *
+ * @brief  ESP32 Bluetooth Low Energy client abstraction.
+ * @detail The client connects to peripherals and exposes their GATT databases through remote
+ *         profile, service and characteristic proxies mirroring the server's object model. It
+ *         shares the BLE stack with the server, both roles may run at the same time.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_CLIENT_HPP
+#define COMPONENTS_BLE_BLE_CLIENT_HPP
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+
+#include "esp_gap_ble_api.h"
+#include "esp_gattc_api.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "utilities.hpp"
+
+#include "ble_gattc.hpp"
+#include "ble_remote_profile.hpp"
+#include "ble_utilities.hpp"
+
+namespace BLE
+{
+
+using Utilities::Notification_Manager;
+
+
+class BLE_Client
+{
+public:
+    enum class State
+    {
+        STOPPED,
+        IDLE,
+    };
+
+
+    static constexpr const uint16_t BLE_CLIENT_APP_ID = 0x4000;
+
+
+    /**
+     * @brief Retrieve an instance of the current active BLE GATTC client or create and return a
+     *        new one if none exist.
+     * @note  The first caller will get the only shared pointer to the client. Therefore, in order
+     *        to avoid the client being destroyed, you must keep it alive.
+     * @return A shared pointer to the BLE GATTC client
+     */
+    static std::shared_ptr<BLE_Client> get_instance(void);
+
+    /**
+     * @brief Starts the BLE GATTC client, enabling the BLE stack if the server has not already.
+     * @param [in] gattc (default=nullptr) The GATT client layer to use, nullptr selects the
+     *             Bluedroid implementation.
+     * @return True if the operation succeeds, false otherwise.
+     */
+    bool client_start(std::shared_ptr<BLE_GATTC_Interface> gattc=nullptr);
+
+    /**
+     * @brief Connects to a peripheral and discovers its GATT database.
+     * @detail The MTU exchange is started as soon as the link is open and runs alongside the
+     *         discovery performed by the stack, the services and characteristics are then read
+     *         from the stack's cache in a single pass.
+     * @param [in] address The address of the peripheral.
+     * @param [in] address_type (default=BLE_ADDR_TYPE_PUBLIC) The type of the address.
+     * @param [in] blocking (default=true) Blocks the call until the discovery completes. If this
+     *                                     value is set to false the function is not guaranteed to
+     *                                     complete by the time the call completes, in that case
+     *                                     callers should poll the state of the profile.
+     * @return True on success, false otherwise.
+     */
+    bool connect(const esp_bd_addr_t address, esp_ble_addr_type_t address_type=BLE_ADDR_TYPE_PUBLIC,
+                 bool blocking=true);
+
+    /**
+     * @brief Disconnects from a peripheral, pending operations complete with ESP_GATT_CANCEL.
+     * @param [in] address The address of the peripheral.
+     * @param [in] blocking (default=true) Blocks the call until the operation completes. If this
+     *                                     value is set to false the function is not guaranteed to
+     *                                     complete by the time the call completes.
+     */
+    void disconnect(const esp_bd_addr_t address, bool blocking=true);
+
+    /**
+     * @brief Retrieves the remote profile of a connected peripheral.
+     * @note This function is thread safe.
+     * @param [in] address The address of the peripheral.
+     * @return A weak pointer to the profile if the peripheral is connected, else a default
+     *         constructed weak pointer (nullptr).
+     */
+    std::weak_ptr<BLE_Remote_Profile> profile_get(const esp_bd_addr_t address);
+
+    /**
+     * @brief Retrieves the remote profile of a connection.
+     * @note This function is thread safe.
+     * @param [in] connection_id The connection of interest.
+     * @return A weak pointer to the profile if the connection exists, else a default constructed
+     *         weak pointer (nullptr).
+     */
+    std::weak_ptr<BLE_Remote_Profile> profile_get(uint16_t connection_id);
+
+private:
+    enum class OP
+    {
+        APP_REGISTER,
+        CONNECT,
+        DISCONNECT,
+    };
+
+    using Profile_Map = std::unordered_map<uint16_t, std::shared_ptr<BLE_Remote_Profile>>;
+
+
+    BLE_Client(void)
+    {
+        if (m_profiles_semaphore == nullptr)
+            throw std::bad_alloc();
+
+        xSemaphoreGive(m_profiles_semaphore);
+    }
+
+    static uint64_t address_key(const esp_bd_addr_t address);
+
+    void handle_connection_open(const esp_ble_gattc_cb_param_t::gattc_open_evt_param& param);
+    void handle_connection_close(const esp_ble_gattc_cb_param_t::gattc_disconnect_evt_param& param);
+
+    void event_handler_gattc(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if,
+                             esp_ble_gattc_cb_param_t *param);
+
+
+    static std::weak_ptr<BLE_Client>        instance;
+
+    BLE_Client::State                       m_state = BLE_Client::State::STOPPED;
+    std::shared_ptr<BLE_GATTC_Interface>    m_gattc;
+    esp_gatt_if_t                           m_gattc_if = ESP_GATT_IF_NONE;
+    uint16_t                                m_client_mtu = MTU_DEFAULT_BLE_SERVER;
+
+    Profile_Map                             m_profiles;
+    SemaphoreHandle_t                       m_profiles_semaphore = xSemaphoreCreateBinary();
+    Notification_Manager<uint64_t, OP>      m_notification_mgr;
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_CLIENT_HPP
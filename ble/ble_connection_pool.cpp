@@ -0,0 +1,556 @@
+/**
+ * @file   ble_connection_pool.cpp
+ *
+ * @brief  Connection pool for the central role.
+ * @detail The pool caps the number of peripheral links and of concurrent connection attempts,
+ *         reuses established links and schedules the operations of every link with deficit
+ *         round-robin, so that a chatty peripheral gets its fair share of bytes and no more. It
+ *         is built on BLE_Client and only talks to the stack through it.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "utilities.hpp"
+
+#include "ble_client.hpp"
+#include "ble_connection_pool.hpp"
+#include "ble_log.hpp"
+#include "ble_remote_characteristic.hpp"
+#include "ble_remote_profile.hpp"
+#include "ble_remote_service.hpp"
+
+namespace BLE
+{
+
+using Utilities::AnchorSemaphore;
+
+
+constexpr const char* LOG_TAG_BLE_CONNECTION_POOL = "BLE Connection Pool";
+
+// The opcode and handle preceding the value of a write.
+constexpr const int32_t POOL_WRITE_OVERHEAD = 3;
+
+/***************************************************************************************************
+* Logging Macros
+***************************************************************************************************/
+#define POOL_LOG_LEVEL CONFIG_BLE_REDUX_LOG_LEVEL_CLIENT
+
+#define POOL_LOG(LVL, MSG, ...)\
+    BLE_LOG(POOL_LOG_LEVEL, LVL, LOG_TAG_BLE_CONNECTION_POOL, "%s", "", MSG, ##__VA_ARGS__)
+
+#define POOL_LOGE(MSG, ...) POOL_LOG(ESP_LOG_ERROR, MSG, ##__VA_ARGS__)
+#define POOL_LOGW(MSG, ...) POOL_LOG(ESP_LOG_WARN, MSG, ##__VA_ARGS__)
+#define POOL_LOGI(MSG, ...) POOL_LOG(ESP_LOG_INFO, MSG, ##__VA_ARGS__)
+#define POOL_LOGD(MSG, ...) POOL_LOG(ESP_LOG_DEBUG, MSG, ##__VA_ARGS__)
+#define POOL_LOGV(MSG, ...) POOL_LOG(ESP_LOG_VERBOSE, MSG, ##__VA_ARGS__)
+
+/***************************************************************************************************
+* Static Singleton Functions
+***************************************************************************************************/
+std::weak_ptr<BLE_Connection_Pool> BLE_Connection_Pool::instance;
+
+
+/**
+ * @brief Retrieve an instance of the current active connection pool or create and return a new
+ *        one if none exist.
+ * @note  The first caller will get the only shared pointer to the pool. Therefore, in order to
+ *        avoid the pool being destroyed, you must keep it alive.
+ * @return A shared pointer to the connection pool.
+ */
+std::shared_ptr<BLE_Connection_Pool>
+BLE_Connection_Pool::get_instance(void)
+{
+    auto instance_shared_ptr = instance.lock();
+    if (instance_shared_ptr)
+        return instance_shared_ptr;
+
+    std::shared_ptr<BLE_Connection_Pool> pool =
+        std::shared_ptr<BLE_Connection_Pool>(new BLE_Connection_Pool());
+    instance = pool;
+    return pool;
+}
+
+
+BLE_Connection_Pool::BLE_Connection_Pool(void)
+    : m_client(BLE_Client::get_instance())
+{
+    if ((m_links_semaphore == nullptr) || (m_connect_slots == nullptr))
+        throw std::bad_alloc();
+
+    xSemaphoreGive(m_links_semaphore);
+}
+
+
+/***************************************************************************************************
+* Pool Management
+***************************************************************************************************/
+/**
+ * @brief Sets the limits of the pool.
+ * @note This function is thread safe, the limits apply from the next scheduling decision.
+ *       Lowering links_max does not close established links.
+ * @param [in] limits The new limits.
+ */
+void
+BLE_Connection_Pool::limits_set(const limits_t& limits)
+{
+    {
+        AnchorSemaphore anchor(m_links_semaphore);
+        m_limits = limits;
+        // A zero quantum or slot count would stall every link.
+        m_limits.quantum_bytes = std::max<uint32_t>(m_limits.quantum_bytes, 1);
+        m_limits.in_flight_max = std::max<size_t>(m_limits.in_flight_max, 1);
+    }
+
+    schedule();
+}
+
+
+/**
+ * @brief Retrieves the link to a peripheral, connecting to it if needed.
+ * @detail Established links are returned immediately. Otherwise the call blocks while at most
+ *         CONFIG_BLE_REDUX_POOL_CONNECTING_MAX connection attempts are in progress, then connects
+ *         and discovers the peripheral. The client must have been started.
+ * @param [in] address The address of the peripheral.
+ * @param [in] address_type (default=BLE_ADDR_TYPE_PUBLIC) The type of the address.
+ * @return The profile of the peripheral, nullptr if the pool is full, another task is already
+ *         connecting to the peripheral or the connection failed.
+ */
+std::shared_ptr<BLE_Remote_Profile>
+BLE_Connection_Pool::acquire(const Address& address, esp_ble_addr_type_t address_type)
+{
+    uint64_t key = address_key(address.data());
+    {
+        AnchorSemaphore anchor(m_links_semaphore);
+        auto link_entry = m_links.find(key);
+        if (link_entry != m_links.end())
+        {
+            if (link_entry->second.connecting)
+            {
+                POOL_LOGW("Already connecting to %012llX", key);
+                return nullptr;
+            }
+
+            auto profile = link_entry->second.profile.lock();
+            if (profile && (profile->state_get() != BLE_Remote_Profile::State::DISCONNECTED))
+                return profile;
+        }
+
+        // Links whose peripheral went away are forgotten once nothing refers to them anymore.
+        size_t links = 0;
+        for (auto link = m_links.begin(); link != m_links.end();)
+        {
+            if (link_alive(link->second))
+            {
+                links++;
+                link++;
+            }
+            else if ((link->first != key) && !link->second.busy && link->second.jobs.empty())
+            {
+                link = m_links.erase(link);
+            }
+            else
+            {
+                link++;
+            }
+        }
+
+        if (links >= m_limits.links_max)
+        {
+            POOL_LOGW("Pool full, %012llX refused", key);
+            return nullptr;
+        }
+
+        m_links[key].connecting = true;
+    }
+
+    xSemaphoreTake(m_connect_slots, portMAX_DELAY);
+    bool connected = m_client->connect(address.data(), address_type, true);
+    xSemaphoreGive(m_connect_slots);
+
+    std::shared_ptr<BLE_Remote_Profile> profile;
+    if (connected)
+        profile = m_client->profile_get(address.data()).lock();
+
+    {
+        AnchorSemaphore anchor(m_links_semaphore);
+        link_t& link = m_links[key];
+        link.connecting = false;
+        if (profile)
+        {
+            // Operations queued for a previous link stay queued and fail once dispatched, their
+            // characteristics belong to the old connection.
+            link.profile = profile;
+            link.counters = {};
+            link.counters.connected_us = esp_timer_get_time();
+        }
+        else if (link.jobs.empty() && !link.busy)
+        {
+            m_links.erase(key);
+        }
+    }
+
+    if (!profile)
+        POOL_LOGE("Connection to %012llX failed", key);
+
+    return profile;
+}
+
+
+/**
+ * @brief Disconnects from a peripheral and forgets its link.
+ * @detail Operations still queued in the pool complete with ESP_GATT_CANCEL.
+ * @param [in] address The address of the peripheral.
+ */
+void
+BLE_Connection_Pool::release(const Address& address)
+{
+    uint64_t key = address_key(address.data());
+    std::deque<job_t> jobs;
+    {
+        AnchorSemaphore anchor(m_links_semaphore);
+        auto link_entry = m_links.find(key);
+        if ((link_entry == m_links.end()) || link_entry->second.connecting)
+            return;
+
+        jobs.swap(link_entry->second.jobs);
+        m_links.erase(link_entry);
+        m_active.erase(std::remove(m_active.begin(), m_active.end(), key), m_active.end());
+    }
+
+    // The operation in flight, if any, is cancelled by the client and still frees its slot.
+    m_client->disconnect(address.data(), true);
+
+    for (auto& job : jobs)
+    {
+        if (job.completion)
+            job.completion(ESP_GATT_CANCEL, {});
+    }
+}
+
+
+/**
+ * @brief Retrieves the metrics of a link.
+ * @note This function is thread safe.
+ * @param [in] address The address of the peripheral.
+ * @return The metrics or std::nullopt if the pool holds no link to the peripheral.
+ */
+std::optional<BLE_Connection_Pool::link_metrics_t>
+BLE_Connection_Pool::metrics_get(const Address& address)
+{
+    AnchorSemaphore anchor(m_links_semaphore);
+    auto link_entry = m_links.find(address_key(address.data()));
+    if (link_entry == m_links.end())
+        return {};
+
+    const link_t& link = link_entry->second;
+    const link_counters_t& counters = link.counters;
+
+    link_metrics_t metrics;
+    metrics.completed = counters.completed;
+    metrics.failed = counters.failed;
+    metrics.bytes = counters.bytes;
+    metrics.queue_depth = link.jobs.size();
+    metrics.queue_peak = counters.queue_peak;
+    metrics.wait_us_max = counters.wait_us_max;
+    metrics.deficit = link.deficit;
+
+    uint32_t operations = counters.completed + counters.failed;
+    metrics.latency_us_mean = operations ? (counters.latency_us_total / operations) : 0;
+
+    int64_t elapsed_us = esp_timer_get_time() - counters.connected_us;
+    metrics.throughput_bps = ((counters.connected_us != 0) && (elapsed_us > 0))
+                                 ? static_cast<uint32_t>((counters.bytes * 1000000) / elapsed_us)
+                                 : 0;
+    return metrics;
+}
+
+
+/**
+ * @brief Retrieves the number of links held by the pool.
+ * @note This function is thread safe.
+ * @return The number of established and connecting links.
+ */
+size_t
+BLE_Connection_Pool::links_get(void)
+{
+    AnchorSemaphore anchor(m_links_semaphore);
+    return std::count_if(m_links.begin(), m_links.end(), [](const auto& link){
+        return link_alive(link.second);
+    });
+}
+
+
+uint64_t
+BLE_Connection_Pool::address_key(const uint8_t* address)
+{
+    uint64_t key = 0;
+    for (size_t i = 0; i < ESP_BD_ADDR_LEN; i++)
+        key = (key << 8) | address[i];
+
+    return key;
+}
+
+
+bool
+BLE_Connection_Pool::link_alive(const link_t& link)
+{
+    if (link.connecting)
+        return true;
+
+    auto profile = link.profile.lock();
+    return profile && (profile->state_get() != BLE_Remote_Profile::State::DISCONNECTED);
+}
+
+
+/***************************************************************************************************
+* Operations
+***************************************************************************************************/
+/**
+ * @brief Queues a read on the link of the characteristic.
+ * @note This function is thread safe.
+ * @param [in] characteristic The characteristic to read, obtained from an acquired link.
+ * @param [in] completion The function receiving the status and the value.
+ * @return True if the read was queued, false if the link is unknown or its queue is full.
+ */
+bool
+BLE_Connection_Pool::read(std::shared_ptr<BLE_Remote_Characteristic> characteristic,
+                          Completion completion)
+{
+    return submit(characteristic, {OP::READ, characteristic, {}, std::move(completion), 0});
+}
+
+
+/**
+ * @brief Queues a write on the link of the characteristic.
+ * @note This function is thread safe.
+ * @param [in] characteristic The characteristic to write, obtained from an acquired link.
+ * @param [in] value The value to write.
+ * @param [in] completion The function receiving the status.
+ * @param [in] response (default=true) Uses a Write Request, otherwise a Write Command.
+ * @return True if the write was queued, false if the link is unknown or its queue is full.
+ */
+bool
+BLE_Connection_Pool::write(std::shared_ptr<BLE_Remote_Characteristic> characteristic,
+                           std::vector<uint8_t> value, Completion completion, bool response)
+{
+    return submit(characteristic, {response ? OP::WRITE : OP::WRITE_NO_RESPONSE, characteristic,
+                                   std::move(value), std::move(completion), 0});
+}
+
+
+bool
+BLE_Connection_Pool::submit(std::shared_ptr<BLE_Remote_Characteristic> characteristic, job_t job)
+{
+    if (!characteristic)
+        return false;
+
+    auto service = characteristic->service.lock();
+    auto profile = service ? service->profile.lock() : nullptr;
+    if (!profile)
+        return false;
+
+    uint64_t key = address_key(profile->address.data());
+    {
+        AnchorSemaphore anchor(m_links_semaphore);
+        auto link_entry = m_links.find(key);
+        if (link_entry == m_links.end())
+        {
+            POOL_LOGE("No link to %012llX, acquire it first", key);
+            return false;
+        }
+
+        link_t& link = link_entry->second;
+        if (link.jobs.size() >= m_limits.link_queue_max)
+        {
+            POOL_LOGW("Queue of %012llX full", key);
+            return false;
+        }
+
+        job.queued_us = esp_timer_get_time();
+        link.jobs.push_back(std::move(job));
+        link.counters.queue_peak = std::max(link.counters.queue_peak, link.jobs.size());
+
+        if (!link.active)
+        {
+            // A link returning to the rotation keeps any debt but no credit.
+            link.active = true;
+            link.deficit = std::min(link.deficit, 0);
+            m_active.push_back(key);
+        }
+    }
+
+    schedule();
+    return true;
+}
+
+
+void
+BLE_Connection_Pool::schedule(void)
+{
+    std::vector<dispatch_t> dispatches;
+    {
+        AnchorSemaphore anchor(m_links_semaphore);
+        int64_t now_us = esp_timer_get_time();
+
+        // Every visit credits an idle link with a quantum and issues its next operation if the
+        // credit covers it. A pass which finds idle links but issues nothing has still raised
+        // their credit, so passes repeat until a slot is taken or every link is busy.
+        while ((m_in_flight < m_limits.in_flight_max) && !m_active.empty())
+        {
+            bool idle_found = false;
+            size_t visits = m_active.size();
+            for (size_t i = 0; (i < visits) && (m_in_flight < m_limits.in_flight_max); i++)
+            {
+                uint64_t key = m_active.front();
+                m_active.pop_front();
+
+                link_t& link = m_links.at(key);
+                if (link.busy)
+                {
+                    m_active.push_back(key);
+                    continue;
+                }
+
+                idle_found = true;
+                link.deficit += m_limits.quantum_bytes;
+
+                // Reads are charged a full response up front and refunded on completion.
+                job_t& job = link.jobs.front();
+                int32_t cost = job.value.size() + POOL_WRITE_OVERHEAD;
+                if (job.type == OP::READ)
+                {
+                    auto profile = link.profile.lock();
+                    cost = profile ? (profile->mtu_get() - 1) : 0;
+                }
+
+                if (cost <= link.deficit)
+                {
+                    link.deficit -= cost;
+                    link.busy = true;
+                    m_in_flight++;
+
+                    uint32_t wait_us = now_us - job.queued_us;
+                    link.counters.wait_us_max = std::max(link.counters.wait_us_max, wait_us);
+
+                    dispatches.push_back({key, std::move(job), cost});
+                    link.jobs.pop_front();
+                }
+
+                if (link.jobs.empty())
+                {
+                    link.active = false;
+                    link.deficit = std::min(link.deficit, 0);
+                }
+                else
+                {
+                    m_active.push_back(key);
+                }
+            }
+
+            if (!idle_found)
+                break;
+        }
+    }
+
+    // Issued without the semaphore, a BLE_GATTC_Interface implementation may complete them
+    // synchronously.
+    for (auto& dispatch_entry : dispatches)
+        dispatch(std::move(dispatch_entry));
+}
+
+
+void
+BLE_Connection_Pool::dispatch(dispatch_t dispatch)
+{
+    uint64_t key = dispatch.key;
+    int32_t cost = dispatch.cost;
+    int64_t queued_us = dispatch.job.queued_us;
+    Completion completion = std::move(dispatch.job.completion);
+
+    auto characteristic = dispatch.job.characteristic.lock();
+    bool issued = false;
+    if (characteristic)
+    {
+        if (dispatch.job.type == OP::READ)
+        {
+            issued = characteristic->read([=](esp_gatt_status_t status,
+                                              const std::vector<uint8_t>& value){
+                auto pool = instance.lock();
+                if (pool)
+                    pool->complete(key, cost - static_cast<int32_t>(value.size()), value.size(),
+                                   queued_us, status, value, completion);
+            });
+        }
+        else
+        {
+            size_t length = dispatch.job.value.size();
+            issued = characteristic->write(std::move(dispatch.job.value),
+                                           [=](esp_gatt_status_t status){
+                auto pool = instance.lock();
+                if (pool)
+                    pool->complete(key, 0, length, queued_us, status, {}, completion);
+            }, dispatch.job.type == OP::WRITE);
+        }
+    }
+
+    if (!issued)
+        complete(key, 0, 0, queued_us, ESP_GATT_ERROR, {}, completion);
+}
+
+
+void
+BLE_Connection_Pool::complete(uint64_t key, int32_t refund, size_t bytes, int64_t queued_us,
+                              esp_gatt_status_t status, const std::vector<uint8_t>& value,
+                              const Completion& completion)
+{
+    {
+        AnchorSemaphore anchor(m_links_semaphore);
+        m_in_flight--;
+
+        auto link_entry = m_links.find(key);
+        if (link_entry != m_links.end())
+        {
+            link_t& link = link_entry->second;
+            link.busy = false;
+            if (link.active)
+                link.deficit += refund;
+
+            if (status == ESP_GATT_OK)
+            {
+                link.counters.completed++;
+                link.counters.bytes += bytes;
+            }
+            else
+            {
+                link.counters.failed++;
+            }
+
+            link.counters.latency_us_total += esp_timer_get_time() - queued_us;
+        }
+    }
+
+    // The freed slot is handed out before the application sees this result.
+    schedule();
+
+    if (completion)
+        completion(status, value);
+}
+
+};
@@ -0,0 +1,258 @@
+/**
+ * @file   ble_connection_pool.hpp
+ *
+ * @brief  Connection pool for the central role.
+ * @detail The pool caps the number of peripheral links and of concurrent connection attempts,
+ *         reuses established links and schedules the operations of every link with deficit
+ *         round-robin, so that a chatty peripheral gets its fair share of bytes and no more. It
+ *         is built on BLE_Client and only talks to the stack through it.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_CONNECTION_POOL_HPP
+#define COMPONENTS_BLE_BLE_CONNECTION_POOL_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "esp_gap_ble_api.h"
+#include "esp_gatt_defs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+
+#include "ble_client.hpp"
+#include "ble_remote_characteristic.hpp"
+#include "ble_remote_profile.hpp"
+
+#ifndef CONFIG_BLE_REDUX_POOL_LINKS_MAX
+#define CONFIG_BLE_REDUX_POOL_LINKS_MAX 8
+#endif
+
+#ifndef CONFIG_BLE_REDUX_POOL_CONNECTING_MAX
+#define CONFIG_BLE_REDUX_POOL_CONNECTING_MAX 1
+#endif
+
+#ifndef CONFIG_BLE_REDUX_POOL_IN_FLIGHT_MAX
+#define CONFIG_BLE_REDUX_POOL_IN_FLIGHT_MAX 4
+#endif
+
+#ifndef CONFIG_BLE_REDUX_POOL_QUANTUM_BYTES
+#define CONFIG_BLE_REDUX_POOL_QUANTUM_BYTES 64
+#endif
+
+#ifndef CONFIG_BLE_REDUX_POOL_LINK_QUEUE_MAX
+#define CONFIG_BLE_REDUX_POOL_LINK_QUEUE_MAX 16
+#endif
+
+namespace BLE
+{
+
+class BLE_Connection_Pool
+{
+public:
+    using Address = BLE_Remote_Profile::Address;
+    // Receives the status and, for reads, the value. Called from the GATTC event handler.
+    using Completion = std::function<void(esp_gatt_status_t, const std::vector<uint8_t>&)>;
+
+    struct limits_t
+    {
+        // The number of links held at the same time, connecting links included.
+        size_t      links_max = CONFIG_BLE_REDUX_POOL_LINKS_MAX;
+        // The number of operations in flight across all links, each link has at most one.
+        size_t      in_flight_max = CONFIG_BLE_REDUX_POOL_IN_FLIGHT_MAX;
+        // The bytes a link is credited every time the scheduler visits it.
+        uint32_t    quantum_bytes = CONFIG_BLE_REDUX_POOL_QUANTUM_BYTES;
+        // The operations a link holds while waiting to be scheduled.
+        size_t      link_queue_max = CONFIG_BLE_REDUX_POOL_LINK_QUEUE_MAX;
+    };
+
+    struct link_metrics_t
+    {
+        uint32_t    completed;
+        uint32_t    failed;
+        // The value bytes read and written since the link was established.
+        uint64_t    bytes;
+        // The bytes per second since the link was established.
+        uint32_t    throughput_bps;
+        size_t      queue_depth;
+        size_t      queue_peak;
+        // The time operations spent queued in the pool before being issued.
+        uint32_t    wait_us_max;
+        // The time from submission to completion.
+        uint32_t    latency_us_mean;
+        int32_t     deficit;
+    };
+
+
+    /**
+     * @brief Retrieve an instance of the current active connection pool or create and return a
+     *        new one if none exist.
+     * @note  The first caller will get the only shared pointer to the pool. Therefore, in order
+     *        to avoid the pool being destroyed, you must keep it alive.
+     * @return A shared pointer to the connection pool.
+     */
+    static std::shared_ptr<BLE_Connection_Pool> get_instance(void);
+
+    /**
+     * @brief Sets the limits of the pool.
+     * @note This function is thread safe, the limits apply from the next scheduling decision.
+     *       Lowering links_max does not close established links.
+     * @param [in] limits The new limits.
+     */
+    void limits_set(const limits_t& limits);
+
+    /**
+     * @brief Retrieves the link to a peripheral, connecting to it if needed.
+     * @detail Established links are returned immediately. Otherwise the call blocks while at most
+     *         CONFIG_BLE_REDUX_POOL_CONNECTING_MAX connection attempts are in progress, then
+     *         connects and discovers the peripheral. The client must have been started.
+     * @param [in] address The address of the peripheral.
+     * @param [in] address_type (default=BLE_ADDR_TYPE_PUBLIC) The type of the address.
+     * @return The profile of the peripheral, nullptr if the pool is full, another task is already
+     *         connecting to the peripheral or the connection failed.
+     */
+    std::shared_ptr<BLE_Remote_Profile> acquire(const Address& address,
+                                                esp_ble_addr_type_t address_type=
+                                                    BLE_ADDR_TYPE_PUBLIC);
+
+    /**
+     * @brief Disconnects from a peripheral and forgets its link.
+     * @detail Operations still queued in the pool complete with ESP_GATT_CANCEL.
+     * @param [in] address The address of the peripheral.
+     */
+    void release(const Address& address);
+
+    /**
+     * @brief Queues a read on the link of the characteristic.
+     * @note This function is thread safe.
+     * @param [in] characteristic The characteristic to read, obtained from an acquired link.
+     * @param [in] completion The function receiving the status and the value.
+     * @return True if the read was queued, false if the link is unknown or its queue is full.
+     */
+    bool read(std::shared_ptr<BLE_Remote_Characteristic> characteristic, Completion completion);
+
+    /**
+     * @brief Queues a write on the link of the characteristic.
+     * @note This function is thread safe.
+     * @param [in] characteristic The characteristic to write, obtained from an acquired link.
+     * @param [in] value The value to write.
+     * @param [in] completion The function receiving the status.
+     * @param [in] response (default=true) Uses a Write Request, otherwise a Write Command.
+     * @return True if the write was queued, false if the link is unknown or its queue is full.
+     */
+    bool write(std::shared_ptr<BLE_Remote_Characteristic> characteristic,
+               std::vector<uint8_t> value, Completion completion, bool response=true);
+
+    /**
+     * @brief Retrieves the metrics of a link.
+     * @note This function is thread safe.
+     * @param [in] address The address of the peripheral.
+     * @return The metrics or std::nullopt if the pool holds no link to the peripheral.
+     */
+    std::optional<link_metrics_t> metrics_get(const Address& address);
+
+    /**
+     * @brief Retrieves the number of links held by the pool.
+     * @note This function is thread safe.
+     * @return The number of established and connecting links.
+     */
+    size_t links_get(void);
+
+private:
+    enum class OP : uint8_t
+    {
+        READ,
+        WRITE,
+        WRITE_NO_RESPONSE,
+    };
+
+    struct job_t
+    {
+        OP                                          type;
+        std::weak_ptr<BLE_Remote_Characteristic>    characteristic;
+        std::vector<uint8_t>                        value;
+        Completion                                  completion;
+        int64_t                                     queued_us;
+    };
+
+    struct dispatch_t
+    {
+        uint64_t    key;
+        job_t       job;
+        // The bytes charged to the link, corrected once the actual size is known.
+        int32_t     cost;
+    };
+
+    // Restarted every time the link is established.
+    struct link_counters_t
+    {
+        int64_t     connected_us;
+        uint32_t    completed;
+        uint32_t    failed;
+        uint64_t    bytes;
+        size_t      queue_peak;
+        uint32_t    wait_us_max;
+        uint64_t    latency_us_total;
+    };
+
+    struct link_t
+    {
+        std::weak_ptr<BLE_Remote_Profile>   profile;
+        std::deque<job_t>                   jobs;
+        int32_t                             deficit = 0;
+        // An operation of the link is in flight, ATT allows a single outstanding request.
+        bool                                busy = false;
+        // The link is in the scheduler's rotation.
+        bool                                active = false;
+        bool                                connecting = false;
+        link_counters_t                     counters = {};
+    };
+
+    using Link_Map = std::unordered_map<uint64_t, link_t>;
+
+
+    BLE_Connection_Pool(void);
+
+    static uint64_t address_key(const uint8_t* address);
+    static bool link_alive(const link_t& link);
+
+    bool submit(std::shared_ptr<BLE_Remote_Characteristic> characteristic, job_t job);
+    void schedule(void);
+    void dispatch(dispatch_t dispatch);
+    void complete(uint64_t key, int32_t refund, size_t bytes, int64_t queued_us,
+                  esp_gatt_status_t status, const std::vector<uint8_t>& value,
+                  const Completion& completion);
+
+
+    static std::weak_ptr<BLE_Connection_Pool>   instance;
+
+    std::shared_ptr<BLE_Client>                 m_client;
+    limits_t                                    m_limits;
+
+    Link_Map                                    m_links;
+    // The links with queued operations, in the order the scheduler visits them.
+    std::deque<uint64_t>                        m_active;
+    size_t                                      m_in_flight = 0;
+    SemaphoreHandle_t                           m_links_semaphore = xSemaphoreCreateBinary();
+
+    SemaphoreHandle_t                           m_connect_slots =
+        xSemaphoreCreateCounting(CONFIG_BLE_REDUX_POOL_CONNECTING_MAX,
+                                 CONFIG_BLE_REDUX_POOL_CONNECTING_MAX);
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_CONNECTION_POOL_HPP
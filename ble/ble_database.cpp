@@ -0,0 +1,151 @@
+/**
+ * @file   ble_database.cpp
+ *
+ * @brief  GATT database hash computation.
+ * @detail The hash is the AES-CMAC, with a zero key, of the handle, type and value of every
+ *         service and characteristic declaration in handle order, as defined by the Core
+ *         Specification (Vol 3, Part G, 7.3). Clients compare it against the hash they cached
+ *         alongside their discovery results to decide whether those results are still valid.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "esp_gatt_defs.h"
+#include "mbedtls/cipher.h"
+#include "mbedtls/cmac.h"
+
+#include "ble_database.hpp"
+#include "uuid.hpp"
+
+#ifndef MBEDTLS_CMAC_C
+#error "The GATT database hash requires CONFIG_MBEDTLS_CMAC_C"
+#endif
+
+namespace BLE
+{
+
+constexpr const uint16_t ATTRIBUTE_TYPE_PRIMARY_SERVICE = 0x2800;
+constexpr const uint16_t ATTRIBUTE_TYPE_SECONDARY_SERVICE = 0x2801;
+constexpr const uint16_t ATTRIBUTE_TYPE_CHARACTERISTIC = 0x2803;
+
+
+/**
+ * @brief Adds a service declaration to the hash input.
+ * @param [in] handle The handle of the service declaration.
+ * @param [in] primary Whether the service is primary or secondary.
+ * @param [in] uuid The UUID of the service.
+ */
+void
+BLE_Database_Hash::service_add(uint16_t handle, bool primary, const UUID& uuid)
+{
+    // Every UUID is registered with the stack in its 128 bit form, see UUID::to_esp_uuid.
+    std::array<uint8_t, 16> raw_uuid = uuid.to_raw_128();
+    attribute_add(handle, primary ? ATTRIBUTE_TYPE_PRIMARY_SERVICE
+                                  : ATTRIBUTE_TYPE_SECONDARY_SERVICE,
+                  raw_uuid.data(), raw_uuid.size());
+}
+
+
+/**
+ * @brief Adds a characteristic declaration to the hash input.
+ * @param [in] value_handle The handle of the characteristic value, the declaration occupies the
+ *             preceding handle.
+ * @param [in] properties The properties of the characteristic.
+ * @param [in] uuid The UUID of the characteristic.
+ */
+void
+BLE_Database_Hash::characteristic_add(uint16_t value_handle, esp_gatt_char_prop_t properties,
+                                      const UUID& uuid)
+{
+    std::array<uint8_t, 16> raw_uuid = uuid.to_raw_128();
+
+    // Properties, value handle and UUID.
+    std::array<uint8_t, 3 + 16> declaration;
+    declaration[0] = properties;
+    declaration[1] = value_handle & 0xFF;
+    declaration[2] = value_handle >> 8;
+    std::copy(raw_uuid.begin(), raw_uuid.end(), declaration.begin() + 3);
+
+    attribute_add(value_handle - 1, ATTRIBUTE_TYPE_CHARACTERISTIC, declaration.data(),
+                  declaration.size());
+}
+
+
+/**
+ * @brief Adds a descriptor whose value is not part of the hash input, such as the Client
+ *        Characteristic Configuration.
+ * @param [in] handle The handle of the descriptor.
+ * @param [in] type The 16 bit UUID of the descriptor.
+ */
+void
+BLE_Database_Hash::descriptor_add(uint16_t handle, uint16_t type)
+{
+    attribute_add(handle, type, nullptr, 0);
+}
+
+
+/**
+ * @brief Computes the hash over every declaration added so far.
+ * @return The database hash, or an all zero hash if the CMAC could not be computed.
+ */
+BLE_Database_Hash::Hash
+BLE_Database_Hash::compute(void)
+{
+    std::sort(m_attributes.begin(), m_attributes.end(),
+              [](const attribute_t& lhs, const attribute_t& rhs){
+                  return lhs.handle < rhs.handle;
+              });
+
+    static const std::array<uint8_t, 16> key = {};
+    Hash hash = {};
+
+    mbedtls_cipher_context_t context;
+    mbedtls_cipher_init(&context);
+    int err = mbedtls_cipher_setup(&context,
+                                   mbedtls_cipher_info_from_type(MBEDTLS_CIPHER_AES_128_ECB));
+    if (!err)
+        err = mbedtls_cipher_cmac_starts(&context, key.data(), key.size() * 8);
+
+    for (size_t i = 0; !err && (i < m_attributes.size()); i++)
+        err = mbedtls_cipher_cmac_update(&context, m_attributes[i].data.data(),
+                                         m_attributes[i].data.size());
+
+    if (!err)
+        err = mbedtls_cipher_cmac_finish(&context, hash.data());
+
+    mbedtls_cipher_free(&context);
+
+    if (err)
+        return {};
+
+    // The CMAC is produced most significant octet first.
+    std::reverse(hash.begin(), hash.end());
+    return hash;
+}
+
+
+void
+BLE_Database_Hash::attribute_add(uint16_t handle, uint16_t type, const uint8_t* value,
+                                 size_t length)
+{
+    attribute_t attribute = {handle, {}};
+    attribute.data.reserve(4 + length);
+    attribute.data.push_back(handle & 0xFF);
+    attribute.data.push_back(handle >> 8);
+    attribute.data.push_back(type & 0xFF);
+    attribute.data.push_back(type >> 8);
+    attribute.data.insert(attribute.data.end(), value, value + length);
+
+    m_attributes.push_back(std::move(attribute));
+}
+
+};
@@ -0,0 +1,91 @@
+/**
+ * @file   ble_database.hpp
+ *
+ * @brief  GATT database hash computation.
+ * @detail The hash is the AES-CMAC, with a zero key, of the handle, type and value of every
+ *         service and characteristic declaration in handle order, as defined by the Core
+ *         Specification (Vol 3, Part G, 7.3). Clients compare it against the hash they cached
+ *         alongside their discovery results to decide whether those results are still valid.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_DATABASE_HPP
+#define COMPONENTS_BLE_BLE_DATABASE_HPP
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+#include "esp_gatt_defs.h"
+
+#include "uuid.hpp"
+
+namespace BLE
+{
+
+class BLE_Database_Hash
+{
+public:
+    // The CMAC output, stored least significant octet first as it is sent over the air.
+    using Hash = std::array<uint8_t, 16>;
+
+    // The service carrying the hash, see BLE_Server::database_service_add.
+    static constexpr const uint128_t UUID_SERVICE =
+        absl::MakeUint128(0x7B5E0401A1B24E8C, 0x9D3F60C1B2A9E4D7);
+    static constexpr const uint16_t UUID_DATABASE_HASH = 0x2B2A;
+
+
+    /**
+     * @brief Adds a service declaration to the hash input.
+     * @param [in] handle The handle of the service declaration.
+     * @param [in] primary Whether the service is primary or secondary.
+     * @param [in] uuid The UUID of the service.
+     */
+    void service_add(uint16_t handle, bool primary, const UUID& uuid);
+
+    /**
+     * @brief Adds a characteristic declaration to the hash input.
+     * @param [in] value_handle The handle of the characteristic value, the declaration occupies
+     *             the preceding handle.
+     * @param [in] properties The properties of the characteristic.
+     * @param [in] uuid The UUID of the characteristic.
+     */
+    void characteristic_add(uint16_t value_handle, esp_gatt_char_prop_t properties,
+                            const UUID& uuid);
+
+    /**
+     * @brief Adds a descriptor whose value is not part of the hash input, such as the Client
+     *        Characteristic Configuration.
+     * @param [in] handle The handle of the descriptor.
+     * @param [in] type The 16 bit UUID of the descriptor.
+     */
+    void descriptor_add(uint16_t handle, uint16_t type);
+
+    /**
+     * @brief Computes the hash over every declaration added so far.
+     * @return The database hash, or an all zero hash if the CMAC could not be computed.
+     */
+    Hash compute(void);
+
+private:
+    struct attribute_t
+    {
+        uint16_t                handle;
+        std::vector<uint8_t>    data;
+    };
+
+
+    void attribute_add(uint16_t handle, uint16_t type, const uint8_t* value, size_t length);
+
+
+    std::vector<attribute_t>    m_attributes;
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_DATABASE_HPP
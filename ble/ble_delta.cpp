@@ -0,0 +1,226 @@
+/**
+ * @file   ble_delta.cpp
+ *
+ * @brief  Delta notifications of large characteristic values.
+ * @detail Keeps the last value each subscriber received and notifies only the byte ranges that
+ *         changed since, encoded by BLE_Delta_Codec, so that the air time of an update follows the
+ *         size of the change instead of the size of the value. Full refreshes go out to new
+ *         subscribers, when the length of the value changes and periodically, so that a client
+ *         which missed a patch resynchronises.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "esp_gatt_defs.h"
+#include "esp_timer.h"
+
+#include "ble_delta.hpp"
+#include "ble_profile.hpp"
+#include "ble_server.hpp"
+#include "ble_service.hpp"
+#include "ble_utilities.hpp"
+
+namespace BLE
+{
+
+/**
+ * @brief Sends the updates of a characteristic value as delta notifications.
+ * @param [in] characteristic A characteristic with the notify or indicate property.
+ * @param [in] refresh_updates (default=32) The patches after which a subscriber receives a full
+ *             refresh, 0 to not count them.
+ * @param [in] refresh_ms (default=10000) The time after which a subscriber receives a full
+ *             refresh with its next update, 0 to not time them.
+ * @return A shared pointer to the notifier, nullptr if the characteristic can not notify.
+ */
+std::shared_ptr<BLE_Delta_Notifier>
+BLE_Delta_Notifier::create(std::shared_ptr<BLE_Characteristic> characteristic,
+                           uint32_t refresh_updates, uint32_t refresh_ms)
+{
+    if (!characteristic ||
+        !(characteristic->properties &
+          (ESP_GATT_CHAR_PROP_BIT_NOTIFY | ESP_GATT_CHAR_PROP_BIT_INDICATE)))
+        return nullptr;
+
+    return std::shared_ptr<BLE_Delta_Notifier>(new BLE_Delta_Notifier(std::move(characteristic),
+                                                                      refresh_updates,
+                                                                      refresh_ms));
+}
+
+
+/**
+ * @brief Sets the value of the characteristic and notifies the changes to every subscriber.
+ * @detail Reads of the characteristic return the whole value. A subscriber whose notification
+ *         fails is sent the changes against the value it last received at the next update.
+ * @note Only one task may update at a time.
+ * @param [in] data The new value.
+ * @param [in] length The length of the new value, at most BLE_Delta_Codec::VALUE_LENGTH_MAX.
+ * @return The number of subscribers notified.
+ */
+size_t
+BLE_Delta_Notifier::update(const uint8_t* data, size_t length)
+{
+    if (!data || (length > BLE_Delta_Codec::VALUE_LENGTH_MAX))
+        return 0;
+
+    m_characteristic->value_update(length, [data, length](uint8_t* value, size_t){
+        memcpy(value, data, length);
+    });
+    m_updates.fetch_add(1, std::memory_order_relaxed);
+
+    // Subscribers which left are forgotten, a peer subscribing again starts with a full refresh.
+    std::vector<uint16_t> subscribers = m_characteristic->subscribers_get();
+    for (auto it = m_subscribers.begin(); it != m_subscribers.end();)
+    {
+        if (std::find(subscribers.begin(), subscribers.end(), it->first) == subscribers.end())
+            it = m_subscribers.erase(it);
+        else
+            ++it;
+    }
+
+    auto service = m_characteristic->service.lock();
+    auto profile = service ? service->profile.lock() : nullptr;
+    auto server = profile ? profile->server.lock() : nullptr;
+    bool refresh = m_refresh.exchange(false, std::memory_order_relaxed);
+    int64_t now_us = esp_timer_get_time();
+
+    size_t notified = 0;
+    for (uint16_t connection_id : subscribers)
+    {
+        subscriber_t& subscriber = m_subscribers[connection_id];
+        auto connection = server ? server->connection_get(connection_id) : std::nullopt;
+
+        // Connection identifiers are reused, a different peer behind one holds nothing.
+        if (connection && memcmp(subscriber.bda, connection->bda, sizeof(esp_bd_addr_t)))
+        {
+            memcpy(subscriber.bda, connection->bda, sizeof(esp_bd_addr_t));
+            subscriber.valid = false;
+        }
+
+        size_t capacity = std::min(m_characteristic->notification_capacity_get(connection_id),
+                                   m_packet.size());
+
+        bool full = refresh || !subscriber.valid || (subscriber.value.size() != length) ||
+                    (m_refresh_updates && (subscriber.patches >= m_refresh_updates)) ||
+                    (m_refresh_ms && (now_us - subscriber.refreshed_us >= m_refresh_ms * 1000LL));
+        if (!full && std::equal(subscriber.value.begin(), subscriber.value.end(), data))
+            continue;
+
+        size_t packet_length = 0;
+        if (!full)
+        {
+            packet_length = BLE_Delta_Codec::patch_encode(subscriber.value.data(), data, length,
+                                                          subscriber.sequence, m_packet.data(),
+                                                          capacity);
+
+            // A change spread over the value is cheaper to send whole.
+            full = !packet_length || (packet_length >= BLE_Delta_Codec::FULL_HEADER_LENGTH +
+                                                       length);
+        }
+
+        m_bytes_full.fetch_add(length, std::memory_order_relaxed);
+        if (full)
+        {
+            notified += full_send(connection_id, subscriber, data, length, capacity);
+            continue;
+        }
+
+        // The subscriber keeps its value on failure, the next patch covers both changes.
+        if (!m_characteristic->notify(connection_id, m_packet.data(), packet_length))
+        {
+            m_send_failed.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        std::copy(data, data + length, subscriber.value.begin());
+        subscriber.sequence++;
+        subscriber.patches++;
+        m_patches.fetch_add(1, std::memory_order_relaxed);
+        m_bytes_sent.fetch_add(packet_length, std::memory_order_relaxed);
+        notified++;
+    }
+
+    return notified;
+}
+
+
+/**
+ * @brief Sends every subscriber a full refresh with the next update, e.g. after a client reported
+ *        a lost patch.
+ * @note This function is thread safe.
+ */
+void
+BLE_Delta_Notifier::refresh(void)
+{
+    m_refresh.store(true, std::memory_order_relaxed);
+}
+
+
+/**
+ * @brief Retrieves the delta counters.
+ * @param [in] reset (default=false) Zeroes the counters after reading them.
+ * @return A copy of the counters.
+ */
+BLE_Delta_Notifier::counters_t
+BLE_Delta_Notifier::counters_get(bool reset)
+{
+    auto read = [reset](auto& counter){
+        return reset ? counter.exchange(0, std::memory_order_relaxed)
+                     : counter.load(std::memory_order_relaxed);
+    };
+
+    counters_t counters;
+    counters.updates = read(m_updates);
+    counters.patches = read(m_patches);
+    counters.refreshes = read(m_refreshes);
+    counters.send_failed = read(m_send_failed);
+    counters.bytes_sent = read(m_bytes_sent);
+    counters.bytes_full = read(m_bytes_full);
+    return counters;
+}
+
+
+bool
+BLE_Delta_Notifier::full_send(uint16_t connection_id, subscriber_t& subscriber,
+                              const uint8_t* data, size_t length, size_t capacity)
+{
+    // Values longer than the MTU are refreshed in chunks, an empty value in a single header.
+    size_t offset = 0;
+    do
+    {
+        size_t packet_length = BLE_Delta_Codec::full_encode(data, length, offset,
+                                                            subscriber.sequence, m_packet.data(),
+                                                            capacity);
+        if (!packet_length || !m_characteristic->notify(connection_id, m_packet.data(),
+                                                        packet_length))
+        {
+            // The subscriber may hold part of the refresh, it is sent whole again next time.
+            m_send_failed.fetch_add(1, std::memory_order_relaxed);
+            subscriber.valid = false;
+            return false;
+        }
+
+        subscriber.sequence++;
+        offset += packet_length - BLE_Delta_Codec::FULL_HEADER_LENGTH;
+        m_refreshes.fetch_add(1, std::memory_order_relaxed);
+        m_bytes_sent.fetch_add(packet_length, std::memory_order_relaxed);
+    } while (offset < length);
+
+    subscriber.value.assign(data, data + length);
+    subscriber.valid = true;
+    subscriber.patches = 0;
+    subscriber.refreshed_us = esp_timer_get_time();
+    return true;
+}
+
+};
@@ -0,0 +1,134 @@
+/**
+ * @file   ble_delta.hpp
+ *
+ * @brief  Delta notifications of large characteristic values.
+ * @detail Keeps the last value each subscriber received and notifies only the byte ranges that
+ *         changed since, encoded by BLE_Delta_Codec, so that the air time of an update follows the
+ *         size of the change instead of the size of the value. Full refreshes go out to new
+ *         subscribers, when the length of the value changes and periodically, so that a client
+ *         which missed a patch resynchronises.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_DELTA_HPP
+#define COMPONENTS_BLE_BLE_DELTA_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+#include "esp_bt_defs.h"
+
+#include "ble_characteristic.hpp"
+#include "ble_delta_codec.hpp"
+
+namespace BLE
+{
+
+class BLE_Delta_Notifier
+{
+public:
+    struct counters_t
+    {
+        uint32_t    updates;
+        uint32_t    patches;
+        // Notifications carrying a chunk of a full refresh.
+        uint32_t    refreshes;
+        uint32_t    send_failed;
+        // The bytes sent, headers included, and what notifying the whole value every time takes.
+        uint64_t    bytes_sent;
+        uint64_t    bytes_full;
+    };
+
+
+    /**
+     * @brief Sends the updates of a characteristic value as delta notifications.
+     * @param [in] characteristic A characteristic with the notify or indicate property.
+     * @param [in] refresh_updates (default=32) The patches after which a subscriber receives a full
+     *             refresh, 0 to not count them.
+     * @param [in] refresh_ms (default=10000) The time after which a subscriber receives a full
+     *             refresh with its next update, 0 to not time them.
+     * @return A shared pointer to the notifier, nullptr if the characteristic can not notify.
+     */
+    static std::shared_ptr<BLE_Delta_Notifier> create(
+        std::shared_ptr<BLE_Characteristic> characteristic, uint32_t refresh_updates=32,
+        uint32_t refresh_ms=10000);
+
+    BLE_Delta_Notifier(const BLE_Delta_Notifier&) = delete;
+    BLE_Delta_Notifier& operator=(const BLE_Delta_Notifier&) = delete;
+
+    /**
+     * @brief Sets the value of the characteristic and notifies the changes to every subscriber.
+     * @detail Reads of the characteristic return the whole value. A subscriber whose notification
+     *         fails is sent the changes against the value it last received at the next update.
+     * @note Only one task may update at a time.
+     * @param [in] data The new value.
+     * @param [in] length The length of the new value, at most BLE_Delta_Codec::VALUE_LENGTH_MAX.
+     * @return The number of subscribers notified.
+     */
+    size_t update(const uint8_t* data, size_t length);
+
+    /**
+     * @brief Sends every subscriber a full refresh with the next update, e.g. after a client
+     *        reported a lost patch.
+     * @note This function is thread safe.
+     */
+    void refresh(void);
+
+    /**
+     * @brief Retrieves the delta counters.
+     * @param [in] reset (default=false) Zeroes the counters after reading them.
+     * @return A copy of the counters.
+     */
+    counters_t counters_get(bool reset=false);
+
+private:
+    struct subscriber_t
+    {
+        esp_bd_addr_t           bda = {};
+        // The value the subscriber holds, empty until it received a full refresh.
+        std::vector<uint8_t>    value;
+        bool                    valid = false;
+        uint8_t                 sequence = 0;
+        uint32_t                patches = 0;
+        int64_t                 refreshed_us = 0;
+    };
+
+    BLE_Delta_Notifier(std::shared_ptr<BLE_Characteristic> characteristic,
+                       uint32_t refresh_updates, uint32_t refresh_ms)
+        : m_characteristic(std::move(characteristic)), m_refresh_updates(refresh_updates),
+          m_refresh_ms(refresh_ms) {}
+
+    bool full_send(uint16_t connection_id, subscriber_t& subscriber, const uint8_t* data,
+                   size_t length, size_t capacity);
+
+
+    const std::shared_ptr<BLE_Characteristic>                       m_characteristic;
+    const uint32_t                                                  m_refresh_updates;
+    const uint32_t                                                  m_refresh_ms;
+
+    // Owned by the updating task.
+    std::unordered_map<uint16_t, subscriber_t>                      m_subscribers;
+    std::array<uint8_t, BLE_Delta_Codec::VALUE_LENGTH_MAX>          m_packet;
+    std::atomic<bool>                                               m_refresh{false};
+
+    std::atomic<uint32_t>   m_updates{0};
+    std::atomic<uint32_t>   m_patches{0};
+    std::atomic<uint32_t>   m_refreshes{0};
+    std::atomic<uint32_t>   m_send_failed{0};
+    std::atomic<uint64_t>   m_bytes_sent{0};
+    std::atomic<uint64_t>   m_bytes_full{0};
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_DELTA_HPP
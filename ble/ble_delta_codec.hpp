@@ -0,0 +1,196 @@
+/**
+ * @file   ble_delta_codec.hpp
+ *
+ * @brief  Encoding of value changes as byte range patches.
+ * @detail A patch lists the byte ranges in which a value differs from the previous one, as
+ *         (offset, length, bytes) runs, so that a small change to a large value costs about the
+ *         size of the change on the air. Full refreshes carry the whole value in one or more
+ *         chunks. Packets start with their type and a sequence number which lets clients detect a
+ *         lost patch and wait for the next refresh. The header has no dependency on ESP-IDF so
+ *         that clients and host tools can decode packets with it.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_DELTA_CODEC_HPP
+#define COMPONENTS_BLE_BLE_DELTA_CODEC_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+namespace BLE
+{
+
+class BLE_Delta_Codec
+{
+public:
+    enum class Type : uint8_t
+    {
+        // The total length, the offset of the chunk and the bytes of the chunk.
+        FULL,
+        // Runs of the offset, the length and the bytes of a changed range.
+        PATCH,
+    };
+
+    // The type and the sequence number.
+    static constexpr const size_t HEADER_LENGTH = 2;
+    static constexpr const size_t FULL_HEADER_LENGTH = HEADER_LENGTH + 2 * sizeof(uint16_t);
+    static constexpr const size_t RUN_HEADER_LENGTH = sizeof(uint16_t) + sizeof(uint8_t);
+    static constexpr const size_t RUN_LENGTH_MAX = UINT8_MAX;
+    static constexpr const size_t VALUE_LENGTH_MAX = 512;
+
+
+    /**
+     * @brief Encodes the changes between two values of the same length as a patch.
+     * @detail Ranges separated by fewer unchanged bytes than a run header are merged into a single
+     *         run.
+     * @param [in] previous The value the receiver holds.
+     * @param [in] current The new value.
+     * @param [in] length The length of both values.
+     * @param [in] sequence The sequence number of the packet.
+     * @param [out] out The packet.
+     * @param [in] capacity The length the packet may grow to.
+     * @return The length of the packet, 0 if it does not fit the capacity.
+     */
+    static size_t patch_encode(const uint8_t* previous, const uint8_t* current, size_t length,
+                               uint8_t sequence, uint8_t* out, size_t capacity)
+    {
+        if (capacity < HEADER_LENGTH)
+            return 0;
+
+        out[0] = static_cast<uint8_t>(Type::PATCH);
+        out[1] = sequence;
+        size_t used = HEADER_LENGTH;
+        for (size_t i = 0; i < length;)
+        {
+            if (previous[i] == current[i])
+            {
+                i++;
+                continue;
+            }
+
+            // Extends the run over short gaps, bridging fewer than RUN_HEADER_LENGTH unchanged
+            // bytes is cheaper than starting a new run.
+            size_t start = i;
+            size_t end = i + 1;
+            for (size_t next = end; (next < length) && (next - start < RUN_LENGTH_MAX); next++)
+            {
+                if (previous[next] != current[next])
+                    end = next + 1;
+                else if (next - end >= RUN_HEADER_LENGTH - 1)
+                    break;
+            }
+
+            size_t run = end - start;
+            if (used + RUN_HEADER_LENGTH + run > capacity)
+                return 0;
+
+            out[used++] = static_cast<uint8_t>(start);
+            out[used++] = static_cast<uint8_t>(start >> 8);
+            out[used++] = static_cast<uint8_t>(run);
+            memcpy(out + used, current + start, run);
+            used += run;
+            i = end;
+        }
+
+        return used;
+    }
+
+    /**
+     * @brief Encodes a chunk of a full refresh.
+     * @param [in] current The value.
+     * @param [in] length The length of the value.
+     * @param [in] offset The offset of the chunk, 0 for the first one.
+     * @param [in] sequence The sequence number of the packet.
+     * @param [out] out The packet.
+     * @param [in] capacity The length the packet may grow to.
+     * @return The length of the packet, 0 if the capacity does not fit a byte of the value.
+     *         The next chunk starts at offset + (length - FULL_HEADER_LENGTH).
+     */
+    static size_t full_encode(const uint8_t* current, size_t length, size_t offset,
+                              uint8_t sequence, uint8_t* out, size_t capacity)
+    {
+        if ((capacity <= FULL_HEADER_LENGTH) && (offset < length))
+            return 0;
+
+        size_t chunk = std::min(length - std::min(offset, length), capacity - FULL_HEADER_LENGTH);
+        out[0] = static_cast<uint8_t>(Type::FULL);
+        out[1] = sequence;
+        out[2] = static_cast<uint8_t>(length);
+        out[3] = static_cast<uint8_t>(length >> 8);
+        out[4] = static_cast<uint8_t>(offset);
+        out[5] = static_cast<uint8_t>(offset >> 8);
+        memcpy(out + FULL_HEADER_LENGTH, current + offset, chunk);
+        return FULL_HEADER_LENGTH + chunk;
+    }
+
+    /**
+     * @brief Applies a packet to the receiver's copy of the value.
+     * @note Check the sequence number (packet[1]) first, after a gap patches must be discarded
+     *       until the next full refresh.
+     * @param [in] packet The packet.
+     * @param [in] length The length of the packet.
+     * @param [in,out] value The receiver's copy of the value.
+     * @param [in,out] value_length The length of the copy, updated by full refreshes.
+     * @param [in] value_capacity The length the copy may grow to.
+     * @return True if the packet was applied, false if it is malformed or out of bounds.
+     */
+    static bool apply(const uint8_t* packet, size_t length, uint8_t* value, size_t& value_length,
+                      size_t value_capacity)
+    {
+        if (length < HEADER_LENGTH)
+            return false;
+
+        if (packet[0] == static_cast<uint8_t>(Type::FULL))
+        {
+            if (length < FULL_HEADER_LENGTH)
+                return false;
+
+            size_t total = packet[2] | (packet[3] << 8);
+            size_t offset = packet[4] | (packet[5] << 8);
+            size_t chunk = length - FULL_HEADER_LENGTH;
+            if ((total > value_capacity) || (offset + chunk > total))
+                return false;
+
+            memcpy(value + offset, packet + FULL_HEADER_LENGTH, chunk);
+            value_length = total;
+            return true;
+        }
+
+        if (packet[0] != static_cast<uint8_t>(Type::PATCH))
+            return false;
+
+        // Validated as a whole first so that a malformed patch leaves the value untouched.
+        for (int pass = 0; pass < 2; pass++)
+        {
+            for (size_t i = HEADER_LENGTH; i < length;)
+            {
+                if (i + RUN_HEADER_LENGTH > length)
+                    return false;
+
+                size_t offset = packet[i] | (packet[i + 1] << 8);
+                size_t run = packet[i + 2];
+                i += RUN_HEADER_LENGTH;
+                if ((i + run > length) || (offset + run > value_length))
+                    return false;
+
+                if (pass)
+                    memcpy(value + offset, packet + i, run);
+
+                i += run;
+            }
+        }
+
+        return true;
+    }
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_DELTA_CODEC_HPP
@@ -0,0 +1,174 @@
+/**
+ * @file   ble_gattc.cpp
+ *
+ * @brief  The GATT client layer used by the BLE client.
+ * @detail Every call the client makes into the Bluedroid GATTC API goes through this interface,
+ *         and every event it handles comes back through the registered callback. The default
+ *         implementation forwards to esp_ble_gattc_*. Applications may substitute their own
+ *         implementation, e.g. to record or inject events, no other implementation ships with the
+ *         library.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "esp_gattc_api.h"
+#include "esp_gatt_defs.h"
+
+#include "ble_gattc.hpp"
+
+namespace BLE
+{
+
+BLE_GATTC_Interface::Callback BLE_GATTC_ESP::callback;
+
+
+esp_err_t
+BLE_GATTC_ESP::callback_register(Callback callback)
+{
+    BLE_GATTC_ESP::callback = std::move(callback);
+    return esp_ble_gattc_register_callback([](esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if,
+                                              esp_ble_gattc_cb_param_t *param)
+                                           {
+                                               if (BLE_GATTC_ESP::callback)
+                                                   BLE_GATTC_ESP::callback(event, gattc_if, param);
+                                           });
+}
+
+
+esp_err_t
+BLE_GATTC_ESP::app_register(uint16_t app_id)
+{
+    return esp_ble_gattc_app_register(app_id);
+}
+
+
+esp_err_t
+BLE_GATTC_ESP::open(esp_gatt_if_t gattc_if, const esp_bd_addr_t address,
+                    esp_ble_addr_type_t address_type)
+{
+    esp_bd_addr_t remote_address;
+    memcpy(remote_address, address, sizeof(esp_bd_addr_t));
+    return esp_ble_gattc_open(gattc_if, remote_address, address_type, true);
+}
+
+
+esp_err_t
+BLE_GATTC_ESP::close(esp_gatt_if_t gattc_if, uint16_t connection_id)
+{
+    return esp_ble_gattc_close(gattc_if, connection_id);
+}
+
+
+esp_err_t
+BLE_GATTC_ESP::mtu_request(esp_gatt_if_t gattc_if, uint16_t connection_id)
+{
+    return esp_ble_gattc_send_mtu_req(gattc_if, connection_id);
+}
+
+
+esp_err_t
+BLE_GATTC_ESP::service_search(esp_gatt_if_t gattc_if, uint16_t connection_id)
+{
+    return esp_ble_gattc_search_service(gattc_if, connection_id, nullptr);
+}
+
+
+esp_err_t
+BLE_GATTC_ESP::read(esp_gatt_if_t gattc_if, uint16_t connection_id, uint16_t handle)
+{
+    return esp_ble_gattc_read_char(gattc_if, connection_id, handle, ESP_GATT_AUTH_REQ_NONE);
+}
+
+
+esp_err_t
+BLE_GATTC_ESP::write(esp_gatt_if_t gattc_if, uint16_t connection_id, uint16_t handle,
+                     const std::vector<uint8_t>& value, esp_gatt_write_type_t type)
+{
+    // The stack copies the value before returning, it is never written through.
+    return esp_ble_gattc_write_char(gattc_if, connection_id, handle, value.size(),
+                                    const_cast<uint8_t*>(value.data()), type,
+                                    ESP_GATT_AUTH_REQ_NONE);
+}
+
+
+esp_err_t
+BLE_GATTC_ESP::descriptor_write(esp_gatt_if_t gattc_if, uint16_t connection_id, uint16_t handle,
+                                const std::vector<uint8_t>& value)
+{
+    return esp_ble_gattc_write_char_descr(gattc_if, connection_id, handle, value.size(),
+                                          const_cast<uint8_t*>(value.data()),
+                                          ESP_GATT_WRITE_TYPE_RSP, ESP_GATT_AUTH_REQ_NONE);
+}
+
+
+esp_err_t
+BLE_GATTC_ESP::notify_register(esp_gatt_if_t gattc_if, const esp_bd_addr_t address,
+                               uint16_t handle)
+{
+    esp_bd_addr_t remote_address;
+    memcpy(remote_address, address, sizeof(esp_bd_addr_t));
+    return esp_ble_gattc_register_for_notify(gattc_if, remote_address, handle);
+}
+
+
+esp_err_t
+BLE_GATTC_ESP::notify_unregister(esp_gatt_if_t gattc_if, const esp_bd_addr_t address,
+                                 uint16_t handle)
+{
+    esp_bd_addr_t remote_address;
+    memcpy(remote_address, address, sizeof(esp_bd_addr_t));
+    return esp_ble_gattc_unregister_for_notify(gattc_if, remote_address, handle);
+}
+
+
+std::vector<esp_gattc_char_elem_t>
+BLE_GATTC_ESP::characteristics_get(esp_gatt_if_t gattc_if, uint16_t connection_id,
+                                   uint16_t start_handle, uint16_t end_handle)
+{
+    uint16_t count = 0;
+    esp_gatt_status_t status = esp_ble_gattc_get_attr_count(gattc_if, connection_id,
+                                                            ESP_GATT_DB_CHARACTERISTIC,
+                                                            start_handle, end_handle,
+                                                            ESP_GATT_ILLEGAL_HANDLE, &count);
+    if ((status != ESP_GATT_OK) || !count)
+        return {};
+
+    std::vector<esp_gattc_char_elem_t> characteristics(count);
+    status = esp_ble_gattc_get_all_char(gattc_if, connection_id, start_handle, end_handle,
+                                        characteristics.data(), &count, 0);
+    if (status != ESP_GATT_OK)
+        return {};
+
+    characteristics.resize(count);
+    return characteristics;
+}
+
+
+uint16_t
+BLE_GATTC_ESP::descriptor_find(esp_gatt_if_t gattc_if, uint16_t connection_id,
+                               uint16_t characteristic_handle, uint16_t type)
+{
+    esp_bt_uuid_t uuid = {};
+    uuid.len = ESP_UUID_LEN_16;
+    uuid.uuid.uuid16 = type;
+
+    esp_gattc_descr_elem_t descriptor;
+    uint16_t count = 1;
+    esp_gatt_status_t status = esp_ble_gattc_get_descr_by_char_handle(gattc_if, connection_id,
+                                                                      characteristic_handle, uuid,
+                                                                      &descriptor, &count);
+    if ((status != ESP_GATT_OK) || !count)
+        return 0;
+
+    return descriptor.handle;
+}
+
+};
@@ -0,0 +1,126 @@
+/**
+ * @file   ble_gattc.hpp
+ *
+ * @brief  The GATT client layer used by the BLE client.
+ * @detail Every call the client makes into the Bluedroid GATTC API goes through this interface,
+ *         and every event it handles comes back through the registered callback. The default
+ *         implementation forwards to esp_ble_gattc_*. Applications may substitute their own
+ *         implementation, e.g. to record or inject events, no other implementation ships with the
+ *         library.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_GATTC_HPP
+#define COMPONENTS_BLE_BLE_GATTC_HPP
+
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "esp_gap_ble_api.h"
+#include "esp_gattc_api.h"
+#include "esp_gatt_defs.h"
+
+namespace BLE
+{
+
+class BLE_GATTC_Interface
+{
+public:
+    using Callback = std::function<void(esp_gattc_cb_event_t, esp_gatt_if_t,
+                                        esp_ble_gattc_cb_param_t*)>;
+
+
+    virtual ~BLE_GATTC_Interface() = default;
+
+    /**
+     * @brief Sets the function every GATTC event is delivered to.
+     * @param [in] callback The event handler.
+     * @return ESP_OK on success, an error code otherwise.
+     */
+    virtual esp_err_t callback_register(Callback callback) = 0;
+
+    // The remaining functions mirror the esp_ble_gattc_* function of the same name, their
+    // completion is reported through the registered callback.
+    virtual esp_err_t app_register(uint16_t app_id) = 0;
+    virtual esp_err_t open(esp_gatt_if_t gattc_if, const esp_bd_addr_t address,
+                           esp_ble_addr_type_t address_type) = 0;
+    virtual esp_err_t close(esp_gatt_if_t gattc_if, uint16_t connection_id) = 0;
+    virtual esp_err_t mtu_request(esp_gatt_if_t gattc_if, uint16_t connection_id) = 0;
+    virtual esp_err_t service_search(esp_gatt_if_t gattc_if, uint16_t connection_id) = 0;
+    virtual esp_err_t read(esp_gatt_if_t gattc_if, uint16_t connection_id, uint16_t handle) = 0;
+    virtual esp_err_t write(esp_gatt_if_t gattc_if, uint16_t connection_id, uint16_t handle,
+                            const std::vector<uint8_t>& value, esp_gatt_write_type_t type) = 0;
+    virtual esp_err_t descriptor_write(esp_gatt_if_t gattc_if, uint16_t connection_id,
+                                       uint16_t handle, const std::vector<uint8_t>& value) = 0;
+    virtual esp_err_t notify_register(esp_gatt_if_t gattc_if, const esp_bd_addr_t address,
+                                      uint16_t handle) = 0;
+    virtual esp_err_t notify_unregister(esp_gatt_if_t gattc_if, const esp_bd_addr_t address,
+                                        uint16_t handle) = 0;
+
+    /**
+     * @brief Retrieves the characteristics of a discovered service from the local cache.
+     * @param [in] gattc_if The GATTC interface of the client.
+     * @param [in] connection_id The connection of interest.
+     * @param [in] start_handle The first handle of the service.
+     * @param [in] end_handle The last handle of the service.
+     * @return The characteristics of the service, empty if there are none or the lookup failed.
+     */
+    virtual std::vector<esp_gattc_char_elem_t> characteristics_get(esp_gatt_if_t gattc_if,
+                                                                   uint16_t connection_id,
+                                                                   uint16_t start_handle,
+                                                                   uint16_t end_handle) = 0;
+
+    /**
+     * @brief Retrieves the handle of a descriptor of a discovered characteristic from the local
+     *        cache.
+     * @param [in] gattc_if The GATTC interface of the client.
+     * @param [in] connection_id The connection of interest.
+     * @param [in] characteristic_handle The value handle of the characteristic.
+     * @param [in] type The 16 bit UUID of the descriptor.
+     * @return The handle of the descriptor, 0 if the characteristic has none.
+     */
+    virtual uint16_t descriptor_find(esp_gatt_if_t gattc_if, uint16_t connection_id,
+                                     uint16_t characteristic_handle, uint16_t type) = 0;
+};
+
+
+class BLE_GATTC_ESP : public BLE_GATTC_Interface
+{
+public:
+    esp_err_t callback_register(Callback callback) override;
+    esp_err_t app_register(uint16_t app_id) override;
+    esp_err_t open(esp_gatt_if_t gattc_if, const esp_bd_addr_t address,
+                   esp_ble_addr_type_t address_type) override;
+    esp_err_t close(esp_gatt_if_t gattc_if, uint16_t connection_id) override;
+    esp_err_t mtu_request(esp_gatt_if_t gattc_if, uint16_t connection_id) override;
+    esp_err_t service_search(esp_gatt_if_t gattc_if, uint16_t connection_id) override;
+    esp_err_t read(esp_gatt_if_t gattc_if, uint16_t connection_id, uint16_t handle) override;
+    esp_err_t write(esp_gatt_if_t gattc_if, uint16_t connection_id, uint16_t handle,
+                    const std::vector<uint8_t>& value, esp_gatt_write_type_t type) override;
+    esp_err_t descriptor_write(esp_gatt_if_t gattc_if, uint16_t connection_id, uint16_t handle,
+                               const std::vector<uint8_t>& value) override;
+    esp_err_t notify_register(esp_gatt_if_t gattc_if, const esp_bd_addr_t address,
+                              uint16_t handle) override;
+    esp_err_t notify_unregister(esp_gatt_if_t gattc_if, const esp_bd_addr_t address,
+                                uint16_t handle) override;
+    std::vector<esp_gattc_char_elem_t> characteristics_get(esp_gatt_if_t gattc_if,
+                                                           uint16_t connection_id,
+                                                           uint16_t start_handle,
+                                                           uint16_t end_handle) override;
+    uint16_t descriptor_find(esp_gatt_if_t gattc_if, uint16_t connection_id,
+                             uint16_t characteristic_handle, uint16_t type) override;
+
+private:
+    // Bluedroid takes a plain function pointer, so the active callback has to be static.
+    static Callback     callback;
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_GATTC_HPP
@@ -0,0 +1,129 @@
+/**
+ * @file   ble_histogram.cpp
+ *
+ * @brief  Fixed memory log-linear latency histogram.
+ * @detail Values are grouped into power of two ranges which are further split into linear
+ *         sub-buckets, giving a bounded relative error across the whole range with a constant
+ *         number of buckets. Recording is lock-free and never allocates.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "ble_histogram.hpp"
+
+namespace BLE
+{
+
+/**
+ * @brief Retrieves the bucket a value would be recorded in.
+ * @param [in] latency_us The value of interest.
+ * @return The index of the bucket.
+ */
+size_t
+BLE_Latency_Histogram::bucket_index(uint32_t latency_us)
+{
+    if (latency_us < SUB_BUCKET_COUNT)
+        return latency_us;
+
+    if (latency_us >= (1u << MAGNITUDE_MAX))
+        return BUCKET_COUNT - 1;
+
+    uint32_t magnitude = 31 - __builtin_clz(latency_us);
+    uint32_t sub_bucket = (latency_us >> (magnitude - SUB_BUCKET_BITS)) & (SUB_BUCKET_COUNT - 1);
+    return (SUB_BUCKET_COUNT * (magnitude - SUB_BUCKET_BITS + 1)) + sub_bucket;
+}
+
+
+/**
+ * @brief Retrieves the smallest value that is recorded in a bucket.
+ * @param [in] index The index of the bucket of interest.
+ * @return The lower bound of the bucket in microseconds.
+ */
+uint32_t
+BLE_Latency_Histogram::bucket_lower_bound(size_t index)
+{
+    if (index < SUB_BUCKET_COUNT)
+        return index;
+
+    if (index >= BUCKET_COUNT - 1)
+        return 1u << MAGNITUDE_MAX;
+
+    uint32_t magnitude = (index / SUB_BUCKET_COUNT) + SUB_BUCKET_BITS - 1;
+    uint32_t sub_bucket = index % SUB_BUCKET_COUNT;
+    return (SUB_BUCKET_COUNT + sub_bucket) << (magnitude - SUB_BUCKET_BITS);
+}
+
+
+/**
+ * @brief Records a single latency sample.
+ * @note This function is lock-free, allocation free and safe to call from any task.
+ * @param [in] latency_us The latency in microseconds.
+ */
+void
+BLE_Latency_Histogram::record(uint32_t latency_us)
+{
+    m_buckets[bucket_index(latency_us)].fetch_add(1, std::memory_order_relaxed);
+    m_count.fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t max_us = m_max_us.load(std::memory_order_relaxed);
+    while ((latency_us > max_us) &&
+           !m_max_us.compare_exchange_weak(max_us, latency_us, std::memory_order_relaxed));
+}
+
+
+/**
+ * @brief Captures the current state of the histogram.
+ * @param [in] reset (default=false) Clears each counter as it is read, samples recorded
+ *                   concurrently are either part of this snapshot or the next one.
+ * @return A copy of the histogram counters.
+ */
+BLE_Latency_Histogram::snapshot_t
+BLE_Latency_Histogram::snapshot(bool reset)
+{
+    snapshot_t snapshot;
+    for (size_t i = 0; i < BUCKET_COUNT; i++)
+        snapshot.buckets[i] = reset ? m_buckets[i].exchange(0) : m_buckets[i].load();
+
+    snapshot.count = reset ? m_count.exchange(0) : m_count.load();
+    snapshot.max_us = reset ? m_max_us.exchange(0) : m_max_us.load();
+
+    return snapshot;
+}
+
+
+/**
+ * @brief Estimates a percentile from the bucketed values.
+ * @param [in] percentile The percentile of interest in the range [0, 100].
+ * @return The upper bound of the bucket containing the percentile, in microseconds.
+ */
+uint32_t
+BLE_Latency_Histogram::snapshot_t::percentile(float percentile) const
+{
+    uint32_t total = 0;
+    for (uint32_t bucket : buckets)
+        total += bucket;
+
+    if (total == 0)
+        return 0;
+
+    uint32_t target = std::max<uint32_t>(1, (total * std::min(percentile, 100.0f)) / 100.0f);
+    uint32_t seen = 0;
+    for (size_t i = 0; i < BUCKET_COUNT - 1; i++)
+    {
+        seen += buckets[i];
+        if (seen >= target)
+            return std::min(bucket_lower_bound(i + 1) - 1, max_us);
+    }
+
+    return max_us;
+}
+
+};
@@ -0,0 +1,93 @@
+/**
+ * @file   ble_histogram.hpp
+ *
+ * @brief  Fixed memory log-linear latency histogram.
+ * @detail Values are grouped into power of two ranges which are further split into linear
+ *         sub-buckets, giving a bounded relative error across the whole range with a constant
+ *         number of buckets. Recording is lock-free and never allocates.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_HISTOGRAM_HPP
+#define COMPONENTS_BLE_BLE_HISTOGRAM_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace BLE
+{
+
+class BLE_Latency_Histogram
+{
+public:
+    // Each power of two range is split into 2^SUB_BUCKET_BITS linear buckets (~25% error).
+    static constexpr const uint32_t SUB_BUCKET_BITS = 2;
+    static constexpr const uint32_t SUB_BUCKET_COUNT = 1 << SUB_BUCKET_BITS;
+
+    // Values up to 2^MAGNITUDE_MAX microseconds (~8.4 seconds) are bucketed, larger values are
+    // counted in the final overflow bucket.
+    static constexpr const uint32_t MAGNITUDE_MAX = 23;
+    static constexpr const size_t BUCKET_COUNT = (SUB_BUCKET_COUNT *
+                                                  (MAGNITUDE_MAX - SUB_BUCKET_BITS + 1)) + 1;
+
+
+    struct snapshot_t
+    {
+        std::array<uint32_t, BUCKET_COUNT>  buckets;
+        uint32_t                            count;
+        uint32_t                            max_us;
+
+        /**
+         * @brief Estimates a percentile from the bucketed values.
+         * @param [in] percentile The percentile of interest in the range [0, 100].
+         * @return The upper bound of the bucket containing the percentile, in microseconds.
+         */
+        uint32_t percentile(float percentile) const;
+    };
+
+
+    /**
+     * @brief Records a single latency sample.
+     * @note This function is lock-free, allocation free and safe to call from any task.
+     * @param [in] latency_us The latency in microseconds.
+     */
+    void record(uint32_t latency_us);
+
+    /**
+     * @brief Captures the current state of the histogram.
+     * @param [in] reset (default=false) Clears each counter as it is read, samples recorded
+     *                   concurrently are either part of this snapshot or the next one.
+     * @return A copy of the histogram counters.
+     */
+    snapshot_t snapshot(bool reset=false);
+
+    /**
+     * @brief Retrieves the bucket a value would be recorded in.
+     * @param [in] latency_us The value of interest.
+     * @return The index of the bucket.
+     */
+    static size_t bucket_index(uint32_t latency_us);
+
+    /**
+     * @brief Retrieves the smallest value that is recorded in a bucket.
+     * @param [in] index The index of the bucket of interest.
+     * @return The lower bound of the bucket in microseconds.
+     */
+    static uint32_t bucket_lower_bound(size_t index);
+
+private:
+    std::array<std::atomic<uint32_t>, BUCKET_COUNT> m_buckets = {};
+    std::atomic<uint32_t>                           m_count = {0};
+    std::atomic<uint32_t>                           m_max_us = {0};
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_HISTOGRAM_HPP
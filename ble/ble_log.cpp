@@ -0,0 +1,164 @@
+/**
+ * @file   ble_log.cpp
+ *
+ * @brief  Compile-time log elision and deferred binary logging.
+ * @detail Every module has a compile-time log threshold (CONFIG_BLE_REDUX_LOG_LEVEL_*), log
+ *         statements above it generate no code. Hot paths may additionally use the deferred
+ *         logger, which only records the format string pointer and the raw arguments and leaves
+ *         the formatting to a low priority task.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include "ble_log.hpp"
+#include "ble_queue.hpp"
+
+namespace BLE
+{
+
+#ifdef CONFIG_BLE_REDUX_LOG_DEFERRED
+
+constexpr const char* LOG_TAG_BLE_DEFERRED_LOG = "BLE Log";
+constexpr const uint16_t DEFERRED_LOG_TRACE_ID = 0x4C00;
+constexpr const uint32_t DEFERRED_LOG_TASK_STACK = 3072;
+constexpr const TickType_t DEFERRED_LOG_POLL_INTERVAL = pdMS_TO_TICKS(20);
+constexpr const size_t DEFERRED_LOG_LINE_MAX = 192;
+
+// Indexed by esp_log_level_t.
+constexpr const char DEFERRED_LOG_LEVEL_LETTERS[] = {'N', 'E', 'W', 'I', 'D', 'V'};
+
+
+using Deferred_Log_Queue = BLE_Queue<BLE_Deferred_Log::record_t,
+                                     CONFIG_BLE_REDUX_LOG_DEFERRED_RECORDS>;
+
+static Deferred_Log_Queue       deferred_log_queue(DEFERRED_LOG_TRACE_ID);
+static std::atomic<uint32_t>    deferred_log_dropped(0);
+static TaskHandle_t             deferred_log_task = nullptr;
+
+
+/**
+ * @brief Starts the task which formats and prints deferred records.
+ * @note Records logged before the task is started are kept until the buffer fills up.
+ * @param [in] priority (default=1) The FreeRTOS priority of the logging task.
+ * @return True if the task is running, false otherwise.
+ */
+bool
+BLE_Deferred_Log::start(uint32_t priority)
+{
+    if (deferred_log_task)
+        return true;
+
+    if (xTaskCreate(&BLE_Deferred_Log::task, "ble_log", DEFERRED_LOG_TASK_STACK, nullptr, priority,
+                    &deferred_log_task) != pdPASS)
+    {
+        ESP_LOGE(LOG_TAG_BLE_DEFERRED_LOG, "Could not start the deferred logging task");
+        deferred_log_task = nullptr;
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Retrieves the number of records dropped because the buffer was full.
+ * @return The number of dropped records since boot.
+ */
+uint32_t
+BLE_Deferred_Log::dropped(void)
+{
+    return deferred_log_dropped.load();
+}
+
+
+bool
+BLE_Deferred_Log::push(const record_t& record)
+{
+    if (deferred_log_queue.push(record))
+        return true;
+
+    deferred_log_dropped.fetch_add(1, std::memory_order_relaxed);
+    return false;
+}
+
+
+void
+BLE_Deferred_Log::task(void*)
+{
+    uint32_t dropped_reported = 0;
+    char line[DEFERRED_LOG_LINE_MAX];
+
+    for (;;)
+    {
+        record_t record;
+        while (deferred_log_queue.pop(record))
+        {
+            int length = snprintf(line, sizeof(line), "%c (%u) %s: ",
+                                  DEFERRED_LOG_LEVEL_LETTERS[record.level],
+                                  record.timestamp_ms, record.tag);
+            if ((length > 0) && (static_cast<size_t>(length) < sizeof(line)))
+            {
+                // Unused argument slots are zero, printf ignores surplus arguments.
+                snprintf(line + length, sizeof(line) - length, record.format,
+                         record.args[0], record.args[1], record.args[2], record.args[3],
+                         record.args[4], record.args[5]);
+            }
+
+            esp_log_write(record.level, record.tag, "%s\n", line);
+        }
+
+        uint32_t dropped = deferred_log_dropped.load();
+        if (dropped != dropped_reported)
+        {
+            ESP_LOGW(LOG_TAG_BLE_DEFERRED_LOG, "%u deferred records dropped",
+                     dropped - dropped_reported);
+            dropped_reported = dropped;
+        }
+
+        vTaskDelay(DEFERRED_LOG_POLL_INTERVAL);
+    }
+}
+
+#else
+
+bool
+BLE_Deferred_Log::start(uint32_t)
+{
+    return false;
+}
+
+
+uint32_t
+BLE_Deferred_Log::dropped(void)
+{
+    return 0;
+}
+
+
+bool
+BLE_Deferred_Log::push(const record_t&)
+{
+    return false;
+}
+
+
+void
+BLE_Deferred_Log::task(void*)
+{
+}
+
+#endif // CONFIG_BLE_REDUX_LOG_DEFERRED
+
+};
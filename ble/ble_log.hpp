@@ -0,0 +1,149 @@
+/**
+ * @file   ble_log.hpp
+ *
+ * @brief  Compile-time log elision and deferred binary logging.
+ * @detail Every module has a compile-time log threshold (CONFIG_BLE_REDUX_LOG_LEVEL_*), log
+ *         statements above it generate no code. Hot paths may additionally use the deferred
+ *         logger, which only records the format string pointer and the raw arguments and leaves
+ *         the formatting to a low priority task.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_LOG_HPP
+#define COMPONENTS_BLE_BLE_LOG_HPP
+
+#include <array>
+#include <cstdint>
+#include <type_traits>
+
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#ifndef CONFIG_BLE_REDUX_LOG_LEVEL_SERVER
+#define CONFIG_BLE_REDUX_LOG_LEVEL_SERVER 5
+#endif
+
+#ifndef CONFIG_BLE_REDUX_LOG_LEVEL_PROFILE
+#define CONFIG_BLE_REDUX_LOG_LEVEL_PROFILE 5
+#endif
+
+#ifndef CONFIG_BLE_REDUX_LOG_LEVEL_SERVICE
+#define CONFIG_BLE_REDUX_LOG_LEVEL_SERVICE 5
+#endif
+
+#ifndef CONFIG_BLE_REDUX_LOG_LEVEL_CHARACTERISTIC
+#define CONFIG_BLE_REDUX_LOG_LEVEL_CHARACTERISTIC 5
+#endif
+
+#ifndef CONFIG_BLE_REDUX_LOG_LEVEL_CLIENT
+#define CONFIG_BLE_REDUX_LOG_LEVEL_CLIENT 5
+#endif
+
+#ifndef CONFIG_BLE_REDUX_LOG_DEFERRED_RECORDS
+#define CONFIG_BLE_REDUX_LOG_DEFERRED_RECORDS 64
+#endif
+
+namespace BLE
+{
+
+class BLE_Deferred_Log
+{
+public:
+    static constexpr const size_t ARGUMENT_COUNT_MAX = 6;
+
+    struct record_t
+    {
+        const char*                                 tag;
+        const char*                                 format;
+        uint32_t                                    timestamp_ms;
+        esp_log_level_t                             level;
+        std::array<uint32_t, ARGUMENT_COUNT_MAX>    args;
+    };
+
+
+    /**
+     * @brief Starts the task which formats and prints deferred records.
+     * @note Records logged before the task is started are kept until the buffer fills up.
+     * @param [in] priority (default=1) The FreeRTOS priority of the logging task.
+     * @return True if the task is running, false otherwise.
+     */
+    static bool start(uint32_t priority=1);
+
+    /**
+     * @brief Records a log statement to be formatted later.
+     * @note This function is lock-free and never blocks, records are dropped when the buffer is
+     *       full. Statements below the runtime log level of the tag are not recorded.
+     * @tparam Args The argument types, these must be integral or enumeration types no larger than
+     *         32 bits since only their values are kept.
+     * @param [in] level The log level of the statement.
+     * @param [in] tag The log tag, this must have static storage duration.
+     * @param [in] format The format string, this must have static storage duration.
+     * @param [in] args The format arguments.
+     */
+    template<typename... Args>
+    static void log(esp_log_level_t level, const char* tag, const char* format, Args... args);
+
+    /**
+     * @brief Retrieves the number of records dropped because the buffer was full.
+     * @return The number of dropped records since boot.
+     */
+    static uint32_t dropped(void);
+
+private:
+    static bool push(const record_t& record);
+    static void task(void* parameters);
+};
+
+
+template<typename... Args>
+inline
+void
+BLE_Deferred_Log::log(esp_log_level_t level, const char* tag, const char* format, Args... args)
+{
+    static_assert(sizeof...(Args) <= ARGUMENT_COUNT_MAX, "Too many deferred log arguments");
+    static_assert(std::conjunction_v<std::disjunction<std::is_integral<Args>,
+                                                      std::is_enum<Args>>...>,
+                  "Deferred log arguments must be integral, pointers may dangle by print time");
+    static_assert(((sizeof(Args) <= sizeof(uint32_t)) && ...),
+                  "Deferred log arguments must fit in 32 bits");
+
+    // Statements below the runtime level of the tag are discarded here, as ESP_LOG does, rather
+    // than by the logging task after they took a slot in the buffer.
+    if (esp_log_level_get(tag) < level)
+        return;
+
+    record_t record = {tag, format, esp_log_timestamp(), level,
+                       {static_cast<uint32_t>(args)...}};
+    push(record);
+}
+
+};
+
+
+/***************************************************************************************************
+* Logging Macros
+***************************************************************************************************/
+// Evaluates to true if a statement at LVL survives a module threshold. Use it with if constexpr so
+// that statements below the threshold are discarded at compile time.
+#define BLE_LOG_ENABLED(THRESHOLD, LVL) (static_cast<int>(LVL) <= (THRESHOLD))
+
+#define BLE_LOG(THRESHOLD, LVL, TAG, PREFIX_FMT, PREFIX, MSG, ...)\
+    do {\
+        if constexpr (BLE_LOG_ENABLED(THRESHOLD, LVL))\
+            INTANCE_LOG(LVL, TAG, PREFIX_FMT, PREFIX, MSG, ##__VA_ARGS__);\
+    } while (0)
+
+// Records a statement with the deferred logger. Modules wrap this in their own *_LOG_DEFERRED
+// macros which fall back to their regular log macros when CONFIG_BLE_REDUX_LOG_DEFERRED is unset.
+#define BLE_LOG_DEFERRED(THRESHOLD, LVL, TAG, MSG, ...)\
+    do {\
+        if constexpr (BLE_LOG_ENABLED(THRESHOLD, LVL))\
+            BLE::BLE_Deferred_Log::log(LVL, TAG, MSG, ##__VA_ARGS__);\
+    } while (0)
+
+#endif // COMPONENTS_BLE_BLE_LOG_HPP
@@ -0,0 +1,331 @@
+/**
+ * @file   ble_log_stream.cpp
+ *
+ * @brief  Device log streaming service.
+ * @detail The ESP-IDF log output is captured by a vprintf hook which formats each line into a
+ *         lock-free ring buffer and returns, dropping the line if the buffer is full, so that
+ *         logging never waits on the radio. A low priority task packs the buffered lines into
+ *         MTU sized notifications for the subscribed clients.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "ble_log_stream.hpp"
+#include "ble_queue.hpp"
+#include "ble_server.hpp"
+#include "ble_service.hpp"
+
+namespace BLE
+{
+
+#ifdef CONFIG_BLE_REDUX_LOG_STREAM
+
+constexpr const char* LOG_TAG_BLE_LOG_STREAM = "BLE Log Stream";
+constexpr const uint16_t LOG_STREAM_TRACE_ID = 0x4C01;
+constexpr const uint32_t LOG_STREAM_TASK_STACK = 3072;
+constexpr const TickType_t LOG_STREAM_POLL_INTERVAL = pdMS_TO_TICKS(50);
+// Bounds the notifications queued with the stack per poll, lines beyond that wait in the ring
+// buffer and are dropped there once it fills up.
+constexpr const size_t LOG_STREAM_PACKETS_PER_POLL = 8;
+
+
+// The hook cannot reach the stream object safely while it is being destroyed, so the buffer and
+// the producer side counters live for the lifetime of the program.
+static BLE_Queue<BLE_Log_Stream::record_t, CONFIG_BLE_REDUX_LOG_STREAM_RECORDS>
+                                        log_stream_queue(LOG_STREAM_TRACE_ID);
+static std::atomic<vprintf_like_t>      log_stream_previous(nullptr);
+static std::atomic<bool>                log_stream_active(false);
+static std::atomic<TaskHandle_t>        log_stream_task(nullptr);
+static std::atomic<uint32_t>            log_stream_captured(0);
+static std::atomic<uint32_t>            log_stream_dropped(0);
+static std::atomic<uint32_t>            log_stream_truncated(0);
+
+
+/***************************************************************************************************
+* Stream Management
+***************************************************************************************************/
+BLE_Log_Stream::BLE_Log_Stream(void)
+{
+    if (m_stopped == nullptr)
+        throw std::bad_alloc();
+}
+
+
+BLE_Log_Stream::~BLE_Log_Stream(void)
+{
+    if (m_hooked)
+        esp_log_set_vprintf(log_stream_previous.load());
+
+    log_stream_task = nullptr;
+
+    if (m_task)
+    {
+        m_running = false;
+        xSemaphoreTake(m_stopped, portMAX_DELAY);
+    }
+
+    vSemaphoreDelete(m_stopped);
+    log_stream_active = false;
+}
+
+
+/**
+ * @brief Adds the log streaming service to a profile and starts capturing the log output.
+ * @note Requires CONFIG_BLE_REDUX_LOG_STREAM. Only one stream may exist at a time, the log output
+ *       keeps going to its previous destination as well.
+ * @param [in] profile The profile to add the service to.
+ * @param [in] priority (default=1) The FreeRTOS priority of the streaming task.
+ * @return A shared pointer to the stream, nullptr if it could not be created. Capturing stops
+ *         once the pointer is released.
+ */
+std::shared_ptr<BLE_Log_Stream>
+BLE_Log_Stream::create(std::shared_ptr<BLE_Profile> profile, uint32_t priority)
+{
+    if (!profile || log_stream_active.exchange(true))
+        return nullptr;
+
+    // Held until the stream is destroyed, including by the failure paths below.
+    std::shared_ptr<BLE_Log_Stream> stream;
+    try
+    {
+        stream = std::shared_ptr<BLE_Log_Stream>(new BLE_Log_Stream());
+    }
+    catch (const std::bad_alloc&)
+    {
+        log_stream_active = false;
+        throw;
+    }
+
+    // The service declaration and the log characteristic with its configuration descriptor.
+    UUID service_uuid(UUID_SERVICE);
+    if (!profile->service_add(service_uuid, false, 4))
+        return nullptr;
+
+    auto service = profile->service_get(service_uuid).lock();
+    if (!service ||
+        !service->characteristic_add(UUID(UUID_LOG), ESP_GATT_CHAR_PROP_BIT_NOTIFY,
+                                     ESP_GATT_PERM_READ))
+    {
+        ESP_LOGE(LOG_TAG_BLE_LOG_STREAM, "Log stream service creation failed");
+        return nullptr;
+    }
+
+    stream->m_characteristic = service->characteristic_get(UUID(UUID_LOG));
+
+    if (xTaskCreate(&BLE_Log_Stream::task, "ble_log_stream", LOG_STREAM_TASK_STACK, stream.get(),
+                    priority, &stream->m_task) != pdPASS)
+    {
+        ESP_LOGE(LOG_TAG_BLE_LOG_STREAM, "Could not start the streaming task");
+        stream->m_task = nullptr;
+        return nullptr;
+    }
+
+    log_stream_task = stream->m_task;
+    log_stream_previous = esp_log_set_vprintf(&BLE_Log_Stream::vprintf_hook);
+    stream->m_hooked = true;
+    return stream;
+}
+
+
+/**
+ * @brief Retrieves the streaming counters.
+ * @param [in] reset (default=false) Zeroes the counters after reading them.
+ * @return A copy of the counters.
+ */
+BLE_Log_Stream::counters_t
+BLE_Log_Stream::counters_get(bool reset)
+{
+    auto read = [reset](auto& counter){
+        return reset ? counter.exchange(0, std::memory_order_relaxed)
+                     : counter.load(std::memory_order_relaxed);
+    };
+
+    counters_t counters;
+    counters.captured = read(log_stream_captured);
+    counters.dropped = read(log_stream_dropped);
+    counters.truncated = read(log_stream_truncated);
+    counters.packets = read(m_packets);
+    counters.bytes = read(m_bytes);
+    counters.send_failed = read(m_send_failed);
+
+    // The drop notice in the stream follows the counter.
+    if (reset)
+        m_dropped_reported = 0;
+
+    return counters;
+}
+
+
+/***************************************************************************************************
+* Capture
+***************************************************************************************************/
+int
+BLE_Log_Stream::vprintf_hook(const char* format, va_list args)
+{
+    int result = 0;
+    vprintf_like_t previous = log_stream_previous.load();
+    if (previous)
+    {
+        va_list previous_args;
+        va_copy(previous_args, args);
+        result = previous(format, previous_args);
+        va_end(previous_args);
+    }
+
+    // Lines the streaming task causes itself, e.g. from the stack while it is congested, would be
+    // streamed again and feed on themselves.
+    if (xTaskGetCurrentTaskHandle() == log_stream_task.load(std::memory_order_relaxed))
+        return result;
+
+    // Formatting on the caller's stack and a lock-free push, nothing here can block.
+    record_t record;
+    int length = vsnprintf(record.text.data(), record.text.size(), format, args);
+    if (length <= 0)
+        return result;
+
+    if (static_cast<size_t>(length) >= record.text.size())
+    {
+        log_stream_truncated.fetch_add(1, std::memory_order_relaxed);
+        length = record.text.size() - 1;
+        record.text[length - 1] = '\n';
+    }
+
+    record.length = length;
+    log_stream_captured.fetch_add(1, std::memory_order_relaxed);
+    if (!log_stream_queue.push(record))
+        log_stream_dropped.fetch_add(1, std::memory_order_relaxed);
+
+    return result;
+}
+
+
+/***************************************************************************************************
+* Streaming Task
+***************************************************************************************************/
+void
+BLE_Log_Stream::task(void* parameters)
+{
+    auto stream = static_cast<BLE_Log_Stream*>(parameters);
+    while (stream->m_running)
+    {
+        stream->drain();
+        vTaskDelay(LOG_STREAM_POLL_INTERVAL);
+    }
+
+    xSemaphoreGive(stream->m_stopped);
+    vTaskDelete(nullptr);
+}
+
+
+void
+BLE_Log_Stream::drain(void)
+{
+    auto characteristic = m_characteristic.lock();
+    if (!characteristic)
+        return;
+
+    // Lines wait for a client to subscribe, so the start of a session is not lost.
+    std::vector<uint16_t> subscribers = characteristic->subscribers_get();
+    if (subscribers.empty())
+        return;
+
+    size_t capacity = characteristic->notification_capacity_get(subscribers);
+    for (size_t packet = 0; packet < LOG_STREAM_PACKETS_PER_POLL; packet++)
+    {
+        // Lines are concatenated and split wherever a notification fills up.
+        size_t length = PACKET_HEADER_LENGTH;
+        while (length < capacity)
+        {
+            if ((m_record_offset == m_record.length) && !record_next())
+                break;
+
+            size_t chunk = std::min(capacity - length, m_record.length - m_record_offset);
+            memcpy(m_packet.data() + length, m_record.text.data() + m_record_offset, chunk);
+            m_record_offset += chunk;
+            length += chunk;
+        }
+
+        if (length == PACKET_HEADER_LENGTH)
+            return;
+
+        m_packet[0] = m_sequence++;
+        for (uint16_t connection_id : subscribers)
+        {
+            // Failures are counted rather than logged, the log would stream them back.
+            if (!characteristic->notify(connection_id, m_packet.data(), length, true))
+                m_send_failed.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        m_packets.fetch_add(1, std::memory_order_relaxed);
+        m_bytes.fetch_add(length, std::memory_order_relaxed);
+        if (length < capacity)
+            return;
+    }
+}
+
+
+bool
+BLE_Log_Stream::record_next(void)
+{
+    m_record_offset = 0;
+
+    // Losses are reported in the stream itself, where the reader notices the gap.
+    uint32_t dropped = log_stream_dropped.load(std::memory_order_relaxed);
+    if (dropped != m_dropped_reported)
+    {
+        int length = snprintf(m_record.text.data(), m_record.text.size(),
+                              "--- %u log lines dropped ---\n", dropped - m_dropped_reported);
+        m_dropped_reported = dropped;
+        m_record.length = std::min<size_t>(std::max(length, 0), m_record.text.size() - 1);
+        return true;
+    }
+
+    if (log_stream_queue.pop(m_record))
+        return true;
+
+    m_record.length = 0;
+    return false;
+}
+
+#else
+
+BLE_Log_Stream::~BLE_Log_Stream(void)
+{
+}
+
+
+std::shared_ptr<BLE_Log_Stream>
+BLE_Log_Stream::create(std::shared_ptr<BLE_Profile>, uint32_t)
+{
+    return nullptr;
+}
+
+
+BLE_Log_Stream::counters_t
+BLE_Log_Stream::counters_get(bool)
+{
+    return {};
+}
+
+#endif // CONFIG_BLE_REDUX_LOG_STREAM
+
+};
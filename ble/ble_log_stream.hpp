@@ -0,0 +1,141 @@
+/**
+ * @file   ble_log_stream.hpp
+ *
+ * @brief  Device log streaming service.
+ * @detail The ESP-IDF log output is captured by a vprintf hook which formats each line into a
+ *         lock-free ring buffer and returns, dropping the line if the buffer is full, so that
+ *         logging never waits on the radio. A low priority task packs the buffered lines into
+ *         MTU sized notifications for the subscribed clients.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_LOG_STREAM_HPP
+#define COMPONENTS_BLE_BLE_LOG_STREAM_HPP
+
+#include <array>
+#include <atomic>
+#include <cstdarg>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "sdkconfig.h"
+
+#include "ble_characteristic.hpp"
+#include "ble_profile.hpp"
+#include "ble_utilities.hpp"
+#include "types.hpp"
+
+#ifndef CONFIG_BLE_REDUX_LOG_STREAM_RECORDS
+#define CONFIG_BLE_REDUX_LOG_STREAM_RECORDS 64
+#endif
+
+#ifndef CONFIG_BLE_REDUX_LOG_STREAM_LINE_MAX
+#define CONFIG_BLE_REDUX_LOG_STREAM_LINE_MAX 128
+#endif
+
+namespace BLE
+{
+
+class BLE_Log_Stream
+{
+public:
+    struct counters_t
+    {
+        uint32_t    captured;
+        // Lines lost because the link did not keep up and the ring buffer was full.
+        uint32_t    dropped;
+        // Lines cut at CONFIG_BLE_REDUX_LOG_STREAM_LINE_MAX.
+        uint32_t    truncated;
+        uint32_t    packets;
+        uint64_t    bytes;
+        // Notifications the stack refused, their contents are lost for that client.
+        uint32_t    send_failed;
+    };
+
+    static constexpr const uint128_t UUID_SERVICE =
+        absl::MakeUint128(0x7B5E0301A1B24E8C, 0x9D3F60C1B2A9E4D7);
+    static constexpr const uint128_t UUID_LOG =
+        absl::MakeUint128(0x7B5E0302A1B24E8C, 0x9D3F60C1B2A9E4D7);
+
+    // A notification is a sequence number followed by log text, lines may continue in the next
+    // notification. A gap in the sequence numbers means notifications were lost.
+    static constexpr const size_t PACKET_HEADER_LENGTH = sizeof(uint8_t);
+
+
+    /**
+     * @brief Adds the log streaming service to a profile and starts capturing the log output.
+     * @note Requires CONFIG_BLE_REDUX_LOG_STREAM. Only one stream may exist at a time, the log
+     *       output keeps going to its previous destination as well.
+     * @param [in] profile The profile to add the service to.
+     * @param [in] priority (default=1) The FreeRTOS priority of the streaming task.
+     * @return A shared pointer to the stream, nullptr if it could not be created. Capturing stops
+     *         once the pointer is released.
+     */
+    static std::shared_ptr<BLE_Log_Stream> create(std::shared_ptr<BLE_Profile> profile,
+                                                  uint32_t priority=1);
+
+    ~BLE_Log_Stream(void);
+
+    BLE_Log_Stream(const BLE_Log_Stream&) = delete;
+    BLE_Log_Stream& operator=(const BLE_Log_Stream&) = delete;
+
+    /**
+     * @brief Retrieves the streaming counters.
+     * @param [in] reset (default=false) Zeroes the counters after reading them.
+     * @return A copy of the counters.
+     */
+    counters_t counters_get(bool reset=false);
+
+    // A captured log line, as buffered between the hook and the streaming task.
+    struct record_t
+    {
+        uint8_t                                                 length;
+        std::array<char, CONFIG_BLE_REDUX_LOG_STREAM_LINE_MAX>  text;
+    };
+
+    static_assert(CONFIG_BLE_REDUX_LOG_STREAM_LINE_MAX <= UINT8_MAX,
+                  "Log lines are at most 255 bytes long");
+
+private:
+    BLE_Log_Stream(void);
+
+    static int vprintf_hook(const char* format, va_list args);
+    static void task(void* parameters);
+
+    void drain(void);
+    bool record_next(void);
+
+
+    std::weak_ptr<BLE_Characteristic>               m_characteristic;
+
+    // Owned by the streaming task: the line being sent and how much of it went out.
+    record_t                                        m_record = {};
+    size_t                                          m_record_offset = 0;
+    uint32_t                                        m_dropped_reported = 0;
+    uint8_t                                         m_sequence = 0;
+    std::array<uint8_t, ATT_ATTRIBUTE_LENGTH_MAX>   m_packet;
+
+    std::atomic<uint32_t>                           m_packets{0};
+    std::atomic<uint64_t>                           m_bytes{0};
+    std::atomic<uint32_t>                           m_send_failed{0};
+
+    std::atomic<bool>                               m_running{true};
+    SemaphoreHandle_t                               m_stopped = xSemaphoreCreateBinary();
+    TaskHandle_t                                    m_task = nullptr;
+    // Set once the hook is installed, a stream which failed to start has nothing to restore.
+    bool                                            m_hooked = false;
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_LOG_STREAM_HPP
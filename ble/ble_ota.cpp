@@ -0,0 +1,654 @@
+/**
+ * @file   ble_ota.cpp
+ *
+ * @brief  Streaming firmware update service.
+ * @detail Firmware arrives as Write Commands on a data characteristic, each frame carrying its
+ *         offset in the image. Frames are copied into one of two buffers on the BT task while a
+ *         writer task commits the other one to the update partition and hashes it, so flash
+ *         writes never hold up the link. Commits are acknowledged on the control characteristic,
+ *         a client resumes an interrupted transfer from the last acknowledged offset and the
+ *         image is checked against its SHA-256 before it is accepted.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "esp_log.h"
+#include "esp_ota_ops.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "mbedtls/sha256.h"
+#include "utilities.hpp"
+
+#include "ble_log.hpp"
+#include "ble_ota.hpp"
+#include "ble_service.hpp"
+
+namespace BLE
+{
+
+using Utilities::AnchorSemaphore;
+
+
+constexpr const char* LOG_TAG_BLE_OTA = "BLE OTA";
+constexpr const uint32_t OTA_TASK_STACK = 4096;
+// The time a frame may wait for the writer task to free a buffer, which throttles the link while a
+// flash erase is in progress. Frames waiting longer are refused and the client rewinds.
+constexpr const TickType_t OTA_BUFFER_WAIT = pdMS_TO_TICKS(50);
+// The command byte, the image size and its SHA-256.
+constexpr const size_t OTA_BEGIN_LENGTH = 1 + sizeof(uint32_t) + 32;
+
+/***************************************************************************************************
+* Logging Macros
+***************************************************************************************************/
+#define OTA_LOG_LEVEL CONFIG_BLE_REDUX_LOG_LEVEL_SERVICE
+
+#define OTA_LOG(LVL, MSG, ...)\
+    BLE_LOG(OTA_LOG_LEVEL, LVL, LOG_TAG_BLE_OTA, "%s", "", MSG, ##__VA_ARGS__)
+
+#define OTA_LOGE(MSG, ...) OTA_LOG(ESP_LOG_ERROR, MSG, ##__VA_ARGS__)
+#define OTA_LOGW(MSG, ...) OTA_LOG(ESP_LOG_WARN, MSG, ##__VA_ARGS__)
+#define OTA_LOGI(MSG, ...) OTA_LOG(ESP_LOG_INFO, MSG, ##__VA_ARGS__)
+#define OTA_LOGD(MSG, ...) OTA_LOG(ESP_LOG_DEBUG, MSG, ##__VA_ARGS__)
+#define OTA_LOGV(MSG, ...) OTA_LOG(ESP_LOG_VERBOSE, MSG, ##__VA_ARGS__)
+
+
+static uint32_t
+uint32_read(const uint8_t* data)
+{
+    return data[0] | (data[1] << 8) | (data[2] << 16) | (static_cast<uint32_t>(data[3]) << 24);
+}
+
+
+/***************************************************************************************************
+* Writers
+***************************************************************************************************/
+bool
+BLE_OTA_Writer_ESP::begin(size_t image_size)
+{
+    if (m_handle)
+        end(false);
+
+    m_partition = esp_ota_get_next_update_partition(nullptr);
+    if (!m_partition)
+    {
+        ESP_LOGE(LOG_TAG_BLE_OTA, "No update partition");
+        return false;
+    }
+
+    // Erases the sectors the image will occupy, which may take several seconds.
+    esp_err_t err = esp_ota_begin(m_partition, image_size, &m_handle);
+    if (err)
+    {
+        ESP_LOGE(LOG_TAG_BLE_OTA, "Update begin failed: %s (%d)", esp_err_to_name(err), err);
+        m_handle = 0;
+        return false;
+    }
+
+    return true;
+}
+
+
+bool
+BLE_OTA_Writer_ESP::write(const uint8_t* data, size_t length)
+{
+    return m_handle && (esp_ota_write(m_handle, data, length) == ESP_OK);
+}
+
+
+bool
+BLE_OTA_Writer_ESP::end(bool valid)
+{
+    if (!m_handle)
+        return false;
+
+    // Also validates the application image, an invalid one is never made bootable.
+    esp_err_t err = esp_ota_end(m_handle);
+    m_handle = 0;
+    if (!valid || err)
+        return false;
+
+    err = esp_ota_set_boot_partition(m_partition);
+    if (err)
+    {
+        ESP_LOGE(LOG_TAG_BLE_OTA, "Boot partition change failed: %s (%d)", esp_err_to_name(err),
+                 err);
+        return false;
+    }
+
+    return true;
+}
+
+
+BLE_OTA_Writer_File::~BLE_OTA_Writer_File(void)
+{
+    if (m_file)
+        fclose(m_file);
+}
+
+
+bool
+BLE_OTA_Writer_File::begin(size_t)
+{
+    if (m_file)
+        fclose(m_file);
+
+    m_file = fopen(m_path.c_str(), "wb");
+    return m_file != nullptr;
+}
+
+
+bool
+BLE_OTA_Writer_File::write(const uint8_t* data, size_t length)
+{
+    return m_file && (fwrite(data, 1, length, m_file) == length);
+}
+
+
+bool
+BLE_OTA_Writer_File::end(bool valid)
+{
+    if (!m_file)
+        return false;
+
+    bool closed = fclose(m_file) == 0;
+    m_file = nullptr;
+    if (!valid || !closed)
+    {
+        remove(m_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+/***************************************************************************************************
+* Service Management
+***************************************************************************************************/
+BLE_OTA_Service::BLE_OTA_Service(std::shared_ptr<BLE_OTA_Writer> writer)
+    : m_writer(std::move(writer))
+{
+    if ((m_work == nullptr) || (m_buffers_free == nullptr) || (m_respond_semaphore == nullptr) ||
+        (m_stopped == nullptr))
+        throw std::bad_alloc();
+
+    xSemaphoreGive(m_respond_semaphore);
+
+    for (auto& buffer : m_buffers)
+        buffer.resize(CONFIG_BLE_REDUX_OTA_BUFFER_BYTES);
+
+    mbedtls_sha256_init(&m_sha);
+}
+
+
+BLE_OTA_Service::~BLE_OTA_Service(void)
+{
+    if (m_task)
+    {
+        work_post(Work::STOP);
+        xSemaphoreTake(m_stopped, portMAX_DELAY);
+    }
+
+    if (m_writer_open)
+        m_writer->end(false);
+
+    mbedtls_sha256_free(&m_sha);
+    vQueueDelete(m_work);
+    vSemaphoreDelete(m_buffers_free);
+    vSemaphoreDelete(m_respond_semaphore);
+    vSemaphoreDelete(m_stopped);
+}
+
+
+/**
+ * @brief Adds the update service to a profile and starts its writer task.
+ * @param [in] profile The profile to add the service to.
+ * @param [in] writer The destination of received images.
+ * @return A shared pointer to the service, nullptr if it could not be created. The service stops
+ *         receiving once the pointer is released.
+ */
+std::shared_ptr<BLE_OTA_Service>
+BLE_OTA_Service::create(std::shared_ptr<BLE_Profile> profile,
+                        std::shared_ptr<BLE_OTA_Writer> writer)
+{
+    if (!profile || !writer)
+        return nullptr;
+
+    auto ota = std::shared_ptr<BLE_OTA_Service>(new BLE_OTA_Service(std::move(writer)));
+
+    // The service declaration, the control characteristic with its configuration descriptor and
+    // the data characteristic.
+    UUID service_uuid(UUID_SERVICE);
+    if (!profile->service_add(service_uuid, false, 6))
+        return nullptr;
+
+    auto service = profile->service_get(service_uuid).lock();
+    if (!service ||
+        !service->characteristic_add(UUID(UUID_CONTROL),
+                                     ESP_GATT_CHAR_PROP_BIT_WRITE | ESP_GATT_CHAR_PROP_BIT_NOTIFY,
+                                     ESP_GATT_PERM_WRITE) ||
+        !service->characteristic_add(UUID(UUID_DATA), ESP_GATT_CHAR_PROP_BIT_WRITE_NR,
+                                     ESP_GATT_PERM_WRITE))
+    {
+        OTA_LOGE("Update service creation failed");
+        return nullptr;
+    }
+
+    auto control = service->characteristic_get(UUID(UUID_CONTROL)).lock();
+    auto data = service->characteristic_get(UUID(UUID_DATA)).lock();
+    if (!control || !data)
+        return nullptr;
+
+    // Frames are consumed in place, they are never stored in the characteristic's value.
+    std::weak_ptr<BLE_OTA_Service> ota_weak_ptr = ota;
+    control->callback_write_raw_set([ota_weak_ptr](uint16_t, const uint8_t* value, size_t length){
+        auto ota_instance = ota_weak_ptr.lock();
+        if (ota_instance)
+            ota_instance->handle_control(value, length);
+    });
+    data->callback_write_raw_set([ota_weak_ptr](uint16_t, const uint8_t* value, size_t length){
+        auto ota_instance = ota_weak_ptr.lock();
+        if (ota_instance)
+            ota_instance->handle_data(value, length);
+    });
+    ota->m_control = control;
+
+    if (xTaskCreate(&BLE_OTA_Service::task, "ble_ota", OTA_TASK_STACK, ota.get(),
+                    CONFIG_BLE_REDUX_OTA_TASK_PRIORITY, &ota->m_task) != pdPASS)
+    {
+        OTA_LOGE("Could not start the writer task");
+        ota->m_task = nullptr;
+        return nullptr;
+    }
+
+    return ota;
+}
+
+
+/**
+ * @brief Retrieves the state of the current image.
+ * @return The current state.
+ */
+BLE_OTA_Service::State
+BLE_OTA_Service::state_get(void) const
+{
+    return m_state;
+}
+
+
+/**
+ * @brief Retrieves the number of bytes committed to the writer.
+ * @return The committed, and acknowledged, length of the current image.
+ */
+size_t
+BLE_OTA_Service::offset_get(void) const
+{
+    return m_committed;
+}
+
+
+/***************************************************************************************************
+* BT Task
+***************************************************************************************************/
+void
+BLE_OTA_Service::handle_control(const uint8_t* value, size_t length)
+{
+    if (length == 0)
+        return;
+
+    switch (static_cast<Command>(value[0]))
+    {
+        case Command::BEGIN:
+            if (length < OTA_BEGIN_LENGTH)
+                respond(Response::BEGIN, Status::INVALID, 0);
+            else
+                session_begin(uint32_read(value + 1), value + 1 + sizeof(uint32_t));
+        break;
+        case Command::FINISH:
+            session_finish();
+        break;
+        case Command::ABORT:
+            session_abort();
+        break;
+        default:
+            OTA_LOGW("Unknown command 0x%02X", value[0]);
+        break;
+    }
+}
+
+
+void
+BLE_OTA_Service::handle_data(const uint8_t* value, size_t length)
+{
+    if ((m_state != State::RECEIVING) || (length <= FRAME_HEADER_LENGTH))
+        return;
+
+    // Frames after a gap are refused until the client has rewound to the expected offset.
+    uint32_t offset = uint32_read(value);
+    const uint8_t* payload = value + FRAME_HEADER_LENGTH;
+    size_t remaining = length - FRAME_HEADER_LENGTH;
+    if ((offset != m_received) || (remaining > (m_image_size - m_received)))
+    {
+        rewind();
+        return;
+    }
+
+    while (remaining)
+    {
+        if ((m_fill == BUFFER_NONE) && !buffer_acquire())
+        {
+            rewind();
+            return;
+        }
+
+        std::vector<uint8_t>& buffer = m_buffers[m_fill];
+        size_t chunk = std::min(remaining, buffer.size() - m_fill_length);
+        memcpy(buffer.data() + m_fill_length, payload, chunk);
+        m_fill_length += chunk;
+        m_received += chunk;
+        payload += chunk;
+        remaining -= chunk;
+
+        if ((m_fill_length == buffer.size()) || (m_received == m_image_size))
+            buffer_submit();
+    }
+
+    m_rewind_sent = false;
+}
+
+
+void
+BLE_OTA_Service::session_begin(uint32_t image_size, const uint8_t* hash)
+{
+    if ((m_state == State::VERIFYING) || (image_size == 0))
+    {
+        respond(Response::BEGIN, Status::INVALID, m_committed);
+        return;
+    }
+
+    // Data received past the last commit was never acknowledged, the client sends it again.
+    buffers_drain();
+
+    bool same_image = (image_size == m_image_size) &&
+                      std::equal(m_image_hash.begin(), m_image_hash.end(), hash);
+    if ((m_state == State::RECEIVING) && same_image)
+    {
+        m_received = m_committed;
+        m_rewind_sent = false;
+        OTA_LOGI("Resuming at %u of %u", m_received, m_image_size);
+        respond(Response::BEGIN, Status::OK, m_received);
+        return;
+    }
+
+    m_state = State::IDLE;
+    m_image_size = image_size;
+    std::copy(hash, hash + m_image_hash.size(), m_image_hash.begin());
+    m_received = 0;
+    m_rewind_sent = false;
+
+    // The writer task answers once the destination is ready, an erase may take seconds.
+    work_post(Work::BEGIN);
+}
+
+
+void
+BLE_OTA_Service::session_finish(void)
+{
+    if ((m_state != State::RECEIVING) || (m_received != m_image_size))
+    {
+        respond(Response::FINISH, Status::INVALID, m_received);
+        return;
+    }
+
+    if (m_fill != BUFFER_NONE)
+        buffer_submit();
+
+    m_state = State::VERIFYING;
+    work_post(Work::FINISH);
+}
+
+
+void
+BLE_OTA_Service::session_abort(void)
+{
+    if (m_state == State::VERIFYING)
+    {
+        respond(Response::ABORT, Status::INVALID, m_committed);
+        return;
+    }
+
+    buffers_drain();
+    m_state = State::IDLE;
+    work_post(Work::ABORT);
+}
+
+
+bool
+BLE_OTA_Service::buffer_acquire(void)
+{
+    if (xSemaphoreTake(m_buffers_free, OTA_BUFFER_WAIT) != pdTRUE)
+    {
+        OTA_LOGW("Writer behind, frame at %u refused", m_received);
+        return false;
+    }
+
+    // Buffers are committed in order, so they are also freed in order.
+    m_fill = m_fill_next;
+    m_fill_next ^= 1;
+    m_fill_length = 0;
+    return true;
+}
+
+
+void
+BLE_OTA_Service::buffer_submit(void)
+{
+    work_post(Work::WRITE, m_fill, m_fill_length);
+    m_fill = BUFFER_NONE;
+    m_fill_length = 0;
+}
+
+
+void
+BLE_OTA_Service::buffers_drain(void)
+{
+    // The buffer being filled is discarded and every other one waited for, after which the writer
+    // task is idle and both buffers are free.
+    if (m_fill != BUFFER_NONE)
+    {
+        m_fill = BUFFER_NONE;
+        m_fill_length = 0;
+        xSemaphoreGive(m_buffers_free);
+    }
+
+    for (size_t i = 0; i < m_buffers.size(); i++)
+        xSemaphoreTake(m_buffers_free, portMAX_DELAY);
+
+    for (size_t i = 0; i < m_buffers.size(); i++)
+        xSemaphoreGive(m_buffers_free);
+
+    m_fill_next = 0;
+}
+
+
+void
+BLE_OTA_Service::work_post(Work type, uint8_t buffer, uint32_t length)
+{
+    // The queue holds both buffers and a command, so posting never waits in practice.
+    work_t work = {type, buffer, length};
+    xQueueSend(m_work, &work, portMAX_DELAY);
+}
+
+
+void
+BLE_OTA_Service::rewind(void)
+{
+    // A single request per gap, the frames already in flight behind it are dropped silently.
+    if (m_rewind_sent)
+        return;
+
+    m_rewind_sent = true;
+    respond(Response::ACK, Status::REWIND, m_received);
+}
+
+
+/***************************************************************************************************
+* Writer Task
+***************************************************************************************************/
+void
+BLE_OTA_Service::task(void* parameters)
+{
+    auto ota = static_cast<BLE_OTA_Service*>(parameters);
+    for (;;)
+    {
+        work_t work;
+        if (xQueueReceive(ota->m_work, &work, portMAX_DELAY) != pdTRUE)
+            continue;
+
+        if (work.type == Work::STOP)
+            break;
+
+        switch (work.type)
+        {
+            case Work::BEGIN:
+                ota->writer_begin();
+            break;
+            case Work::WRITE:
+                ota->writer_commit(work);
+            break;
+            case Work::FINISH:
+                ota->writer_verify();
+            break;
+            case Work::ABORT:
+                ota->writer_abort();
+            break;
+            default:
+            break;
+        }
+    }
+
+    xSemaphoreGive(ota->m_stopped);
+    vTaskDelete(nullptr);
+}
+
+
+void
+BLE_OTA_Service::writer_begin(void)
+{
+    if (m_writer_open)
+        m_writer->end(false);
+
+    m_committed = 0;
+    m_write_failed = false;
+    mbedtls_sha256_starts_ret(&m_sha, 0);
+
+    m_writer_open = m_writer->begin(m_image_size);
+    if (!m_writer_open)
+    {
+        m_state = State::FAILED;
+        respond(Response::BEGIN, Status::WRITE_FAILED, 0);
+        return;
+    }
+
+    OTA_LOGI("Receiving %u bytes", m_image_size);
+    m_state = State::RECEIVING;
+    respond(Response::BEGIN, Status::OK, 0);
+}
+
+
+void
+BLE_OTA_Service::writer_commit(const work_t& work)
+{
+    const uint8_t* data = m_buffers[work.buffer].data();
+    if (!m_write_failed)
+    {
+        if (m_writer->write(data, work.length))
+        {
+            mbedtls_sha256_update_ret(&m_sha, data, work.length);
+            m_committed += work.length;
+        }
+        else
+        {
+            OTA_LOGE("Write at %u failed", m_committed.load());
+            m_write_failed = true;
+            m_state = State::FAILED;
+        }
+    }
+
+    xSemaphoreGive(m_buffers_free);
+    respond(Response::ACK, m_write_failed ? Status::WRITE_FAILED : Status::OK, m_committed);
+}
+
+
+void
+BLE_OTA_Service::writer_verify(void)
+{
+    Hash hash;
+    mbedtls_sha256_finish_ret(&m_sha, hash.data());
+
+    bool valid = !m_write_failed && (m_committed == m_image_size) && (hash == m_image_hash);
+    bool accepted = m_writer->end(valid);
+    m_writer_open = false;
+
+    Status status = Status::OK;
+    if (m_write_failed)
+        status = Status::WRITE_FAILED;
+    else if (!valid)
+        status = Status::INTEGRITY_FAILED;
+    else if (!accepted)
+        status = Status::WRITE_FAILED;
+
+    OTA_LOGI("Image of %u bytes %s", m_committed.load(),
+             status == Status::OK ? "accepted" : "rejected");
+    m_state = (status == Status::OK) ? State::COMPLETE : State::FAILED;
+    respond(Response::FINISH, status, m_committed);
+}
+
+
+void
+BLE_OTA_Service::writer_abort(void)
+{
+    if (m_writer_open)
+        m_writer->end(false);
+
+    m_writer_open = false;
+    m_committed = 0;
+    respond(Response::ABORT, Status::OK, 0);
+}
+
+
+void
+BLE_OTA_Service::respond(Response response, Status status, uint32_t offset)
+{
+    auto control = m_control.lock();
+    if (!control)
+        return;
+
+    using Frame = std::array<uint8_t, 2 + sizeof(uint32_t)>;
+    Frame frame = {static_cast<uint8_t>(response), static_cast<uint8_t>(status),
+                   static_cast<uint8_t>(offset), static_cast<uint8_t>(offset >> 8),
+                   static_cast<uint8_t>(offset >> 16), static_cast<uint8_t>(offset >> 24)};
+
+    AnchorSemaphore anchor(m_respond_semaphore);
+    control->value_set<Frame>(frame, [](Frame frame){
+        return std::vector<uint8_t>(frame.begin(), frame.end());
+    });
+    control->notify();
+}
+
+};
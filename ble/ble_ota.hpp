@@ -0,0 +1,280 @@
+/**
+ * @file   ble_ota.hpp
+ *
+ * @brief  Streaming firmware update service.
+ * @detail Firmware arrives as Write Commands on a data characteristic, each frame carrying its
+ *         offset in the image. Frames are copied into one of two buffers on the BT task while a
+ *         writer task commits the other one to the update partition and hashes it, so flash
+ *         writes never hold up the link. Commits are acknowledged on the control characteristic,
+ *         a client resumes an interrupted transfer from the last acknowledged offset and the
+ *         image is checked against its SHA-256 before it is accepted.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_OTA_HPP
+#define COMPONENTS_BLE_BLE_OTA_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "esp_ota_ops.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "mbedtls/sha256.h"
+#include "sdkconfig.h"
+
+#include "ble_characteristic.hpp"
+#include "ble_profile.hpp"
+#include "types.hpp"
+
+#ifndef CONFIG_BLE_REDUX_OTA_BUFFER_BYTES
+#define CONFIG_BLE_REDUX_OTA_BUFFER_BYTES 4096
+#endif
+
+#ifndef CONFIG_BLE_REDUX_OTA_TASK_PRIORITY
+#define CONFIG_BLE_REDUX_OTA_TASK_PRIORITY 5
+#endif
+
+namespace BLE
+{
+
+/**
+ * @brief The destination of a firmware image.
+ * @detail Calls are made from the writer task of the service, one image at a time, so they may
+ *         block on flash erases and writes. Chunks arrive in order and without gaps.
+ */
+class BLE_OTA_Writer
+{
+public:
+    virtual ~BLE_OTA_Writer(void) = default;
+
+    /**
+     * @brief Prepares the destination for a new image, discarding any unfinished one.
+     * @param [in] image_size The size of the image in bytes.
+     * @return True on success, false otherwise.
+     */
+    virtual bool begin(size_t image_size) = 0;
+
+    /**
+     * @brief Appends the next chunk of the image.
+     * @return True on success, false otherwise.
+     */
+    virtual bool write(const uint8_t* data, size_t length) = 0;
+
+    /**
+     * @brief Completes the image.
+     * @param [in] valid Whether the image passed the integrity check, invalid images are dropped.
+     * @return True if a valid image was accepted, false otherwise.
+     */
+    virtual bool end(bool valid) = 0;
+};
+
+
+// Writes the image to the next OTA partition and makes it the boot partition once it is valid.
+class BLE_OTA_Writer_ESP : public BLE_OTA_Writer
+{
+public:
+    bool begin(size_t image_size) override;
+    bool write(const uint8_t* data, size_t length) override;
+    bool end(bool valid) override;
+
+private:
+    const esp_partition_t*  m_partition = nullptr;
+    esp_ota_handle_t        m_handle = 0;
+};
+
+
+// Writes the image to a file, for staging images on a mounted filesystem.
+class BLE_OTA_Writer_File : public BLE_OTA_Writer
+{
+public:
+    explicit BLE_OTA_Writer_File(std::string path) : m_path(std::move(path)) {}
+    ~BLE_OTA_Writer_File(void) override;
+
+    bool begin(size_t image_size) override;
+    bool write(const uint8_t* data, size_t length) override;
+    bool end(bool valid) override;
+
+private:
+    const std::string   m_path;
+    FILE*               m_file = nullptr;
+};
+
+
+class BLE_OTA_Service
+{
+public:
+    enum class State : uint8_t
+    {
+        IDLE,
+        RECEIVING,
+        VERIFYING,
+        COMPLETE,
+        FAILED,
+    };
+
+    // The first byte of a control write.
+    enum class Command : uint8_t
+    {
+        // Followed by the image size (uint32_t, little endian) and its SHA-256.
+        BEGIN = 0x01,
+        FINISH = 0x02,
+        ABORT = 0x03,
+    };
+
+    // The first byte of a control notification, followed by a Status and an offset (uint32_t,
+    // little endian).
+    enum class Response : uint8_t
+    {
+        BEGIN = 0x81,
+        FINISH = 0x82,
+        ABORT = 0x83,
+        // Sent whenever a buffer has been committed or a frame was refused, the offset is the
+        // next byte the service expects.
+        ACK = 0x90,
+    };
+
+    enum class Status : uint8_t
+    {
+        OK,
+        INVALID,
+        WRITE_FAILED,
+        INTEGRITY_FAILED,
+        // A frame did not start at the expected offset or arrived while both buffers were full,
+        // the client rewinds to the offset of the acknowledgement.
+        REWIND,
+    };
+
+    using Hash = std::array<uint8_t, 32>;
+
+    static constexpr const uint128_t UUID_SERVICE =
+        absl::MakeUint128(0x7B5E0001A1B24E8C, 0x9D3F60C1B2A9E4D7);
+    static constexpr const uint128_t UUID_CONTROL =
+        absl::MakeUint128(0x7B5E0002A1B24E8C, 0x9D3F60C1B2A9E4D7);
+    static constexpr const uint128_t UUID_DATA =
+        absl::MakeUint128(0x7B5E0003A1B24E8C, 0x9D3F60C1B2A9E4D7);
+
+    // A data frame is the offset of its payload (uint32_t, little endian) followed by the payload.
+    static constexpr const size_t FRAME_HEADER_LENGTH = sizeof(uint32_t);
+    // The bytes committed, and therefore acknowledged, at once.
+    static constexpr const size_t WINDOW_LENGTH = CONFIG_BLE_REDUX_OTA_BUFFER_BYTES;
+
+
+    /**
+     * @brief Adds the update service to a profile and starts its writer task.
+     * @param [in] profile The profile to add the service to.
+     * @param [in] writer The destination of received images.
+     * @return A shared pointer to the service, nullptr if it could not be created. The service
+     *         stops receiving once the pointer is released.
+     */
+    static std::shared_ptr<BLE_OTA_Service> create(std::shared_ptr<BLE_Profile> profile,
+                                                   std::shared_ptr<BLE_OTA_Writer> writer);
+
+    ~BLE_OTA_Service(void);
+
+    BLE_OTA_Service(const BLE_OTA_Service&) = delete;
+    BLE_OTA_Service& operator=(const BLE_OTA_Service&) = delete;
+
+    /**
+     * @brief Retrieves the state of the current image.
+     * @return The current state.
+     */
+    State state_get(void) const;
+
+    /**
+     * @brief Retrieves the number of bytes committed to the writer.
+     * @return The committed, and acknowledged, length of the current image.
+     */
+    size_t offset_get(void) const;
+
+private:
+    enum class Work : uint8_t
+    {
+        BEGIN,
+        WRITE,
+        FINISH,
+        ABORT,
+        STOP,
+    };
+
+    struct work_t
+    {
+        Work        type;
+        uint8_t     buffer;
+        uint32_t    length;
+    };
+
+    static constexpr const int BUFFER_NONE = -1;
+
+
+    BLE_OTA_Service(std::shared_ptr<BLE_OTA_Writer> writer);
+
+    static void task(void* parameters);
+
+    void handle_control(const uint8_t* value, size_t length);
+    void handle_data(const uint8_t* value, size_t length);
+
+    void session_begin(uint32_t image_size, const uint8_t* hash);
+    void session_finish(void);
+    void session_abort(void);
+
+    bool buffer_acquire(void);
+    void buffer_submit(void);
+    void buffers_drain(void);
+    void work_post(Work type, uint8_t buffer=0, uint32_t length=0);
+    void rewind(void);
+
+    void writer_begin(void);
+    void writer_commit(const work_t& work);
+    void writer_verify(void);
+    void writer_abort(void);
+
+    void respond(Response response, Status status, uint32_t offset);
+
+
+    std::shared_ptr<BLE_OTA_Writer>     m_writer;
+    std::weak_ptr<BLE_Characteristic>   m_control;
+
+    std::atomic<State>                  m_state{State::IDLE};
+    // Set by the BT task before the image is handed to the writer task.
+    uint32_t                            m_image_size = 0;
+    Hash                                m_image_hash = {};
+
+    // Owned by the BT task: the buffer being filled and the next offset expected from the client.
+    std::array<std::vector<uint8_t>, 2> m_buffers;
+    int                                 m_fill = BUFFER_NONE;
+    size_t                              m_fill_length = 0;
+    uint8_t                             m_fill_next = 0;
+    uint32_t                            m_received = 0;
+    bool                                m_rewind_sent = false;
+
+    // Owned by the writer task.
+    std::atomic<uint32_t>               m_committed{0};
+    bool                                m_writer_open = false;
+    bool                                m_write_failed = false;
+    mbedtls_sha256_context              m_sha;
+
+    QueueHandle_t                       m_work = xQueueCreate(4, sizeof(work_t));
+    SemaphoreHandle_t                   m_buffers_free = xSemaphoreCreateCounting(2, 2);
+    // Responses are sent from both tasks through the value of the control characteristic.
+    SemaphoreHandle_t                   m_respond_semaphore = xSemaphoreCreateBinary();
+    SemaphoreHandle_t                   m_stopped = xSemaphoreCreateBinary();
+    TaskHandle_t                        m_task = nullptr;
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_OTA_HPP
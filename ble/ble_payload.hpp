@@ -0,0 +1,102 @@
+/**
+ * @file   ble_payload.hpp
+ *
+ * @brief  Fixed layout payload access.
+ * @detail Loads and stores of arithmetic fields at fixed offsets of a byte buffer, in an explicit
+ *         byte order and without alignment requirements. The payload views generated by
+ *         tools/ble_payload_gen.py are built on these, they read and write a characteristic's
+ *         value in place instead of going through a serializer and an intermediate vector. The
+ *         header has no dependency on ESP-IDF so that generated views also build on the host.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_PAYLOAD_HPP
+#define COMPONENTS_BLE_BLE_PAYLOAD_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+namespace BLE
+{
+
+// Bluetooth SIG defined characteristics are little endian, big endian fields exist in vendor
+// payloads.
+enum class Endian : uint8_t
+{
+    LITTLE,
+    BIG,
+};
+
+
+template<size_t N>
+using payload_uint_t = std::conditional_t<N == 1, uint8_t,
+                       std::conditional_t<N == 2, uint16_t,
+                       std::conditional_t<N == 4, uint32_t, uint64_t>>>;
+
+
+/**
+ * @brief Reads a field of a payload.
+ * @tparam T An arithmetic type of 1, 2, 4 or 8 bytes.
+ * @tparam E The byte order of the field.
+ * @param [in] data The first byte of the field, it does not have to be aligned.
+ * @return The value of the field.
+ */
+template<typename T, Endian E>
+inline
+T
+payload_load(const uint8_t* data)
+{
+    static_assert(std::is_arithmetic_v<T>, "Payload fields must be arithmetic types");
+    using Raw = payload_uint_t<sizeof(T)>;
+    static_assert(sizeof(Raw) == sizeof(T), "Payload fields must be 1, 2, 4 or 8 bytes long");
+
+    // Byte by byte so that the result does not depend on the host's byte order, compilers fold
+    // the loop into a single load where the order matches.
+    Raw raw = 0;
+    for (size_t i = 0; i < sizeof(T); i++)
+    {
+        size_t shift = (E == Endian::LITTLE) ? i : (sizeof(T) - 1 - i);
+        raw |= static_cast<Raw>(static_cast<Raw>(data[i]) << (8 * shift));
+    }
+
+    T value;
+    memcpy(&value, &raw, sizeof(T));
+    return value;
+}
+
+
+/**
+ * @brief Writes a field of a payload.
+ * @tparam T An arithmetic type of 1, 2, 4 or 8 bytes.
+ * @tparam E The byte order of the field.
+ * @param [out] data The first byte of the field, it does not have to be aligned.
+ * @param [in] value The value of the field.
+ */
+template<typename T, Endian E>
+inline
+void
+payload_store(uint8_t* data, T value)
+{
+    static_assert(std::is_arithmetic_v<T>, "Payload fields must be arithmetic types");
+    using Raw = payload_uint_t<sizeof(T)>;
+    static_assert(sizeof(Raw) == sizeof(T), "Payload fields must be 1, 2, 4 or 8 bytes long");
+
+    Raw raw;
+    memcpy(&raw, &value, sizeof(T));
+    for (size_t i = 0; i < sizeof(T); i++)
+    {
+        size_t shift = (E == Endian::LITTLE) ? i : (sizeof(T) - 1 - i);
+        data[i] = static_cast<uint8_t>(raw >> (8 * shift));
+    }
+}
+
+};
+
+#endif // COMPONENTS_BLE_BLE_PAYLOAD_HPP
@@ -0,0 +1,244 @@
+/**
+ * @file   ble_peer.cpp
+ *
+ * @brief  Persistent per-peer state for bonded clients.
+ * @detail The server keeps the subscriptions, negotiated MTU and connection parameters of bonded
+ *         peers in a pluggable store keyed by their identity address, so that a reconnecting peer
+ *         receives notifications without rewriting its Client Characteristic Configuration
+ *         descriptors. Stores are provided for NVS and for plain files.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "esp_err.h"
+#include "nvs.h"
+
+#include "ble_peer.hpp"
+
+namespace BLE
+{
+
+// Bumped whenever the serialized layout changes, older records are then ignored.
+constexpr const uint8_t PEER_STATE_VERSION = 1;
+// Version, hash, MTU, interval, latency, timeout and subscription count.
+constexpr const size_t PEER_STATE_HEADER_LENGTH = 1 + 16 + 2 + 2 + 2 + 2 + 1;
+constexpr const size_t PEER_STATE_SUBSCRIPTIONS_MAX = 255;
+
+
+/***************************************************************************************************
+* Serialization
+***************************************************************************************************/
+std::vector<uint8_t>
+BLE_Peer_Store::serialize(const peer_state_t& state)
+{
+    size_t count = std::min(state.subscriptions.size(), PEER_STATE_SUBSCRIPTIONS_MAX);
+
+    std::vector<uint8_t> data;
+    data.reserve(PEER_STATE_HEADER_LENGTH + (count * 4));
+
+    auto put_16 = [&](uint16_t value){
+        data.push_back(value & 0xFF);
+        data.push_back(value >> 8);
+    };
+
+    data.push_back(PEER_STATE_VERSION);
+    data.insert(data.end(), state.database_hash.begin(), state.database_hash.end());
+    put_16(state.mtu);
+    put_16(state.interval);
+    put_16(state.latency);
+    put_16(state.timeout);
+    data.push_back(count);
+    for (size_t i = 0; i < count; i++)
+    {
+        put_16(state.subscriptions[i].handle);
+        put_16(state.subscriptions[i].configuration);
+    }
+
+    return data;
+}
+
+
+std::optional<BLE_Peer_Store::peer_state_t>
+BLE_Peer_Store::deserialize(const std::vector<uint8_t>& data)
+{
+    if ((data.size() < PEER_STATE_HEADER_LENGTH) || (data[0] != PEER_STATE_VERSION))
+        return {};
+
+    size_t position = 1;
+    auto get_16 = [&](){
+        uint16_t value = data[position] | (data[position + 1] << 8);
+        position += 2;
+        return value;
+    };
+
+    peer_state_t state;
+    std::copy(data.begin() + position, data.begin() + position + state.database_hash.size(),
+              state.database_hash.begin());
+    position += state.database_hash.size();
+    state.mtu = get_16();
+    state.interval = get_16();
+    state.latency = get_16();
+    state.timeout = get_16();
+
+    size_t count = data[position++];
+    if (data.size() != PEER_STATE_HEADER_LENGTH + (count * 4))
+        return {};
+
+    state.subscriptions.resize(count);
+    for (subscription_t& subscription : state.subscriptions)
+    {
+        subscription.handle = get_16();
+        subscription.configuration = get_16();
+    }
+
+    return state;
+}
+
+
+std::string
+BLE_Peer_Store::key(const Address& address)
+{
+    // Twelve hex digits, which also fits the 15 character limit of NVS keys.
+    std::array<char, (ESP_BD_ADDR_LEN * 2) + 1> key;
+    snprintf(key.data(), key.size(), "%02x%02x%02x%02x%02x%02x", address[0], address[1],
+             address[2], address[3], address[4], address[5]);
+
+    return key.data();
+}
+
+
+/***************************************************************************************************
+* NVS Store
+***************************************************************************************************/
+std::optional<BLE_Peer_Store::peer_state_t>
+BLE_Peer_Store_NVS::load(const Address& address)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(m_namespace.c_str(), NVS_READONLY, &nvs) != ESP_OK)
+        return {};
+
+    std::string peer_key = key(address);
+    size_t length = 0;
+    std::vector<uint8_t> data;
+    esp_err_t err = nvs_get_blob(nvs, peer_key.c_str(), nullptr, &length);
+    if (err == ESP_OK)
+    {
+        data.resize(length);
+        err = nvs_get_blob(nvs, peer_key.c_str(), data.data(), &length);
+    }
+
+    nvs_close(nvs);
+    if (err != ESP_OK)
+        return {};
+
+    return deserialize(data);
+}
+
+
+bool
+BLE_Peer_Store_NVS::save(const Address& address, const peer_state_t& state)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(m_namespace.c_str(), NVS_READWRITE, &nvs) != ESP_OK)
+        return false;
+
+    std::vector<uint8_t> data = serialize(state);
+    esp_err_t err = nvs_set_blob(nvs, key(address).c_str(), data.data(), data.size());
+    if (err == ESP_OK)
+        err = nvs_commit(nvs);
+
+    nvs_close(nvs);
+    return err == ESP_OK;
+}
+
+
+void
+BLE_Peer_Store_NVS::erase(const Address& address)
+{
+    nvs_handle_t nvs;
+    if (nvs_open(m_namespace.c_str(), NVS_READWRITE, &nvs) != ESP_OK)
+        return;
+
+    if (nvs_erase_key(nvs, key(address).c_str()) == ESP_OK)
+        nvs_commit(nvs);
+
+    nvs_close(nvs);
+}
+
+
+/***************************************************************************************************
+* File Store
+***************************************************************************************************/
+std::optional<BLE_Peer_Store::peer_state_t>
+BLE_Peer_Store_File::load(const Address& address)
+{
+    FILE* file = fopen(path(address).c_str(), "rb");
+    if (!file)
+        return {};
+
+    std::vector<uint8_t> data;
+    std::array<uint8_t, 64> chunk;
+    size_t length;
+    while ((length = fread(chunk.data(), 1, chunk.size(), file)) > 0)
+        data.insert(data.end(), chunk.begin(), chunk.begin() + length);
+
+    fclose(file);
+    return deserialize(data);
+}
+
+
+bool
+BLE_Peer_Store_File::save(const Address& address, const peer_state_t& state)
+{
+    // Written next to the previous state and renamed over it, so a reset never leaves a torn file.
+    std::string peer_path = path(address);
+    std::string temporary_path = peer_path + ".tmp";
+
+    FILE* file = fopen(temporary_path.c_str(), "wb");
+    if (!file)
+        return false;
+
+    std::vector<uint8_t> data = serialize(state);
+    bool success = fwrite(data.data(), 1, data.size(), file) == data.size();
+    success = (fclose(file) == 0) && success;
+
+    // Not every VFS replaces an existing file on rename.
+    if (success)
+        remove(peer_path.c_str());
+
+    if (!success || (rename(temporary_path.c_str(), peer_path.c_str()) != 0))
+    {
+        remove(temporary_path.c_str());
+        return false;
+    }
+
+    return true;
+}
+
+
+void
+BLE_Peer_Store_File::erase(const Address& address)
+{
+    remove(path(address).c_str());
+}
+
+
+std::string
+BLE_Peer_Store_File::path(const Address& address) const
+{
+    return m_directory + "/" + key(address) + ".peer";
+}
+
+};
@@ -0,0 +1,133 @@
+/**
+ * @file   ble_peer.hpp
+ *
+ * @brief  Persistent per-peer state for bonded clients.
+ * @detail The server keeps the subscriptions, negotiated MTU and connection parameters of bonded
+ *         peers in a pluggable store keyed by their identity address, so that a reconnecting peer
+ *         receives notifications without rewriting its Client Characteristic Configuration
+ *         descriptors. Stores are provided for NVS and for plain files.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_PEER_HPP
+#define COMPONENTS_BLE_BLE_PEER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "esp_bt_defs.h"
+
+#include "ble_database.hpp"
+
+namespace BLE
+{
+
+class BLE_Peer_Store
+{
+public:
+    using Address = std::array<uint8_t, ESP_BD_ADDR_LEN>;
+
+    struct subscription_t
+    {
+        uint16_t    handle;
+        // The value of the Client Characteristic Configuration descriptor.
+        uint16_t    configuration;
+    };
+
+    struct peer_state_t
+    {
+        // Subscriptions refer to handles, they are only restored if the database is unchanged.
+        BLE_Database_Hash::Hash         database_hash;
+        // The MTU negotiated during the last connection, only the client can start an exchange.
+        uint16_t                        mtu;
+        // The connection parameters of the last connection, all zero if they are unknown.
+        uint16_t                        interval;
+        uint16_t                        latency;
+        uint16_t                        timeout;
+        std::vector<subscription_t>     subscriptions;
+    };
+
+
+    virtual ~BLE_Peer_Store() = default;
+
+    /**
+     * @brief Retrieves the state of a peer.
+     * @param [in] address The identity address of the peer.
+     * @return The stored state or std::nullopt if there is none or it could not be read.
+     */
+    virtual std::optional<peer_state_t> load(const Address& address) = 0;
+
+    /**
+     * @brief Stores the state of a peer, replacing any previous state.
+     * @param [in] address The identity address of the peer.
+     * @param [in] state The state to store.
+     * @return True on success, false otherwise.
+     */
+    virtual bool save(const Address& address, const peer_state_t& state) = 0;
+
+    /**
+     * @brief Removes the state of a peer, for example once its bond is removed.
+     * @param [in] address The identity address of the peer.
+     */
+    virtual void erase(const Address& address) = 0;
+
+protected:
+    static std::vector<uint8_t> serialize(const peer_state_t& state);
+    static std::optional<peer_state_t> deserialize(const std::vector<uint8_t>& data);
+    static std::string key(const Address& address);
+};
+
+
+class BLE_Peer_Store_NVS : public BLE_Peer_Store
+{
+public:
+    /**
+     * @brief Creates a store which keeps one blob per peer in an NVS namespace.
+     * @note NVS must have been initialized with nvs_flash_init.
+     * @param [in] name_space (default="ble_peers") The NVS namespace, at most 15 characters.
+     */
+    explicit BLE_Peer_Store_NVS(std::string name_space="ble_peers")
+        : m_namespace(std::move(name_space)) {}
+
+    std::optional<peer_state_t> load(const Address& address) override;
+    bool save(const Address& address, const peer_state_t& state) override;
+    void erase(const Address& address) override;
+
+private:
+    std::string     m_namespace;
+};
+
+
+class BLE_Peer_Store_File : public BLE_Peer_Store
+{
+public:
+    /**
+     * @brief Creates a store which keeps one file per peer in a directory.
+     * @note The directory must exist, on target it has to be on a mounted VFS partition.
+     * @param [in] directory The directory holding the peer files.
+     */
+    explicit BLE_Peer_Store_File(std::string directory)
+        : m_directory(std::move(directory)) {}
+
+    std::optional<peer_state_t> load(const Address& address) override;
+    bool save(const Address& address, const peer_state_t& state) override;
+    void erase(const Address& address) override;
+
+private:
+    std::string path(const Address& address) const;
+
+    std::string     m_directory;
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_PEER_HPP
@@ -14,6 +14,7 @@
  * @TODO Move some LOGEs to throws
  */
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <memory>
@@ -26,6 +27,8 @@
 #include "utilities.hpp"
 
 #include "ble_profile.hpp"
+#include "ble_database.hpp"
+#include "ble_log.hpp"
 #include "ble_server.hpp"
 #include "ble_service.hpp"
 #include "types.hpp"
@@ -42,8 +45,18 @@ constexpr const char* LOG_TAG_BLE_PROFILE = "BLE Profile";
 /***************************************************************************************************
 * Logging Macros
 ***************************************************************************************************/
+#define PROFILE_LOG_LEVEL CONFIG_BLE_REDUX_LOG_LEVEL_PROFILE
+
 #define PROFILE_LOG(LVL, MSG, ...)\
-    INTANCE_LOG(LVL, LOG_TAG_BLE_PROFILE, "%04X --", id, MSG, ##__VA_ARGS__)
+    BLE_LOG(PROFILE_LOG_LEVEL, LVL, LOG_TAG_BLE_PROFILE, "%04X --", id, MSG, ##__VA_ARGS__)
+
+#ifdef CONFIG_BLE_REDUX_LOG_DEFERRED
+#define PROFILE_LOG_DEFERRED(LVL, MSG, ...)\
+    BLE_LOG_DEFERRED(PROFILE_LOG_LEVEL, LVL, LOG_TAG_BLE_PROFILE, "%04X -- " MSG, id,\
+                     ##__VA_ARGS__)
+#else
+#define PROFILE_LOG_DEFERRED(LVL, MSG, ...) PROFILE_LOG(LVL, MSG, ##__VA_ARGS__)
+#endif
 
 #define PROFILE_LOGE(MSG, ...) PROFILE_LOG(ESP_LOG_ERROR, MSG, ##__VA_ARGS__)
 #define PROFILE_LOGW(MSG, ...) PROFILE_LOG(ESP_LOG_WARN, MSG, ##__VA_ARGS__)
@@ -51,6 +64,9 @@ constexpr const char* LOG_TAG_BLE_PROFILE = "BLE Profile";
 #define PROFILE_LOGD(MSG, ...) PROFILE_LOG(ESP_LOG_DEBUG, MSG, ##__VA_ARGS__)
 #define PROFILE_LOGV(MSG, ...) PROFILE_LOG(ESP_LOG_VERBOSE, MSG, ##__VA_ARGS__)
 
+#define PROFILE_LOGD_DEFERRED(MSG, ...) PROFILE_LOG_DEFERRED(ESP_LOG_DEBUG, MSG, ##__VA_ARGS__)
+#define PROFILE_LOGV_DEFERRED(MSG, ...) PROFILE_LOG_DEFERRED(ESP_LOG_VERBOSE, MSG, ##__VA_ARGS__)
+
 
 /***************************************************************************************************
 * Profile Member Functions
@@ -177,9 +193,15 @@ BLE_Profile::service_remove(UUID uuid, bool blocking)
     else
         deletion_function();
 
-    AnchorSemaphore anchor(m_service_map_semaphore);
-    m_services_handle.erase(m_services_uuid[uuid]->handle);
-    m_services_uuid.erase(uuid);
+    {
+        AnchorSemaphore anchor(m_service_map_semaphore);
+        m_services_handle.erase(m_services_uuid[uuid]->handle);
+        m_services_uuid.erase(uuid);
+    }
+
+    auto server_instance = server.lock();
+    if (server_instance)
+        server_instance->database_changed();
 }
 
 
@@ -264,6 +286,164 @@ BLE_Profile::service_get_all(void)
 }
 
 
+/***************************************************************************************************
+* Schema Reconfiguration
+***************************************************************************************************/
+/**
+ * @brief Compares the services of this profile against a desired schema.
+ * @note This function is thread safe.
+ * @param [in] schema The desired services and characteristics of this profile.
+ * @return The services that would be removed, recreated, added and kept by schema_apply.
+ */
+BLE_Profile::schema_diff_t
+BLE_Profile::schema_diff(const Schema& schema)
+{
+    schema_diff_t diff;
+    for (const service_schema_t& service_schema : schema)
+    {
+        auto service = service_get(service_schema.uuid).lock();
+        if (!service)
+            diff.added.push_back(service_schema.uuid);
+        else if (schema_service_matches(service, service_schema))
+            diff.unchanged.push_back(service_schema.uuid);
+        else
+            diff.changed.push_back(service_schema.uuid);
+    }
+
+    for (auto& service_weak_ptr : service_get_all())
+    {
+        // The database hash service is managed by the server, see database_service_add.
+        auto service = service_weak_ptr.lock();
+        if (!service || (service->uuid == UUID(BLE_Database_Hash::UUID_SERVICE)))
+            continue;
+
+        auto desired = std::find_if(schema.begin(), schema.end(),
+                                    [&](const service_schema_t& service_schema){
+                                        return service_schema.uuid == service->uuid;
+                                    });
+        if (desired == schema.end())
+            diff.removed.push_back(service->uuid);
+    }
+
+    return diff;
+}
+
+
+/**
+ * @brief Reconfigures this profile to match a desired schema.
+ * @detail Only services that are missing from the schema or differ from it are removed and only
+ *         new or differing services are created, services that match keep their handles and
+ *         values. Connected clients receive a single Service Changed indication once the whole
+ *         schema has been applied, provided the stack's Service Changed mode is manual, see
+ *         BLE_Server::database_changed. The advertise flag of kept services is updated in place
+ *         and takes effect the next time advertising starts.
+ * @note This function blocks until every service operation completes.
+ * @param [in] schema The desired services and characteristics of this profile.
+ * @return True if every service operation succeeded, false otherwise.
+ */
+bool
+BLE_Profile::schema_apply(const Schema& schema)
+{
+    auto server_instance = server.lock();
+    if (!server_instance)
+        return false;
+
+    schema_diff_t diff = schema_diff(schema);
+    PROFILE_LOGI("Applying schema: %u removed, %u changed, %u added, %u unchanged",
+                 diff.removed.size(), diff.changed.size(), diff.added.size(),
+                 diff.unchanged.size());
+
+    if (diff.removed.empty() && diff.changed.empty() && diff.added.empty())
+        return true;
+
+    // Every intermediate layout change is folded into a single hash update and indication.
+    server_instance->database_batch_begin();
+
+    for (const UUID& uuid : diff.removed)
+        service_remove(uuid);
+
+    for (const UUID& uuid : diff.changed)
+        service_remove(uuid);
+
+    bool success = true;
+    for (const service_schema_t& service_schema : schema)
+    {
+        auto service = service_get(service_schema.uuid).lock();
+        if (service)
+            service->advertise = service_schema.advertise;
+        else if (!schema_service_create(service_schema))
+            success = false;
+    }
+
+    server_instance->database_batch_end();
+    return success;
+}
+
+
+bool
+BLE_Profile::schema_service_matches(const std::shared_ptr<BLE_Service>& service,
+                                    const service_schema_t& schema)
+{
+    if (service->service_id.is_primary != schema.primary)
+        return false;
+
+    auto characteristics = service->characteristic_get_all();
+    if (characteristics.size() != schema.characteristics.size())
+        return false;
+
+    for (const characteristic_schema_t& characteristic_schema : schema.characteristics)
+    {
+        auto characteristic = service->characteristic_get(characteristic_schema.uuid).lock();
+        if (!characteristic ||
+            (characteristic->properties != characteristic_schema.properties) ||
+            (characteristic->permissions != characteristic_schema.permissions) ||
+            (characteristic->auto_response != characteristic_schema.auto_response))
+            return false;
+    }
+
+    return true;
+}
+
+
+bool
+BLE_Profile::schema_service_create(const service_schema_t& schema)
+{
+    // One handle for the service declaration and two for each characteristic (declaration and
+    // value), plus room for a configuration descriptor on those that notify or indicate.
+    uint16_t handles = 1;
+    for (const characteristic_schema_t& characteristic_schema : schema.characteristics)
+    {
+        handles += 2;
+        if (characteristic_schema.properties & (ESP_GATT_CHAR_PROP_BIT_NOTIFY |
+                                                ESP_GATT_CHAR_PROP_BIT_INDICATE))
+            handles++;
+    }
+
+    if (!service_add(schema.uuid, schema.advertise, handles, schema.primary))
+        return false;
+
+    auto service = service_get(schema.uuid).lock();
+    if (!service)
+        return false;
+
+    for (const characteristic_schema_t& characteristic_schema : schema.characteristics)
+    {
+        if (!service->characteristic_add(characteristic_schema.uuid,
+                                         characteristic_schema.properties,
+                                         characteristic_schema.permissions,
+                                         true,
+                                         characteristic_schema.auto_response))
+        {
+            PROFILE_LOGE("Schema characteristic creation failed: %s",
+                         characteristic_schema.uuid.to_string().c_str());
+            return false;
+        }
+    }
+
+    return true;
+}
+
+
 /***************************************************************************************************
 * Event Handling
 ***************************************************************************************************/
@@ -313,16 +493,21 @@ BLE_Profile::handle_service_add(const esp_ble_gatts_cb_param_t::gatts_create_evt
         return;
     }
 
-    AnchorSemaphore anchor(m_service_map_semaphore);
-    auto service = std::make_shared<BLE_Service>(param.service_id,
-                                                 param.service_handle,
-                                                 gatts_if,
-                                                 m_services_creation[uuid],
-                                                 self_ptr);
+    {
+        AnchorSemaphore anchor(m_service_map_semaphore);
+        auto service = std::make_shared<BLE_Service>(param.service_id,
+                                                     param.service_handle,
+                                                     gatts_if,
+                                                     m_services_creation[uuid],
+                                                     self_ptr);
+
+        m_services_uuid.insert(std::make_pair(uuid, service));
+        m_services_handle.insert(std::make_pair(param.service_handle, service));
+        m_services_creation.erase(uuid);
+    }
 
-    m_services_uuid.insert(std::make_pair(uuid, service));
-    m_services_handle.insert(std::make_pair(param.service_handle, service));
-    m_services_creation.erase(uuid);
+    // The hash walks every service, so the map semaphore must be released first.
+    server_instance->database_changed();
 
     PROFILE_LOGI("Service successfully created: 0x%04X", param.service_handle);
     m_notification_mgr.notify(uuid, OP::SERVICE_ADD, true);
@@ -351,7 +536,7 @@ void
 BLE_Profile::profile_event_handler_gatts(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
                                          esp_ble_gatts_cb_param_t *param)
 {
-    PROFILE_LOGV("GATTS event = %d, inf = 0x%04X", event, gatts_if);
+    PROFILE_LOGV_DEFERRED("GATTS event = %d, inf = 0x%04X", event, gatts_if);
     if (gatts_if != this->gatts_if)
     {
         PROFILE_LOGE("Invalid inf received: 0x%04X", this->gatts_if);
@@ -42,6 +42,37 @@ class BLE_Server;
 class BLE_Profile
 {
 public:
+    struct characteristic_schema_t
+    {
+        UUID                    uuid;
+        esp_gatt_char_prop_t    properties;
+        esp_gatt_perm_t         permissions;
+        bool                    auto_response = false;
+    };
+
+    struct service_schema_t
+    {
+        UUID                                    uuid;
+        bool                                    advertise;
+        bool                                    primary = true;
+        std::vector<characteristic_schema_t>    characteristics;
+    };
+
+    using Schema = std::vector<service_schema_t>;
+
+    struct schema_diff_t
+    {
+        // Services which are not part of the desired schema.
+        std::vector<UUID>   removed;
+        // Services whose declaration or characteristics differ, these are recreated.
+        std::vector<UUID>   changed;
+        // Services which only exist in the desired schema.
+        std::vector<UUID>   added;
+        // Services which are kept as they are, along with their handles and values.
+        std::vector<UUID>   unchanged;
+    };
+
+
     BLE_Profile(uint16_t id, esp_gatt_if_t gatts_if, std::weak_ptr<BLE_Server> server);
 
     /**
@@ -118,6 +149,28 @@ public:
      */
     std::vector<std::weak_ptr<BLE_Service>> service_get_all(void);
 
+    /**
+     * @brief Compares the services of this profile against a desired schema.
+     * @note This function is thread safe.
+     * @param [in] schema The desired services and characteristics of this profile.
+     * @return The services that would be removed, recreated, added and kept by schema_apply.
+     */
+    schema_diff_t schema_diff(const Schema& schema);
+
+    /**
+     * @brief Reconfigures this profile to match a desired schema.
+     * @detail Only services that are missing from the schema or differ from it are removed and
+     *         only new or differing services are created, services that match keep their handles
+     *         and values. Connected clients receive a single Service Changed indication once the
+     *         whole schema has been applied, provided the stack's Service Changed mode is manual,
+     *         see BLE_Server::database_changed. The advertise flag of kept services is updated in
+     *         place and takes effect the next time advertising starts.
+     * @note This function blocks until every service operation completes.
+     * @param [in] schema The desired services and characteristics of this profile.
+     * @return True if every service operation succeeded, false otherwise.
+     */
+    bool schema_apply(const Schema& schema);
+
     /**
      * @brief A function used internally by the framework to signal events to the profile.
      * @warning DO NOT CALL THIS FUNCTION
@@ -132,6 +185,8 @@ public:
     const std::weak_ptr<BLE_Server>     server;
 
 private:
+    friend class BLE_Benchmark;
+
     enum class OP
     {
         SERVICE_ADD,
@@ -146,6 +201,10 @@ private:
     void handle_service_add(const esp_ble_gatts_cb_param_t::gatts_create_evt_param& param);
     void handle_service_remove(const esp_ble_gatts_cb_param_t::gatts_delete_evt_param& param);
 
+    bool schema_service_matches(const std::shared_ptr<BLE_Service>& service,
+                                const service_schema_t& schema);
+    bool schema_service_create(const service_schema_t& schema);
+
 
     Service_Map_UUID                m_services_uuid;
     Service_Map_Handle              m_services_handle;
@@ -0,0 +1,370 @@
+/**
+ * @file   ble_pubsub.cpp
+ *
+ * @brief  Topic based publish/subscribe service.
+ * @detail Clients register topic filters and minimum intervals on a control characteristic, each
+ *         registration is compiled into a topic bitmap for the connection. Messages are fanned
+ *         out on a single notify characteristic to the connections whose bitmap holds the topic
+ *         and whose interval has elapsed, and a message nobody is due to receive is never
+ *         encoded.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "utilities.hpp"
+
+#include "ble_log.hpp"
+#include "ble_pubsub.hpp"
+#include "ble_server.hpp"
+#include "ble_service.hpp"
+
+namespace BLE
+{
+
+using Utilities::AnchorSemaphore;
+
+
+constexpr const char* LOG_TAG_BLE_PUBSUB = "BLE PubSub";
+// The command byte, a filter, a mask and an interval.
+constexpr const size_t PUBSUB_SUBSCRIBE_LENGTH = 3 + sizeof(uint16_t);
+constexpr const size_t PUBSUB_UNSUBSCRIBE_LENGTH = 3;
+
+/***************************************************************************************************
+* Logging Macros
+***************************************************************************************************/
+#define PUBSUB_LOG_LEVEL CONFIG_BLE_REDUX_LOG_LEVEL_SERVICE
+
+#define PUBSUB_LOG(LVL, MSG, ...)\
+    BLE_LOG(PUBSUB_LOG_LEVEL, LVL, LOG_TAG_BLE_PUBSUB, "%s", "", MSG, ##__VA_ARGS__)
+
+#define PUBSUB_LOGE(MSG, ...) PUBSUB_LOG(ESP_LOG_ERROR, MSG, ##__VA_ARGS__)
+#define PUBSUB_LOGW(MSG, ...) PUBSUB_LOG(ESP_LOG_WARN, MSG, ##__VA_ARGS__)
+#define PUBSUB_LOGI(MSG, ...) PUBSUB_LOG(ESP_LOG_INFO, MSG, ##__VA_ARGS__)
+#define PUBSUB_LOGD(MSG, ...) PUBSUB_LOG(ESP_LOG_DEBUG, MSG, ##__VA_ARGS__)
+#define PUBSUB_LOGV(MSG, ...) PUBSUB_LOG(ESP_LOG_VERBOSE, MSG, ##__VA_ARGS__)
+
+
+/***************************************************************************************************
+* Service Management
+***************************************************************************************************/
+BLE_PubSub_Service::BLE_PubSub_Service(void)
+{
+    if (m_subscribers_semaphore == nullptr)
+        throw std::bad_alloc();
+
+    xSemaphoreGive(m_subscribers_semaphore);
+}
+
+
+BLE_PubSub_Service::~BLE_PubSub_Service(void)
+{
+    vSemaphoreDelete(m_subscribers_semaphore);
+}
+
+
+/**
+ * @brief Adds the publish/subscribe service to a profile.
+ * @param [in] profile The profile to add the service to.
+ * @return A shared pointer to the service, nullptr if it could not be created.
+ */
+std::shared_ptr<BLE_PubSub_Service>
+BLE_PubSub_Service::create(std::shared_ptr<BLE_Profile> profile)
+{
+    if (!profile)
+        return nullptr;
+
+    auto pubsub = std::shared_ptr<BLE_PubSub_Service>(new BLE_PubSub_Service());
+
+    // The service declaration, the control characteristic and the message characteristic with
+    // its configuration descriptor.
+    UUID service_uuid(UUID_SERVICE);
+    if (!profile->service_add(service_uuid, false, 6))
+        return nullptr;
+
+    auto service = profile->service_get(service_uuid).lock();
+    if (!service ||
+        !service->characteristic_add(UUID(UUID_CONTROL), ESP_GATT_CHAR_PROP_BIT_WRITE,
+                                     ESP_GATT_PERM_WRITE) ||
+        !service->characteristic_add(UUID(UUID_MESSAGES), ESP_GATT_CHAR_PROP_BIT_NOTIFY,
+                                     ESP_GATT_PERM_READ))
+    {
+        PUBSUB_LOGE("Publish/subscribe service creation failed");
+        return nullptr;
+    }
+
+    auto control = service->characteristic_get(UUID(UUID_CONTROL)).lock();
+    auto messages = service->characteristic_get(UUID(UUID_MESSAGES)).lock();
+    if (!control || !messages)
+        return nullptr;
+
+    std::weak_ptr<BLE_PubSub_Service> pubsub_weak_ptr = pubsub;
+    control->callback_write_raw_set([pubsub_weak_ptr](uint16_t connection_id,
+                                                      const uint8_t* value, size_t length){
+        auto pubsub_instance = pubsub_weak_ptr.lock();
+        if (pubsub_instance)
+            pubsub_instance->handle_control(connection_id, value, length);
+    });
+    pubsub->m_server = profile->server;
+    pubsub->m_messages = messages;
+
+    return pubsub;
+}
+
+
+/**
+ * @brief Publishes an encoded payload to the connections subscribed to its topic.
+ * @note This function is thread safe.
+ * @param [in] topic The topic of the message.
+ * @param [in] data The payload.
+ * @param [in] length The length of the payload.
+ * @return The number of connections the message was sent to.
+ */
+size_t
+BLE_PubSub_Service::publish(uint8_t topic, const uint8_t* data, size_t length)
+{
+    return publish(topic, [data, length](uint8_t* buffer, size_t capacity){
+        if (length <= capacity)
+            memcpy(buffer, data, length);
+
+        return length;
+    });
+}
+
+
+/**
+ * @brief Checks whether a connection subscribed to a topic.
+ * @note This function is thread safe.
+ * @param [in] connection_id The connection of interest.
+ * @param [in] topic The topic of interest.
+ * @return True if the connection receives the topic, false otherwise.
+ */
+bool
+BLE_PubSub_Service::subscribed(uint16_t connection_id, uint8_t topic)
+{
+    if (topic >= TOPICS)
+        return false;
+
+    AnchorSemaphore anchor(m_subscribers_semaphore);
+    for (auto& subscriber : m_subscribers)
+    {
+        if (subscriber.used && (subscriber.connection_id == connection_id))
+            return subscriber.topics.test(topic);
+    }
+
+    return false;
+}
+
+
+/**
+ * @brief Retrieves the publication counters.
+ * @param [in] reset (default=false) Zeroes the counters after reading them.
+ * @return A copy of the counters.
+ */
+BLE_PubSub_Service::counters_t
+BLE_PubSub_Service::counters_get(bool reset)
+{
+    auto read = [reset](std::atomic<uint32_t>& counter){
+        return reset ? counter.exchange(0, std::memory_order_relaxed)
+                     : counter.load(std::memory_order_relaxed);
+    };
+
+    counters_t counters;
+    counters.published = read(m_published);
+    counters.unsent = read(m_unsent);
+    counters.rate_limited = read(m_rate_limited);
+    counters.delivered = read(m_delivered);
+    counters.dropped = read(m_dropped);
+    return counters;
+}
+
+
+/***************************************************************************************************
+* Registration
+***************************************************************************************************/
+void
+BLE_PubSub_Service::handle_control(uint16_t connection_id, const uint8_t* value, size_t length)
+{
+    if (length == 0)
+        return;
+
+    AnchorSemaphore anchor(m_subscribers_semaphore);
+    subscriber_t* subscriber = subscriber_get(connection_id);
+    if (!subscriber)
+    {
+        PUBSUB_LOGW("No room for the subscriptions of 0x%04X", connection_id);
+        return;
+    }
+
+    switch (static_cast<Command>(value[0]))
+    {
+        case Command::SUBSCRIBE:
+            if (length >= PUBSUB_SUBSCRIBE_LENGTH)
+                topics_set(*subscriber, value[1], value[2], true, value[3] | (value[4] << 8));
+        break;
+        case Command::UNSUBSCRIBE:
+            if (length >= PUBSUB_UNSUBSCRIBE_LENGTH)
+                topics_set(*subscriber, value[1], value[2], false, 0);
+        break;
+        case Command::CLEAR:
+            subscriber->topics.reset();
+        break;
+        default:
+            PUBSUB_LOGW("Unknown command 0x%02X from 0x%04X", value[0], connection_id);
+        break;
+    }
+}
+
+
+BLE_PubSub_Service::subscriber_t*
+BLE_PubSub_Service::subscriber_get(uint16_t connection_id)
+{
+    auto server = m_server.lock();
+    auto connection = server ? server->connection_get(connection_id) : std::nullopt;
+    if (!connection)
+        return nullptr;
+
+    subscriber_t* free_subscriber = nullptr;
+    for (auto& subscriber : m_subscribers)
+    {
+        if (!subscriber.used)
+        {
+            free_subscriber = free_subscriber ? free_subscriber : &subscriber;
+            continue;
+        }
+
+        if (subscriber.connection_id != connection_id)
+            continue;
+
+        if (memcmp(subscriber.address, connection->bda, sizeof(esp_bd_addr_t)) == 0)
+            return &subscriber;
+
+        free_subscriber = &subscriber;
+        break;
+    }
+
+    if (!free_subscriber)
+        return nullptr;
+
+    free_subscriber->used = true;
+    free_subscriber->connection_id = connection_id;
+    memcpy(free_subscriber->address, connection->bda, sizeof(esp_bd_addr_t));
+    free_subscriber->topics.reset();
+    return free_subscriber;
+}
+
+
+void
+BLE_PubSub_Service::topics_set(subscriber_t& subscriber, uint8_t filter, uint8_t mask,
+                               bool subscribe, uint16_t interval_ms)
+{
+    // The filter is expanded once here so that publishing only tests a bit.
+    for (size_t topic = 0; topic < TOPICS; topic++)
+    {
+        if ((topic & mask) != (filter & mask))
+            continue;
+
+        subscriber.topics.set(topic, subscribe);
+        if (subscribe)
+        {
+            subscriber.interval_ms[topic] = interval_ms;
+            subscriber.sent_ms[topic] = static_cast<uint32_t>(esp_timer_get_time() / 1000) -
+                                        interval_ms;
+        }
+    }
+}
+
+
+/***************************************************************************************************
+* Publication
+***************************************************************************************************/
+size_t
+BLE_PubSub_Service::targets_select(uint8_t topic, targets_t& targets)
+{
+    m_published.fetch_add(1, std::memory_order_relaxed);
+
+    auto server = m_server.lock();
+    auto messages = m_messages.lock();
+    if ((topic >= TOPICS) || !server || !messages)
+    {
+        m_unsent.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    uint32_t now_ms = static_cast<uint32_t>(esp_timer_get_time() / 1000);
+    size_t capacity = ATT_ATTRIBUTE_LENGTH_MAX - MESSAGE_HEADER_LENGTH;
+    AnchorSemaphore anchor(m_subscribers_semaphore);
+    for (auto& subscriber : m_subscribers)
+    {
+        if (!subscriber.used || !subscriber.topics.test(topic))
+            continue;
+
+        // Entries of closed connections are reclaimed here rather than tracking disconnections,
+        // including those whose connection ID was reused by another peer since.
+        auto connection = server->connection_get(subscriber.connection_id);
+        if (!connection ||
+            memcmp(subscriber.address, connection->bda, sizeof(esp_bd_addr_t)))
+        {
+            subscriber.used = false;
+            continue;
+        }
+
+        if (!messages->subscription_get(subscriber.connection_id))
+            continue;
+
+        if ((now_ms - subscriber.sent_ms[topic]) < subscriber.interval_ms[topic])
+        {
+            m_rate_limited.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        subscriber.sent_ms[topic] = now_ms;
+        targets.connections[targets.count++] = subscriber.connection_id;
+
+        capacity = std::min(capacity,
+                            messages->notification_capacity_get(subscriber.connection_id) -
+                            MESSAGE_HEADER_LENGTH);
+    }
+
+    if (!targets.count)
+    {
+        m_unsent.fetch_add(1, std::memory_order_relaxed);
+        return 0;
+    }
+
+    return capacity;
+}
+
+
+size_t
+BLE_PubSub_Service::targets_send(const targets_t& targets, const uint8_t* message, size_t length)
+{
+    auto messages = m_messages.lock();
+    if (!messages)
+        return 0;
+
+    size_t sent = 0;
+    for (size_t i = 0; i < targets.count; i++)
+    {
+        if (messages->notify(targets.connections[i], message, length))
+            sent++;
+    }
+
+    m_delivered.fetch_add(sent, std::memory_order_relaxed);
+    m_dropped.fetch_add(targets.count - sent, std::memory_order_relaxed);
+    return sent;
+}
+
+};
@@ -0,0 +1,207 @@
+/**
+ * @file   ble_pubsub.hpp
+ *
+ * @brief  Topic based publish/subscribe service.
+ * @detail Clients register topic filters and minimum intervals on a control characteristic, each
+ *         registration is compiled into a topic bitmap for the connection. Messages are fanned
+ *         out on a single notify characteristic to the connections whose bitmap holds the topic
+ *         and whose interval has elapsed, and a message nobody is due to receive is never
+ *         encoded.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_PUBSUB_HPP
+#define COMPONENTS_BLE_BLE_PUBSUB_HPP
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+
+#include "esp_gap_ble_api.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+
+#include "ble_characteristic.hpp"
+#include "ble_profile.hpp"
+#include "ble_utilities.hpp"
+#include "types.hpp"
+
+#ifndef CONFIG_BLE_REDUX_PUBSUB_TOPICS
+#define CONFIG_BLE_REDUX_PUBSUB_TOPICS 32
+#endif
+
+#ifndef CONFIG_BLE_REDUX_PUBSUB_CONNECTIONS_MAX
+#define CONFIG_BLE_REDUX_PUBSUB_CONNECTIONS_MAX 4
+#endif
+
+namespace BLE
+{
+
+class BLE_PubSub_Service
+{
+public:
+    // The first byte of a control write.
+    enum class Command : uint8_t
+    {
+        // Followed by a filter, a mask and a minimum interval in milliseconds (uint16_t, little
+        // endian). Subscribes to every topic whose masked bits equal those of the filter.
+        SUBSCRIBE = 0x01,
+        // Followed by a filter and a mask.
+        UNSUBSCRIBE = 0x02,
+        CLEAR = 0x03,
+    };
+
+    struct counters_t
+    {
+        uint32_t    published;
+        // Publications which no connection was due to receive, they were never encoded.
+        uint32_t    unsent;
+        // Publications skipped for a connection because its interval had not elapsed.
+        uint32_t    rate_limited;
+        uint32_t    delivered;
+        // Messages the stack refused or which did not fit the MTU of a connection.
+        uint32_t    dropped;
+    };
+
+    static constexpr const uint128_t UUID_SERVICE =
+        absl::MakeUint128(0x7B5E0201A1B24E8C, 0x9D3F60C1B2A9E4D7);
+    static constexpr const uint128_t UUID_CONTROL =
+        absl::MakeUint128(0x7B5E0202A1B24E8C, 0x9D3F60C1B2A9E4D7);
+    static constexpr const uint128_t UUID_MESSAGES =
+        absl::MakeUint128(0x7B5E0203A1B24E8C, 0x9D3F60C1B2A9E4D7);
+
+    static constexpr const size_t TOPICS = CONFIG_BLE_REDUX_PUBSUB_TOPICS;
+    // A message is its topic followed by the payload.
+    static constexpr const size_t MESSAGE_HEADER_LENGTH = sizeof(uint8_t);
+
+    static_assert(TOPICS <= 256, "Topics are identified by a single byte");
+
+
+    /**
+     * @brief Adds the publish/subscribe service to a profile.
+     * @param [in] profile The profile to add the service to.
+     * @return A shared pointer to the service, nullptr if it could not be created.
+     */
+    static std::shared_ptr<BLE_PubSub_Service> create(std::shared_ptr<BLE_Profile> profile);
+
+    ~BLE_PubSub_Service(void);
+
+    BLE_PubSub_Service(const BLE_PubSub_Service&) = delete;
+    BLE_PubSub_Service& operator=(const BLE_PubSub_Service&) = delete;
+
+    /**
+     * @brief Publishes a message to the connections subscribed to its topic.
+     * @detail The connections due to receive the message are selected first, the encoder only
+     *         runs if there is at least one. It writes the payload to the buffer it is given and
+     *         returns its length, a length above the capacity drops the message.
+     * @note This function is thread safe. The message is encoded on the stack of the caller.
+     * @tparam Encoder A callable of signature size_t(uint8_t* buffer, size_t capacity).
+     * @param [in] topic The topic of the message.
+     * @param [in] encode The encoder of the payload, called at most once.
+     * @return The number of connections the message was sent to.
+     */
+    template<typename Encoder>
+    size_t publish(uint8_t topic, Encoder&& encode)
+    {
+        targets_t targets;
+        size_t capacity = targets_select(topic, targets);
+        if (!capacity)
+            return 0;
+
+        std::array<uint8_t, ATT_ATTRIBUTE_LENGTH_MAX> message;
+        message[0] = topic;
+        size_t length = encode(message.data() + MESSAGE_HEADER_LENGTH, capacity);
+        if (length > capacity)
+        {
+            m_dropped.fetch_add(targets.count, std::memory_order_relaxed);
+            return 0;
+        }
+
+        return targets_send(targets, message.data(), MESSAGE_HEADER_LENGTH + length);
+    }
+
+    /**
+     * @brief Publishes an encoded payload to the connections subscribed to its topic.
+     * @note This function is thread safe.
+     * @param [in] topic The topic of the message.
+     * @param [in] data The payload.
+     * @param [in] length The length of the payload.
+     * @return The number of connections the message was sent to.
+     */
+    size_t publish(uint8_t topic, const uint8_t* data, size_t length);
+
+    /**
+     * @brief Checks whether a connection subscribed to a topic.
+     * @note This function is thread safe.
+     * @param [in] connection_id The connection of interest.
+     * @param [in] topic The topic of interest.
+     * @return True if the connection receives the topic, false otherwise.
+     */
+    bool subscribed(uint16_t connection_id, uint8_t topic);
+
+    /**
+     * @brief Retrieves the publication counters.
+     * @param [in] reset (default=false) Zeroes the counters after reading them.
+     * @return A copy of the counters.
+     */
+    counters_t counters_get(bool reset=false);
+
+private:
+    // The filters of a connection, compiled when they are registered.
+    struct subscriber_t
+    {
+        bool                                used;
+        uint16_t                            connection_id;
+        // Registrations are reset once the connection ID is reused by another peer.
+        esp_bd_addr_t                       address;
+        std::bitset<TOPICS>                 topics;
+        std::array<uint16_t, TOPICS>        interval_ms;
+        std::array<uint32_t, TOPICS>        sent_ms;
+    };
+
+    struct targets_t
+    {
+        std::array<uint16_t, CONFIG_BLE_REDUX_PUBSUB_CONNECTIONS_MAX>  connections;
+        size_t                                                          count = 0;
+    };
+
+
+    BLE_PubSub_Service(void);
+
+    void handle_control(uint16_t connection_id, const uint8_t* value, size_t length);
+    subscriber_t* subscriber_get(uint16_t connection_id);
+    void topics_set(subscriber_t& subscriber, uint8_t filter, uint8_t mask, bool subscribe,
+                    uint16_t interval_ms);
+
+    size_t targets_select(uint8_t topic, targets_t& targets);
+    size_t targets_send(const targets_t& targets, const uint8_t* message, size_t length);
+
+
+    std::weak_ptr<BLE_Server>           m_server;
+    std::weak_ptr<BLE_Characteristic>   m_messages;
+
+    std::array<subscriber_t, CONFIG_BLE_REDUX_PUBSUB_CONNECTIONS_MAX>  m_subscribers = {};
+    SemaphoreHandle_t                   m_subscribers_semaphore = xSemaphoreCreateBinary();
+
+    std::atomic<uint32_t>               m_published{0};
+    std::atomic<uint32_t>               m_unsent{0};
+    std::atomic<uint32_t>               m_rate_limited{0};
+    std::atomic<uint32_t>               m_delivered{0};
+    std::atomic<uint32_t>               m_dropped{0};
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_PUBSUB_HPP
@@ -0,0 +1,85 @@
+/**
+ * @file   ble_queue.hpp
+ *
+ * @brief  Bounded lock-free multi-producer multi-consumer queue.
+ * @detail A fixed capacity ring of cells, each carrying a sequence number which tells producers
+ *         and consumers whether the cell is free or holds a value for the current lap. Neither
+ *         side ever blocks or allocates, a full queue rejects the value instead.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_QUEUE_HPP
+#define COMPONENTS_BLE_BLE_QUEUE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <type_traits>
+
+#include "ble_trace.hpp"
+
+namespace BLE
+{
+
+template<typename T, size_t N>
+class BLE_Queue
+{
+public:
+    static_assert((N != 0) && ((N & (N - 1)) == 0), "The queue capacity must be a power of two");
+    static_assert(std::is_trivially_copyable_v<T>, "Queued values are copied in and out by value");
+
+    /**
+     * @brief Creates an empty queue.
+     * @param [in] trace_id (default=0) An identifier used by queue tracepoints, see BLE_Trace.
+     */
+    explicit BLE_Queue(uint16_t trace_id=0);
+
+    /**
+     * @brief Appends a value to the queue.
+     * @note This function is lock-free and safe to call from any task.
+     * @param [in] value The value to append.
+     * @return True if the value was queued, false if the queue is full.
+     */
+    bool push(const T& value);
+
+    /**
+     * @brief Removes the oldest value from the queue.
+     * @note This function is lock-free and safe to call from any task.
+     * @param [out] value The location the oldest value is moved to.
+     * @return True if a value was retrieved, false if the queue is empty.
+     */
+    bool pop(T& value);
+
+    /**
+     * @brief Retrieves the number of queued values.
+     * @note The result is only a snapshot when other tasks are using the queue concurrently.
+     * @return The approximate number of queued values.
+     */
+    size_t size(void) const;
+
+    static constexpr size_t capacity(void) { return N; }
+
+private:
+    struct cell_t
+    {
+        std::atomic<size_t> sequence;
+        T                   value;
+    };
+
+    std::array<cell_t, N>   m_cells;
+    std::atomic<size_t>     m_position_push = {0};
+    std::atomic<size_t>     m_position_pop = {0};
+    const uint16_t          m_trace_id;
+};
+
+#include "ble_queue.tpp"
+
+};
+
+#endif // COMPONENTS_BLE_BLE_QUEUE_HPP
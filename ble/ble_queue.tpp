@@ -0,0 +1,137 @@
+/**
+ * @file   ble_queue.tpp
+ *
+ * @brief  Bounded lock-free multi-producer multi-consumer queue.
+ * @detail A fixed capacity ring of cells, each carrying a sequence number which tells producers
+ *         and consumers whether the cell is free or holds a value for the current lap. Neither
+ *         side ever blocks or allocates, a full queue rejects the value instead.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_QUEUE_TPP
+#define COMPONENTS_BLE_BLE_QUEUE_TPP
+
+/**
+ * @brief Creates an empty queue.
+ * @param [in] trace_id (default=0) An identifier used by queue tracepoints, see BLE_Trace.
+ */
+template<typename T, size_t N>
+BLE_Queue<T, N>::BLE_Queue(uint16_t trace_id)
+    : m_trace_id(trace_id)
+{
+    for (size_t i = 0; i < N; i++)
+        m_cells[i].sequence.store(i, std::memory_order_relaxed);
+}
+
+
+/**
+ * @brief Appends a value to the queue.
+ * @note This function is lock-free and safe to call from any task.
+ * @param [in] value The value to append.
+ * @return True if the value was queued, false if the queue is full.
+ */
+template<typename T, size_t N>
+bool
+BLE_Queue<T, N>::push(const T& value)
+{
+    size_t position = m_position_push.load(std::memory_order_relaxed);
+    cell_t* cell;
+    for (;;)
+    {
+        cell = &m_cells[position & (N - 1)];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+
+        // The cell is free for this lap, try to claim it.
+        if (difference == 0)
+        {
+            if (m_position_push.compare_exchange_weak(position, position + 1,
+                                                      std::memory_order_relaxed))
+                break;
+        }
+        // The cell still holds the value from the previous lap, the queue is full.
+        else if (difference < 0)
+        {
+            return false;
+        }
+        // Another producer claimed the cell first.
+        else
+        {
+            position = m_position_push.load(std::memory_order_relaxed);
+        }
+    }
+
+    cell->value = value;
+    cell->sequence.store(position + 1, std::memory_order_release);
+
+    BLE_TRACE(QUEUE_ENQUEUE, 0, m_trace_id, 0, size());
+    return true;
+}
+
+
+/**
+ * @brief Removes the oldest value from the queue.
+ * @note This function is lock-free and safe to call from any task.
+ * @param [out] value The location the oldest value is moved to.
+ * @return True if a value was retrieved, false if the queue is empty.
+ */
+template<typename T, size_t N>
+bool
+BLE_Queue<T, N>::pop(T& value)
+{
+    size_t position = m_position_pop.load(std::memory_order_relaxed);
+    cell_t* cell;
+    for (;;)
+    {
+        cell = &m_cells[position & (N - 1)];
+        size_t sequence = cell->sequence.load(std::memory_order_acquire);
+        intptr_t difference = static_cast<intptr_t>(sequence) -
+                              static_cast<intptr_t>(position + 1);
+
+        // The cell holds a value for this lap, try to claim it.
+        if (difference == 0)
+        {
+            if (m_position_pop.compare_exchange_weak(position, position + 1,
+                                                     std::memory_order_relaxed))
+                break;
+        }
+        // The cell has not been written yet, the queue is empty.
+        else if (difference < 0)
+        {
+            return false;
+        }
+        // Another consumer claimed the cell first.
+        else
+        {
+            position = m_position_pop.load(std::memory_order_relaxed);
+        }
+    }
+
+    value = cell->value;
+    cell->sequence.store(position + N, std::memory_order_release);
+
+    BLE_TRACE(QUEUE_DEQUEUE, 0, m_trace_id, 0, size());
+    return true;
+}
+
+
+/**
+ * @brief Retrieves the number of queued values.
+ * @note The result is only a snapshot when other tasks are using the queue concurrently.
+ * @return The approximate number of queued values.
+ */
+template<typename T, size_t N>
+size_t
+BLE_Queue<T, N>::size(void) const
+{
+    size_t pushed = m_position_push.load(std::memory_order_relaxed);
+    size_t popped = m_position_pop.load(std::memory_order_relaxed);
+    return pushed >= popped ? pushed - popped : 0;
+}
+
+#endif // COMPONENTS_BLE_BLE_QUEUE_TPP
@@ -0,0 +1,327 @@
+/**
+ * @file   ble_remote_characteristic.cpp
+ *
+ * @brief  ESP32 Bluetooth Low Energy remote characteristic proxy.
+ * @detail This class represents a characteristic discovered on a peripheral the client is
+ *         connected to. Reads, writes and subscription changes are queued on the connection of
+ *         the characteristic and complete asynchronously, blocking variants are provided for
+ *         convenience.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "esp_gatt_defs.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "utilities.hpp"
+
+#include "ble_log.hpp"
+#include "ble_remote_characteristic.hpp"
+#include "ble_remote_profile.hpp"
+#include "ble_remote_service.hpp"
+
+namespace BLE
+{
+
+using Utilities::AnchorSemaphore;
+
+
+constexpr const char* LOG_TAG_BLE_REMOTE_CHARACTERISTIC = "BLE Remote Characteristic";
+
+// Longer than the 30 second ATT transaction timeout, after which the stack fails the operation.
+constexpr const TickType_t REMOTE_OPERATION_TIMEOUT = pdMS_TO_TICKS(35000);
+
+/***************************************************************************************************
+* Logging Macros
+***************************************************************************************************/
+#define REMOTE_CHARACTERISTIC_LOG_LEVEL CONFIG_BLE_REDUX_LOG_LEVEL_CLIENT
+
+#define REMOTE_CHARACTERISTIC_LOG(LVL, MSG, ...)\
+    BLE_LOG(REMOTE_CHARACTERISTIC_LOG_LEVEL, LVL, LOG_TAG_BLE_REMOTE_CHARACTERISTIC, "%04X --",\
+            this->handle, MSG, ##__VA_ARGS__)
+
+#define REMOTE_CHARACTERISTIC_LOGE(MSG, ...)\
+    REMOTE_CHARACTERISTIC_LOG(ESP_LOG_ERROR, MSG, ##__VA_ARGS__)
+#define REMOTE_CHARACTERISTIC_LOGW(MSG, ...)\
+    REMOTE_CHARACTERISTIC_LOG(ESP_LOG_WARN, MSG, ##__VA_ARGS__)
+#define REMOTE_CHARACTERISTIC_LOGI(MSG, ...)\
+    REMOTE_CHARACTERISTIC_LOG(ESP_LOG_INFO, MSG, ##__VA_ARGS__)
+#define REMOTE_CHARACTERISTIC_LOGD(MSG, ...)\
+    REMOTE_CHARACTERISTIC_LOG(ESP_LOG_DEBUG, MSG, ##__VA_ARGS__)
+#define REMOTE_CHARACTERISTIC_LOGV(MSG, ...)\
+    REMOTE_CHARACTERISTIC_LOG(ESP_LOG_VERBOSE, MSG, ##__VA_ARGS__)
+
+
+// The state shared between a blocking call and its completion. It is reference counted so that a
+// completion arriving after the caller gave up does not touch freed memory.
+struct remote_completion_t
+{
+    remote_completion_t(void) : done(xSemaphoreCreateBinary())
+    {
+        if (done == nullptr)
+            throw std::bad_alloc();
+    }
+
+    ~remote_completion_t(void)
+    {
+        vSemaphoreDelete(done);
+    }
+
+    bool wait(void)
+    {
+        return (xSemaphoreTake(done, REMOTE_OPERATION_TIMEOUT) == pdTRUE) &&
+               (status == ESP_GATT_OK);
+    }
+
+    SemaphoreHandle_t       done;
+    esp_gatt_status_t       status = ESP_GATT_ERROR;
+    std::vector<uint8_t>    value;
+};
+
+
+/***************************************************************************************************
+* Remote Characteristic Member Functions
+***************************************************************************************************/
+/**
+ * @brief Queues a read of the value.
+ * @note This function is thread safe.
+ * @param [in] callback The function receiving the status and the value once the read completes.
+ *             Values longer than the MTU are read in full by the stack.
+ * @return True if the read was queued, false if the connection is gone or its queue is full.
+ */
+bool
+BLE_Remote_Characteristic::read(Read_Callback callback)
+{
+    if (!(properties & ESP_GATT_CHAR_PROP_BIT_READ))
+    {
+        REMOTE_CHARACTERISTIC_LOGE("Characteristic is not readable");
+        return false;
+    }
+
+    auto profile = profile_get();
+    if (!profile)
+        return false;
+
+    auto completion = [callback](esp_gatt_status_t status, const uint8_t* value, size_t length){
+        if (callback)
+            callback(status, std::vector<uint8_t>(value, value + length));
+    };
+
+    return profile->operation_enqueue({BLE_Remote_Profile::OP::READ, handle, {}, completion});
+}
+
+
+/**
+ * @brief Reads the value and waits for the result.
+ * @warning Must not be called from a callback of the client, the completion would never be
+ *          delivered.
+ * @return The value or std::nullopt if the read failed.
+ */
+std::optional<std::vector<uint8_t>>
+BLE_Remote_Characteristic::read(void)
+{
+    auto result = std::make_shared<remote_completion_t>();
+    bool queued = read([result](esp_gatt_status_t status, const std::vector<uint8_t>& value){
+        result->status = status;
+        result->value = value;
+        xSemaphoreGive(result->done);
+    });
+
+    if (!queued || !result->wait())
+        return {};
+
+    return std::move(result->value);
+}
+
+
+/**
+ * @brief Queues a write of the value.
+ * @note This function is thread safe.
+ * @param [in] value The value to write, values longer than the MTU are written with prepared
+ *             writes by the stack.
+ * @param [in] callback The function receiving the status once the write completes.
+ * @param [in] response (default=true) Uses a Write Request, otherwise a Write Command whose
+ *             completion only means that it has been handed to the controller.
+ * @return True if the write was queued, false if the connection is gone or its queue is full.
+ */
+bool
+BLE_Remote_Characteristic::write(std::vector<uint8_t> value, Write_Callback callback,
+                                 bool response)
+{
+    esp_gatt_char_prop_t required = response ? ESP_GATT_CHAR_PROP_BIT_WRITE
+                                             : ESP_GATT_CHAR_PROP_BIT_WRITE_NR;
+    if (!(properties & required))
+    {
+        REMOTE_CHARACTERISTIC_LOGE("Characteristic does not support this write type");
+        return false;
+    }
+
+    auto profile = profile_get();
+    if (!profile)
+        return false;
+
+    auto completion = [callback](esp_gatt_status_t status, const uint8_t*, size_t){
+        if (callback)
+            callback(status);
+    };
+
+    return profile->operation_enqueue({response ? BLE_Remote_Profile::OP::WRITE
+                                                : BLE_Remote_Profile::OP::WRITE_NO_RESPONSE,
+                                       handle, std::move(value), completion});
+}
+
+
+/**
+ * @brief Writes the value and waits for the result.
+ * @warning Must not be called from a callback of the client, the completion would never be
+ *          delivered.
+ * @param [in] value The value to write.
+ * @param [in] response (default=true) Uses a Write Request, otherwise a Write Command.
+ * @return True on success, false otherwise.
+ */
+bool
+BLE_Remote_Characteristic::write(std::vector<uint8_t> value, bool response)
+{
+    auto result = std::make_shared<remote_completion_t>();
+    bool queued = write(std::move(value), [result](esp_gatt_status_t status){
+        result->status = status;
+        xSemaphoreGive(result->done);
+    }, response);
+
+    return queued && result->wait();
+}
+
+
+/**
+ * @brief Subscribes to notifications or indications of the value.
+ * @detail The callback is registered immediately, the Client Characteristic Configuration write
+ *         is queued like any other operation.
+ * @note This function is thread safe.
+ * @param [in] callback The function receiving every notified or indicated value.
+ * @param [in] indicate (default=false) Requests indications instead of notifications.
+ * @param [in] completion (default=nullptr) The function receiving the status of the configuration
+ *             write.
+ * @return True if the subscription was queued, false if the characteristic does not support it,
+ *         the connection is gone or its queue is full.
+ */
+bool
+BLE_Remote_Characteristic::subscribe(Notify_Callback callback, bool indicate,
+                                     Write_Callback completion)
+{
+    esp_gatt_char_prop_t required = indicate ? ESP_GATT_CHAR_PROP_BIT_INDICATE
+                                             : ESP_GATT_CHAR_PROP_BIT_NOTIFY;
+    if (!(properties & required) || !configuration_handle)
+    {
+        REMOTE_CHARACTERISTIC_LOGE("Characteristic does not support this subscription");
+        return false;
+    }
+
+    auto profile = profile_get();
+    if (!profile)
+        return false;
+
+    {
+        AnchorSemaphore anchor(m_callback_notify_semaphore);
+        m_callback_notify = std::move(callback);
+    }
+
+    // Registration only updates the stack's local table, it is in place before the peripheral
+    // sees the configuration write queued behind it.
+    esp_err_t err = profile->notify_register(handle, true);
+    if (err)
+    {
+        REMOTE_CHARACTERISTIC_LOGE("Notification registration failed: %s (%d)",
+                                   esp_err_to_name(err), err);
+        return false;
+    }
+
+    return configuration_write(indicate ? CONFIGURATION_INDICATE : CONFIGURATION_NOTIFY,
+                               std::move(completion));
+}
+
+
+/**
+ * @brief Unsubscribes from notifications and indications of the value.
+ * @note This function is thread safe.
+ * @param [in] completion (default=nullptr) The function receiving the status of the configuration
+ *             write.
+ * @return True if the configuration write was queued, false otherwise.
+ */
+bool
+BLE_Remote_Characteristic::unsubscribe(Write_Callback completion)
+{
+    if (!configuration_handle)
+        return false;
+
+    auto profile = profile_get();
+    if (!profile)
+        return false;
+
+    {
+        AnchorSemaphore anchor(m_callback_notify_semaphore);
+        m_callback_notify = nullptr;
+    }
+
+    profile->notify_register(handle, false);
+    return configuration_write(0, std::move(completion));
+}
+
+
+std::shared_ptr<BLE_Remote_Profile>
+BLE_Remote_Characteristic::profile_get(void) const
+{
+    auto service_instance = service.lock();
+    if (!service_instance)
+        return nullptr;
+
+    return service_instance->profile.lock();
+}
+
+
+void
+BLE_Remote_Characteristic::handle_notification(const uint8_t* value, size_t length)
+{
+    Notify_Callback callback;
+    {
+        AnchorSemaphore anchor(m_callback_notify_semaphore);
+        callback = m_callback_notify;
+    }
+
+    if (callback)
+        callback(value, length);
+    else
+        REMOTE_CHARACTERISTIC_LOGV("Notification without a subscriber");
+}
+
+
+bool
+BLE_Remote_Characteristic::configuration_write(uint16_t configuration, Write_Callback completion)
+{
+    auto profile = profile_get();
+    if (!profile)
+        return false;
+
+    auto operation_completion = [completion](esp_gatt_status_t status, const uint8_t*, size_t){
+        if (completion)
+            completion(status);
+    };
+
+    std::vector<uint8_t> value = {static_cast<uint8_t>(configuration & 0xFF),
+                                  static_cast<uint8_t>(configuration >> 8)};
+    return profile->operation_enqueue({BLE_Remote_Profile::OP::DESCRIPTOR_WRITE,
+                                       configuration_handle, std::move(value),
+                                       operation_completion});
+}
+
+};
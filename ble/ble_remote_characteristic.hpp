@@ -0,0 +1,155 @@
+/**
+ * @file   ble_remote_characteristic.hpp
+ *
+ * @brief  ESP32 Bluetooth Low Energy remote characteristic proxy.
+ * @detail This class represents a characteristic discovered on a peripheral the client is
+ *         connected to. Reads, writes and subscription changes are queued on the connection of
+ *         the characteristic and complete asynchronously, blocking variants are provided for
+ *         convenience.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_REMOTE_CHARACTERISTIC_HPP
+#define COMPONENTS_BLE_BLE_REMOTE_CHARACTERISTIC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <new>
+#include <optional>
+#include <vector>
+
+#include "esp_gatt_defs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "types.hpp"
+
+namespace BLE
+{
+
+class BLE_Remote_Profile;
+class BLE_Remote_Service;
+
+
+class BLE_Remote_Characteristic
+{
+public:
+    using Read_Callback = std::function<void(esp_gatt_status_t, const std::vector<uint8_t>&)>;
+    using Write_Callback = std::function<void(esp_gatt_status_t)>;
+    // Called from the GATTC event handler with the value of every notification or indication.
+    using Notify_Callback = std::function<void(const uint8_t*, size_t)>;
+
+    // The bits of the Client Characteristic Configuration descriptor.
+    static constexpr const uint16_t CONFIGURATION_NOTIFY = 0x0001;
+    static constexpr const uint16_t CONFIGURATION_INDICATE = 0x0002;
+
+
+    BLE_Remote_Characteristic(UUID uuid, uint16_t handle, esp_gatt_char_prop_t properties,
+                              uint16_t configuration_handle,
+                              std::weak_ptr<BLE_Remote_Service> service)
+        : uuid(uuid),
+          handle(handle),
+          properties(properties),
+          configuration_handle(configuration_handle),
+          service(service)
+    {
+        if (m_callback_notify_semaphore == nullptr)
+            throw std::bad_alloc();
+
+        xSemaphoreGive(m_callback_notify_semaphore);
+    }
+
+    /**
+     * @brief Queues a read of the value.
+     * @note This function is thread safe.
+     * @param [in] callback The function receiving the status and the value once the read
+     *             completes. Values longer than the MTU are read in full by the stack.
+     * @return True if the read was queued, false if the connection is gone or its queue is full.
+     */
+    bool read(Read_Callback callback);
+
+    /**
+     * @brief Reads the value and waits for the result.
+     * @warning Must not be called from a callback of the client, the completion would never be
+     *          delivered.
+     * @return The value or std::nullopt if the read failed.
+     */
+    std::optional<std::vector<uint8_t>> read(void);
+
+    /**
+     * @brief Queues a write of the value.
+     * @note This function is thread safe.
+     * @param [in] value The value to write, values longer than the MTU are written with prepared
+     *             writes by the stack.
+     * @param [in] callback The function receiving the status once the write completes.
+     * @param [in] response (default=true) Uses a Write Request, otherwise a Write Command whose
+     *             completion only means that it has been handed to the controller.
+     * @return True if the write was queued, false if the connection is gone or its queue is full.
+     */
+    bool write(std::vector<uint8_t> value, Write_Callback callback, bool response=true);
+
+    /**
+     * @brief Writes the value and waits for the result.
+     * @warning Must not be called from a callback of the client, the completion would never be
+     *          delivered.
+     * @param [in] value The value to write.
+     * @param [in] response (default=true) Uses a Write Request, otherwise a Write Command.
+     * @return True on success, false otherwise.
+     */
+    bool write(std::vector<uint8_t> value, bool response=true);
+
+    /**
+     * @brief Subscribes to notifications or indications of the value.
+     * @detail The callback is registered immediately, the Client Characteristic Configuration
+     *         write is queued like any other operation.
+     * @note This function is thread safe.
+     * @param [in] callback The function receiving every notified or indicated value.
+     * @param [in] indicate (default=false) Requests indications instead of notifications.
+     * @param [in] completion (default=nullptr) The function receiving the status of the
+     *             configuration write.
+     * @return True if the subscription was queued, false if the characteristic does not support
+     *         it, the connection is gone or its queue is full.
+     */
+    bool subscribe(Notify_Callback callback, bool indicate=false,
+                   Write_Callback completion=nullptr);
+
+    /**
+     * @brief Unsubscribes from notifications and indications of the value.
+     * @note This function is thread safe.
+     * @param [in] completion (default=nullptr) The function receiving the status of the
+     *             configuration write.
+     * @return True if the configuration write was queued, false otherwise.
+     */
+    bool unsubscribe(Write_Callback completion=nullptr);
+
+
+    const UUID                                  uuid;
+    const uint16_t                              handle;
+    const esp_gatt_char_prop_t                  properties;
+    // The handle of the Client Characteristic Configuration descriptor, 0 if there is none.
+    const uint16_t                              configuration_handle;
+    const std::weak_ptr<BLE_Remote_Service>     service;
+
+private:
+    friend class BLE_Remote_Profile;
+
+    std::shared_ptr<BLE_Remote_Profile> profile_get(void) const;
+    void handle_notification(const uint8_t* value, size_t length);
+    bool configuration_write(uint16_t configuration, Write_Callback completion);
+
+
+    // Replaced by the application while the GATTC event handler may be invoking it.
+    Notify_Callback     m_callback_notify;
+    SemaphoreHandle_t   m_callback_notify_semaphore = xSemaphoreCreateBinary();
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_REMOTE_CHARACTERISTIC_HPP
@@ -0,0 +1,457 @@
+/**
+ * @file   ble_remote_profile.cpp
+ *
+ * @brief  ESP32 Bluetooth Low Energy remote profile proxy.
+ * @detail This class represents the GATT database of a peripheral the client is connected to,
+ *         along with the connection itself. Operations on its characteristics are queued per
+ *         connection; ATT allows a single outstanding request per bearer, so the next operation
+ *         is issued from the completion event of the previous one instead of waiting for the
+ *         application to react.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "esp_gattc_api.h"
+#include "esp_gatt_defs.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "utilities.hpp"
+
+#include "ble_client.hpp"
+#include "ble_log.hpp"
+#include "ble_remote_profile.hpp"
+#include "ble_utilities.hpp"
+
+namespace BLE
+{
+
+using Utilities::AnchorSemaphore;
+
+
+constexpr const char* LOG_TAG_BLE_REMOTE_PROFILE = "BLE Remote Profile";
+
+/***************************************************************************************************
+* Logging Macros
+***************************************************************************************************/
+#define REMOTE_PROFILE_LOG_LEVEL CONFIG_BLE_REDUX_LOG_LEVEL_CLIENT
+
+#define REMOTE_PROFILE_LOG(LVL, MSG, ...)\
+    BLE_LOG(REMOTE_PROFILE_LOG_LEVEL, LVL, LOG_TAG_BLE_REMOTE_PROFILE, "%04X --",\
+            this->connection_id, MSG, ##__VA_ARGS__)
+
+#define REMOTE_PROFILE_LOGE(MSG, ...) REMOTE_PROFILE_LOG(ESP_LOG_ERROR, MSG, ##__VA_ARGS__)
+#define REMOTE_PROFILE_LOGW(MSG, ...) REMOTE_PROFILE_LOG(ESP_LOG_WARN, MSG, ##__VA_ARGS__)
+#define REMOTE_PROFILE_LOGI(MSG, ...) REMOTE_PROFILE_LOG(ESP_LOG_INFO, MSG, ##__VA_ARGS__)
+#define REMOTE_PROFILE_LOGD(MSG, ...) REMOTE_PROFILE_LOG(ESP_LOG_DEBUG, MSG, ##__VA_ARGS__)
+#define REMOTE_PROFILE_LOGV(MSG, ...) REMOTE_PROFILE_LOG(ESP_LOG_VERBOSE, MSG, ##__VA_ARGS__)
+
+
+/***************************************************************************************************
+* Remote Profile Member Functions
+***************************************************************************************************/
+BLE_Remote_Profile::BLE_Remote_Profile(uint16_t connection_id, const esp_bd_addr_t address,
+                                       esp_gatt_if_t gattc_if, uint16_t mtu,
+                                       std::shared_ptr<BLE_GATTC_Interface> gattc,
+                                       std::weak_ptr<BLE_Client> client)
+    : connection_id(connection_id),
+      address({address[0], address[1], address[2], address[3], address[4], address[5]}),
+      gattc_if(gattc_if),
+      client(client),
+      m_gattc(std::move(gattc)),
+      m_mtu(mtu)
+{
+    if ((m_services_semaphore == nullptr) || (m_operations_semaphore == nullptr))
+        throw std::bad_alloc();
+
+    xSemaphoreGive(m_services_semaphore);
+    xSemaphoreGive(m_operations_semaphore);
+}
+
+
+/**
+ * @brief Retrieves a discovered service.
+ * @note This function is thread safe.
+ * @param [in] uuid The UUID of the service of interest.
+ * @return A weak pointer to the first service with the UUID, else a default constructed weak
+ *         pointer (nullptr).
+ */
+std::weak_ptr<BLE_Remote_Service>
+BLE_Remote_Profile::service_get(UUID uuid)
+{
+    AnchorSemaphore anchor(m_services_semaphore);
+    for (const auto& service : m_services)
+    {
+        if (service->uuid == uuid)
+            return service;
+    }
+
+    return {};
+}
+
+
+/**
+ * @brief Retrieves all discovered services.
+ * @note This function is thread safe.
+ * @return The services in handle order.
+ */
+std::vector<std::weak_ptr<BLE_Remote_Service>>
+BLE_Remote_Profile::service_get_all(void)
+{
+    AnchorSemaphore anchor(m_services_semaphore);
+    return std::vector<std::weak_ptr<BLE_Remote_Service>>(m_services.begin(), m_services.end());
+}
+
+
+/**
+ * @brief Retrieves the state of the connection and its discovery.
+ * @return The current state.
+ */
+BLE_Remote_Profile::State
+BLE_Remote_Profile::state_get(void) const
+{
+    return m_state;
+}
+
+
+/**
+ * @brief Retrieves the MTU of the connection.
+ * @return The negotiated MTU, 23 until the exchange completes.
+ */
+uint16_t
+BLE_Remote_Profile::mtu_get(void) const
+{
+    return m_mtu;
+}
+
+
+/**
+ * @brief Retrieves the number of operations queued or in flight on the connection.
+ * @note This function is thread safe.
+ * @return The number of operations which have not completed yet.
+ */
+size_t
+BLE_Remote_Profile::operations_pending(void)
+{
+    AnchorSemaphore anchor(m_operations_semaphore);
+    return m_operations.size() + (m_operation_in_flight ? 1 : 0);
+}
+
+
+/***************************************************************************************************
+* Operation Queue
+***************************************************************************************************/
+bool
+BLE_Remote_Profile::operation_enqueue(operation_t operation)
+{
+    if (m_state == State::DISCONNECTED)
+        return false;
+
+    {
+        AnchorSemaphore anchor(m_operations_semaphore);
+        if (m_operations.size() >= CONFIG_BLE_REDUX_CLIENT_OPERATIONS_MAX)
+        {
+            REMOTE_PROFILE_LOGW("Operation queue full, handle 0x%04X refused", operation.handle);
+            return false;
+        }
+
+        m_operations.push_back(std::move(operation));
+    }
+
+    operation_issue();
+    return true;
+}
+
+
+void
+BLE_Remote_Profile::operation_issue(void)
+{
+    operation_t operation;
+    {
+        AnchorSemaphore anchor(m_operations_semaphore);
+        if (m_operation_in_flight || m_operations.empty() || (m_state != State::READY))
+            return;
+
+        operation = std::move(m_operations.front());
+        m_operations.pop_front();
+
+        // The value stays with the local copy, it is only needed until the stack has taken it.
+        m_operation_in_flight = operation_t{operation.type, operation.handle, {},
+                                            std::move(operation.completion)};
+    }
+
+    // The semaphore is released first, a BLE_GATTC_Interface implementation may complete the call
+    // synchronously.
+    esp_err_t err = ESP_OK;
+    switch (operation.type)
+    {
+        case OP::READ:
+            err = m_gattc->read(gattc_if, connection_id, operation.handle);
+        break;
+        case OP::WRITE:
+            err = m_gattc->write(gattc_if, connection_id, operation.handle, operation.value,
+                                 ESP_GATT_WRITE_TYPE_RSP);
+        break;
+        case OP::WRITE_NO_RESPONSE:
+            err = m_gattc->write(gattc_if, connection_id, operation.handle, operation.value,
+                                 ESP_GATT_WRITE_TYPE_NO_RSP);
+        break;
+        case OP::DESCRIPTOR_WRITE:
+            err = m_gattc->descriptor_write(gattc_if, connection_id, operation.handle,
+                                            operation.value);
+        break;
+    }
+
+    if (err)
+    {
+        // The stack never accepted the operation, so no event will complete it.
+        REMOTE_PROFILE_LOGE("Operation on handle 0x%04X failed: %s (%d)", operation.handle,
+                            esp_err_to_name(err), err);
+        operation_complete(ESP_GATT_ERROR, operation.handle, nullptr, 0);
+    }
+}
+
+
+void
+BLE_Remote_Profile::operation_complete(esp_gatt_status_t status, uint16_t handle,
+                                       const uint8_t* value, size_t length)
+{
+    std::optional<operation_t> operation;
+    {
+        AnchorSemaphore anchor(m_operations_semaphore);
+        operation.swap(m_operation_in_flight);
+    }
+
+    if (!operation)
+    {
+        REMOTE_PROFILE_LOGW("Completion for handle 0x%04X without an operation", handle);
+        return;
+    }
+
+    if (operation->handle != handle)
+        REMOTE_PROFILE_LOGW("Completion for handle 0x%04X, expected 0x%04X", handle,
+                            operation->handle);
+
+    // The next operation is handed to the stack before the application sees this result, so
+    // the link does not idle while the callback runs.
+    operation_issue();
+
+    if (operation->completion)
+        operation->completion(status, value, length);
+}
+
+
+void
+BLE_Remote_Profile::operations_abort(esp_gatt_status_t status)
+{
+    std::deque<operation_t> operations;
+    std::optional<operation_t> operation_in_flight;
+    {
+        AnchorSemaphore anchor(m_operations_semaphore);
+        operations.swap(m_operations);
+        operation_in_flight.swap(m_operation_in_flight);
+    }
+
+    if (operation_in_flight && operation_in_flight->completion)
+        operation_in_flight->completion(status, nullptr, 0);
+
+    for (auto& operation : operations)
+    {
+        if (operation.completion)
+            operation.completion(status, nullptr, 0);
+    }
+}
+
+
+esp_err_t
+BLE_Remote_Profile::notify_register(uint16_t handle, bool enabled)
+{
+    if (enabled)
+        return m_gattc->notify_register(gattc_if, address.data(), handle);
+
+    return m_gattc->notify_unregister(gattc_if, address.data(), handle);
+}
+
+
+/***************************************************************************************************
+* Event Handling
+***************************************************************************************************/
+void
+BLE_Remote_Profile::handle_discovery_start(void)
+{
+    // Also reached when the peripheral indicates a Service Changed, the stack has then refreshed
+    // its cache and the proxies are rebuilt from it.
+    m_state = State::DISCOVERING;
+    m_services_found.clear();
+
+    esp_err_t err = m_gattc->service_search(gattc_if, connection_id);
+    if (err)
+        REMOTE_PROFILE_LOGE("Service search failed: %s (%d)", esp_err_to_name(err), err);
+}
+
+
+void
+BLE_Remote_Profile::handle_service_found(
+    const esp_ble_gattc_cb_param_t::gattc_search_res_evt_param& param)
+{
+    m_services_found.push_back({UUID(param.srvc_id.uuid), param.start_handle, param.end_handle,
+                                param.is_primary});
+}
+
+
+bool
+BLE_Remote_Profile::handle_discovery_complete(
+    const esp_ble_gattc_cb_param_t::gattc_search_cmpl_evt_param& param)
+{
+    if (param.status != ESP_GATT_OK)
+    {
+        REMOTE_PROFILE_LOGE("Service search failed, status: %d", param.status);
+        return false;
+    }
+
+    auto client_instance = client.lock();
+    if (!client_instance)
+        return false;
+
+    auto self_ptr = client_instance->profile_get(connection_id).lock();
+    if (!self_ptr)
+    {
+        REMOTE_PROFILE_LOGE("Client does not acknowledge that this profile exists");
+        return false;
+    }
+
+    std::sort(m_services_found.begin(), m_services_found.end(),
+              [](const service_found_t& lhs, const service_found_t& rhs){
+                  return lhs.start_handle < rhs.start_handle;
+              });
+
+    // The stack has already discovered everything, the characteristics and their configuration
+    // descriptors are read from its cache without further round trips.
+    Service_List services;
+    Characteristic_Map_Handle characteristics;
+    for (const service_found_t& found : m_services_found)
+    {
+        auto service = std::make_shared<BLE_Remote_Service>(found.uuid, found.start_handle,
+                                                            found.end_handle, found.primary,
+                                                            self_ptr);
+
+        for (const esp_gattc_char_elem_t& element :
+             m_gattc->characteristics_get(gattc_if, connection_id, found.start_handle,
+                                          found.end_handle))
+        {
+            uint16_t configuration_handle = 0;
+            if (element.properties & (ESP_GATT_CHAR_PROP_BIT_NOTIFY |
+                                      ESP_GATT_CHAR_PROP_BIT_INDICATE))
+                configuration_handle = m_gattc->descriptor_find(gattc_if, connection_id,
+                                                                element.char_handle,
+                                                                ESP_GATT_UUID_CHAR_CLIENT_CONFIG);
+
+            auto characteristic = std::make_shared<BLE_Remote_Characteristic>(
+                UUID(element.uuid), element.char_handle, element.properties,
+                configuration_handle, service);
+
+            service->m_characteristics.push_back(characteristic);
+            characteristics.insert(std::make_pair(element.char_handle, characteristic));
+        }
+
+        services.push_back(service);
+    }
+
+    {
+        AnchorSemaphore anchor(m_services_semaphore);
+        m_services.swap(services);
+        m_characteristics_handle.swap(characteristics);
+    }
+
+    REMOTE_PROFILE_LOGI("Discovery complete: %d services", m_services_found.size());
+    m_services_found.clear();
+    m_state = State::READY;
+
+    // Operations queued while the database was being rediscovered.
+    operation_issue();
+    return true;
+}
+
+
+void
+BLE_Remote_Profile::handle_notification(
+    const esp_ble_gattc_cb_param_t::gattc_notify_evt_param& param)
+{
+    std::shared_ptr<BLE_Remote_Characteristic> characteristic;
+    {
+        AnchorSemaphore anchor(m_services_semaphore);
+        auto characteristic_entry = m_characteristics_handle.find(param.handle);
+        if (characteristic_entry != m_characteristics_handle.end())
+            characteristic = characteristic_entry->second;
+    }
+
+    if (!characteristic)
+    {
+        REMOTE_PROFILE_LOGW("Notification for unknown handle 0x%04X", param.handle);
+        return;
+    }
+
+    characteristic->handle_notification(param.value, param.value_len);
+}
+
+
+void
+BLE_Remote_Profile::handle_disconnect(void)
+{
+    m_state = State::DISCONNECTED;
+    operations_abort(ESP_GATT_CANCEL);
+}
+
+
+void
+BLE_Remote_Profile::profile_event_handler_gattc(esp_gattc_cb_event_t event,
+                                                esp_gatt_if_t gattc_if,
+                                                esp_ble_gattc_cb_param_t *param)
+{
+    switch (event)
+    {
+        case ESP_GATTC_CFG_MTU_EVT:
+            if (param->cfg_mtu.status == ESP_GATT_OK)
+                m_mtu = param->cfg_mtu.mtu;
+
+            REMOTE_PROFILE_LOGI("MTU exchange status: %d, MTU: %d", param->cfg_mtu.status,
+                                param->cfg_mtu.mtu);
+        break;
+        case ESP_GATTC_DIS_SRVC_CMPL_EVT:
+            if (param->dis_srvc_cmpl.status != ESP_GATT_OK)
+                REMOTE_PROFILE_LOGE("Discovery failed, status: %d", param->dis_srvc_cmpl.status);
+            else
+                handle_discovery_start();
+        break;
+        case ESP_GATTC_SEARCH_RES_EVT:
+            handle_service_found(param->search_res);
+        break;
+        case ESP_GATTC_READ_CHAR_EVT:
+            operation_complete(param->read.status, param->read.handle, param->read.value,
+                               param->read.value_len);
+        break;
+        case ESP_GATTC_WRITE_CHAR_EVT:
+        case ESP_GATTC_WRITE_DESCR_EVT:
+            operation_complete(param->write.status, param->write.handle, nullptr, 0);
+        break;
+        case ESP_GATTC_NOTIFY_EVT:
+            handle_notification(param->notify);
+        break;
+        default:
+        break;
+    }
+}
+
+};
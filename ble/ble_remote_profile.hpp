@@ -0,0 +1,182 @@
+/**
+ * @file   ble_remote_profile.hpp
+ *
+ * @brief  ESP32 Bluetooth Low Energy remote profile proxy.
+ * @detail This class represents the GATT database of a peripheral the client is connected to,
+ *         along with the connection itself. Operations on its characteristics are queued per
+ *         connection; ATT allows a single outstanding request per bearer, so the next operation
+ *         is issued from the completion event of the previous one instead of waiting for the
+ *         application to react.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_REMOTE_PROFILE_HPP
+#define COMPONENTS_BLE_BLE_REMOTE_PROFILE_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "esp_gattc_api.h"
+#include "esp_gatt_defs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+
+#include "ble_gattc.hpp"
+#include "ble_remote_service.hpp"
+#include "types.hpp"
+
+#ifndef CONFIG_BLE_REDUX_CLIENT_OPERATIONS_MAX
+#define CONFIG_BLE_REDUX_CLIENT_OPERATIONS_MAX 32
+#endif
+
+namespace BLE
+{
+
+class BLE_Client;
+
+
+class BLE_Remote_Profile
+{
+public:
+    enum class State : uint8_t
+    {
+        DISCOVERING,
+        READY,
+        DISCONNECTED,
+    };
+
+    using Address = std::array<uint8_t, ESP_BD_ADDR_LEN>;
+
+
+    BLE_Remote_Profile(uint16_t connection_id, const esp_bd_addr_t address,
+                       esp_gatt_if_t gattc_if, uint16_t mtu,
+                       std::shared_ptr<BLE_GATTC_Interface> gattc,
+                       std::weak_ptr<BLE_Client> client);
+
+    /**
+     * @brief Retrieves a discovered service.
+     * @note This function is thread safe.
+     * @param [in] uuid The UUID of the service of interest.
+     * @return A weak pointer to the first service with the UUID, else a default constructed weak
+     *         pointer (nullptr).
+     */
+    std::weak_ptr<BLE_Remote_Service> service_get(UUID uuid);
+
+    /**
+     * @brief Retrieves all discovered services.
+     * @note This function is thread safe.
+     * @return The services in handle order.
+     */
+    std::vector<std::weak_ptr<BLE_Remote_Service>> service_get_all(void);
+
+    /**
+     * @brief Retrieves the state of the connection and its discovery.
+     * @return The current state.
+     */
+    State state_get(void) const;
+
+    /**
+     * @brief Retrieves the MTU of the connection.
+     * @return The negotiated MTU, 23 until the exchange completes.
+     */
+    uint16_t mtu_get(void) const;
+
+    /**
+     * @brief Retrieves the number of operations queued or in flight on the connection.
+     * @note This function is thread safe.
+     * @return The number of operations which have not completed yet.
+     */
+    size_t operations_pending(void);
+
+
+    const uint16_t                          connection_id;
+    const Address                           address;
+    const esp_gatt_if_t                     gattc_if;
+    const std::weak_ptr<BLE_Client>         client;
+
+private:
+    friend class BLE_Client;
+    friend class BLE_Remote_Characteristic;
+
+    enum class OP : uint8_t
+    {
+        READ,
+        WRITE,
+        WRITE_NO_RESPONSE,
+        DESCRIPTOR_WRITE,
+    };
+
+    using Completion = std::function<void(esp_gatt_status_t, const uint8_t*, size_t)>;
+
+    struct operation_t
+    {
+        OP                      type;
+        uint16_t                handle;
+        std::vector<uint8_t>    value;
+        Completion              completion;
+    };
+
+    struct service_found_t
+    {
+        UUID        uuid;
+        uint16_t    start_handle;
+        uint16_t    end_handle;
+        bool        primary;
+    };
+
+    using Service_List = std::vector<std::shared_ptr<BLE_Remote_Service>>;
+    using Characteristic_Map_Handle = std::unordered_map<uint16_t,
+                                                         std::shared_ptr<BLE_Remote_Characteristic>>;
+
+
+    bool operation_enqueue(operation_t operation);
+    void operation_issue(void);
+    void operation_complete(esp_gatt_status_t status, uint16_t handle, const uint8_t* value,
+                            size_t length);
+    void operations_abort(esp_gatt_status_t status);
+    esp_err_t notify_register(uint16_t handle, bool enabled);
+
+    void handle_discovery_start(void);
+    void handle_service_found(const esp_ble_gattc_cb_param_t::gattc_search_res_evt_param& param);
+    bool handle_discovery_complete(
+        const esp_ble_gattc_cb_param_t::gattc_search_cmpl_evt_param& param);
+    void handle_notification(const esp_ble_gattc_cb_param_t::gattc_notify_evt_param& param);
+    void handle_disconnect(void);
+
+    void profile_event_handler_gattc(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if,
+                                     esp_ble_gattc_cb_param_t *param);
+
+
+    std::shared_ptr<BLE_GATTC_Interface>    m_gattc;
+    std::atomic<State>                      m_state{State::DISCOVERING};
+    std::atomic<uint16_t>                   m_mtu;
+
+    // Written by the GATTC event handler only, published by swapping them in under the semaphore.
+    std::vector<service_found_t>            m_services_found;
+    Service_List                            m_services;
+    Characteristic_Map_Handle               m_characteristics_handle;
+    SemaphoreHandle_t                       m_services_semaphore = xSemaphoreCreateBinary();
+
+    // The operation in flight has been taken off the queue, only its completion is kept.
+    std::deque<operation_t>                 m_operations;
+    std::optional<operation_t>              m_operation_in_flight;
+    SemaphoreHandle_t                       m_operations_semaphore = xSemaphoreCreateBinary();
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_REMOTE_PROFILE_HPP
@@ -0,0 +1,55 @@
+/**
+ * @file   ble_remote_service.cpp
+ *
+ * @brief  ESP32 Bluetooth Low Energy remote service proxy.
+ * @detail This class represents a service discovered on a peripheral the client is connected to.
+ *         Its characteristics are populated once during discovery and never change afterwards,
+ *         a rediscovery replaces the service as a whole.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <memory>
+#include <vector>
+
+#include "ble_remote_service.hpp"
+#include "types.hpp"
+
+namespace BLE
+{
+
+/**
+ * @brief Retrieves a characteristic of this service.
+ * @param [in] uuid The UUID of the characteristic of interest.
+ * @return A weak pointer to the first characteristic with the UUID, else a default constructed
+ *         weak pointer (nullptr).
+ */
+std::weak_ptr<BLE_Remote_Characteristic>
+BLE_Remote_Service::characteristic_get(UUID uuid)
+{
+    for (const auto& characteristic : m_characteristics)
+    {
+        if (characteristic->uuid == uuid)
+            return characteristic;
+    }
+
+    return {};
+}
+
+
+/**
+ * @brief Retrieves all characteristics of this service.
+ * @return The characteristics in handle order.
+ */
+std::vector<std::weak_ptr<BLE_Remote_Characteristic>>
+BLE_Remote_Service::characteristic_get_all(void)
+{
+    return std::vector<std::weak_ptr<BLE_Remote_Characteristic>>(m_characteristics.begin(),
+                                                                 m_characteristics.end());
+}
+
+};
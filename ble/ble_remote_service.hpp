@@ -0,0 +1,72 @@
+/**
+ * @file   ble_remote_service.hpp
+ *
+ * @brief  ESP32 Bluetooth Low Energy remote service proxy.
+ * @detail This class represents a service discovered on a peripheral the client is connected to.
+ *         Its characteristics are populated once during discovery and never change afterwards,
+ *         a rediscovery replaces the service as a whole.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_REMOTE_SERVICE_HPP
+#define COMPONENTS_BLE_BLE_REMOTE_SERVICE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "ble_remote_characteristic.hpp"
+#include "types.hpp"
+
+namespace BLE
+{
+
+class BLE_Remote_Profile;
+
+
+class BLE_Remote_Service
+{
+public:
+    BLE_Remote_Service(UUID uuid, uint16_t start_handle, uint16_t end_handle, bool primary,
+                       std::weak_ptr<BLE_Remote_Profile> profile)
+        : uuid(uuid),
+          start_handle(start_handle),
+          end_handle(end_handle),
+          primary(primary),
+          profile(profile) {}
+
+    /**
+     * @brief Retrieves a characteristic of this service.
+     * @param [in] uuid The UUID of the characteristic of interest.
+     * @return A weak pointer to the first characteristic with the UUID, else a default
+     *         constructed weak pointer (nullptr).
+     */
+    std::weak_ptr<BLE_Remote_Characteristic> characteristic_get(UUID uuid);
+
+    /**
+     * @brief Retrieves all characteristics of this service.
+     * @return The characteristics in handle order.
+     */
+    std::vector<std::weak_ptr<BLE_Remote_Characteristic>> characteristic_get_all(void);
+
+
+    const UUID                                  uuid;
+    const uint16_t                              start_handle;
+    const uint16_t                              end_handle;
+    const bool                                  primary;
+    const std::weak_ptr<BLE_Remote_Profile>     profile;
+
+private:
+    friend class BLE_Remote_Profile;
+
+    std::vector<std::shared_ptr<BLE_Remote_Characteristic>>     m_characteristics;
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_REMOTE_SERVICE_HPP
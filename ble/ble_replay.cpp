@@ -0,0 +1,568 @@
+/**
+ * @file   ble_replay.cpp
+ *
+ * @brief  Capture and replay of the GATTS and GAP event streams.
+ * @detail While capturing, every event entering BLE_Server::event_handler_gatts and
+ *         BLE_Server::event_handler_gap is copied with its arrival time into a lock-free buffer and
+ *         written to a compact binary file by a low priority task. A capture can later be fed back
+ *         through the server of another build, at the recorded pace or accelerated, to compare the
+ *         dispatch latency and the memory use of both builds on the same traffic. Capturing is
+ *         enabled through CONFIG_BLE_REDUX_REPLAY, when disabled the capture hooks compile to
+ *         nothing. Replaying is always available.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <optional>
+
+#include "esp_gap_ble_api.h"
+#include "esp_gatts_api.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+
+#include "ble_allocation.hpp"
+#include "ble_profile.hpp"
+#include "ble_queue.hpp"
+#include "ble_replay.hpp"
+#include "ble_server.hpp"
+#include "ble_utilities.hpp"
+
+namespace BLE
+{
+
+constexpr const char* LOG_TAG_BLE_REPLAY = "BLE Replay";
+constexpr const char REPLAY_MAGIC[8] = {'B', 'L', 'E', 'C', 'A', 'P', 'T', 'R'};
+
+struct replay_file_header_t
+{
+    char        magic[8];
+    uint16_t    version;
+    uint16_t    gatts_param_length;
+    uint16_t    gap_param_length;
+    uint16_t    reserved;
+};
+
+static_assert(sizeof(replay_file_header_t) == 16, "The file header is part of the file format");
+static_assert(CONFIG_BLE_REDUX_REPLAY_VALUE_MAX <= ATT_ATTRIBUTE_LENGTH_MAX,
+              "Captured values are attribute values");
+
+
+/**
+ * @brief Locates the value pointer of the events that carry one.
+ * @param [in] capture The event of interest.
+ * @param [out] length The length of the value the pointer refers to.
+ * @return The address of the pointer within the parameters, nullptr if the event has no value.
+ */
+static uint8_t**
+replay_value_field(BLE_Replay::capture_t& capture, uint16_t& length)
+{
+    if (capture.source != BLE_Replay::Source::GATTS)
+        return nullptr;
+
+    switch (capture.event)
+    {
+        case ESP_GATTS_WRITE_EVT:
+            length = capture.param.gatts.write.len;
+            return &capture.param.gatts.write.value;
+        case ESP_GATTS_CONF_EVT:
+            length = capture.param.gatts.conf.len;
+            return &capture.param.gatts.conf.value;
+        default:
+            return nullptr;
+    }
+}
+
+
+/**
+ * @brief Decides whether an event is replayed.
+ * @detail Only traffic from peers is replayed. Events that build the database or complete stack
+ *         operations would corrupt the state of the live server or restart advertising and
+ *         scanning.
+ */
+static bool
+replay_event_replayable(BLE_Replay::Source source, uint8_t event)
+{
+    if (source == BLE_Replay::Source::GAP)
+    {
+        return (event == ESP_GAP_BLE_SCAN_RESULT_EVT) ||
+               (event == ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT) ||
+               (event == ESP_GAP_BLE_AUTH_CMPL_EVT);
+    }
+
+    switch (event)
+    {
+        case ESP_GATTS_READ_EVT:
+        case ESP_GATTS_WRITE_EVT:
+        case ESP_GATTS_EXEC_WRITE_EVT:
+        case ESP_GATTS_MTU_EVT:
+        case ESP_GATTS_CONF_EVT:
+        case ESP_GATTS_CONNECT_EVT:
+        case ESP_GATTS_DISCONNECT_EVT:
+        case ESP_GATTS_CONGEST_EVT:
+            return true;
+        default:
+            return false;
+    }
+}
+
+
+static size_t
+replay_param_length(BLE_Replay::Source source)
+{
+    return (source == BLE_Replay::Source::GATTS) ? sizeof(esp_ble_gatts_cb_param_t)
+                                                 : sizeof(esp_ble_gap_cb_param_t);
+}
+
+
+/***************************************************************************************************
+* Capture
+***************************************************************************************************/
+#ifdef CONFIG_BLE_REDUX_REPLAY
+constexpr const uint16_t REPLAY_TRACE_ID = 0x5201;
+constexpr const uint32_t REPLAY_TASK_STACK = 3072;
+constexpr const TickType_t REPLAY_POLL_INTERVAL = pdMS_TO_TICKS(20);
+
+static BLE_Queue<BLE_Replay::capture_t, CONFIG_BLE_REDUX_REPLAY_RECORDS>
+                                        capture_queue(REPLAY_TRACE_ID);
+static std::atomic<bool>                capture_active(false);
+static std::atomic<bool>                capture_running(false);
+static std::atomic<bool>                capture_scan_results(false);
+static FILE*                            capture_out = nullptr;
+static int64_t                          capture_previous_us = 0;
+static SemaphoreHandle_t                capture_stopped = nullptr;
+
+static std::atomic<uint32_t>            capture_captured(0);
+static std::atomic<uint32_t>            capture_dropped(0);
+static std::atomic<uint32_t>            capture_truncated(0);
+static std::atomic<uint64_t>            capture_bytes(0);
+
+
+static void
+capture_push(BLE_Replay::capture_t& capture)
+{
+    uint16_t length = 0;
+    uint8_t** value = replay_value_field(capture, length);
+    if (value)
+    {
+        if (*value && length)
+        {
+            capture.value_length = std::min<size_t>(length, capture.value.size());
+            memcpy(capture.value.data(), *value, capture.value_length);
+            if (capture.value_length < length)
+            {
+                capture.flags |= BLE_Replay::RECORD_FLAG_TRUNCATED;
+                capture_truncated.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        // Addresses mean nothing outside of this run and would defeat the trimming of the
+        // parameters.
+        *value = nullptr;
+    }
+
+    capture_captured.fetch_add(1, std::memory_order_relaxed);
+    if (!capture_queue.push(capture))
+        capture_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+#endif
+
+
+/**
+ * @brief Copies a GATTS event into the capture buffer.
+ * @note This function is lock-free and never blocks the dispatch path.
+ * @warning Use the BLE_REPLAY_CAPTURE macros instead so that the call is compiled out when
+ *          capturing is disabled.
+ */
+void
+BLE_Replay::capture_gatts(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
+                          const esp_ble_gatts_cb_param_t* param)
+{
+#ifdef CONFIG_BLE_REDUX_REPLAY
+    if (!capture_active.load(std::memory_order_relaxed) || !param)
+        return;
+
+    // Zeroed so that the unused tail of the parameters can be trimmed from the file.
+    capture_t capture = {};
+    capture.timestamp_us = esp_timer_get_time();
+    capture.source = Source::GATTS;
+    capture.event = event;
+    capture.gatts_if = gatts_if;
+    memcpy(&capture.param.gatts, param, sizeof(*param));
+    capture_push(capture);
+#endif
+}
+
+
+/**
+ * @brief Copies a GAP event into the capture buffer.
+ * @note This function is lock-free and never blocks the dispatch path.
+ * @warning Use the BLE_REPLAY_CAPTURE macros instead so that the call is compiled out when
+ *          capturing is disabled.
+ */
+void
+BLE_Replay::capture_gap(esp_gap_ble_cb_event_t event, const esp_ble_gap_cb_param_t* param)
+{
+#ifdef CONFIG_BLE_REDUX_REPLAY
+    if (!capture_active.load(std::memory_order_relaxed) || !param)
+        return;
+
+    if ((event == ESP_GAP_BLE_SCAN_RESULT_EVT) &&
+        !capture_scan_results.load(std::memory_order_relaxed))
+        return;
+
+    capture_t capture = {};
+    capture.timestamp_us = esp_timer_get_time();
+    capture.source = Source::GAP;
+    capture.event = event;
+    capture.gatts_if = ESP_GATT_IF_NONE;
+    memcpy(&capture.param.gap, param, sizeof(*param));
+    capture_push(capture);
+#endif
+}
+
+
+/**
+ * @brief Starts capturing the events entering the server.
+ * @note Requires CONFIG_BLE_REDUX_REPLAY. Start capturing before the profiles are added so that
+ *       their registration, which replays map interfaces through, is part of the capture.
+ * @param [in] out The stream to write to, it must stay open until capture_stop returns.
+ * @param [in] scan_results (default=false) Also captures advertisement reports, which are usually
+ *                          the bulk of the GAP events.
+ * @param [in] priority (default=1) The FreeRTOS priority of the writer task.
+ * @return True if capturing started, false if it is disabled or already running.
+ */
+bool
+BLE_Replay::capture_start(FILE* out, bool scan_results, uint32_t priority)
+{
+#ifdef CONFIG_BLE_REDUX_REPLAY
+    if (!out || capture_running)
+        return false;
+
+    replay_file_header_t header = {};
+    memcpy(header.magic, REPLAY_MAGIC, sizeof(header.magic));
+    header.version = FORMAT_VERSION;
+    header.gatts_param_length = sizeof(esp_ble_gatts_cb_param_t);
+    header.gap_param_length = sizeof(esp_ble_gap_cb_param_t);
+    if (fwrite(&header, sizeof(header), 1, out) != 1)
+        return false;
+
+    capture_stopped = xSemaphoreCreateBinary();
+    if (!capture_stopped)
+        return false;
+
+    // Events pushed by hooks that raced the end of the previous capture.
+    capture_t stale;
+    while (capture_queue.pop(stale)) {}
+
+    capture_out = out;
+    capture_previous_us = esp_timer_get_time();
+    capture_scan_results = scan_results;
+    capture_running = true;
+    if (xTaskCreate(&BLE_Replay::capture_task, "ble_replay", REPLAY_TASK_STACK, nullptr, priority,
+                    nullptr) != pdPASS)
+    {
+        ESP_LOGE(LOG_TAG_BLE_REPLAY, "Could not start the capture task");
+        capture_running = false;
+        vSemaphoreDelete(capture_stopped);
+        capture_stopped = nullptr;
+        return false;
+    }
+
+    capture_active = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+
+/**
+ * @brief Stops capturing, writes the buffered events and flushes the stream.
+ */
+void
+BLE_Replay::capture_stop(void)
+{
+#ifdef CONFIG_BLE_REDUX_REPLAY
+    if (!capture_active.exchange(false))
+        return;
+
+    capture_running = false;
+    xSemaphoreTake(capture_stopped, portMAX_DELAY);
+    vSemaphoreDelete(capture_stopped);
+    capture_stopped = nullptr;
+
+    fflush(capture_out);
+    capture_out = nullptr;
+#endif
+}
+
+
+/**
+ * @brief Retrieves the capture counters.
+ * @param [in] reset (default=false) Zeroes the counters after reading them.
+ * @return A copy of the counters.
+ */
+BLE_Replay::counters_t
+BLE_Replay::counters_get(bool reset)
+{
+    counters_t counters = {};
+#ifdef CONFIG_BLE_REDUX_REPLAY
+    auto read = [reset](auto& counter){
+        return reset ? counter.exchange(0, std::memory_order_relaxed)
+                     : counter.load(std::memory_order_relaxed);
+    };
+
+    counters.captured = read(capture_captured);
+    counters.dropped = read(capture_dropped);
+    counters.truncated = read(capture_truncated);
+    counters.bytes = read(capture_bytes);
+#endif
+    return counters;
+}
+
+
+void
+BLE_Replay::capture_task(void* parameters)
+{
+#ifdef CONFIG_BLE_REDUX_REPLAY
+    capture_t capture;
+    for (;;)
+    {
+        // Read before draining so that the events pushed before the stop are all written.
+        bool running = capture_running.load();
+        while (capture_queue.pop(capture))
+        {
+            if (!capture_write(capture))
+                ESP_LOGW(LOG_TAG_BLE_REPLAY, "Capture write failed");
+        }
+
+        if (!running)
+            break;
+
+        vTaskDelay(REPLAY_POLL_INTERVAL);
+    }
+
+    xSemaphoreGive(capture_stopped);
+#endif
+    vTaskDelete(nullptr);
+}
+
+
+bool
+BLE_Replay::capture_write(const capture_t& capture)
+{
+#ifdef CONFIG_BLE_REDUX_REPLAY
+    record_header_t header;
+    int64_t delta_us = capture.timestamp_us - capture_previous_us;
+    header.delta_us = std::clamp<int64_t>(delta_us, 0, UINT32_MAX);
+    header.source = capture.source;
+    header.event = capture.event;
+    header.gatts_if = capture.gatts_if;
+    header.flags = capture.flags;
+    header.value_length = capture.value_length;
+    capture_previous_us = capture.timestamp_us;
+
+    // Most events only use a few bytes of the parameter union.
+    auto param = reinterpret_cast<const uint8_t*>(&capture.param);
+    size_t length = replay_param_length(capture.source);
+    while (length && !param[length - 1])
+        length--;
+
+    header.param_length = length;
+    bool written = (fwrite(&header, sizeof(header), 1, capture_out) == 1) &&
+                   (fwrite(param, 1, length, capture_out) == length) &&
+                   (fwrite(capture.value.data(), 1, capture.value_length, capture_out) ==
+                    capture.value_length);
+
+    capture_bytes.fetch_add(sizeof(header) + length + capture.value_length,
+                            std::memory_order_relaxed);
+    return written;
+#else
+    return false;
+#endif
+}
+
+
+/***************************************************************************************************
+* Replay
+***************************************************************************************************/
+/**
+ * @brief Feeds a capture through a server and measures it.
+ * @detail Connection and attribute traffic is replayed, interfaces are mapped through the profile
+ *         IDs of the captured registrations so the server must host the same profiles as the
+ *         captured one. Events that build the database or complete stack operations are skipped.
+ * @note Run with no peer connected, responses to replayed requests are sent to connections the
+ *       stack does not know about and fail.
+ * @param [in] server The server to feed.
+ * @param [in] in The capture to replay.
+ * @param [in] speed (default=1.0) The pace relative to the recording, 0 replays as fast as
+ *                   possible.
+ * @return The measurements, std::nullopt if the capture could not be read or was taken with an
+ *         incompatible version of ESP-IDF.
+ */
+std::optional<BLE_Replay::report_t>
+BLE_Replay::play(std::shared_ptr<BLE_Server> server, FILE* in, float speed)
+{
+    if (!server || !in || (speed < 0))
+        return std::nullopt;
+
+    replay_file_header_t header;
+    if ((fread(&header, sizeof(header), 1, in) != 1) ||
+        memcmp(header.magic, REPLAY_MAGIC, sizeof(header.magic)))
+    {
+        ESP_LOGE(LOG_TAG_BLE_REPLAY, "Not a capture");
+        return std::nullopt;
+    }
+
+    // The parameters are stored as the stack lays them out.
+    if ((header.version != FORMAT_VERSION) ||
+        (header.gatts_param_length != sizeof(esp_ble_gatts_cb_param_t)) ||
+        (header.gap_param_length != sizeof(esp_ble_gap_cb_param_t)))
+    {
+        ESP_LOGE(LOG_TAG_BLE_REPLAY, "The capture was taken with an incompatible build");
+        return std::nullopt;
+    }
+
+    // Everything the replay needs is allocated up front so that only the server's own
+    // allocations are counted.
+    struct state_t
+    {
+        capture_t                                       capture;
+        std::array<uint8_t, ATT_ATTRIBUTE_LENGTH_MAX>   value;
+        // The profile IDs of the captured interfaces, indexed by interface.
+        std::array<int32_t, UINT8_MAX + 1>              profile_ids;
+        BLE_Latency_Histogram                           latency;
+    };
+
+    auto state = std::make_unique<state_t>();
+    state->profile_ids.fill(-1);
+
+    report_t report = {};
+    uint32_t heap_start = esp_get_free_heap_size();
+    uint32_t allocations_start = BLE_Allocation_Audit::allocations_total();
+    report.heap_free_min = heap_start;
+
+    int64_t start_us = esp_timer_get_time();
+    int64_t recorded_us = 0;
+    record_header_t record;
+    while (fread(&record, sizeof(record), 1, in) == 1)
+    {
+        capture_t& capture = state->capture;
+        if ((record.param_length > replay_param_length(record.source)) ||
+            (record.value_length > state->value.size()))
+        {
+            ESP_LOGE(LOG_TAG_BLE_REPLAY, "Corrupt capture record");
+            return std::nullopt;
+        }
+
+        memset(&capture.param, 0, sizeof(capture.param));
+        if ((fread(&capture.param, 1, record.param_length, in) != record.param_length) ||
+            (fread(state->value.data(), 1, record.value_length, in) != record.value_length))
+            break;
+
+        capture.source = record.source;
+        capture.event = record.event;
+        recorded_us += record.delta_us;
+
+        if ((record.source == Source::GATTS) && (record.event == ESP_GATTS_REG_EVT))
+            state->profile_ids[record.gatts_if] = capture.param.gatts.reg.app_id;
+
+        if (!replay_event_replayable(record.source, record.event))
+        {
+            report.skipped++;
+            continue;
+        }
+
+        esp_gatt_if_t gatts_if = ESP_GATT_IF_NONE;
+        if ((record.source == Source::GATTS) && (record.gatts_if != ESP_GATT_IF_NONE))
+        {
+            int32_t profile_id = state->profile_ids[record.gatts_if];
+            auto profile = (profile_id < 0) ? server->m_profiles.end()
+                                            : server->m_profiles.find(profile_id);
+            if (profile == server->m_profiles.end())
+            {
+                report.skipped++;
+                continue;
+            }
+
+            gatts_if = profile->second->gatts_if;
+        }
+
+        uint16_t length = 0;
+        uint8_t** value = replay_value_field(capture, length);
+        if (value)
+            *value = record.value_length ? state->value.data() : nullptr;
+
+        if (speed > 0)
+        {
+            int64_t wait_us = start_us + static_cast<int64_t>(recorded_us / speed) -
+                              esp_timer_get_time();
+            if (wait_us >= (portTICK_PERIOD_MS * 1000))
+                vTaskDelay(wait_us / (portTICK_PERIOD_MS * 1000));
+        }
+
+        int64_t dispatch_us = esp_timer_get_time();
+        if (record.source == Source::GATTS)
+        {
+            server->event_handler_gatts(static_cast<esp_gatts_cb_event_t>(record.event), gatts_if,
+                                        &capture.param.gatts);
+        }
+        else
+        {
+            server->event_handler_gap(static_cast<esp_gap_ble_cb_event_t>(record.event),
+                                      &capture.param.gap);
+        }
+
+        state->latency.record(esp_timer_get_time() - dispatch_us);
+        report.heap_free_min = std::min(report.heap_free_min, esp_get_free_heap_size());
+        report.events++;
+    }
+
+    report.duration_us = esp_timer_get_time() - start_us;
+    report.latency = state->latency.snapshot();
+    report.allocations = BLE_Allocation_Audit::allocations_total() - allocations_start;
+    report.heap_delta = static_cast<int32_t>(heap_start - esp_get_free_heap_size());
+    return report;
+}
+
+
+/**
+ * @brief Writes a replay report as JSON, in a fixed key order so reports can be diffed.
+ * @param [in] report The report to be written.
+ * @param [in] out (default=stdout) The stream to write to.
+ */
+void
+BLE_Replay::report_json(const report_t& report, FILE* out)
+{
+    fprintf(out, "{\"format\":\"esp32-ble-redux-replay\",\"version\":%" PRIu16 ",\"events\":%"
+                 PRIu32 ",\"skipped\":%" PRIu32 ",\"duration_us\":%" PRId64,
+            FORMAT_VERSION, report.events, report.skipped, report.duration_us);
+    fprintf(out, ",\"latency_us\":{\"p50\":%" PRIu32 ",\"p90\":%" PRIu32 ",\"p99\":%" PRIu32
+                 ",\"max\":%" PRIu32 "}",
+            report.latency.percentile(50), report.latency.percentile(90),
+            report.latency.percentile(99), report.latency.max_us);
+#ifdef CONFIG_BLE_REDUX_ALLOCATION_AUDIT
+    fprintf(out, ",\"allocations\":%" PRIu32, report.allocations);
+#endif
+    fprintf(out, ",\"heap_delta\":%" PRId32 ",\"heap_free_min\":%" PRIu32 "}\n",
+            report.heap_delta, report.heap_free_min);
+    fflush(out);
+}
+
+};
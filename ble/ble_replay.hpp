@@ -0,0 +1,208 @@
+/**
+ * @file   ble_replay.hpp
+ *
+ * @brief  Capture and replay of the GATTS and GAP event streams.
+ * @detail While capturing, every event entering BLE_Server::event_handler_gatts and
+ *         BLE_Server::event_handler_gap is copied with its arrival time into a lock-free buffer and
+ *         written to a compact binary file by a low priority task. A capture can later be fed back
+ *         through the server of another build, at the recorded pace or accelerated, to compare the
+ *         dispatch latency and the memory use of both builds on the same traffic. Capturing is
+ *         enabled through CONFIG_BLE_REDUX_REPLAY, when disabled the capture hooks compile to
+ *         nothing. Replaying is always available.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_REPLAY_HPP
+#define COMPONENTS_BLE_BLE_REPLAY_HPP
+
+#include <array>
+#include <cstdint>
+#include <cstdio>
+#include <memory>
+#include <optional>
+
+#include "esp_gap_ble_api.h"
+#include "esp_gatts_api.h"
+#include "sdkconfig.h"
+
+#include "ble_histogram.hpp"
+
+#ifndef CONFIG_BLE_REDUX_REPLAY_RECORDS
+#define CONFIG_BLE_REDUX_REPLAY_RECORDS 32
+#endif
+
+#ifndef CONFIG_BLE_REDUX_REPLAY_VALUE_MAX
+#define CONFIG_BLE_REDUX_REPLAY_VALUE_MAX 256
+#endif
+
+namespace BLE
+{
+
+class BLE_Server;
+
+
+class BLE_Replay
+{
+public:
+    static constexpr const uint16_t FORMAT_VERSION = 1;
+
+    enum class Source : uint8_t
+    {
+        GATTS,
+        GAP,
+    };
+
+    // The file starts with a 16 byte header ("BLECAPTR", u16 version, u16 size of the GATTS
+    // parameters, u16 size of the GAP parameters, u16 reserved) followed by the records in little
+    // endian order. Each record is this header, its parameters with the trailing zero bytes cut
+    // and the value a WRITE or CONF event points to.
+    struct record_header_t
+    {
+        // Microseconds since the previous record, saturated.
+        uint32_t    delta_us;
+        Source      source;
+        uint8_t     event;
+        uint8_t     gatts_if;
+        uint8_t     flags;
+        uint16_t    param_length;
+        uint16_t    value_length;
+    };
+
+    static_assert(sizeof(record_header_t) == 12, "Record headers are part of the file format");
+
+    // The value of the event was cut at CONFIG_BLE_REDUX_REPLAY_VALUE_MAX.
+    static constexpr const uint8_t RECORD_FLAG_TRUNCATED = 0x01;
+
+    struct counters_t
+    {
+        uint32_t    captured;
+        // Events lost because the writer did not keep up and the buffer was full.
+        uint32_t    dropped;
+        uint32_t    truncated;
+        uint64_t    bytes;
+    };
+
+    struct report_t
+    {
+        uint32_t                            events;
+        // Database construction and stack completion events, which are not replayed.
+        uint32_t                            skipped;
+        int64_t                             duration_us;
+        BLE_Latency_Histogram::snapshot_t   latency;
+        // Only counted when CONFIG_BLE_REDUX_ALLOCATION_AUDIT is enabled.
+        uint32_t                            allocations;
+        int32_t                             heap_delta;
+        uint32_t                            heap_free_min;
+    };
+
+
+    /**
+     * @brief Starts capturing the events entering the server.
+     * @note Requires CONFIG_BLE_REDUX_REPLAY. Start capturing before the profiles are added so that
+     *       their registration, which replays map interfaces through, is part of the capture.
+     * @param [in] out The stream to write to, it must stay open until capture_stop returns.
+     * @param [in] scan_results (default=false) Also captures advertisement reports, which are
+     *                          usually the bulk of the GAP events.
+     * @param [in] priority (default=1) The FreeRTOS priority of the writer task.
+     * @return True if capturing started, false if it is disabled or already running.
+     */
+    static bool capture_start(FILE* out, bool scan_results=false, uint32_t priority=1);
+
+    /**
+     * @brief Stops capturing, writes the buffered events and flushes the stream.
+     */
+    static void capture_stop(void);
+
+    /**
+     * @brief Retrieves the capture counters.
+     * @param [in] reset (default=false) Zeroes the counters after reading them.
+     * @return A copy of the counters.
+     */
+    static counters_t counters_get(bool reset=false);
+
+    /**
+     * @brief Feeds a capture through a server and measures it.
+     * @detail Connection and attribute traffic is replayed, interfaces are mapped through the
+     *         profile IDs of the captured registrations so the server must host the same profiles
+     *         as the captured one. Events that build the database or complete stack operations are
+     *         skipped.
+     * @note Run with no peer connected, responses to replayed requests are sent to connections the
+     *       stack does not know about and fail.
+     * @param [in] server The server to feed.
+     * @param [in] in The capture to replay.
+     * @param [in] speed (default=1.0) The pace relative to the recording, 0 replays as fast as
+     *                   possible.
+     * @return The measurements, std::nullopt if the capture could not be read or was taken with
+     *         an incompatible version of ESP-IDF.
+     */
+    static std::optional<report_t> play(std::shared_ptr<BLE_Server> server, FILE* in,
+                                        float speed=1.0f);
+
+    /**
+     * @brief Writes a replay report as JSON, in a fixed key order so reports can be diffed.
+     * @param [in] report The report to be written.
+     * @param [in] out (default=stdout) The stream to write to.
+     */
+    static void report_json(const report_t& report, FILE* out=stdout);
+
+    /**
+     * @brief Copies a GATTS event into the capture buffer.
+     * @note This function is lock-free and never blocks the dispatch path.
+     * @warning Use the BLE_REPLAY_CAPTURE macros instead so that the call is compiled out when
+     *          capturing is disabled.
+     */
+    static void capture_gatts(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
+                              const esp_ble_gatts_cb_param_t* param);
+
+    /**
+     * @brief Copies a GAP event into the capture buffer.
+     * @note This function is lock-free and never blocks the dispatch path.
+     * @warning Use the BLE_REPLAY_CAPTURE macros instead so that the call is compiled out when
+     *          capturing is disabled.
+     */
+    static void capture_gap(esp_gap_ble_cb_event_t event, const esp_ble_gap_cb_param_t* param);
+
+    // A captured event, as buffered between the hooks and the writer task.
+    struct capture_t
+    {
+        int64_t                                                 timestamp_us;
+        Source                                                  source;
+        uint8_t                                                 event;
+        uint8_t                                                 gatts_if;
+        uint8_t                                                 flags;
+        uint16_t                                                value_length;
+        union
+        {
+            esp_ble_gatts_cb_param_t                            gatts;
+            esp_ble_gap_cb_param_t                              gap;
+        }                                                       param;
+        std::array<uint8_t, CONFIG_BLE_REDUX_REPLAY_VALUE_MAX>  value;
+    };
+
+private:
+    static void capture_task(void* parameters);
+    static bool capture_write(const capture_t& capture);
+};
+
+};
+
+
+#ifdef CONFIG_BLE_REDUX_REPLAY
+#define BLE_REPLAY_CAPTURE_GATTS(EVENT, GATTS_IF, PARAM)\
+    BLE::BLE_Replay::capture_gatts(EVENT, GATTS_IF, PARAM)
+
+#define BLE_REPLAY_CAPTURE_GAP(EVENT, PARAM) BLE::BLE_Replay::capture_gap(EVENT, PARAM)
+#else
+#define BLE_REPLAY_CAPTURE_GATTS(EVENT, GATTS_IF, PARAM)\
+    do { (void) sizeof(EVENT); (void) sizeof(GATTS_IF); (void) sizeof(PARAM); } while (0)
+
+#define BLE_REPLAY_CAPTURE_GAP(EVENT, PARAM)\
+    do { (void) sizeof(EVENT); (void) sizeof(PARAM); } while (0)
+#endif
+
+#endif // COMPONENTS_BLE_BLE_REPLAY_HPP
@@ -0,0 +1,316 @@
+/**
+ * @file   ble_rpc.cpp
+ *
+ * @brief  Multiplexed remote procedure calls over a characteristic pair.
+ * @detail Calls are written to a request characteristic and answered on a response characteristic
+ *         in a compact envelope tagged with a request ID, so a client can pipeline calls and match
+ *         the answers as they arrive. Methods are dispatched through a handler table that is
+ *         fixed and checked at compile time, a handful of attributes thereby replace one
+ *         characteristic per command.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <vector>
+
+#include "esp_log.h"
+#include "utilities.hpp"
+
+#include "ble_log.hpp"
+#include "ble_rpc.hpp"
+#include "ble_server.hpp"
+#include "ble_service.hpp"
+
+namespace BLE
+{
+
+using Utilities::AnchorSemaphore;
+
+
+constexpr const char* LOG_TAG_BLE_RPC = "BLE RPC";
+
+/***************************************************************************************************
+* Logging Macros
+***************************************************************************************************/
+#define RPC_LOG_LEVEL CONFIG_BLE_REDUX_LOG_LEVEL_SERVICE
+
+#define RPC_LOG(LVL, MSG, ...)\
+    BLE_LOG(RPC_LOG_LEVEL, LVL, LOG_TAG_BLE_RPC, "%s", "", MSG, ##__VA_ARGS__)
+
+#define RPC_LOGE(MSG, ...) RPC_LOG(ESP_LOG_ERROR, MSG, ##__VA_ARGS__)
+#define RPC_LOGW(MSG, ...) RPC_LOG(ESP_LOG_WARN, MSG, ##__VA_ARGS__)
+#define RPC_LOGI(MSG, ...) RPC_LOG(ESP_LOG_INFO, MSG, ##__VA_ARGS__)
+#define RPC_LOGD(MSG, ...) RPC_LOG(ESP_LOG_DEBUG, MSG, ##__VA_ARGS__)
+#define RPC_LOGV(MSG, ...) RPC_LOG(ESP_LOG_VERBOSE, MSG, ##__VA_ARGS__)
+
+
+/***************************************************************************************************
+* Service Management
+***************************************************************************************************/
+BLE_RPC_Service::BLE_RPC_Service(const method_t* methods, size_t method_count)
+    : m_methods(methods),
+      m_method_count(method_count)
+{
+    if (m_pending_semaphore == nullptr)
+        throw std::bad_alloc();
+
+    xSemaphoreGive(m_pending_semaphore);
+}
+
+
+BLE_RPC_Service::~BLE_RPC_Service(void)
+{
+    vSemaphoreDelete(m_pending_semaphore);
+}
+
+
+std::shared_ptr<BLE_RPC_Service>
+BLE_RPC_Service::create(std::shared_ptr<BLE_Profile> profile, const method_t* methods,
+                        size_t method_count)
+{
+    if (!profile)
+        return nullptr;
+
+    auto rpc = std::shared_ptr<BLE_RPC_Service>(new BLE_RPC_Service(methods, method_count));
+
+    // The service declaration, the request characteristic and the response characteristic with
+    // its configuration descriptor.
+    UUID service_uuid(UUID_SERVICE);
+    if (!profile->service_add(service_uuid, false, 6))
+        return nullptr;
+
+    // Write Commands let a client pipeline calls without waiting for each write to be confirmed.
+    auto service = profile->service_get(service_uuid).lock();
+    if (!service ||
+        !service->characteristic_add(UUID(UUID_REQUEST),
+                                     ESP_GATT_CHAR_PROP_BIT_WRITE |
+                                     ESP_GATT_CHAR_PROP_BIT_WRITE_NR,
+                                     ESP_GATT_PERM_WRITE) ||
+        !service->characteristic_add(UUID(UUID_RESPONSE), ESP_GATT_CHAR_PROP_BIT_NOTIFY,
+                                     ESP_GATT_PERM_READ))
+    {
+        RPC_LOGE("RPC service creation failed");
+        return nullptr;
+    }
+
+    auto request = service->characteristic_get(UUID(UUID_REQUEST)).lock();
+    auto response = service->characteristic_get(UUID(UUID_RESPONSE)).lock();
+    if (!request || !response)
+        return nullptr;
+
+    std::weak_ptr<BLE_RPC_Service> rpc_weak_ptr = rpc;
+    request->callback_write_raw_set([rpc_weak_ptr](uint16_t connection_id, const uint8_t* value,
+                                                   size_t length){
+        auto rpc_instance = rpc_weak_ptr.lock();
+        if (rpc_instance)
+            rpc_instance->handle_request(connection_id, value, length);
+    });
+    rpc->m_response = response;
+    rpc->m_server = profile->server;
+
+    return rpc;
+}
+
+
+/**
+ * @brief Answers a call whose handler returned Status::PENDING.
+ * @note This function is thread safe. The calls of a connection are dropped once it closes,
+ *       answering one of them afterwards does nothing.
+ * @param [in] connection_id The connection of the call.
+ * @param [in] request_id The request ID of the call.
+ * @param [in] status The status to return, anything but Status::PENDING.
+ * @param [in] result (default=nullptr) The result of the call.
+ * @param [in] length (default=0) The length of the result.
+ * @return True if the response was sent, false if the call is not pending, its connection closed
+ *         or the response could not be sent.
+ */
+bool
+BLE_RPC_Service::respond(uint16_t connection_id, uint16_t request_id, Status status,
+                         const uint8_t* result, size_t length)
+{
+    if ((status == Status::PENDING) || !pending_remove(connection_id, request_id))
+        return false;
+
+    std::vector<uint8_t> frame;
+    return send(frame, connection_id, request_id, status, result, length);
+}
+
+
+/**
+ * @brief Retrieves the number of calls of a connection waiting for a response.
+ * @note This function is thread safe.
+ * @param [in] connection_id The connection of interest.
+ * @return The number of pending calls.
+ */
+size_t
+BLE_RPC_Service::pending_get(uint16_t connection_id)
+{
+    AnchorSemaphore anchor(m_pending_semaphore);
+    pending_t* pending = pending_find(connection_id, false);
+    return pending ? pending->request_ids.size() : 0;
+}
+
+
+/***************************************************************************************************
+* Dispatch
+***************************************************************************************************/
+const BLE_RPC_Service::method_t*
+BLE_RPC_Service::method_find(uint8_t id) const
+{
+    const method_t* end = m_methods + m_method_count;
+    const method_t* method = std::lower_bound(m_methods, end, id,
+                                              [](const method_t& method, uint8_t id){
+        return method.id < id;
+    });
+
+    return ((method != end) && (method->id == id)) ? method : nullptr;
+}
+
+
+void
+BLE_RPC_Service::handle_request(uint16_t connection_id, const uint8_t* value, size_t length)
+{
+    // Without a request ID there is nothing the client could match an error to.
+    if (length < REQUEST_HEADER_LENGTH)
+    {
+        RPC_LOGW("Request of %u bytes from 0x%04X dropped", length, connection_id);
+        return;
+    }
+
+    uint16_t request_id = value[0] | (value[1] << 8);
+    uint8_t method_id = value[2];
+
+    const method_t* method = method_find(method_id);
+    if (!method)
+    {
+        send(m_frame, connection_id, request_id, Status::UNKNOWN_METHOD, nullptr, 0);
+        return;
+    }
+
+    // The call is registered before the handler runs, another task may answer it at once.
+    Status status = Status::OK;
+    if (!pending_add(connection_id, request_id, status))
+    {
+        send(m_frame, connection_id, request_id, status, nullptr, 0);
+        return;
+    }
+
+    m_result.clear();
+    call_t call = {*this, connection_id, request_id, method_id, value + REQUEST_HEADER_LENGTH,
+                   length - REQUEST_HEADER_LENGTH};
+    status = method->handler(call, m_result);
+    if (status == Status::PENDING)
+        return;
+
+    if (pending_remove(connection_id, request_id))
+        send(m_frame, connection_id, request_id, status, m_result.data(), m_result.size());
+}
+
+
+// Must be called with the pending semaphore held.
+BLE_RPC_Service::pending_t*
+BLE_RPC_Service::pending_find(uint16_t connection_id, bool create)
+{
+    // The calls of closed connections are reclaimed here rather than tracking disconnections, so
+    // that a peer reusing the connection ID neither inherits their slots nor their answers.
+    auto server = m_server.lock();
+    auto connection = server ? server->connection_get(connection_id) : std::nullopt;
+    auto pending = m_pending.find(connection_id);
+    if ((pending != m_pending.end()) &&
+        (!connection || memcmp(pending->second.address, connection->bda, sizeof(esp_bd_addr_t))))
+    {
+        m_pending.erase(pending);
+        pending = m_pending.end();
+    }
+
+    if (pending != m_pending.end())
+        return &pending->second;
+
+    if (!create || !connection)
+        return nullptr;
+
+    pending_t& created = m_pending[connection_id];
+    memcpy(created.address, connection->bda, sizeof(esp_bd_addr_t));
+    return &created;
+}
+
+
+bool
+BLE_RPC_Service::pending_add(uint16_t connection_id, uint16_t request_id, Status& status)
+{
+    AnchorSemaphore anchor(m_pending_semaphore);
+    pending_t* entry = pending_find(connection_id, true);
+    if (!entry)
+    {
+        status = Status::FAILED;
+        return false;
+    }
+
+    std::vector<uint16_t>& pending = entry->request_ids;
+    if (std::find(pending.begin(), pending.end(), request_id) != pending.end())
+    {
+        status = Status::MALFORMED;
+        return false;
+    }
+
+    if (pending.size() >= CONFIG_BLE_REDUX_RPC_IN_FLIGHT_MAX)
+    {
+        status = Status::BUSY;
+        return false;
+    }
+
+    pending.push_back(request_id);
+    return true;
+}
+
+
+bool
+BLE_RPC_Service::pending_remove(uint16_t connection_id, uint16_t request_id)
+{
+    AnchorSemaphore anchor(m_pending_semaphore);
+    pending_t* pending = pending_find(connection_id, false);
+    if (!pending)
+        return false;
+
+    auto call = std::find(pending->request_ids.begin(), pending->request_ids.end(), request_id);
+    if (call == pending->request_ids.end())
+        return false;
+
+    pending->request_ids.erase(call);
+    return true;
+}
+
+
+bool
+BLE_RPC_Service::send(std::vector<uint8_t>& frame, uint16_t connection_id, uint16_t request_id,
+                      Status status, const uint8_t* result, size_t length)
+{
+    auto response = m_response.lock();
+    if (!response)
+        return false;
+
+    frame.assign({static_cast<uint8_t>(request_id), static_cast<uint8_t>(request_id >> 8),
+                  static_cast<uint8_t>(status)});
+    frame.insert(frame.end(), result, result + length);
+    if (response->notify(connection_id, frame.data(), frame.size()))
+        return true;
+
+    // The client still learns the outcome of a call whose result does not fit.
+    if (!length)
+        return false;
+
+    frame.resize(RESPONSE_HEADER_LENGTH);
+    frame[2] = static_cast<uint8_t>(Status::TOO_LARGE);
+    return response->notify(connection_id, frame.data(), frame.size());
+}
+
+};
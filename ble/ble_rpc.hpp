@@ -0,0 +1,205 @@
+/**
+ * @file   ble_rpc.hpp
+ *
+ * @brief  Multiplexed remote procedure calls over a characteristic pair.
+ * @detail Calls are written to a request characteristic and answered on a response characteristic
+ *         in a compact envelope tagged with a request ID, so a client can pipeline calls and match
+ *         the answers as they arrive. Methods are dispatched through a handler table that is
+ *         fixed and checked at compile time, a handful of attributes thereby replace one
+ *         characteristic per command.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_RPC_HPP
+#define COMPONENTS_BLE_BLE_RPC_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <unordered_map>
+#include <vector>
+
+#include "esp_bt_defs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+
+#include "ble_characteristic.hpp"
+#include "ble_profile.hpp"
+#include "types.hpp"
+
+#ifndef CONFIG_BLE_REDUX_RPC_IN_FLIGHT_MAX
+#define CONFIG_BLE_REDUX_RPC_IN_FLIGHT_MAX 8
+#endif
+
+namespace BLE
+{
+
+class BLE_RPC_Service
+{
+public:
+    // The status byte of a response. Handlers may also return application codes from
+    // APPLICATION upwards, they are passed to the client unchanged.
+    enum class Status : uint8_t
+    {
+        OK = 0x00,
+        UNKNOWN_METHOD = 0x01,
+        MALFORMED = 0x02,
+        // The connection already has CONFIG_BLE_REDUX_RPC_IN_FLIGHT_MAX calls pending.
+        BUSY = 0x03,
+        // The result does not fit in a notification at the MTU of the connection.
+        TOO_LARGE = 0x04,
+        FAILED = 0x05,
+        APPLICATION = 0x80,
+        // Returned by a handler which answers later through respond, never sent to the client.
+        PENDING = 0xFF,
+    };
+
+    struct call_t
+    {
+        BLE_RPC_Service&    service;
+        uint16_t            connection_id;
+        uint16_t            request_id;
+        uint8_t             method;
+        // The arguments, only valid during the call.
+        const uint8_t*      arguments;
+        size_t              length;
+    };
+
+    // Runs on the BT task and must not block. The result is appended to the vector, which is
+    // empty on entry.
+    using Handler = Status (*)(const call_t& call, std::vector<uint8_t>& result);
+
+    struct method_t
+    {
+        uint8_t     id;
+        Handler     handler;
+    };
+
+    static constexpr const uint128_t UUID_SERVICE =
+        absl::MakeUint128(0x7B5E0101A1B24E8C, 0x9D3F60C1B2A9E4D7);
+    static constexpr const uint128_t UUID_REQUEST =
+        absl::MakeUint128(0x7B5E0102A1B24E8C, 0x9D3F60C1B2A9E4D7);
+    static constexpr const uint128_t UUID_RESPONSE =
+        absl::MakeUint128(0x7B5E0103A1B24E8C, 0x9D3F60C1B2A9E4D7);
+
+    // A request is the request ID (uint16_t, little endian) and the method followed by the
+    // arguments. A response is the request ID and the status followed by the result.
+    static constexpr const size_t REQUEST_HEADER_LENGTH = sizeof(uint16_t) + sizeof(uint8_t);
+    static constexpr const size_t RESPONSE_HEADER_LENGTH = sizeof(uint16_t) + sizeof(uint8_t);
+
+
+    /**
+     * @brief Checks that a handler table can be dispatched: method IDs strictly ascending and
+     *        every handler set.
+     * @param [in] table The table, an array of method_t.
+     * @return True if the table is valid, false otherwise.
+     */
+    template<typename Table>
+    static constexpr bool table_valid(const Table& table)
+    {
+        for (size_t i = 0; i < std::size(table); i++)
+        {
+            if (!table[i].handler || ((i > 0) && (table[i - 1].id >= table[i].id)))
+                return false;
+        }
+
+        return std::size(table) > 0;
+    }
+
+    /**
+     * @brief Adds the RPC service to a profile.
+     * @detail The handler table is a template argument so that it is validated at compile time
+     *         and never copied, it must have static storage duration:
+     *         static constexpr BLE_RPC_Service::method_t METHODS[] = {{0x01, &status_get}};
+     *         auto rpc = BLE_RPC_Service::create<METHODS>(profile);
+     * @tparam TABLE The handler table, sorted by method ID.
+     * @param [in] profile The profile to add the service to.
+     * @return A shared pointer to the service, nullptr if it could not be created. The service
+     *         stops answering once the pointer is released.
+     */
+    template<const auto& TABLE>
+    static std::shared_ptr<BLE_RPC_Service> create(std::shared_ptr<BLE_Profile> profile)
+    {
+        static_assert(table_valid(TABLE), "RPC methods must be set and sorted by unique ID");
+        return create(std::move(profile), std::data(TABLE), std::size(TABLE));
+    }
+
+    ~BLE_RPC_Service(void);
+
+    BLE_RPC_Service(const BLE_RPC_Service&) = delete;
+    BLE_RPC_Service& operator=(const BLE_RPC_Service&) = delete;
+
+    /**
+     * @brief Answers a call whose handler returned Status::PENDING.
+     * @note This function is thread safe. The calls of a connection are dropped once it closes,
+     *       answering one of them afterwards does nothing.
+     * @param [in] connection_id The connection of the call.
+     * @param [in] request_id The request ID of the call.
+     * @param [in] status The status to return, anything but Status::PENDING.
+     * @param [in] result (default=nullptr) The result of the call.
+     * @param [in] length (default=0) The length of the result.
+     * @return True if the response was sent, false if the call is not pending, its connection
+     *         closed or the response could not be sent.
+     */
+    bool respond(uint16_t connection_id, uint16_t request_id, Status status,
+                 const uint8_t* result=nullptr, size_t length=0);
+
+    /**
+     * @brief Retrieves the number of calls of a connection waiting for a response.
+     * @note This function is thread safe.
+     * @param [in] connection_id The connection of interest.
+     * @return The number of pending calls.
+     */
+    size_t pending_get(uint16_t connection_id);
+
+private:
+    struct pending_t
+    {
+        // The calls are dropped once the connection ID is reused by another peer.
+        esp_bd_addr_t           address;
+        std::vector<uint16_t>   request_ids;
+    };
+
+    using Pending_Map = std::unordered_map<uint16_t, pending_t>;
+
+
+    BLE_RPC_Service(const method_t* methods, size_t method_count);
+
+    static std::shared_ptr<BLE_RPC_Service> create(std::shared_ptr<BLE_Profile> profile,
+                                                   const method_t* methods, size_t method_count);
+
+    const method_t* method_find(uint8_t id) const;
+
+    void handle_request(uint16_t connection_id, const uint8_t* value, size_t length);
+    pending_t* pending_find(uint16_t connection_id, bool create);
+    bool pending_add(uint16_t connection_id, uint16_t request_id, Status& status);
+    bool pending_remove(uint16_t connection_id, uint16_t request_id);
+    bool send(std::vector<uint8_t>& frame, uint16_t connection_id, uint16_t request_id,
+              Status status, const uint8_t* result, size_t length);
+
+
+    const method_t* const               m_methods;
+    const size_t                        m_method_count;
+    std::weak_ptr<BLE_Characteristic>   m_response;
+    std::weak_ptr<BLE_Server>           m_server;
+
+    // Only accessed from the BT task, reused across calls.
+    std::vector<uint8_t>                m_result;
+    std::vector<uint8_t>                m_frame;
+
+    // The request IDs awaiting a response, per connection.
+    Pending_Map                         m_pending;
+    SemaphoreHandle_t                   m_pending_semaphore = xSemaphoreCreateBinary();
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_RPC_HPP
@@ -0,0 +1,195 @@
+/**
+ * @file   ble_scanner.cpp
+ *
+ * @brief  High-rate advertisement scanner.
+ * @detail Advertisement reports are filtered on the BT task without allocating: repeats of the
+ *         same payload are dropped using a fixed-size table keyed by address, devices can be rate
+ *         limited, and the surviving reports are handed to consumer tasks through a lock-free
+ *         queue. Consumers parse the advertising data in place with BLE_Advertisement_Fields.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+#include "esp_gap_ble_api.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+
+#include "ble_allocation.hpp"
+#include "ble_scanner.hpp"
+
+namespace BLE
+{
+
+constexpr const uint32_t SCAN_HASH_OFFSET = 2166136261u;
+constexpr const uint32_t SCAN_HASH_PRIME = 16777619u;
+
+constexpr const uint64_t SCAN_KEY_OCCUPIED = 1ull << 48;
+constexpr const uint64_t SCAN_KEY_SCAN_RESPONSE = 1ull << 49;
+
+
+// FNV-1a, cheap enough to run on every report and only used to detect repeated payloads.
+static uint32_t
+payload_hash(const uint8_t* data, size_t length, uint32_t hash=SCAN_HASH_OFFSET)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= data[i];
+        hash *= SCAN_HASH_PRIME;
+    }
+
+    return hash;
+}
+
+
+/***************************************************************************************************
+* Scanner Member Functions
+***************************************************************************************************/
+/**
+ * @brief Waits for the next advertisement that passed the filters.
+ * @note This function is thread safe, several consumer tasks may share the scanner.
+ * @param [out] advertisement The location the advertisement is copied to.
+ * @param [in] timeout (default=portMAX_DELAY) The time to wait for an advertisement.
+ * @return True if an advertisement was retrieved, false if the wait timed out.
+ */
+bool
+BLE_Scanner::receive(advertisement_t& advertisement, TickType_t timeout)
+{
+    if (xSemaphoreTake(m_available, timeout) != pdTRUE)
+        return false;
+
+    // Every count was given after a successful push, so a value is always waiting.
+    return m_queue.pop(advertisement);
+}
+
+
+/**
+ * @brief Sets the deduplication window and the per device rate limit.
+ * @note This function is thread safe, the limits apply to the next report.
+ * @param [in] limits The new limits.
+ */
+void
+BLE_Scanner::limits_set(const limits_t& limits)
+{
+    m_duplicate_window_ms.store(limits.duplicate_window_ms, std::memory_order_relaxed);
+    m_device_interval_ms.store(limits.device_interval_ms, std::memory_order_relaxed);
+}
+
+
+/**
+ * @brief Retrieves the filtering counters.
+ * @param [in] reset (default=false) Zeroes the counters after reading them.
+ * @return A copy of the counters.
+ */
+BLE_Scanner::counters_t
+BLE_Scanner::counters_get(bool reset)
+{
+    auto read = [reset](std::atomic<uint32_t>& counter){
+        return reset ? counter.exchange(0, std::memory_order_relaxed)
+                     : counter.load(std::memory_order_relaxed);
+    };
+
+    counters_t counters;
+    counters.seen = read(m_seen);
+    counters.deduplicated = read(m_deduplicated);
+    counters.rate_limited = read(m_rate_limited);
+    counters.dropped = read(m_dropped);
+    counters.delivered = read(m_delivered);
+    return counters;
+}
+
+
+void
+BLE_Scanner::report(const esp_ble_gap_cb_param_t::ble_scan_result_evt_param& param)
+{
+    BLE_ALLOCATION_SCOPE(SCAN);
+    m_seen.fetch_add(1, std::memory_order_relaxed);
+
+    uint32_t now_ms = static_cast<uint32_t>(esp_timer_get_time() / 1000);
+    size_t length = std::min<size_t>(param.adv_data_len + param.scan_rsp_len,
+                                     sizeof(param.ble_adv));
+
+    // Active scans report the scan response separately from the advertisement it answers, the
+    // two are tracked as different entries so that they do not evict each other's payload.
+    uint64_t key = SCAN_KEY_OCCUPIED;
+    for (size_t i = 0; i < ESP_BD_ADDR_LEN; i++)
+        key |= static_cast<uint64_t>(param.bda[i]) << (8 * (ESP_BD_ADDR_LEN - 1 - i));
+    if (param.ble_evt_type == ESP_BLE_EVT_SCAN_RSP)
+        key |= SCAN_KEY_SCAN_RESPONSE;
+
+    uint8_t event_type = param.ble_evt_type;
+    uint32_t hash = payload_hash(param.ble_adv, length, payload_hash(&event_type, 1));
+
+    entry_t& entry = entry_find(key, now_ms);
+    if (entry.key == key)
+    {
+        uint32_t elapsed_ms = now_ms - entry.forwarded_ms;
+        uint32_t duplicate_window_ms = m_duplicate_window_ms.load(std::memory_order_relaxed);
+        if ((entry.payload_hash == hash) && (elapsed_ms < duplicate_window_ms))
+        {
+            m_deduplicated.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+
+        if (elapsed_ms < m_device_interval_ms.load(std::memory_order_relaxed))
+        {
+            m_rate_limited.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+    }
+
+    advertisement_t advertisement;
+    advertisement.timestamp_us = esp_timer_get_time();
+    std::copy(param.bda, param.bda + ESP_BD_ADDR_LEN, advertisement.address.begin());
+    advertisement.address_type = param.ble_addr_type;
+    advertisement.event_type = param.ble_evt_type;
+    advertisement.rssi = static_cast<int8_t>(param.rssi);
+    advertisement.advertising_length = std::min<size_t>(param.adv_data_len, length);
+    advertisement.scan_response_length = length - advertisement.advertising_length;
+    std::copy(param.ble_adv, param.ble_adv + length, advertisement.data.begin());
+
+    if (!m_queue.push(advertisement))
+    {
+        // The entry is left untouched so that the next report of the device is not filtered.
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+
+    xSemaphoreGive(m_available);
+    m_delivered.fetch_add(1, std::memory_order_relaxed);
+
+    entry.key = key;
+    entry.payload_hash = hash;
+    entry.forwarded_ms = now_ms;
+}
+
+
+BLE_Scanner::entry_t&
+BLE_Scanner::entry_find(uint64_t key, uint32_t now_ms)
+{
+    // Linear probing over a short range, the least recently forwarded entry is replaced when the
+    // key is absent and no entry is free.
+    size_t start = static_cast<size_t>((key ^ (key >> 17)) * SCAN_HASH_PRIME);
+    entry_t* oldest = nullptr;
+    for (size_t i = 0; i < DEDUP_PROBES; i++)
+    {
+        entry_t& entry = m_entries[(start + i) & (DEDUP_ENTRIES - 1)];
+        if ((entry.key == key) || (entry.key == 0))
+            return entry;
+
+        if (!oldest || ((now_ms - entry.forwarded_ms) > (now_ms - oldest->forwarded_ms)))
+            oldest = &entry;
+    }
+
+    return *oldest;
+}
+
+};
@@ -0,0 +1,265 @@
+/**
+ * @file   ble_scanner.hpp
+ *
+ * @brief  High-rate advertisement scanner.
+ * @detail Advertisement reports are filtered on the BT task without allocating: repeats of the
+ *         same payload are dropped using a fixed-size table keyed by address, devices can be rate
+ *         limited, and the surviving reports are handed to consumer tasks through a lock-free
+ *         queue. Consumers parse the advertising data in place with BLE_Advertisement_Fields.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_SCANNER_HPP
+#define COMPONENTS_BLE_BLE_SCANNER_HPP
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <new>
+#include <optional>
+
+#include "esp_gap_ble_api.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "sdkconfig.h"
+
+#include "ble_queue.hpp"
+
+#ifndef CONFIG_BLE_REDUX_SCAN_DEDUP_ENTRIES
+#define CONFIG_BLE_REDUX_SCAN_DEDUP_ENTRIES 256
+#endif
+
+#ifndef CONFIG_BLE_REDUX_SCAN_QUEUE_DEPTH
+#define CONFIG_BLE_REDUX_SCAN_QUEUE_DEPTH 64
+#endif
+
+namespace BLE
+{
+
+struct advertisement_field_t
+{
+    // The AD type as assigned by the Bluetooth SIG, e.g. ESP_BLE_AD_TYPE_NAME_CMPL.
+    uint8_t         type;
+    const uint8_t*  data;
+    uint8_t         length;
+};
+
+
+/**
+ * @brief A view over a sequence of AD structures (length, type, data).
+ * @detail The view does not copy or allocate, the underlying buffer must outlive it. Parsing stops
+ *         at the first zero length structure or at a structure overrunning the buffer, so
+ *         malformed reports yield the fields preceding the corruption.
+ */
+class BLE_Advertisement_Fields
+{
+public:
+    class iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type = advertisement_field_t;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const advertisement_field_t*;
+        using reference = const advertisement_field_t&;
+
+        iterator(const uint8_t* position, const uint8_t* end) : m_position(position), m_end(end)
+        {
+            validate();
+        }
+
+        advertisement_field_t operator*(void) const
+        {
+            return {m_position[1], m_position + 2, static_cast<uint8_t>(m_position[0] - 1)};
+        }
+
+        iterator& operator++(void)
+        {
+            m_position += m_position[0] + 1;
+            validate();
+            return *this;
+        }
+
+        iterator operator++(int)
+        {
+            iterator previous = *this;
+            ++(*this);
+            return previous;
+        }
+
+        bool operator==(const iterator& other) const { return m_position == other.m_position; }
+        bool operator!=(const iterator& other) const { return m_position != other.m_position; }
+
+    private:
+        void validate(void)
+        {
+            size_t remaining = m_end - m_position;
+            if ((remaining < 2) || (m_position[0] == 0) || (m_position[0] >= remaining))
+                m_position = m_end;
+        }
+
+        const uint8_t*  m_position;
+        const uint8_t*  m_end;
+    };
+
+
+    BLE_Advertisement_Fields(const uint8_t* data, size_t length)
+        : m_begin(data), m_end(data + length) {}
+
+    iterator begin(void) const { return iterator(m_begin, m_end); }
+    iterator end(void) const { return iterator(m_end, m_end); }
+
+    /**
+     * @brief Finds the first field of a type.
+     * @param [in] type The AD type of interest.
+     * @return The field or std::nullopt if the data does not contain it.
+     */
+    std::optional<advertisement_field_t> find(uint8_t type) const
+    {
+        for (auto field : *this)
+        {
+            if (field.type == type)
+                return field;
+        }
+
+        return {};
+    }
+
+private:
+    const uint8_t*  m_begin;
+    const uint8_t*  m_end;
+};
+
+
+// A single advertising or scan response report, copied by value through the scanner's queue.
+struct advertisement_t
+{
+    // The arrival time in microseconds since boot, as reported by esp_timer_get_time.
+    int64_t                                             timestamp_us;
+    std::array<uint8_t, ESP_BD_ADDR_LEN>                address;
+    esp_ble_addr_type_t                                 address_type;
+    esp_ble_evt_type_t                                  event_type;
+    int8_t                                              rssi;
+    uint8_t                                             advertising_length;
+    uint8_t                                             scan_response_length;
+    // The advertising data followed by the scan response data.
+    std::array<uint8_t, ESP_BLE_ADV_DATA_LEN_MAX + ESP_BLE_SCAN_RSP_DATA_LEN_MAX>  data;
+
+    BLE_Advertisement_Fields fields(void) const
+    {
+        return BLE_Advertisement_Fields(data.data(), advertising_length + scan_response_length);
+    }
+};
+
+
+class BLE_Scanner
+{
+public:
+    struct limits_t
+    {
+        // Reports repeating the previous payload of a device within this window are dropped,
+        // 0 forwards every repeat.
+        uint32_t    duplicate_window_ms = 1000;
+        // The minimum time between two forwarded reports of a device, whatever their payload,
+        // 0 disables rate limiting.
+        uint32_t    device_interval_ms = 0;
+    };
+
+    struct counters_t
+    {
+        uint32_t    seen;
+        uint32_t    deduplicated;
+        uint32_t    rate_limited;
+        // Reports discarded because consumers did not keep up and the queue was full.
+        uint32_t    dropped;
+        uint32_t    delivered;
+    };
+
+
+    BLE_Scanner(void)
+    {
+        if (m_available == nullptr)
+            throw std::bad_alloc();
+    }
+
+    ~BLE_Scanner(void)
+    {
+        vSemaphoreDelete(m_available);
+    }
+
+    BLE_Scanner(const BLE_Scanner&) = delete;
+    BLE_Scanner& operator=(const BLE_Scanner&) = delete;
+
+    /**
+     * @brief Waits for the next advertisement that passed the filters.
+     * @note This function is thread safe, several consumer tasks may share the scanner.
+     * @param [out] advertisement The location the advertisement is copied to.
+     * @param [in] timeout (default=portMAX_DELAY) The time to wait for an advertisement.
+     * @return True if an advertisement was retrieved, false if the wait timed out.
+     */
+    bool receive(advertisement_t& advertisement, TickType_t timeout=portMAX_DELAY);
+
+    /**
+     * @brief Sets the deduplication window and the per device rate limit.
+     * @note This function is thread safe, the limits apply to the next report.
+     * @param [in] limits The new limits.
+     */
+    void limits_set(const limits_t& limits);
+
+    /**
+     * @brief Retrieves the filtering counters.
+     * @param [in] reset (default=false) Zeroes the counters after reading them.
+     * @return A copy of the counters.
+     */
+    counters_t counters_get(bool reset=false);
+
+private:
+    friend class BLE_Server;
+
+    struct entry_t
+    {
+        // The address, its scan response flag and an occupancy bit, 0 marks a free entry.
+        uint64_t    key;
+        uint32_t    payload_hash;
+        uint32_t    forwarded_ms;
+    };
+
+    static constexpr const size_t DEDUP_ENTRIES = CONFIG_BLE_REDUX_SCAN_DEDUP_ENTRIES;
+    static constexpr const size_t DEDUP_PROBES = 8;
+
+    static_assert((DEDUP_ENTRIES & (DEDUP_ENTRIES - 1)) == 0,
+                  "The deduplication table size must be a power of two");
+    static_assert(DEDUP_ENTRIES >= DEDUP_PROBES, "The deduplication table is too small");
+
+    void report(const esp_ble_gap_cb_param_t::ble_scan_result_evt_param& param);
+    entry_t& entry_find(uint64_t key, uint32_t now_ms);
+
+
+    // Only accessed from the BT task.
+    std::array<entry_t, DEDUP_ENTRIES>                                  m_entries = {};
+
+    BLE_Queue<advertisement_t, CONFIG_BLE_REDUX_SCAN_QUEUE_DEPTH>       m_queue;
+    // Counts the queued advertisements so that consumers can block instead of polling.
+    SemaphoreHandle_t   m_available = xSemaphoreCreateCounting(CONFIG_BLE_REDUX_SCAN_QUEUE_DEPTH,
+                                                               0);
+
+    std::atomic<uint32_t>   m_duplicate_window_ms{limits_t().duplicate_window_ms};
+    std::atomic<uint32_t>   m_device_interval_ms{limits_t().device_interval_ms};
+
+    std::atomic<uint32_t>   m_seen{0};
+    std::atomic<uint32_t>   m_deduplicated{0};
+    std::atomic<uint32_t>   m_rate_limited{0};
+    std::atomic<uint32_t>   m_dropped{0};
+    std::atomic<uint32_t>   m_delivered{0};
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_SCANNER_HPP
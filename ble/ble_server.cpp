@@ -17,6 +17,7 @@
  * @TODO Give the ability to specify blocking opts for all functions
  */
 
+#include <algorithm>
 #include <array>
 #include <cstdint>
 #include <memory>
@@ -26,32 +27,51 @@
 #include <utility>
 #include <vector>
 
-#include "esp_bt.h"
-#include "esp_bt_main.h"
 #include "esp_gap_ble_api.h"
 #include "esp_gatts_api.h"
 #include "esp_gatt_common_api.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "sdkconfig.h"
 #include "utilities.hpp"
 
+#include "ble_allocation.hpp"
+#include "ble_database.hpp"
+#include "ble_peer.hpp"
 #include "ble_profile.hpp"
+#include "ble_replay.hpp"
 #include "ble_server.hpp"
 #include "ble_service.hpp"
+#include "ble_log.hpp"
+#include "ble_trace.hpp"
+#include "ble_utilities.hpp"
 #include "uuid.hpp"
 
 namespace BLE
 {
 
+using Utilities::AnchorSemaphore;
+
+
 constexpr const char* LOG_TAG_BLE_SERVER = "BLE Server";
 constexpr const std::size_t MAX_ADV_UUID_LEN  = std::numeric_limits<decltype(std::declval<esp_ble_adv_data_t>().service_uuid_len)>::max();
 
 /***************************************************************************************************
 * Logging Macros
 ***************************************************************************************************/
+#define SERVER_LOG_LEVEL CONFIG_BLE_REDUX_LOG_LEVEL_SERVER
+
 #define SERVER_LOG(LVL, MSG, ...)\
-    INTANCE_LOG(LVL, LOG_TAG_BLE_SERVER, "%s", "", MSG, ##__VA_ARGS__)
+    BLE_LOG(SERVER_LOG_LEVEL, LVL, LOG_TAG_BLE_SERVER, "%s", "", MSG, ##__VA_ARGS__)
+
+#ifdef CONFIG_BLE_REDUX_LOG_DEFERRED
+#define SERVER_LOG_DEFERRED(LVL, MSG, ...)\
+    BLE_LOG_DEFERRED(SERVER_LOG_LEVEL, LVL, LOG_TAG_BLE_SERVER, MSG, ##__VA_ARGS__)
+#else
+#define SERVER_LOG_DEFERRED(LVL, MSG, ...) SERVER_LOG(LVL, MSG, ##__VA_ARGS__)
+#endif
 
 #define SERVER_LOGE(MSG, ...) SERVER_LOG(ESP_LOG_ERROR, MSG, ##__VA_ARGS__)
 #define SERVER_LOGW(MSG, ...) SERVER_LOG(ESP_LOG_WARN, MSG, ##__VA_ARGS__)
@@ -59,10 +79,14 @@ constexpr const std::size_t MAX_ADV_UUID_LEN  = std::numeric_limits<decltype(std
 #define SERVER_LOGD(MSG, ...) SERVER_LOG(ESP_LOG_DEBUG, MSG, ##__VA_ARGS__)
 #define SERVER_LOGV(MSG, ...) SERVER_LOG(ESP_LOG_VERBOSE, MSG, ##__VA_ARGS__)
 
+#define SERVER_LOGD_DEFERRED(MSG, ...) SERVER_LOG_DEFERRED(ESP_LOG_DEBUG, MSG, ##__VA_ARGS__)
+#define SERVER_LOGV_DEFERRED(MSG, ...) SERVER_LOG_DEFERRED(ESP_LOG_VERBOSE, MSG, ##__VA_ARGS__)
+
 /***************************************************************************************************
 * Static Singleton Functions
 ***************************************************************************************************/
 std::weak_ptr<BLE_Server> BLE_Server::instance;
+int64_t BLE_Server::event_timestamp = 0;
 
 
 /**
@@ -106,42 +130,12 @@ BLE_Server::server_start(void)
         return false;
     }
 
-    esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
-
-    esp_err_t err;
-    err = esp_bt_controller_init(&bt_cfg);
-    if (err)
-    {
-        SERVER_LOGE("Enable controller failed: %s (%d)", esp_err_to_name(err), err);
-        return false;
-    }
-    err = esp_bt_controller_enable(ESP_BT_MODE_BLE);
-    if (err)
-    {
-        SERVER_LOGE("Enable controller failed: %s (%d)", esp_err_to_name(err), err);
-        return false;
-    }
-
-    err = esp_bluedroid_init();
-    if (err)
-    {
-        SERVER_LOGE("Init bluetooth failed: %s (%d)", esp_err_to_name(err), err);
-        return false;
-    }
+#ifdef CONFIG_BLE_REDUX_LOG_DEFERRED
+    BLE_Deferred_Log::start();
+#endif
 
-    err = esp_bluedroid_enable();
-    if (err)
-    {
-        SERVER_LOGE("Enable bluetooth failed: %s (%d)", esp_err_to_name(err), err);
-        return false;
-    }
- 
-    err = esp_ble_gatt_set_local_mtu(m_server_mtu);
-    if (err)
-    {
-        SERVER_LOGE("Set local MTU failed: %s (%d)", esp_err_to_name(err), err);
+    if (!stack_enable(m_server_mtu))
         return false;
-    }
 
     // This static decoupling guarantees that there is always a valid instance that is being
     // referenced by the callbacks. This unfortunately causes some abstraction issues.
@@ -298,6 +292,84 @@ BLE_Server::advertising_stop(void)
 }
 
 
+/***************************************************************************************************
+* Scanning related functions
+***************************************************************************************************/
+/**
+ * @brief Starts scanning for advertisements, see scanner_get to consume them.
+ * @detail The controller's duplicate filter is disabled, the scanner deduplicates on the payload
+ *         instead so that devices changing their advertising data are still reported.
+ * @param [in] duration_s (default=0) The duration of the scan in seconds, 0 scans until scan_stop
+ *                        is called.
+ * @param [in] active (default=true) Requests scan responses from scannable advertisers.
+ * @param [in] interval (default=0x50) The scan interval. Range: 0x0004 to 0x4000.
+ *                      Time = N * 0.625 msec.
+ * @param [in] window (default=0x30) The scan window, no longer than the interval.
+ *                    Range: 0x0004 to 0x4000. Time = N * 0.625 msec.
+ * @return True if the operation succeeds, false otherwise.
+ */
+bool
+BLE_Server::scan_start(uint32_t duration_s, bool active, uint16_t interval, uint16_t window)
+{
+    if (m_state == BLE_Server::State::STOPPED)
+    {
+        SERVER_LOGE("Server not started");
+        return false;
+    }
+
+    if ((window > interval) || (interval < 0x0004) || (interval > 0x4000) || (window < 0x0004))
+        return false;
+
+    // Created before the first report can arrive and kept for the lifetime of the server, so
+    // the GAP handler never observes it changing.
+    if (!m_scanner)
+        m_scanner = std::make_shared<BLE_Scanner>();
+
+    m_scan_duration = duration_s;
+
+    esp_ble_scan_params_t scan_params;
+    scan_params.scan_type = active ? BLE_SCAN_TYPE_ACTIVE : BLE_SCAN_TYPE_PASSIVE;
+    scan_params.own_addr_type = BLE_ADDR_TYPE_PUBLIC;
+    scan_params.scan_filter_policy = BLE_SCAN_FILTER_ALLOW_ALL;
+    scan_params.scan_interval = interval;
+    scan_params.scan_window = window;
+    scan_params.scan_duplicate = BLE_SCAN_DUPLICATE_DISABLE;
+
+    // Scanning starts once the parameters are applied, see ESP_GAP_BLE_SCAN_PARAM_SET_COMPLETE_EVT.
+    esp_err_t err = esp_ble_gap_set_scan_params(&scan_params);
+    if (err)
+    {
+        SERVER_LOGE("Error: scan params set failed: %s (%d)", esp_err_to_name(err), err);
+        return false;
+    }
+
+    return true;
+}
+
+
+/**
+ * @brief Stops scanning for advertisements, queued advertisements remain available.
+ */
+void
+BLE_Server::scan_stop(void)
+{
+    esp_err_t err = esp_ble_gap_stop_scanning();
+    if (err)
+        SERVER_LOGE("Error: scan stop failed: %s (%d)", esp_err_to_name(err), err);
+}
+
+
+/**
+ * @brief Retrieves the scanner receiving the advertisements.
+ * @return A shared pointer to the scanner, nullptr until scan_start is first called.
+ */
+std::shared_ptr<BLE_Scanner>
+BLE_Server::scanner_get(void)
+{
+    return m_scanner;
+}
+
+
 /**
  * @brief Generate the primary advertising parameters for the GATTS server.
  * @return An ESP-32 advertising parameters struct.
@@ -349,7 +421,8 @@ BLE_Server::adv_data_gen(void)
     }
 
     SERVER_LOGI("Setting advertising UUIDs:");
-    ESP_LOG_BUFFER_HEX(LOG_TAG_BLE_SERVER, m_adv_uuids.data(), m_adv_uuids.size());
+    if constexpr (BLE_LOG_ENABLED(SERVER_LOG_LEVEL, ESP_LOG_INFO))
+        ESP_LOG_BUFFER_HEX(LOG_TAG_BLE_SERVER, m_adv_uuids.data(), m_adv_uuids.size());
 
     // TODO Make this more parameterized
     return
@@ -478,30 +551,404 @@ BLE_Server::profile_get(uint16_t profile_id)
 std::optional<connection_t>
 BLE_Server::connection_get(uint16_t connection_id)
 {
-    if (!m_connections.count(connection_id))
+    AnchorSemaphore anchor(m_connections_semaphore);
+    auto connection = m_connections.find(connection_id);
+    if (connection == m_connections.end())
         return {};
 
-    return m_connections.at(connection_id);
+    return connection->second;
+}
+
+
+/**
+ * @brief Describes a link of this server to the throughput model, see BLE_Throughput.
+ * @param [in] connection_id (default=std::nullopt) A connection whose negotiated MTU and
+ *                           parameters are described, otherwise the configured ones are. The
+ *                           longest configured interval is used, the client picks any of them.
+ * @return The link, the packets per event, data length and PHY keep the model's defaults.
+ */
+BLE_Throughput::link_t
+BLE_Server::throughput_link_get(std::optional<uint16_t> connection_id)
+{
+    BLE_Throughput::link_t link;
+    link.mtu = m_server_mtu;
+    link.interval = m_connection_interval.second;
+    link.latency = m_connection_latency;
+
+    auto connection = connection_id ? connection_get(*connection_id) : std::nullopt;
+    if (connection)
+    {
+        link.mtu = connection->mtu;
+
+        // The parameters are only known once the first update is reported.
+        if (connection->interval)
+        {
+            link.interval = connection->interval;
+            link.latency = connection->latency;
+        }
+    }
+
+    return link;
+}
+
+
+/**
+ * @brief Retrieves the time at which the GATTS event currently being dispatched arrived.
+ * @note Only meaningful when called from within the event dispatch path.
+ * @return The arrival time in microseconds since boot, as reported by esp_timer_get_time.
+ */
+int64_t
+BLE_Server::event_timestamp_get(void)
+{
+    return event_timestamp;
+}
+
+
+/**
+ * @brief Sets the limits applied to prepared (queued) write transactions.
+ * @detail Requests that would exceed a limit are answered with ESP_GATT_PREPARE_Q_FULL and their
+ *         transaction is discarded.
+ * @param [in] limits The global byte budget, per connection cap and time-to-live.
+ */
+void
+BLE_Server::transaction_limits_set(const BLE_Transaction_Manager::limits_t& limits)
+{
+    m_transactions.limits_set(limits);
+}
+
+
+/**
+ * @brief Retrieves the prepared write transaction counters.
+ * @return A copy of the counters.
+ */
+BLE_Transaction_Manager::metrics_t
+BLE_Server::transaction_metrics_get(void) const
+{
+    return m_transactions.metrics();
+}
+
+
+/**
+ * @brief Adds a service exposing the Database Hash characteristic to a profile.
+ * @detail The characteristic is answered by the stack and updated whenever the layout of the
+ *         database changes. It lives in a vendor service because the stack already registers
+ *         the GATT service, of which a server may only expose one. Clients read the hash by
+ *         UUID over the whole handle range, so they find it all the same.
+ * @param [in] profile_id The ID of the profile to add the service to.
+ * @return True on success, false otherwise.
+ */
+bool
+BLE_Server::database_service_add(uint16_t profile_id)
+{
+    auto profile = profile_get(profile_id).lock();
+    if (!profile)
+        return false;
+
+    // The service declaration followed by the declaration and value of the hash.
+    UUID service_uuid(BLE_Database_Hash::UUID_SERVICE);
+    if (!profile->service_add(service_uuid, false, 3))
+        return false;
+
+    auto service = profile->service_get(service_uuid).lock();
+    UUID hash_uuid(BLE_Database_Hash::UUID_DATABASE_HASH);
+    if (!service || !service->characteristic_add(hash_uuid, ESP_GATT_CHAR_PROP_BIT_READ,
+                                                 ESP_GATT_PERM_READ, true, true))
+    {
+        SERVER_LOGE("Database hash characteristic creation failed");
+        return false;
+    }
+
+    m_database_hash_characteristic = service->characteristic_get(hash_uuid);
+    database_hash_publish();
+    return true;
+}
+
+
+/**
+ * @brief Computes the hash of the current layout of the GATT database.
+ * @return The hash over every service and characteristic declaration of every profile.
+ */
+BLE_Database_Hash::Hash
+BLE_Server::database_hash_get(void)
+{
+    BLE_Database_Hash database;
+    for (auto& profile : m_profiles)
+    {
+        for (auto& service_weak_ptr : profile.second->service_get_all())
+        {
+            auto service = service_weak_ptr.lock();
+            if (!service)
+                continue;
+
+            database.service_add(service->handle, service->service_id.is_primary, service->uuid);
+            for (auto& characteristic_weak_ptr : service->characteristic_get_all())
+            {
+                auto characteristic = characteristic_weak_ptr.lock();
+                if (!characteristic)
+                    continue;
+
+                database.characteristic_add(characteristic->handle, characteristic->properties,
+                                            characteristic->uuid);
+                if (characteristic->m_configuration_handle)
+                    database.descriptor_add(characteristic->m_configuration_handle,
+                                            ESP_GATT_UUID_CHAR_CLIENT_CONFIG);
+            }
+        }
+    }
+
+    return database.compute();
+}
+
+
+/**
+ * @brief Holds back database change handling until the matching database_batch_end.
+ * @detail Batches nest, the hash is only recomputed once the outermost batch ends.
+ */
+void
+BLE_Server::database_batch_begin(void)
+{
+    m_database_batch_depth.fetch_add(1);
+}
+
+
+/**
+ * @brief Ends a batch started by database_batch_begin, handling any change made during it.
+ */
+void
+BLE_Server::database_batch_end(void)
+{
+    if ((m_database_batch_depth.fetch_sub(1) == 1) && m_database_batch_pending.exchange(false))
+        database_changed();
+}
+
+
+/**
+ * @brief Recomputes the database hash after a service or characteristic was added or removed and
+ *        tells connected clients to discard their cached discovery results if it changed.
+ * @note The indication is only sent here when the stack's Service Changed mode is manual
+ *       (CONFIG_BT_GATTS_SEND_SERVICE_CHANGE_MANUAL). In the default automatic mode the stack
+ *       rejects it and indicates every service start and deletion itself.
+ * @warning Must not be called while holding a profile or service map semaphore.
+ */
+void
+BLE_Server::database_changed(void)
+{
+    if (m_database_batch_depth.load() > 0)
+    {
+        m_database_batch_pending.store(true);
+        return;
+    }
+
+    BLE_Database_Hash::Hash hash = database_hash_get();
+    if (hash == m_database_hash)
+        return;
+
+    m_database_hash = hash;
+    database_hash_publish();
+
+#ifdef CONFIG_BT_GATTS_SEND_SERVICE_CHANGE_MANUAL
+    if (m_profiles.empty())
+        return;
+
+    // Layout changes may be made from any task, the connections are copied so that the stack is
+    // not called with the semaphore held.
+    Connection_Map connections;
+    {
+        AnchorSemaphore anchor(m_connections_semaphore);
+        connections = m_connections;
+    }
+
+    // Bonded clients which are not connected are indicated by the stack once they reconnect.
+    esp_gatt_if_t gatts_if = m_profiles.begin()->second->gatts_if;
+    for (auto& connection : connections)
+    {
+        esp_err_t err = esp_ble_gatts_send_service_change_indication(gatts_if,
+                                                                     connection.second.bda);
+        if (err)
+            SERVER_LOGE("Service changed indication failed for 0x%04X: %s (%d)", connection.first,
+                        esp_err_to_name(err), err);
+    }
+#endif
+}
+
+
+void
+BLE_Server::database_hash_publish(void)
+{
+    auto characteristic = m_database_hash_characteristic.lock();
+    if (!characteristic)
+        return;
+
+    characteristic->value_set<BLE_Database_Hash::Hash>(m_database_hash,
+                                                       [](BLE_Database_Hash::Hash hash){
+        return std::vector<uint8_t>(hash.begin(), hash.end());
+    });
 }
 
 
 /***************************************************************************************************
-* Event Handling
+* Peer Persistence
 ***************************************************************************************************/
+/**
+ * @brief Sets the store which keeps the state of bonded peers across connections.
+ * @detail The subscriptions, MTU and connection parameters of a bonded peer are saved whenever it
+ *         changes its subscriptions and when it disconnects, and restored once it reconnects and
+ *         its link is encrypted with the keys of the bond, so that notifications flow without the
+ *         client rewriting its descriptors. The state of a peer is erased when its bond is removed.
+ * @param [in] store The store to use, nullptr disables persistence.
+ */
 void
-BLE_Server::handle_connection_new(const esp_ble_gatts_cb_param_t::gatts_connect_evt_param& param)
+BLE_Server::peer_store_set(std::shared_ptr<BLE_Peer_Store> store)
 {
-    if (m_connections.count(param.conn_id))
+    m_peer_store = std::move(store);
+}
+
+
+/**
+ * @brief Removes the bond of a peer along with its stored state.
+ * @detail The state is keyed by the identity address of the peer, which can only be looked up while
+ *         the bond exists. Bonds removed with esp_ble_remove_bond_device directly only have their
+ *         state erased if the peer authenticated since the server started.
+ * @param [in] bda The address of the bonded device, as listed by esp_ble_get_bond_device_list.
+ * @return True if the removal was handed to the stack, false otherwise.
+ */
+bool
+BLE_Server::bond_remove(const esp_bd_addr_t bda)
+{
+    auto identity = peer_identity_get(bda);
+    esp_err_t err = esp_ble_remove_bond_device(const_cast<uint8_t*>(bda));
+    if (err)
     {
-        SERVER_LOGE("Connection ID already exists: 0x%04X", param.conn_id);
+        SERVER_LOGE("Bond removal failed: %s (%d)", esp_err_to_name(err), err);
+        return false;
+    }
+
+    if (m_peer_store && identity)
+        m_peer_store->erase(*identity);
+
+    return true;
+}
+
+
+std::optional<BLE_Peer_Store::Address>
+BLE_Server::peer_identity_get(const esp_bd_addr_t bda)
+{
+    int count = esp_ble_get_bond_device_num();
+    if (count <= 0)
+        return {};
+
+    std::vector<esp_ble_bond_dev_t> devices(count);
+    if (esp_ble_get_bond_device_list(&count, devices.data()) != ESP_OK)
+        return {};
+
+    for (int i = 0; i < count; i++)
+    {
+        if (memcmp(devices[i].bd_addr, bda, sizeof(esp_bd_addr_t)) != 0)
+            continue;
+
+        // Peers using private addresses distributed their identity address while bonding.
+        const esp_ble_bond_key_info_t& keys = devices[i].bond_key;
+        const uint8_t* identity = (keys.key_mask & ESP_BLE_ID_KEY_MASK) ? keys.pid_key.static_addr
+                                                                         : devices[i].bd_addr;
+        BLE_Peer_Store::Address address;
+        std::copy(identity, identity + ESP_BD_ADDR_LEN, address.begin());
+        return address;
+    }
+
+    return {};
+}
+
+
+void
+BLE_Server::peer_state_save(uint16_t connection_id)
+{
+    auto connection = m_peer_store ? connection_get(connection_id) : std::nullopt;
+
+    // Only peers which authenticated as a bonded identity can be recognized when they reconnect.
+    if (!connection || !connection->identity)
         return;
+
+    BLE_Peer_Store::peer_state_t state = {};
+    state.database_hash = m_database_hash;
+    state.mtu = connection->mtu;
+    state.interval = connection->interval;
+    state.latency = connection->latency;
+    state.timeout = connection->timeout;
+    for (auto& characteristic : characteristic_get_all())
+    {
+        uint16_t configuration = characteristic->subscription_get(connection_id);
+        if (configuration)
+            state.subscriptions.push_back({characteristic->handle, configuration});
+    }
+
+    if (!m_peer_store->save(*connection->identity, state))
+        SERVER_LOGE("Peer state save failed for 0x%04X", connection_id);
+}
+
+
+std::optional<BLE_Peer_Store::peer_state_t>
+BLE_Server::peer_state_restore(uint16_t connection_id)
+{
+    auto connection = m_peer_store ? connection_get(connection_id) : std::nullopt;
+    if (!connection || !connection->identity)
+        return {};
+
+    auto state = m_peer_store->load(*connection->identity);
+    if (!state)
+        return {};
+
+    {
+        AnchorSemaphore anchor(m_connections_semaphore);
+        auto entry = m_connections.find(connection_id);
+        if (entry != m_connections.end())
+            entry->second.mtu_hint = state->mtu;
+    }
+
+    // Subscriptions refer to handles, which only identify the same characteristics if the
+    // database is laid out exactly as it was when they were saved.
+    if (state->database_hash != m_database_hash)
+    {
+        SERVER_LOGI("Database changed since 0x%04X was connected, subscriptions discarded",
+                    connection_id);
+        state->subscriptions.clear();
     }
 
-    connection_t new_connection;
+    for (auto& subscription : state->subscriptions)
+    {
+        auto characteristic = characteristic_find(subscription.handle);
+        if (characteristic)
+            characteristic->subscription_set(connection_id, subscription.configuration);
+    }
+
+    SERVER_LOGI("Restored %u subscriptions for 0x%04X", state->subscriptions.size(),
+                connection_id);
+    return state;
+}
+
+
+/***************************************************************************************************
+* Event Handling
+***************************************************************************************************/
+void
+BLE_Server::handle_connection_new(const esp_ble_gatts_cb_param_t::gatts_connect_evt_param& param)
+{
+    connection_t new_connection = {};
     new_connection.mtu = MTU_DEFAULT_BLE_CLIENT;
     memcpy(new_connection.bda, param.remote_bda, sizeof(esp_bd_addr_t));
-    m_connections.insert(std::make_pair(param.conn_id, new_connection));
+    bool inserted;
+    {
+        AnchorSemaphore anchor(m_connections_semaphore);
+        inserted = m_connections.insert(std::make_pair(param.conn_id, new_connection)).second;
+    }
+
+    if (!inserted)
+    {
+        SERVER_LOGE("Connection ID already exists: 0x%04X", param.conn_id);
+        return;
+    }
 
+    // The state of a bonded peer is only restored once its link is encrypted, an address alone
+    // can be spoofed.
     esp_ble_conn_update_params_t connection_params;
     connection_params.min_int = m_connection_interval.first;
     connection_params.max_int = m_connection_interval.second;
@@ -519,16 +966,29 @@ BLE_Server::handle_connection_new(const esp_ble_gatts_cb_param_t::gatts_connect_
 void
 BLE_Server::handle_connection_delete(const esp_ble_gatts_cb_param_t::gatts_disconnect_evt_param& param)
 {
-    if (!m_connections.count(param.conn_id))
+    auto connection = connection_get(param.conn_id);
+    if (!connection)
     {
         SERVER_LOGE("Cannot delete nonexistent connection ID 0x%04X", param.conn_id);
         return;
     }
 
-    if(memcmp(m_connections.at(param.conn_id).bda, param.remote_bda, sizeof(esp_bd_addr_t)) != 0)
+    if(memcmp(connection->bda, param.remote_bda, sizeof(esp_bd_addr_t)) != 0)
         SERVER_LOGW("Connection ID 0x%04X BDA miss-match", param.conn_id);
 
-    m_connections.erase(param.conn_id);
+    peer_state_save(param.conn_id);
+    for (auto& characteristic : characteristic_get_all())
+    {
+        characteristic->subscription_clear(param.conn_id);
+        characteristic->stack_prepared_take(param.conn_id);
+    }
+
+    {
+        AnchorSemaphore anchor(m_connections_semaphore);
+        m_connections.erase(param.conn_id);
+    }
+
+    m_transactions.abort(param.conn_id);
 
     SERVER_LOGI("Client disconnected: 0x%04X with reason: 0x%04X", param.conn_id, param.reason);
 
@@ -540,10 +1000,15 @@ BLE_Server::handle_connection_delete(const esp_ble_gatts_cb_param_t::gatts_disco
 void
 BLE_Server::handle_connection_mtu_update(const esp_ble_gatts_cb_param_t::gatts_mtu_evt_param& param)
 {
-    if (!m_connections.count(param.conn_id))
-        return;
+    {
+        AnchorSemaphore anchor(m_connections_semaphore);
+        auto connection = m_connections.find(param.conn_id);
+        if (connection == m_connections.end())
+            return;
+
+        connection->second.mtu = param.mtu;
+    }
 
-    m_connections[param.conn_id].mtu = param.mtu;
     SERVER_LOGI("Connection 0x%04X requested MTU change: %d", param.conn_id, param.mtu);
 }
 
@@ -568,10 +1033,256 @@ BLE_Server::handle_profile_add(esp_gatt_if_t gatts_if,
 }
 
 
+void
+BLE_Server::handle_exec_write(esp_gatt_if_t gatts_if,
+                              const esp_ble_gatts_cb_param_t::gatts_exec_write_evt_param& param)
+{
+    BLE_TRACE_SCOPE(ESP_GATTS_EXEC_WRITE_EVT, 0, param.conn_id, param.trans_id);
+    BLE_ALLOCATION_SCOPE(PREPARED_WRITE);
+    SERVER_LOGD_DEFERRED("Execute write from: %04X, transaction: %u, flag: %d",
+                         param.conn_id,
+                         param.trans_id,
+                         param.exec_write_flag);
+
+    // A queue of which a transaction expired or was rejected can no longer execute whole, and
+    // every transaction is checked before any is committed.
+    esp_gatt_status_t status = (param.exec_write_flag == ESP_GATT_PREP_WRITE_EXEC)
+                               ? m_transactions.verify(param.conn_id) : ESP_GATT_OK;
+
+    // The stack delivers the request to every interface with queued writes and waits for each of
+    // their responses, so only the characteristics served through this interface are handled.
+    std::vector<std::shared_ptr<BLE_Characteristic>> characteristics;
+    for (uint16_t handle : m_transactions.handles(param.conn_id))
+    {
+        std::shared_ptr<BLE_Characteristic> characteristic = characteristic_find(handle);
+        if (!characteristic)
+        {
+            SERVER_LOGW("Queued write to unknown handle 0x%04X discarded", handle);
+            if (status == ESP_GATT_OK)
+                status = ESP_GATT_INVALID_HANDLE;
+        }
+        else if (characteristic->gatts_if == gatts_if)
+        {
+            characteristics.push_back(characteristic);
+        }
+    }
+
+    // Auto response characteristics had their writes queued by the stack.
+    std::vector<std::shared_ptr<BLE_Characteristic>> stack_characteristics;
+    for (auto& characteristic : characteristic_get_all())
+    {
+        if ((characteristic->gatts_if == gatts_if) &&
+            characteristic->stack_prepared_take(param.conn_id))
+            stack_characteristics.push_back(characteristic);
+    }
+
+    // The queue is applied as a whole or not at all. On an error the queues of every interface
+    // are discarded, the stack reports the first error to the client and the other interfaces
+    // then find nothing left to execute.
+    std::vector<std::shared_ptr<BLE_Characteristic>> updated;
+    if ((param.exec_write_flag != ESP_GATT_PREP_WRITE_EXEC) || (status != ESP_GATT_OK))
+    {
+        if (status != ESP_GATT_OK)
+            SERVER_LOGW("Queued writes of 0x%04X discarded, status: 0x%02X", param.conn_id,
+                        status);
+
+        m_transactions.abort(param.conn_id);
+    }
+    else
+    {
+        for (auto& characteristic : characteristics)
+        {
+            auto value = m_transactions.commit(param.conn_id, characteristic->handle);
+            characteristic->handle_exec_write_apply(std::move(*value));
+        }
+
+        updated = characteristics;
+    }
+
+    // The stack executes the writes it queued itself, their values are read back so that the local
+    // copies follow the attributes.
+    if (param.exec_write_flag == ESP_GATT_PREP_WRITE_EXEC)
+    {
+        for (auto& characteristic : stack_characteristics)
+            characteristic->handle_exec_write_pull();
+
+        updated.insert(updated.end(), stack_characteristics.begin(), stack_characteristics.end());
+    }
+
+    // Every value is applied before any callback runs, so callbacks observe the whole update.
+    for (auto& characteristic : updated)
+        characteristic->handle_exec_write_complete();
+
+    // The stack answers for the queue it owns.
+    if (characteristics.empty() && !stack_characteristics.empty())
+        return;
+
+    esp_err_t err = esp_ble_gatts_send_response(gatts_if, param.conn_id, param.trans_id, status,
+                                                nullptr);
+    BLE_TRACE(RESPONSE_SENT, ESP_GATTS_EXEC_WRITE_EVT, 0, param.conn_id, err);
+    if (err)
+        SERVER_LOGE("Write exec response failed: %s (%d)", esp_err_to_name(err), err);
+
+    for (auto& characteristic : characteristics)
+        characteristic->latency_record(BLE_Characteristic::Operation::EXEC_WRITE);
+}
+
+
+void
+BLE_Server::handle_authentication_complete(const esp_ble_auth_cmpl_t& param)
+{
+    auto connection_id = connection_id_find(param.bd_addr);
+    if (!connection_id || !param.success)
+        return;
+
+    // The link is now encrypted with the keys of the bond, so the peer is the identity they belong
+    // to. Peers which paired without bonding have no entry.
+    auto identity = peer_identity_get(param.bd_addr);
+    if (!identity)
+        return;
+
+    BLE_Peer_Store::Address address;
+    std::copy(param.bd_addr, param.bd_addr + ESP_BD_ADDR_LEN, address.begin());
+    auto known = std::find_if(m_peer_identities.begin(), m_peer_identities.end(),
+                              [&](const auto& entry){ return entry.first == address; });
+    if (known == m_peer_identities.end())
+        m_peer_identities.push_back(std::make_pair(address, *identity));
+    else
+        known->second = *identity;
+
+    {
+        AnchorSemaphore anchor(m_connections_semaphore);
+        auto connection = m_connections.find(*connection_id);
+        if (connection == m_connections.end())
+            return;
+
+        connection->second.identity = identity;
+    }
+
+    auto peer_state = peer_state_restore(*connection_id);
+    if (peer_state && peer_state->interval)
+    {
+        esp_ble_conn_update_params_t connection_params;
+        connection_params.min_int = peer_state->interval;
+        connection_params.max_int = peer_state->interval;
+        connection_params.latency = peer_state->latency;
+        connection_params.timeout = peer_state->timeout;
+        memcpy(connection_params.bda, param.bd_addr, sizeof(esp_bd_addr_t));
+        esp_err_t err = esp_ble_gap_update_conn_params(&connection_params);
+        if (err)
+            SERVER_LOGE("Connection parameter update failed: %s (%d)", esp_err_to_name(err), err);
+    }
+
+    // Subscriptions made before bonding completed are persisted along with the restored ones.
+    peer_state_save(*connection_id);
+}
+
+
+void
+BLE_Server::handle_bond_removed(const esp_bd_addr_t bda)
+{
+    BLE_Peer_Store::Address address;
+    std::copy(bda, bda + ESP_BD_ADDR_LEN, address.begin());
+
+    // The bond is already gone, so the identity can only come from an earlier authentication.
+    // Peers which bonded with their identity address are stored under the removed one.
+    BLE_Peer_Store::Address identity = address;
+    auto known = std::find_if(m_peer_identities.begin(), m_peer_identities.end(),
+                              [&](const auto& entry){ return entry.first == address; });
+    if (known != m_peer_identities.end())
+    {
+        identity = known->second;
+        m_peer_identities.erase(known);
+    }
+
+    if (m_peer_store)
+        m_peer_store->erase(identity);
+}
+
+
+std::shared_ptr<BLE_Characteristic>
+BLE_Server::characteristic_find(uint16_t handle)
+{
+    for (auto& profile : m_profiles)
+    {
+        for (auto& service : profile.second->service_get_all())
+        {
+            auto service_instance = service.lock();
+            if (!service_instance)
+                continue;
+
+            auto characteristic = service_instance->characteristic_get(handle).lock();
+            if (characteristic)
+                return characteristic;
+        }
+    }
+
+    return nullptr;
+}
+
+
+std::vector<std::shared_ptr<BLE_Characteristic>>
+BLE_Server::characteristic_get_all(void)
+{
+    std::vector<std::shared_ptr<BLE_Characteristic>> characteristics;
+    for (auto& profile : m_profiles)
+    {
+        for (auto& service : profile.second->service_get_all())
+        {
+            auto service_instance = service.lock();
+            if (!service_instance)
+                continue;
+
+            for (auto& characteristic : service_instance->characteristic_get_all())
+            {
+                auto characteristic_instance = characteristic.lock();
+                if (characteristic_instance)
+                    characteristics.push_back(characteristic_instance);
+            }
+        }
+    }
+
+    return characteristics;
+}
+
+
+std::optional<uint16_t>
+BLE_Server::connection_id_find(const esp_bd_addr_t bda)
+{
+    AnchorSemaphore anchor(m_connections_semaphore);
+    for (auto& connection : m_connections)
+    {
+        if (memcmp(connection.second.bda, bda, sizeof(esp_bd_addr_t)) == 0)
+            return connection.first;
+    }
+
+    return {};
+}
+
+
 void
 BLE_Server::event_handler_gap(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
 {
-    ESP_LOGD(LOG_TAG_BLE_SERVER, "GAP event = %d", event);
+    BLE_REPLAY_CAPTURE_GAP(event, param);
+
+    // Advertisement reports are by far the most frequent GAP event, they skip tracing and logging
+    // and go straight to the scanner.
+    if (event == ESP_GAP_BLE_SCAN_RESULT_EVT)
+    {
+        if (param->scan_rst.search_evt == ESP_GAP_SEARCH_INQ_RES_EVT)
+        {
+            if (m_scanner)
+                m_scanner->report(param->scan_rst);
+        }
+        else if (param->scan_rst.search_evt == ESP_GAP_SEARCH_INQ_CMPL_EVT)
+        {
+            SERVER_LOGI("Scan complete");
+        }
+        return;
+    }
+
+    BLE_TRACE(EVENT_ARRIVAL_GAP, event, 0, 0, 0);
+    SERVER_LOGD_DEFERRED("GAP event = %d", event);
     switch (event) {
         case ESP_GAP_BLE_ADV_DATA_SET_COMPLETE_EVT:
         {
@@ -589,10 +1300,49 @@ BLE_Server::event_handler_gap(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
             }
             else
             {
-                ESP_LOGE(LOG_TAG_BLE_SERVER, "Advertising start failed");
+                SERVER_LOGE("Advertising start failed");
             }
         break;
+        case ESP_GAP_BLE_SCAN_PARAM_SET_COMPLETE_EVT:
+        {
+            if (param->scan_param_cmpl.status != ESP_BT_STATUS_SUCCESS)
+            {
+                SERVER_LOGE("Scan params set failed");
+                break;
+            }
+
+            esp_err_t err = esp_ble_gap_start_scanning(m_scan_duration);
+            if (err)
+                SERVER_LOGE("Could not start scanning");
+        }
+        break;
+        case ESP_GAP_BLE_SCAN_START_COMPLETE_EVT:
+            if (param->scan_start_cmpl.status == ESP_BT_STATUS_SUCCESS)
+                SERVER_LOGI("Scanning started");
+            else
+                SERVER_LOGE("Scanning start failed");
+        break;
+        case ESP_GAP_BLE_SCAN_STOP_COMPLETE_EVT:
+            if (param->scan_stop_cmpl.status == ESP_BT_STATUS_SUCCESS)
+                SERVER_LOGI("Scanning stopped");
+            else
+                SERVER_LOGE("Scanning stop failed");
+        break;
         case ESP_GAP_BLE_UPDATE_CONN_PARAMS_EVT:
+        {
+            auto connection_id = connection_id_find(param->update_conn_params.bda);
+            if (connection_id && (param->update_conn_params.status == ESP_BT_STATUS_SUCCESS))
+            {
+                AnchorSemaphore anchor(m_connections_semaphore);
+                auto connection = m_connections.find(*connection_id);
+                if (connection != m_connections.end())
+                {
+                    connection->second.interval = param->update_conn_params.conn_int;
+                    connection->second.latency = param->update_conn_params.latency;
+                    connection->second.timeout = param->update_conn_params.timeout;
+                }
+            }
+
             SERVER_LOGI("Update connection params status = %d, min_int = %d, max_int = %d, "
                         "conn_int = %d,latency = %d, timeout = %d",
                         param->update_conn_params.status,
@@ -601,6 +1351,14 @@ BLE_Server::event_handler_gap(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
                         param->update_conn_params.conn_int,
                         param->update_conn_params.latency,
                         param->update_conn_params.timeout);
+        }
+        break;
+        case ESP_GAP_BLE_AUTH_CMPL_EVT:
+            handle_authentication_complete(param->ble_security.auth_cmpl);
+        break;
+        case ESP_GAP_BLE_REMOVE_BOND_DEV_COMPLETE_EVT:
+            if (param->remove_bond_dev_cmpl.status == ESP_BT_STATUS_SUCCESS)
+                handle_bond_removed(param->remove_bond_dev_cmpl.bd_addr);
         break;
         default:
         break;
@@ -611,7 +1369,12 @@ BLE_Server::event_handler_gap(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
 void BLE_Server::event_handler_gatts(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
                                      esp_ble_gatts_cb_param_t *param)
 {
-    SERVER_LOGD("GATTS event = %d, inf = 0x%04X", event, gatts_if);
+    // All GATTS events are dispatched from the BT task, so a single timestamp suffices.
+    event_timestamp = esp_timer_get_time();
+    BLE_TRACE(EVENT_ARRIVAL_GATTS, event, 0, 0, gatts_if);
+    BLE_REPLAY_CAPTURE_GATTS(event, gatts_if, param);
+    BLE_ALLOCATION_SCOPE(DISPATCH);
+    SERVER_LOGD_DEFERRED("GATTS event = %d, inf = 0x%04X", event, gatts_if);
 
     switch (event)
     {
@@ -631,9 +1394,16 @@ void BLE_Server::event_handler_gatts(esp_gatts_cb_event_t event, esp_gatt_if_t g
             handle_connection_delete(param->disconnect);
             goto forward;
         break;
+        case ESP_GATTS_EXEC_WRITE_EVT:
+            handle_exec_write(gatts_if, param->exec_write);
+        break;
+        case ESP_GATTS_SEND_SERVICE_CHANGE_EVT:
+            if (param->service_change.status != ESP_GATT_OK)
+                SERVER_LOGW("Service changed indication failed: 0x%02X",
+                            param->service_change.status);
+        break;
         case ESP_GATTS_MTU_EVT:
             handle_connection_mtu_update(param->mtu);
-        case ESP_GATTS_EXEC_WRITE_EVT:
         case ESP_GATTS_READ_EVT:
         case ESP_GATTS_WRITE_EVT:
         default:
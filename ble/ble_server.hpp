@@ -20,8 +20,10 @@
 #ifndef COMPONENT_BLE_BLE_SERVER
 #define COMPONENT_BLE_BLE_SERVER
 
+#include <atomic>
 #include <cstdint>
 #include <memory>
+#include <new>
 #include <optional>
 #include <string>
 #include <tuple>
@@ -32,10 +34,17 @@
 #include "esp_gap_ble_api.h"
 #include "esp_gatt_common_api.h"
 #include "esp_gatts_api.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
 #include "utilities.hpp"
 
+#include "ble_database.hpp"
+#include "ble_peer.hpp"
 #include "ble_profile.hpp"
+#include "ble_scanner.hpp"
 #include "ble_service.hpp"
+#include "ble_throughput.hpp"
+#include "ble_transaction.hpp"
 #include "ble_utilities.hpp"
 
 
@@ -49,6 +58,14 @@ struct connection_t
 {
     esp_bd_addr_t bda;
     uint16_t mtu;
+    // The MTU negotiated during the previous connection of a bonded peer, 0 if unknown.
+    uint16_t mtu_hint;
+    // The current connection parameters, 0 until the first update is reported.
+    uint16_t interval;
+    uint16_t latency;
+    uint16_t timeout;
+    // The identity address of a bonded peer, known once the link is encrypted with its keys.
+    std::optional<BLE_Peer_Store::Address> identity;
 };
 
 
@@ -94,6 +111,33 @@ public:
      */
     void advertising_stop(void);
 
+    /**
+     * @brief Starts scanning for advertisements, see scanner_get to consume them.
+     * @detail The controller's duplicate filter is disabled, the scanner deduplicates on the
+     *         payload instead so that devices changing their advertising data are still reported.
+     * @param [in] duration_s (default=0) The duration of the scan in seconds, 0 scans until
+     *                        scan_stop is called.
+     * @param [in] active (default=true) Requests scan responses from scannable advertisers.
+     * @param [in] interval (default=0x50) The scan interval. Range: 0x0004 to 0x4000.
+     *                      Time = N * 0.625 msec.
+     * @param [in] window (default=0x30) The scan window, no longer than the interval.
+     *                    Range: 0x0004 to 0x4000. Time = N * 0.625 msec.
+     * @return True if the operation succeeds, false otherwise.
+     */
+    bool scan_start(uint32_t duration_s=0, bool active=true, uint16_t interval=0x50,
+                    uint16_t window=0x30);
+
+    /**
+     * @brief Stops scanning for advertisements, queued advertisements remain available.
+     */
+    void scan_stop(void);
+
+    /**
+     * @brief Retrieves the scanner receiving the advertisements.
+     * @return A shared pointer to the scanner, nullptr until scan_start is first called.
+     */
+    std::shared_ptr<BLE_Scanner> scanner_get(void);
+
     /**
      * @brief Adds a profile to the BLE Server.
      * @detail BLE Profiles are designed to help separate and compartmentalise application
@@ -137,6 +181,73 @@ public:
      */
     std::optional<connection_t> connection_get(uint16_t connection_id);
 
+    /**
+     * @brief Describes a link of this server to the throughput model, see BLE_Throughput.
+     * @param [in] connection_id (default=std::nullopt) A connection whose negotiated MTU and
+     *                           parameters are described, otherwise the configured ones are. The
+     *                           longest configured interval is used, the client picks any of them.
+     * @return The link, the packets per event, data length and PHY keep the model's defaults.
+     */
+    BLE_Throughput::link_t throughput_link_get(std::optional<uint16_t> connection_id=std::nullopt);
+
+    /**
+     * @brief Retrieves the time at which the GATTS event currently being dispatched arrived.
+     * @note Only meaningful when called from within the event dispatch path.
+     * @return The arrival time in microseconds since boot, as reported by esp_timer_get_time.
+     */
+    static int64_t event_timestamp_get(void);
+
+    /**
+     * @brief Sets the limits applied to prepared (queued) write transactions.
+     * @detail Requests that would exceed a limit are answered with ESP_GATT_PREPARE_Q_FULL and
+     *         their transaction is discarded.
+     * @param [in] limits The global byte budget, per connection cap and time-to-live.
+     */
+    void transaction_limits_set(const BLE_Transaction_Manager::limits_t& limits);
+
+    /**
+     * @brief Retrieves the prepared write transaction counters.
+     * @return A copy of the counters.
+     */
+    BLE_Transaction_Manager::metrics_t transaction_metrics_get(void) const;
+
+    /**
+     * @brief Adds a service exposing the Database Hash characteristic to a profile.
+     * @detail The characteristic is answered by the stack and updated whenever the layout of the
+     *         database changes. It lives in a vendor service because the stack already
+     *         registers the GATT service, of which a server may only expose one. Clients read
+     *         the hash by UUID over the whole handle range, so they find it all the same.
+     * @param [in] profile_id The ID of the profile to add the service to.
+     * @return True on success, false otherwise.
+     */
+    bool database_service_add(uint16_t profile_id);
+
+    /**
+     * @brief Computes the hash of the current layout of the GATT database.
+     * @return The hash over every service and characteristic declaration of every profile.
+     */
+    BLE_Database_Hash::Hash database_hash_get(void);
+
+    /**
+     * @brief Sets the store which keeps the state of bonded peers across connections.
+     * @detail The subscriptions, MTU and connection parameters of a bonded peer are saved whenever
+     *         it changes its subscriptions and when it disconnects, and restored as soon as it
+     *         reconnects so that notifications flow without the client rewriting its descriptors.
+     *         The state of a peer is erased when its bond is removed.
+     * @param [in] store The store to use, nullptr disables persistence.
+     */
+    void peer_store_set(std::shared_ptr<BLE_Peer_Store> store);
+
+    /**
+     * @brief Removes the bond of a peer along with its stored state.
+     * @detail The state is keyed by the identity address of the peer, which can only be looked up
+     *         while the bond exists. Bonds removed with esp_ble_remove_bond_device directly only
+     *         have their state erased if the peer authenticated since the server started.
+     * @param [in] bda The address of the bonded device, as listed by esp_ble_get_bond_device_list.
+     * @return True if the removal was handed to the stack, false otherwise.
+     */
+    bool bond_remove(const esp_bd_addr_t bda);
+
     /**
      * @brief Sets the device information that can be seen by external scanners
      * @param [in] dev_name The device name.
@@ -173,6 +284,12 @@ public:
                                    uint16_t timeout);
 
 private:
+    friend class BLE_Benchmark;
+    friend class BLE_Characteristic;
+    friend class BLE_Profile;
+    friend class BLE_Replay;
+    friend class BLE_Service;
+
     enum class OP
     {
         PROFILE_ADD,
@@ -185,7 +302,13 @@ private:
     using Connection_Map = std::unordered_map<uint16_t, connection_t>;
 
 
-    BLE_Server(void) {}
+    BLE_Server(void)
+    {
+        if (m_connections_semaphore == nullptr)
+            throw std::bad_alloc();
+
+        xSemaphoreGive(m_connections_semaphore);
+    }
 
     esp_ble_adv_data_t adv_data_gen(void);
     esp_ble_adv_params_t adv_params_gen(void);
@@ -195,6 +318,23 @@ private:
     void handle_connection_new(const esp_ble_gatts_cb_param_t::gatts_connect_evt_param& param);
     void handle_connection_delete(const esp_ble_gatts_cb_param_t::gatts_disconnect_evt_param& param);
     void handle_connection_mtu_update(const esp_ble_gatts_cb_param_t::gatts_mtu_evt_param& param);
+    void handle_exec_write(esp_gatt_if_t gatts_if,
+                           const esp_ble_gatts_cb_param_t::gatts_exec_write_evt_param& param);
+    void handle_authentication_complete(const esp_ble_auth_cmpl_t& param);
+    void handle_bond_removed(const esp_bd_addr_t bda);
+
+    std::shared_ptr<BLE_Characteristic> characteristic_find(uint16_t handle);
+
+    std::optional<BLE_Peer_Store::Address> peer_identity_get(const esp_bd_addr_t bda);
+    void peer_state_save(uint16_t connection_id);
+    std::optional<BLE_Peer_Store::peer_state_t> peer_state_restore(uint16_t connection_id);
+    std::optional<uint16_t> connection_id_find(const esp_bd_addr_t bda);
+    std::vector<std::shared_ptr<BLE_Characteristic>> characteristic_get_all(void);
+
+    void database_batch_begin(void);
+    void database_batch_end(void);
+    void database_changed(void);
+    void database_hash_publish(void);
 
     void event_handler_gap(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param);
     void event_handler_gatts(esp_gatts_cb_event_t event, esp_gatt_if_t inf,
@@ -202,6 +342,7 @@ private:
 
 
     static std::weak_ptr<BLE_Server>    instance;
+    static int64_t                      event_timestamp;
 
     BLE_Server::State                   m_state = BLE_Server::State::STOPPED;
 
@@ -214,9 +355,22 @@ private:
     uint16_t                            m_connection_timeout = 400;
 
     Profile_Map                         m_profiles;
+    // Written by the BT task only, read from any task through connection_get.
     Connection_Map                      m_connections;
+    SemaphoreHandle_t                   m_connections_semaphore = xSemaphoreCreateBinary();
+    BLE_Transaction_Manager             m_transactions;
+    BLE_Database_Hash::Hash             m_database_hash = {};
+    std::weak_ptr<BLE_Characteristic>   m_database_hash_characteristic;
+    std::atomic<uint32_t>               m_database_batch_depth{0};
+    std::atomic<bool>                   m_database_batch_pending{false};
+    std::shared_ptr<BLE_Peer_Store>     m_peer_store;
+    // The identity of every peer which authenticated, by the address the stack reports it under,
+    // so that its state can be found once the bond is gone. Only accessed from the BT task.
+    std::vector<std::pair<BLE_Peer_Store::Address, BLE_Peer_Store::Address>> m_peer_identities;
     Notification_Manager<uint16_t, OP>  m_notification_mgr;
     std::vector<uint8_t>                m_adv_uuids;
+    std::shared_ptr<BLE_Scanner>        m_scanner;
+    uint32_t                            m_scan_duration = 0;
     uint16_t                            m_server_mtu = MTU_DEFAULT_BLE_SERVER;
 };
 
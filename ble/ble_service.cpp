@@ -28,6 +28,9 @@
 
 #include "ble_service.hpp"
 #include "ble_profile.hpp"
+#include "ble_log.hpp"
+#include "ble_server.hpp"
+#include "ble_utilities.hpp"
 #include "types.hpp"
 
 namespace BLE
@@ -42,8 +45,19 @@ constexpr const char* LOG_TAG_BLE_SERVICE = "BLE Service";
 /***************************************************************************************************
 * Logging Macros
 ***************************************************************************************************/
+#define SERVICE_LOG_LEVEL CONFIG_BLE_REDUX_LOG_LEVEL_SERVICE
+
 #define SERVICE_LOG(LVL, MSG, ...)\
-    INTANCE_LOG(LVL, LOG_TAG_BLE_SERVICE, "%04X --", this->handle, MSG, ##__VA_ARGS__)
+    BLE_LOG(SERVICE_LOG_LEVEL, LVL, LOG_TAG_BLE_SERVICE, "%04X --", this->handle,\
+            MSG, ##__VA_ARGS__)
+
+#ifdef CONFIG_BLE_REDUX_LOG_DEFERRED
+#define SERVICE_LOG_DEFERRED(LVL, MSG, ...)\
+    BLE_LOG_DEFERRED(SERVICE_LOG_LEVEL, LVL, LOG_TAG_BLE_SERVICE, "%04X -- " MSG, this->handle,\
+                     ##__VA_ARGS__)
+#else
+#define SERVICE_LOG_DEFERRED(LVL, MSG, ...) SERVICE_LOG(LVL, MSG, ##__VA_ARGS__)
+#endif
 
 #define SERVICE_LOGE(MSG, ...) SERVICE_LOG(ESP_LOG_ERROR, MSG, ##__VA_ARGS__)
 #define SERVICE_LOGW(MSG, ...) SERVICE_LOG(ESP_LOG_WARN, MSG, ##__VA_ARGS__)
@@ -51,6 +65,9 @@ constexpr const char* LOG_TAG_BLE_SERVICE = "BLE Service";
 #define SERVICE_LOGD(MSG, ...) SERVICE_LOG(ESP_LOG_DEBUG, MSG, ##__VA_ARGS__)
 #define SERVICE_LOGV(MSG, ...) SERVICE_LOG(ESP_LOG_VERBOSE, MSG, ##__VA_ARGS__)
 
+#define SERVICE_LOGD_DEFERRED(MSG, ...) SERVICE_LOG_DEFERRED(ESP_LOG_DEBUG, MSG, ##__VA_ARGS__)
+#define SERVICE_LOGV_DEFERRED(MSG, ...) SERVICE_LOG_DEFERRED(ESP_LOG_VERBOSE, MSG, ##__VA_ARGS__)
+
 
 /***************************************************************************************************
 * Service Member Functions
@@ -126,11 +143,15 @@ BLE_Service::service_start(bool blocking)
  *                                     complete by the time the call completes, in that case callers
  *                                     should use the event mechanism to determine when the call
  *                                     has finished execution.
+ * @param [in] auto_response (default=false) Lets the BLE stack answer read and write requests
+ *                           from its own copy of the value. Reads of such a characteristic never
+ *                           reach the application, which suits static and slowly changing values;
+ *                           value_set pushes changes to the stack.
  * @returns True on success, false otherwise.
  */
 bool
 BLE_Service::characteristic_add(UUID uuid, esp_gatt_char_prop_t properties,
-                                esp_gatt_perm_t permissions, bool blocking)
+                                esp_gatt_perm_t permissions, bool blocking, bool auto_response)
 {
     {
         AnchorSemaphore anchor(m_characteristics_map_semaphore);
@@ -144,8 +165,18 @@ BLE_Service::characteristic_add(UUID uuid, esp_gatt_char_prop_t properties,
 
     auto creation_function = [&, this](){
         esp_bt_uuid_t esp_uuid = uuid.to_esp_uuid();
-        esp_err_t err = esp_ble_gatts_add_char(handle, &esp_uuid, permissions, properties,
-                                               nullptr, nullptr);
+
+        // The stack copies the initial value, so an empty one can be shared by all
+        // characteristics. The maximum length reserves room for any later value.
+        static uint8_t empty_value[1] = {};
+        esp_attr_value_t initial_value = {ATT_ATTRIBUTE_LENGTH_MAX, 0, empty_value};
+        esp_attr_control_t control = {ESP_GATT_AUTO_RSP};
+
+        esp_err_t err = auto_response
+                        ? esp_ble_gatts_add_char(handle, &esp_uuid, permissions, properties,
+                                                 &initial_value, &control)
+                        : esp_ble_gatts_add_char(handle, &esp_uuid, permissions, properties,
+                                                 nullptr, nullptr);
         if (err)
         {
             AnchorSemaphore anchor(m_characteristics_map_semaphore);
@@ -161,8 +192,9 @@ BLE_Service::characteristic_add(UUID uuid, esp_gatt_char_prop_t properties,
 
     {
         AnchorSemaphore anchor(m_characteristics_map_semaphore);
-        m_characteristics_creation.insert(std::make_pair(uuid, std::make_pair(properties,
-                                                                              permissions)));
+        m_characteristics_creation.insert(std::make_pair(uuid, std::make_tuple(properties,
+                                                                               permissions,
+                                                                               auto_response)));
     }
 
     if(!blocking)
@@ -199,6 +231,41 @@ BLE_Service::characteristic_get(UUID uuid)
 }
 
 
+/**
+ * @brief Retrieves a characteristic that is defined on this service.
+ * @note This function is thread safe.
+ * @param [in] handle The handle of the characteristic of interest
+ * @return A weak pointer to the BLE_Characteristic if the handle is valid, else a default
+ *         constructed weak pointer (nullptr).
+ */
+std::weak_ptr<BLE_Characteristic>
+BLE_Service::characteristic_get(uint16_t handle)
+{
+    AnchorSemaphore anchor(m_characteristics_map_semaphore);
+    if (!m_characteristics_handle.count(handle))
+        return {};
+
+    return m_characteristics_handle.at(handle);
+}
+
+
+/**
+ * @brief Retrieves all characteristics defined on this service.
+ * @note This function is thread safe.
+ * @return A vector of weak pointers to the BLE_Characteristic objects of this service.
+ */
+std::vector<std::weak_ptr<BLE_Characteristic>>
+BLE_Service::characteristic_get_all(void)
+{
+    AnchorSemaphore anchor(m_characteristics_map_semaphore);
+    std::vector<std::weak_ptr<BLE_Characteristic>> ret;
+    for (auto characteristic : m_characteristics_handle)
+        ret.push_back(characteristic.second);
+
+    return ret;
+}
+
+
 /***************************************************************************************************
 * Event Handling
 ***************************************************************************************************/
@@ -260,26 +327,87 @@ BLE_Service::handle_characteristic_create(const esp_ble_gatts_cb_param_t::gatts_
         return;
     }
 
-    AnchorSemaphore anchor(m_characteristics_map_semaphore);
-    auto creation_data = m_characteristics_creation[uuid];
-    auto characteristic = std::make_shared<BLE_Characteristic>(uuid, param.attr_handle,
-                                                               gatts_if,
-                                                               self_ptr,
-                                                               creation_data.first,
-                                                               creation_data.second);
-
-
-    m_characteristics_uuid.insert(std::make_pair(uuid, characteristic));
-    m_characteristics_handle.insert(std::make_pair(param.attr_handle, characteristic));
-    m_characteristics_creation.erase(uuid);
-    m_notification_mgr.notify(uuid, OP::CHARACTERISTIC_ADD, true);
+    std::shared_ptr<BLE_Characteristic> characteristic;
+    {
+        AnchorSemaphore anchor(m_characteristics_map_semaphore);
+        auto creation_data = m_characteristics_creation[uuid];
+        characteristic = std::make_shared<BLE_Characteristic>(uuid, param.attr_handle,
+                                                              gatts_if,
+                                                              self_ptr,
+                                                              std::get<0>(creation_data),
+                                                              std::get<1>(creation_data),
+                                                              std::get<2>(creation_data));
+
+
+        m_characteristics_uuid.insert(std::make_pair(uuid, characteristic));
+        m_characteristics_handle.insert(std::make_pair(param.attr_handle, characteristic));
+        m_characteristics_creation.erase(uuid);
+    }
+
+    // Characteristics which notify or indicate need a Client Characteristic Configuration
+    // descriptor, the creation only completes once it has been added.
+    if (characteristic->properties & (ESP_GATT_CHAR_PROP_BIT_NOTIFY |
+                                      ESP_GATT_CHAR_PROP_BIT_INDICATE))
+    {
+        esp_bt_uuid_t descriptor_uuid;
+        descriptor_uuid.len = ESP_UUID_LEN_16;
+        descriptor_uuid.uuid.uuid16 = ESP_GATT_UUID_CHAR_CLIENT_CONFIG;
+
+        m_descriptor_pending = characteristic;
+        esp_err_t err = esp_ble_gatts_add_char_descr(handle, &descriptor_uuid,
+                                                     ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE,
+                                                     nullptr, nullptr);
+        if (!err)
+            return;
+
+        m_descriptor_pending.reset();
+        SERVICE_LOGE("Configuration descriptor creation failed for %s: %s (%d)",
+                     uuid.to_string().c_str(), esp_err_to_name(err), err);
+    }
+
+    characteristic_create_complete(characteristic);
+}
+
+
+inline
+void
+BLE_Service::handle_descriptor_create(const esp_ble_gatts_cb_param_t::gatts_add_char_descr_evt_param& param)
+{
+    std::shared_ptr<BLE_Characteristic> characteristic = std::move(m_descriptor_pending);
+    m_descriptor_pending.reset();
+    if (!characteristic)
+    {
+        SERVICE_LOGE("Received unsolicited descriptor creation event: 0x%04X", param.attr_handle);
+        return;
+    }
+
+    if (param.status == ESP_GATT_OK)
+        characteristic->m_configuration_handle = param.attr_handle;
+    else
+        SERVICE_LOGE("Configuration descriptor creation failed for %s: 0x%02X",
+                     characteristic->uuid.to_string().c_str(), param.status);
+
+    characteristic_create_complete(characteristic);
+}
+
+
+void
+BLE_Service::characteristic_create_complete(const std::shared_ptr<BLE_Characteristic>& characteristic)
+{
+    // The hash walks every service, so the map semaphore must not be held.
+    auto profile_instance = profile.lock();
+    auto server_instance = profile_instance ? profile_instance->server.lock() : nullptr;
+    if (server_instance)
+        server_instance->database_changed();
+
+    m_notification_mgr.notify(characteristic->uuid, OP::CHARACTERISTIC_ADD, true);
 }
 
 void
 BLE_Service::service_event_handler_gatts(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
                                          esp_ble_gatts_cb_param_t *param)
 {
-    SERVICE_LOGV("GATTS event = %d, inf = 0x%04X", event, gatts_if);
+    SERVICE_LOGV_DEFERRED("GATTS event = %d, inf = 0x%04X", event, gatts_if);
     if (gatts_if != this->gatts_if)
     {
         SERVICE_LOGE("Invalid inf received: 0x%04X", gatts_if);
@@ -303,6 +431,10 @@ BLE_Service::service_event_handler_gatts(esp_gatts_cb_event_t event, esp_gatt_if
         case ESP_GATTS_ADD_CHAR_EVT:
             handle_characteristic_create(param->add_char);
         break;
+        case ESP_GATTS_ADD_CHAR_DESCR_EVT:
+            if (param->add_char_descr.service_handle == handle)
+                handle_descriptor_create(param->add_char_descr);
+        break;
         default:
             for (auto characteristic : m_characteristics_uuid)
                 characteristic.second->characteristic_event_handler_gatts(event, gatts_if, param);
@@ -21,7 +21,9 @@
 #define COMPONENTS_BLE_BLE_SERVICE_HPP
 
 #include <cstdint>
+#include <tuple>
 #include <unordered_map>
+#include <vector>
 
 #include "esp_gatts_api.h"
 #include "esp_gatt_defs.h"
@@ -78,10 +80,15 @@ public:
      *                                     complete by the time the call completes, in that case
      *                                     callers should use the event mechanism to determine when
      *                                     the call has finished execution.
+     * @param [in] auto_response (default=false) Lets the BLE stack answer read and write requests
+     *                           from its own copy of the value. Reads of such a characteristic
+     *                           never reach the application, which suits static and slowly
+     *                           changing values; value_set pushes changes to the stack.
      * @returns True on success, false otherwise.
      */
     bool characteristic_add(UUID uuid, esp_gatt_char_prop_t properties,
-                            esp_gatt_perm_t permissions, bool blocking=true);
+                            esp_gatt_perm_t permissions, bool blocking=true,
+                            bool auto_response=false);
 
     /**
      * @brief Retrieves a characteristic that is defined on this service.
@@ -95,12 +102,18 @@ public:
     /**
      * @brief Retrieves a characteristic that is defined on this service.
      * @note This function is thread safe.
-     * @param [in] uuid The UUID of the characteristic of interest
-     * @return A weak pointer to the BLE_Characteristic if the uuid is valid, else a default constructed
-     *          weak pointer (nullptr).
+     * @param [in] handle The handle of the characteristic of interest
+     * @return A weak pointer to the BLE_Characteristic if the handle is valid, else a default
+     *         constructed weak pointer (nullptr).
      */
     std::weak_ptr<BLE_Characteristic> characteristic_get(uint16_t handle);
 
+    /**
+     * @brief Retrieves all characteristics defined on this service.
+     * @note This function is thread safe.
+     * @return A vector of weak pointers to the BLE_Characteristic objects of this service.
+     */
+    std::vector<std::weak_ptr<BLE_Characteristic>> characteristic_get_all(void);
 
     /**
      * @brief A function used internally by the framework to signal events to the profile.
@@ -119,6 +132,8 @@ public:
     bool                                advertise;
 
 private:
+    friend class BLE_Benchmark;
+
     enum class OP
     {
         SERVICE_START,
@@ -128,11 +143,14 @@ private:
 
     using Characteristic_Map_UUID = std::unordered_map<UUID, std::shared_ptr<BLE_Characteristic>>;
     using Characteristic_Map_Handle = std::unordered_map<uint16_t, std::shared_ptr<BLE_Characteristic>>;
-    using Characteristic_Creation_Map = std::unordered_map<UUID, std::pair<esp_gatt_char_prop_t,
-                                                           esp_gatt_perm_t>>;
+    using Characteristic_Creation_Map = std::unordered_map<UUID, std::tuple<esp_gatt_char_prop_t,
+                                                                            esp_gatt_perm_t,
+                                                                            bool>>;
 
 
     void handle_characteristic_create(const esp_ble_gatts_cb_param_t::gatts_add_char_evt_param& param);
+    void handle_descriptor_create(const esp_ble_gatts_cb_param_t::gatts_add_char_descr_evt_param& param);
+    void characteristic_create_complete(const std::shared_ptr<BLE_Characteristic>& characteristic);
 
 
     BLE_Service::Status             m_status = BLE_Service::Status::STOPED;
@@ -140,6 +158,8 @@ private:
     Characteristic_Map_UUID         m_characteristics_uuid;
     Characteristic_Map_Handle       m_characteristics_handle;
     Characteristic_Creation_Map     m_characteristics_creation;
+    // The stack attaches descriptors to the characteristic added last, so only one can be pending.
+    std::shared_ptr<BLE_Characteristic> m_descriptor_pending;
 
     Notification_Manager<UUID, OP>  m_notification_mgr;
     SemaphoreHandle_t               m_characteristics_map_semaphore = xSemaphoreCreateBinary();
@@ -0,0 +1,266 @@
+/**
+ * @file   ble_throughput.cpp
+ *
+ * @brief  Analytic model of the goodput and latency of a BLE link.
+ * @detail Predicts how many values per second a characteristic workload can move over a link of a
+ *         given MTU, connection interval, slave latency and packets per connection event, and how
+ *         long each value waits to be delivered. A discrete simulation of the connection events
+ *         built on the same rules validates the model. Neither depends on ESP-IDF, so that the
+ *         planner in tools/ also builds on the host.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <random>
+
+#include "ble_throughput.hpp"
+
+namespace BLE
+{
+
+// The opcode and handle of the ATT PDU, then the length and channel of the L2CAP header.
+constexpr const uint16_t THROUGHPUT_ATT_HEADER_LENGTH = 3;
+constexpr const uint16_t THROUGHPUT_L2CAP_HEADER_LENGTH = 4;
+// The inter frame space between two packets of a connection event.
+constexpr const uint32_t THROUGHPUT_IFS_US = 150;
+// The shortest connection interval the specification allows, 7.5 msec.
+constexpr const uint16_t THROUGHPUT_INTERVAL_MIN = 6;
+
+
+static uint32_t
+ceil_div(uint32_t numerator, uint32_t denominator)
+{
+    return (numerator + denominator - 1) / denominator;
+}
+
+
+/**
+ * @brief Computes the time a link layer data packet occupies the air.
+ * @param [in] payload The link layer payload length in bytes.
+ * @param [in] phy The PHY of the link.
+ * @return The air time in microseconds.
+ */
+uint32_t
+BLE_Throughput::packet_airtime_us(uint16_t payload, PHY phy)
+{
+    // Preamble, access address, header and CRC around the payload, the preamble of the 2M PHY is
+    // one byte longer.
+    if (phy == PHY::LE_2M)
+        return (11 + payload) * 4;
+
+    return (10 + payload) * 8;
+}
+
+
+BLE_Throughput::schedule_t
+BLE_Throughput::schedule_get(const link_t& link, const workload_t& workload)
+{
+    schedule_t schedule;
+    uint16_t value_max = std::max<int>(link.mtu - THROUGHPUT_ATT_HEADER_LENGTH, 0);
+    uint8_t data_length = std::clamp(link.data_length, DATA_LENGTH_DEFAULT, DATA_LENGTH_MAX);
+
+    schedule.value_length = std::min(workload.value_length, value_max);
+    schedule.fragments = ceil_div(schedule.value_length + THROUGHPUT_ATT_HEADER_LENGTH +
+                                  THROUGHPUT_L2CAP_HEADER_LENGTH, data_length);
+    schedule.interval_us = std::max(link.interval, THROUGHPUT_INTERVAL_MIN) * INTERVAL_UNIT_US;
+    schedule.exchange_us = packet_airtime_us(data_length, link.phy) + THROUGHPUT_IFS_US +
+                           packet_airtime_us(0, link.phy) + THROUGHPUT_IFS_US;
+
+    // Long packets at short intervals run out of air time before the controller's limit.
+    schedule.budget = std::max<uint32_t>(1, std::min<uint32_t>(link.packets_per_event,
+                                         schedule.interval_us / schedule.exchange_us));
+
+    // An idle peripheral only listens to every (latency + 1)th event, which delays whatever the
+    // client sends it. Its own notifications go out at the next event.
+    schedule.idle_events = (workload.direction == Direction::NOTIFY) ? 1 : (link.latency + 1);
+    return schedule;
+}
+
+
+/**
+ * @brief Predicts the capacity of a link and the latency of a workload analytically.
+ * @param [in] link The parameters of the link.
+ * @param [in] workload The characteristic workload.
+ * @return The prediction.
+ */
+BLE_Throughput::prediction_t
+BLE_Throughput::predict(const link_t& link, const workload_t& workload)
+{
+    schedule_t schedule = schedule_get(link, workload);
+    prediction_t prediction = {};
+    prediction.fits = (schedule.value_length == workload.value_length);
+    prediction.fragments = schedule.fragments;
+
+    // Fragments of consecutive values share connection events, except for write requests which
+    // wait for their response in the following event.
+    uint32_t value_events = ceil_div(schedule.fragments, schedule.budget);
+    if (workload.direction == Direction::WRITE)
+        prediction.values_per_second_max = 1e6 / ((value_events + 1) * schedule.interval_us);
+    else
+        prediction.values_per_second_max = (1e6 * schedule.budget) /
+                                           (static_cast<double>(schedule.interval_us) *
+                                            schedule.fragments);
+
+    prediction.goodput_max_bytes_per_second = prediction.values_per_second_max *
+                                              schedule.value_length;
+    if (workload.rate_hz <= 0)
+    {
+        prediction.utilization = 1;
+        return prediction;
+    }
+
+    prediction.utilization = workload.rate_hz / prediction.values_per_second_max;
+    prediction.stable = prediction.utilization < 1;
+    if (!prediction.stable)
+        return prediction;
+
+    // A value waits for the next event the receiver listens to, then for its own fragments. A
+    // receiver given a value about every event rarely goes idle, but a single gap lets it sleep.
+    bool idle = (workload.rate_hz * schedule.interval_us) < 1e6;
+    uint32_t sleep_us = schedule.idle_events * schedule.interval_us;
+    uint32_t wake_us = idle ? sleep_us : schedule.interval_us;
+    auto service_us = [&](uint32_t packets){
+        uint32_t events = ceil_div(packets, schedule.budget);
+        return (events - 1) * schedule.interval_us +
+               (packets - (events - 1) * schedule.budget) * schedule.exchange_us;
+    };
+
+    // Values produced while the receiver sleeps go out back to back once it wakes up. A jittery
+    // producer may queue one more value than its rate implies.
+    auto batch_get = [&](uint32_t period_us){
+        return std::max<uint32_t>(1, std::ceil(workload.rate_hz * period_us / 1e6));
+    };
+
+    auto batch_us = [&](uint32_t values){
+        if (workload.direction == Direction::WRITE)
+            return service_us(schedule.fragments) +
+                   (values - 1) * (value_events + 1) * schedule.interval_us;
+
+        return service_us(values * schedule.fragments);
+    };
+
+    uint32_t single_us = batch_us(1);
+    prediction.latency_mean_us = (wake_us / 2) + single_us +
+                                 ((batch_us(batch_get(wake_us)) - single_us) / 2);
+    prediction.latency_max_us = sleep_us + batch_us(batch_get(sleep_us) + 1);
+    return prediction;
+}
+
+
+/**
+ * @brief Simulates a workload event by event over a link, for validating predict.
+ * @param [in] link The parameters of the link.
+ * @param [in] workload The characteristic workload.
+ * @param [in] duration_ms (default=60000) The simulated time.
+ * @param [in] seed (default=1) Seeds the phase of the producer against the connection events.
+ * @return The measured values, in the form of a prediction.
+ */
+BLE_Throughput::prediction_t
+BLE_Throughput::simulate(const link_t& link, const workload_t& workload, uint32_t duration_ms,
+                         uint32_t seed)
+{
+    schedule_t schedule = schedule_get(link, workload);
+    prediction_t result = {};
+    result.fits = (schedule.value_length == workload.value_length);
+    result.fragments = schedule.fragments;
+
+    // Values are produced once per period at a random point within it, real producers are not
+    // locked to the connection events.
+    bool saturated = workload.rate_hz <= 0;
+    double period_us = saturated ? 0 : 1e6 / workload.rate_hz;
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<double> jitter(0, period_us);
+    uint64_t period = 0;
+    double arrival_us = saturated ? 0 : jitter(random);
+
+    std::deque<double> queue;
+    uint32_t remaining = schedule.fragments;
+    uint64_t completed = 0;
+    double latency_total_us = 0;
+    double latency_max_us = 0;
+    uint64_t write_next_event = 0;
+    bool awake = false;
+
+    double duration_us = duration_ms * 1e3;
+    for (uint64_t event = 0; (event * schedule.interval_us) < duration_us; event++)
+    {
+        double event_us = static_cast<double>(event) * schedule.interval_us;
+        if (saturated)
+        {
+            if (queue.empty())
+                queue.push_back(event_us);
+        }
+        else
+        {
+            for (; arrival_us <= event_us; arrival_us = (++period * period_us) + jitter(random))
+                queue.push_back(arrival_us);
+        }
+
+        bool usable = awake || ((event % schedule.idle_events) == 0);
+        if (workload.direction == Direction::WRITE)
+            usable = usable && (event >= write_next_event);
+
+        uint32_t sent = 0;
+        while (usable && !queue.empty() && (sent < schedule.budget))
+        {
+            uint32_t packets = std::min(schedule.budget - sent, remaining);
+            remaining -= packets;
+            sent += packets;
+            if (remaining)
+                break;
+
+            double latency_us = event_us + (sent * schedule.exchange_us) - queue.front();
+            latency_total_us += latency_us;
+            latency_max_us = std::max(latency_max_us, latency_us);
+            queue.pop_front();
+            remaining = schedule.fragments;
+            completed++;
+
+            if (saturated && queue.empty())
+                queue.push_back(event_us);
+
+            // The response arrives in the next event and the next request follows it.
+            if (workload.direction == Direction::WRITE)
+            {
+                write_next_event = event + 2;
+                break;
+            }
+        }
+
+        // A peripheral exchanging data keeps listening, including while it answers a request.
+        awake = (sent > 0) || ((event + 1) == write_next_event);
+    }
+
+    double values_per_second = completed / (duration_us / 1e6);
+    if (saturated)
+    {
+        result.values_per_second_max = values_per_second;
+        result.goodput_max_bytes_per_second = values_per_second * schedule.value_length;
+        result.utilization = 1;
+        return result;
+    }
+
+    prediction_t capacity = simulate(link, {workload.direction, workload.value_length, 0},
+                                     duration_ms, seed);
+    result.values_per_second_max = capacity.values_per_second_max;
+    result.goodput_max_bytes_per_second = capacity.goodput_max_bytes_per_second;
+    result.utilization = workload.rate_hz / capacity.values_per_second_max;
+    result.stable = result.utilization < 1;
+    if (result.stable && completed)
+    {
+        result.latency_mean_us = latency_total_us / completed;
+        result.latency_max_us = latency_max_us;
+    }
+
+    return result;
+}
+
+};
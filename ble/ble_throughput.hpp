@@ -0,0 +1,141 @@
+/**
+ * @file   ble_throughput.hpp
+ *
+ * @brief  Analytic model of the goodput and latency of a BLE link.
+ * @detail Predicts how many values per second a characteristic workload can move over a link of a
+ *         given MTU, connection interval, slave latency and packets per connection event, and how
+ *         long each value waits to be delivered. A discrete simulation of the connection events
+ *         built on the same rules validates the model. Neither depends on ESP-IDF, so that the
+ *         planner in tools/ also builds on the host.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_THROUGHPUT_HPP
+#define COMPONENTS_BLE_BLE_THROUGHPUT_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+namespace BLE
+{
+
+class BLE_Throughput
+{
+public:
+    enum class PHY : uint8_t
+    {
+        LE_1M,
+        LE_2M,
+    };
+
+    enum class Direction : uint8_t
+    {
+        // Server to client.
+        NOTIFY,
+        // Client to server, as many in flight as the link carries.
+        WRITE_NO_RESPONSE,
+        // Client to server, one request in flight at a time.
+        WRITE,
+    };
+
+    // Without the data length extension link layer payloads are limited to 27 bytes.
+    static constexpr const uint8_t DATA_LENGTH_DEFAULT = 27;
+    static constexpr const uint8_t DATA_LENGTH_MAX = 251;
+    // Controllers differ, the ESP32 typically moves a handful of packets per connection event.
+    static constexpr const uint8_t PACKETS_PER_EVENT_DEFAULT = 4;
+    static constexpr const uint32_t INTERVAL_UNIT_US = 1250;
+
+    struct link_t
+    {
+        // The ATT MTU of the connection.
+        uint16_t    mtu = 23;
+        // The connection interval, Time = N * 1.25 msec.
+        uint16_t    interval = 0x30;
+        // The number of connection events the peripheral may skip when it has nothing to send.
+        uint16_t    latency = 0;
+        // The link layer data packets each side sends per connection event.
+        uint8_t     packets_per_event = PACKETS_PER_EVENT_DEFAULT;
+        // The largest link layer payload, 27 up to 251 bytes.
+        uint8_t     data_length = DATA_LENGTH_DEFAULT;
+        PHY         phy = PHY::LE_1M;
+    };
+
+    struct workload_t
+    {
+        Direction   direction = Direction::NOTIFY;
+        uint16_t    value_length = 20;
+        // Values produced per second, 0 keeps the link saturated.
+        double      rate_hz = 0;
+    };
+
+    struct prediction_t
+    {
+        // False if a value does not fit a single ATT PDU at this MTU, it was modelled cut to fit.
+        bool        fits;
+        // The link layer packets carrying one value.
+        uint16_t    fragments;
+        // The capacity of the link for this workload.
+        double      values_per_second_max;
+        double      goodput_max_bytes_per_second;
+        // The offered load relative to the capacity, 1 for a saturated workload.
+        double      utilization;
+        // False if values are produced faster than the link carries them, the latency then grows
+        // without bound and is not reported.
+        bool        stable;
+        // From the time a value is produced to its delivery, 0 unless the workload is stable.
+        uint32_t    latency_mean_us;
+        uint32_t    latency_max_us;
+    };
+
+
+    /**
+     * @brief Predicts the capacity of a link and the latency of a workload analytically.
+     * @param [in] link The parameters of the link.
+     * @param [in] workload The characteristic workload.
+     * @return The prediction.
+     */
+    static prediction_t predict(const link_t& link, const workload_t& workload);
+
+    /**
+     * @brief Simulates a workload event by event over a link, for validating predict.
+     * @param [in] link The parameters of the link.
+     * @param [in] workload The characteristic workload.
+     * @param [in] duration_ms (default=60000) The simulated time.
+     * @param [in] seed (default=1) Seeds the phase of the producer against the connection events.
+     * @return The measured values, in the form of a prediction.
+     */
+    static prediction_t simulate(const link_t& link, const workload_t& workload,
+                                 uint32_t duration_ms=60000, uint32_t seed=1);
+
+    /**
+     * @brief Computes the time a link layer data packet occupies the air.
+     * @param [in] payload The link layer payload length in bytes.
+     * @param [in] phy The PHY of the link.
+     * @return The air time in microseconds.
+     */
+    static uint32_t packet_airtime_us(uint16_t payload, PHY phy);
+
+private:
+    struct schedule_t
+    {
+        uint16_t    value_length;
+        uint16_t    fragments;
+        uint32_t    interval_us;
+        // The time of one data packet exchange, the data packet, its empty answer and two gaps.
+        uint32_t    exchange_us;
+        uint32_t    budget;
+        // Connection events between two events the receiver of the workload listens to.
+        uint32_t    idle_events;
+    };
+
+    static schedule_t schedule_get(const link_t& link, const workload_t& workload);
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_THROUGHPUT_HPP
@@ -0,0 +1,181 @@
+/**
+ * @file   ble_timeseries.cpp
+ *
+ * @brief  Batched time-series notifications.
+ * @detail Producers append samples to a lock-free ring buffer and a flush packs as many of them as
+ *         fit into each notification with BLE_TimeSeries_Packer, instead of paying the ATT
+ *         overhead once per sample. Packets are sized to the smallest MTU among the subscribers
+ *         and numbered so that clients can detect losses.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include "esp_gatt_defs.h"
+
+#include "ble_profile.hpp"
+#include "ble_server.hpp"
+#include "ble_service.hpp"
+#include "ble_timeseries.hpp"
+#include "ble_utilities.hpp"
+
+namespace BLE
+{
+
+/**
+ * @brief Batches samples into the notifications of a characteristic.
+ * @param [in] characteristic A characteristic with the notify or indicate property.
+ * @param [in] channels The number of values per sample, at most
+ *                      CONFIG_BLE_REDUX_TIMESERIES_CHANNELS_MAX.
+ * @return A shared pointer to the time series, nullptr if the arguments are invalid.
+ */
+std::shared_ptr<BLE_TimeSeries>
+BLE_TimeSeries::create(std::shared_ptr<BLE_Characteristic> characteristic, size_t channels)
+{
+    if (!characteristic || (channels == 0) || (channels > BLE_TimeSeries_Packer::CHANNELS_MAX) ||
+        !(characteristic->properties &
+          (ESP_GATT_CHAR_PROP_BIT_NOTIFY | ESP_GATT_CHAR_PROP_BIT_INDICATE)))
+        return nullptr;
+
+    return std::shared_ptr<BLE_TimeSeries>(new BLE_TimeSeries(std::move(characteristic),
+                                                              channels));
+}
+
+
+/**
+ * @brief Appends a sample to the ring buffer.
+ * @note This function is thread safe and lock-free, it may be called from several producers.
+ * @param [in] sample The sample.
+ * @return True if the sample was queued, false if the ring buffer is full.
+ */
+bool
+BLE_TimeSeries::append(const timeseries_sample_t& sample)
+{
+    if (!m_samples.push(sample))
+    {
+        m_dropped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    m_appended.fetch_add(1, std::memory_order_relaxed);
+    return true;
+}
+
+
+/**
+ * @brief Packs the queued samples and notifies them to every subscriber.
+ * @note Only one task may flush at a time.
+ * @param [in] partial (default=true) Also sends the last packet if it is not full, otherwise its
+ *             samples wait for the next flush.
+ * @return The number of packets sent.
+ */
+size_t
+BLE_TimeSeries::flush(bool partial)
+{
+    // Samples are not held back for future subscribers, they would arrive stale.
+    std::vector<uint16_t> subscribers = m_characteristic->subscribers_get();
+    if (subscribers.empty())
+    {
+        uint32_t discarded = (m_packet_open ? m_packer.count() : 0) + (m_carry ? 1 : 0);
+        timeseries_sample_t sample;
+        while (m_samples.pop(sample))
+            discarded++;
+
+        m_packet_open = false;
+        m_carry.reset();
+        m_dropped.fetch_add(discarded, std::memory_order_relaxed);
+        return 0;
+    }
+
+    size_t sent = 0;
+    for (;;)
+    {
+        timeseries_sample_t sample;
+        if (m_carry)
+        {
+            sample = *m_carry;
+            m_carry.reset();
+        }
+        else if (!m_samples.pop(sample))
+        {
+            break;
+        }
+
+        if (!m_packet_open)
+        {
+            m_packer.begin(m_characteristic->notification_capacity_get(subscribers), m_sequence);
+            m_packet_open = true;
+        }
+
+        if (m_packer.append(sample))
+            continue;
+
+        // A sample too large for an empty packet can never be sent at this MTU.
+        if (!m_packer.count())
+        {
+            m_dropped.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        m_carry = sample;
+        sent += packet_send(subscribers);
+    }
+
+    if (partial && m_packet_open && m_packer.count())
+        sent += packet_send(subscribers);
+
+    return sent;
+}
+
+
+/**
+ * @brief Retrieves the batching counters.
+ * @param [in] reset (default=false) Zeroes the counters after reading them.
+ * @return A copy of the counters.
+ */
+BLE_TimeSeries::counters_t
+BLE_TimeSeries::counters_get(bool reset)
+{
+    auto read = [reset](auto& counter){
+        return reset ? counter.exchange(0, std::memory_order_relaxed)
+                     : counter.load(std::memory_order_relaxed);
+    };
+
+    counters_t counters;
+    counters.appended = read(m_appended);
+    counters.dropped = read(m_dropped);
+    counters.packets = read(m_packets);
+    counters.samples_sent = read(m_samples_sent);
+    counters.bytes_sent = read(m_bytes_sent);
+    counters.bytes_raw = read(m_bytes_raw);
+    return counters;
+}
+
+
+bool
+BLE_TimeSeries::packet_send(const std::vector<uint16_t>& subscribers)
+{
+    bool delivered = false;
+    for (uint16_t connection_id : subscribers)
+        delivered |= m_characteristic->notify(connection_id, m_packer.data(), m_packer.length());
+
+    m_packets.fetch_add(1, std::memory_order_relaxed);
+    m_samples_sent.fetch_add(m_packer.count(), std::memory_order_relaxed);
+    m_bytes_sent.fetch_add(m_packer.length(), std::memory_order_relaxed);
+    m_bytes_raw.fetch_add(m_packer.count() * m_packer.sample_length(), std::memory_order_relaxed);
+
+    m_packet_open = false;
+    m_sequence++;
+    return delivered;
+}
+
+};
@@ -0,0 +1,119 @@
+/**
+ * @file   ble_timeseries.hpp
+ *
+ * @brief  Batched time-series notifications.
+ * @detail Producers append samples to a lock-free ring buffer and a flush packs as many of them as
+ *         fit into each notification with BLE_TimeSeries_Packer, instead of paying the ATT
+ *         overhead once per sample. Packets are sized to the smallest MTU among the subscribers
+ *         and numbered so that clients can detect losses.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_TIMESERIES_HPP
+#define COMPONENTS_BLE_BLE_TIMESERIES_HPP
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <vector>
+
+#include "sdkconfig.h"
+
+#include "ble_characteristic.hpp"
+#include "ble_queue.hpp"
+#include "ble_timeseries_packer.hpp"
+
+#ifndef CONFIG_BLE_REDUX_TIMESERIES_DEPTH
+#define CONFIG_BLE_REDUX_TIMESERIES_DEPTH 256
+#endif
+
+namespace BLE
+{
+
+class BLE_TimeSeries
+{
+public:
+    struct counters_t
+    {
+        uint32_t    appended;
+        // Samples lost to a full ring buffer or flushed while nobody was subscribed.
+        uint32_t    dropped;
+        uint32_t    packets;
+        uint32_t    samples_sent;
+        // The packed bytes sent, headers included, and what the same samples take unpacked.
+        uint64_t    bytes_sent;
+        uint64_t    bytes_raw;
+    };
+
+
+    /**
+     * @brief Batches samples into the notifications of a characteristic.
+     * @param [in] characteristic A characteristic with the notify or indicate property.
+     * @param [in] channels The number of values per sample, at most
+     *                      CONFIG_BLE_REDUX_TIMESERIES_CHANNELS_MAX.
+     * @return A shared pointer to the time series, nullptr if the arguments are invalid.
+     */
+    static std::shared_ptr<BLE_TimeSeries> create(
+        std::shared_ptr<BLE_Characteristic> characteristic, size_t channels);
+
+    BLE_TimeSeries(const BLE_TimeSeries&) = delete;
+    BLE_TimeSeries& operator=(const BLE_TimeSeries&) = delete;
+
+    /**
+     * @brief Appends a sample to the ring buffer.
+     * @note This function is thread safe and lock-free, it may be called from several producers.
+     * @param [in] sample The sample.
+     * @return True if the sample was queued, false if the ring buffer is full.
+     */
+    bool append(const timeseries_sample_t& sample);
+
+    /**
+     * @brief Packs the queued samples and notifies them to every subscriber.
+     * @note Only one task may flush at a time.
+     * @param [in] partial (default=true) Also sends the last packet if it is not full, otherwise
+     *             its samples wait for the next flush.
+     * @return The number of packets sent.
+     */
+    size_t flush(bool partial=true);
+
+    /**
+     * @brief Retrieves the batching counters.
+     * @param [in] reset (default=false) Zeroes the counters after reading them.
+     * @return A copy of the counters.
+     */
+    counters_t counters_get(bool reset=false);
+
+private:
+    BLE_TimeSeries(std::shared_ptr<BLE_Characteristic> characteristic, size_t channels)
+        : m_characteristic(std::move(characteristic)), m_packer(channels) {}
+
+    bool packet_send(const std::vector<uint16_t>& subscribers);
+
+
+    const std::shared_ptr<BLE_Characteristic>                               m_characteristic;
+    BLE_Queue<timeseries_sample_t, CONFIG_BLE_REDUX_TIMESERIES_DEPTH>       m_samples;
+
+    // Owned by the flushing task: the open packet and a sample that did not fit in it.
+    BLE_TimeSeries_Packer                                                   m_packer;
+    bool                                                                    m_packet_open = false;
+    std::optional<timeseries_sample_t>                                      m_carry;
+    uint8_t                                                                 m_sequence = 0;
+
+    std::atomic<uint32_t>   m_appended{0};
+    std::atomic<uint32_t>   m_dropped{0};
+    std::atomic<uint32_t>   m_packets{0};
+    std::atomic<uint32_t>   m_samples_sent{0};
+    std::atomic<uint64_t>   m_bytes_sent{0};
+    std::atomic<uint64_t>   m_bytes_raw{0};
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_TIMESERIES_HPP
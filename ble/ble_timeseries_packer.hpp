@@ -0,0 +1,218 @@
+/**
+ * @file   ble_timeseries_packer.hpp
+ *
+ * @brief  Delta and zigzag varint packing of time-series samples.
+ * @detail A packet starts with a header carrying a sequence number, the number of samples and the
+ *         timestamp of the first sample. The first sample's values follow as they are, every later
+ *         sample as the difference to its predecessor, each difference zigzag mapped and written
+ *         as a varint so that slowly changing signals take a byte per value. The packer has no
+ *         dependency on ESP-IDF and builds on the host, see tools/ble_timeseries_bench.cpp.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_TIMESERIES_PACKER_HPP
+#define COMPONENTS_BLE_BLE_TIMESERIES_PACKER_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#ifndef CONFIG_BLE_REDUX_TIMESERIES_CHANNELS_MAX
+#define CONFIG_BLE_REDUX_TIMESERIES_CHANNELS_MAX 4
+#endif
+
+namespace BLE
+{
+
+struct timeseries_sample_t
+{
+    // In a unit chosen by the producer, e.g. milliseconds since boot.
+    uint32_t                                                        timestamp;
+    std::array<int32_t, CONFIG_BLE_REDUX_TIMESERIES_CHANNELS_MAX>   values;
+};
+
+
+class BLE_TimeSeries_Packer
+{
+public:
+    // The sequence number, the sample count and the timestamp of the first sample.
+    static constexpr const size_t HEADER_LENGTH = 2 + sizeof(uint32_t);
+    static constexpr const size_t PACKET_LENGTH_MAX = 512;
+    static constexpr const size_t CHANNELS_MAX = CONFIG_BLE_REDUX_TIMESERIES_CHANNELS_MAX;
+    static constexpr const size_t VARINT_LENGTH_MAX = 5;
+    static constexpr const size_t SAMPLES_MAX = UINT8_MAX;
+
+
+    explicit BLE_TimeSeries_Packer(size_t channels)
+        : m_channels(std::min(std::max<size_t>(channels, 1), CHANNELS_MAX)) {}
+
+    /**
+     * @brief Starts a new packet, discarding the current one.
+     * @param [in] capacity The length the packet may grow to, clamped to PACKET_LENGTH_MAX.
+     * @param [in] sequence The sequence number of the packet.
+     */
+    void begin(size_t capacity, uint8_t sequence)
+    {
+        m_capacity = std::min(capacity, PACKET_LENGTH_MAX);
+        m_length = HEADER_LENGTH;
+        m_count = 0;
+        m_packet[0] = sequence;
+    }
+
+    /**
+     * @brief Appends a sample to the current packet.
+     * @param [in] sample The sample, only the configured number of channels is packed.
+     * @return True if the sample was packed, false if the packet is full.
+     */
+    bool append(const timeseries_sample_t& sample)
+    {
+        if ((m_count == SAMPLES_MAX) || (m_capacity < HEADER_LENGTH))
+            return false;
+
+        // Encoded aside first so that a sample that does not fit leaves the packet untouched.
+        std::array<uint8_t, VARINT_LENGTH_MAX * (CHANNELS_MAX + 1)> encoded;
+        size_t length = 0;
+        if (m_count)
+            length += varint_write(encoded.data(), delta(m_previous.timestamp, sample.timestamp));
+
+        for (size_t channel = 0; channel < m_channels; channel++)
+        {
+            uint32_t previous = m_count ? m_previous.values[channel] : 0;
+            length += varint_write(encoded.data() + length,
+                                   delta(previous, sample.values[channel]));
+        }
+
+        if (m_length + length > m_capacity)
+            return false;
+
+        if (!m_count)
+            uint32_write(m_packet.data() + 2, sample.timestamp);
+
+        memcpy(m_packet.data() + m_length, encoded.data(), length);
+        m_length += length;
+        m_previous = sample;
+        m_count++;
+        m_packet[1] = m_count;
+        return true;
+    }
+
+    const uint8_t* data(void) const { return m_packet.data(); }
+    size_t length(void) const { return m_count ? m_length : 0; }
+    size_t count(void) const { return m_count; }
+    size_t channels(void) const { return m_channels; }
+
+    // The length of a sample without packing, the reference for compression ratios.
+    size_t sample_length(void) const { return sizeof(uint32_t) * (m_channels + 1); }
+
+    /**
+     * @brief Unpacks a packet.
+     * @param [in] packet The packet.
+     * @param [in] length The length of the packet.
+     * @param [in] channels The number of channels the packet was packed with.
+     * @param [out] samples The samples, SAMPLES_MAX entries suffice for any packet.
+     * @param [in] samples_max The number of entries of samples.
+     * @return The number of samples unpacked, 0 if the packet is malformed.
+     */
+    static size_t unpack(const uint8_t* packet, size_t length, size_t channels,
+                         timeseries_sample_t* samples, size_t samples_max)
+    {
+        if ((length < HEADER_LENGTH) || (channels == 0) || (channels > CHANNELS_MAX))
+            return 0;
+
+        size_t count = std::min<size_t>(packet[1], samples_max);
+        size_t position = HEADER_LENGTH;
+        timeseries_sample_t previous = {uint32_read(packet + 2), {}};
+        for (size_t i = 0; i < count; i++)
+        {
+            timeseries_sample_t& sample = samples[i];
+            sample = previous;
+            uint32_t difference = 0;
+            if (i && !varint_read(packet, length, position, difference))
+                return 0;
+
+            sample.timestamp += zigzag_decode(difference);
+            for (size_t channel = 0; channel < channels; channel++)
+            {
+                if (!varint_read(packet, length, position, difference))
+                    return 0;
+
+                uint32_t base = i ? static_cast<uint32_t>(previous.values[channel]) : 0;
+                sample.values[channel] = static_cast<int32_t>(base + zigzag_decode(difference));
+            }
+
+            previous = sample;
+        }
+
+        return count;
+    }
+
+private:
+    // Differences wrap around so that every pair of values round trips exactly.
+    static uint32_t delta(uint32_t previous, uint32_t current)
+    {
+        int32_t difference = static_cast<int32_t>(current - previous);
+        return (static_cast<uint32_t>(difference) << 1) ^ static_cast<uint32_t>(difference >> 31);
+    }
+
+    static uint32_t zigzag_decode(uint32_t value)
+    {
+        return (value >> 1) ^ (0u - (value & 1));
+    }
+
+    static size_t varint_write(uint8_t* out, uint32_t value)
+    {
+        size_t length = 0;
+        while (value >= 0x80)
+        {
+            out[length++] = static_cast<uint8_t>(value) | 0x80;
+            value >>= 7;
+        }
+
+        out[length++] = static_cast<uint8_t>(value);
+        return length;
+    }
+
+    static bool varint_read(const uint8_t* in, size_t length, size_t& position, uint32_t& value)
+    {
+        value = 0;
+        for (size_t shift = 0; (shift < 35) && (position < length); shift += 7)
+        {
+            uint8_t byte = in[position++];
+            value |= static_cast<uint32_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80))
+                return true;
+        }
+
+        return false;
+    }
+
+    static void uint32_write(uint8_t* out, uint32_t value)
+    {
+        for (size_t i = 0; i < sizeof(uint32_t); i++)
+            out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+
+    static uint32_t uint32_read(const uint8_t* in)
+    {
+        return in[0] | (in[1] << 8) | (in[2] << 16) | (static_cast<uint32_t>(in[3]) << 24);
+    }
+
+
+    const size_t                                m_channels;
+    std::array<uint8_t, PACKET_LENGTH_MAX>      m_packet = {};
+    size_t                                      m_capacity = 0;
+    size_t                                      m_length = 0;
+    uint8_t                                     m_count = 0;
+    timeseries_sample_t                         m_previous = {};
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_TIMESERIES_PACKER_HPP
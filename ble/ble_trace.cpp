@@ -0,0 +1,235 @@
+/**
+ * @file   ble_trace.cpp
+ *
+ * @brief  Low overhead binary event tracing for the event dispatch path.
+ * @detail Tracepoints write fixed size records into a lock-free ring buffer. The buffer can be
+ *         dumped in binary form (see tools/ble_trace_to_chrome.py) or directly as Chrome trace
+ *         JSON. Tracing is enabled through CONFIG_BLE_REDUX_TRACE, when disabled the tracepoint
+ *         macros compile to nothing and their arguments are not evaluated.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cinttypes>
+#include <cstdint>
+#include <cstdio>
+
+#include "esp_gatts_api.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+
+#include "ble_trace.hpp"
+
+namespace BLE
+{
+
+constexpr const uint16_t TRACE_DUMP_VERSION = 1;
+constexpr const char TRACE_DUMP_MAGIC[8] = {'B', 'L', 'E', 'T', 'R', 'A', 'C', 'E'};
+
+// Indexed by esp_gatts_cb_event_t, events past the end of the table are printed numerically.
+constexpr const std::array<const char*, 25> TRACE_GATTS_EVENT_NAMES = {
+    "REG", "READ", "WRITE", "EXEC_WRITE", "MTU", "CONF", "UNREG", "CREATE", "ADD_INCL_SRVC",
+    "ADD_CHAR", "ADD_CHAR_DESCR", "DELETE", "START", "STOP", "CONNECT", "DISCONNECT", "OPEN",
+    "CANCEL_OPEN", "CLOSE", "LISTEN", "CONGEST", "RESPONSE", "CREAT_ATTR_TAB", "SET_ATTR_VAL",
+    "SEND_SERVICE_CHANGE",
+};
+
+#ifdef CONFIG_BLE_REDUX_TRACE
+constexpr const uint32_t TRACE_BUFFER_RECORDS = CONFIG_BLE_REDUX_TRACE_BUFFER_RECORDS;
+static_assert((TRACE_BUFFER_RECORDS & (TRACE_BUFFER_RECORDS - 1)) == 0,
+              "CONFIG_BLE_REDUX_TRACE_BUFFER_RECORDS must be a power of two");
+
+static BLE_Trace::record_t  trace_buffer[TRACE_BUFFER_RECORDS];
+static std::atomic<uint32_t> trace_head(0);
+static std::atomic<bool>     trace_enabled(true);
+#endif
+
+
+/***************************************************************************************************
+* Recording
+***************************************************************************************************/
+/**
+ * @brief Appends a record to the trace buffer, overwriting the oldest record if it is full.
+ * @note This function is lock-free and safe to call from any task.
+ * @warning Use the BLE_TRACE macros instead so that the call is compiled out when tracing is
+ *          disabled.
+ */
+void
+BLE_Trace::record(Type type, uint8_t event, uint16_t handle, uint16_t connection_id, uint32_t arg)
+{
+#ifdef CONFIG_BLE_REDUX_TRACE
+    if (!trace_enabled.load(std::memory_order_relaxed))
+        return;
+
+    // Claiming a slot is the only synchronisation required, concurrent writers never share one
+    // unless the buffer wraps around within a single write.
+    uint32_t index = trace_head.fetch_add(1, std::memory_order_relaxed);
+    record_t& slot = trace_buffer[index & (TRACE_BUFFER_RECORDS - 1)];
+    slot.timestamp_us = static_cast<uint32_t>(esp_timer_get_time());
+    slot.type = type;
+    slot.event = event;
+    slot.handle = handle;
+    slot.connection_id = connection_id;
+    slot.reserved = 0;
+    slot.arg = arg;
+#endif
+}
+
+
+/**
+ * @brief Pauses or resumes recording without discarding the buffer contents.
+ * @param [in] enabled Whether tracepoints should record.
+ */
+void
+BLE_Trace::enable(bool enabled)
+{
+#ifdef CONFIG_BLE_REDUX_TRACE
+    trace_enabled.store(enabled);
+#endif
+}
+
+
+/**
+ * @brief Discards all recorded events.
+ */
+void
+BLE_Trace::clear(void)
+{
+#ifdef CONFIG_BLE_REDUX_TRACE
+    trace_head.store(0);
+#endif
+}
+
+
+/***************************************************************************************************
+* Exporting
+***************************************************************************************************/
+template<typename F>
+static size_t
+trace_for_each(F visitor)
+{
+#ifdef CONFIG_BLE_REDUX_TRACE
+    uint32_t head = trace_head.load();
+    uint32_t count = std::min(head, TRACE_BUFFER_RECORDS);
+    for (uint32_t i = head - count; i != head; i++)
+        visitor(trace_buffer[i & (TRACE_BUFFER_RECORDS - 1)]);
+
+    return count;
+#else
+    return 0;
+#endif
+}
+
+
+/**
+ * @brief Writes the buffer contents, oldest first, in the binary dump format.
+ * @detail The dump starts with a 16 byte header ("BLETRACE", u16 version, u16 record size,
+ *         u32 record count) followed by the records in little endian order.
+ * @note Recording should be paused while dumping, records written concurrently may be torn.
+ * @param [in] out The stream to write to, this may be a file or a UART opened through the VFS.
+ * @return The number of records written.
+ */
+size_t
+BLE_Trace::dump_binary(FILE* out)
+{
+    uint16_t version = TRACE_DUMP_VERSION;
+    uint16_t record_size = sizeof(record_t);
+    uint32_t count = trace_for_each([](const record_t&){});
+
+    // The ESP32 is little endian so the header and records can be written as is.
+    fwrite(TRACE_DUMP_MAGIC, sizeof(TRACE_DUMP_MAGIC), 1, out);
+    fwrite(&version, sizeof(version), 1, out);
+    fwrite(&record_size, sizeof(record_size), 1, out);
+    fwrite(&count, sizeof(count), 1, out);
+
+    size_t written = trace_for_each([out](const record_t& record){
+        fwrite(&record, sizeof(record), 1, out);
+    });
+
+    fflush(out);
+    return written;
+}
+
+
+/**
+ * @brief Writes the buffer contents as Chrome trace JSON (chrome://tracing, Perfetto).
+ * @note Recording should be paused while dumping, records written concurrently may be torn.
+ * @param [in] out The stream to write to.
+ * @return The number of records written.
+ */
+size_t
+BLE_Trace::dump_chrome(FILE* out)
+{
+    fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+
+    bool first = true;
+    uint32_t previous = 0;
+    uint64_t epoch = 0;
+    size_t written = trace_for_each([&](const record_t& record){
+        // Timestamps are truncated to 32 bits and wrap roughly every 71 minutes.
+        if (!first && record.timestamp_us < previous)
+            epoch += (uint64_t) 1 << 32;
+        previous = record.timestamp_us;
+        uint64_t timestamp = epoch + record.timestamp_us;
+
+        char event_name[24];
+        bool gatts = record.type != Type::EVENT_ARRIVAL_GAP;
+        if (gatts && record.event < TRACE_GATTS_EVENT_NAMES.size())
+            snprintf(event_name, sizeof(event_name), "%s", TRACE_GATTS_EVENT_NAMES[record.event]);
+        else
+            snprintf(event_name, sizeof(event_name), "EVT_%u", record.event);
+
+        fprintf(out, "%s\n", first ? "" : ",");
+        first = false;
+
+        switch (record.type)
+        {
+            case Type::EVENT_ARRIVAL_GATTS:
+            case Type::EVENT_ARRIVAL_GAP:
+                fprintf(out, "{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"i\",\"s\":\"t\","
+                             "\"ts\":%" PRIu64 ",\"pid\":1,\"tid\":1,\"args\":{\"arg\":%" PRIu32
+                             "}}",
+                        event_name, record.type == Type::EVENT_ARRIVAL_GAP ? "gap" : "gatts",
+                        timestamp, record.arg);
+            break;
+            case Type::HANDLER_ENTER:
+            case Type::HANDLER_EXIT:
+                fprintf(out, "{\"name\":\"%s %04X\",\"cat\":\"handler\",\"ph\":\"%s\","
+                             "\"ts\":%" PRIu64 ",\"pid\":1,\"tid\":1,\"args\":{\"conn_id\":%u,"
+                             "\"arg\":%" PRIu32 "}}",
+                        event_name, record.handle, record.type == Type::HANDLER_ENTER ? "B" : "E",
+                        timestamp, record.connection_id, record.arg);
+            break;
+            case Type::RESPONSE_SENT:
+                fprintf(out, "{\"name\":\"response %04X\",\"cat\":\"response\",\"ph\":\"i\","
+                             "\"s\":\"t\",\"ts\":%" PRIu64 ",\"pid\":1,\"tid\":1,"
+                             "\"args\":{\"conn_id\":%u,\"status\":%" PRIu32 "}}",
+                        record.handle, timestamp, record.connection_id, record.arg);
+            break;
+            case Type::QUEUE_ENQUEUE:
+            case Type::QUEUE_DEQUEUE:
+                // Queue records carry the queue ID in the handle field and its depth in arg.
+                fprintf(out, "{\"name\":\"queue %04X\",\"cat\":\"queue\",\"ph\":\"C\","
+                             "\"ts\":%" PRIu64 ",\"pid\":1,\"args\":{\"depth\":%" PRIu32 "}}",
+                        record.handle, timestamp, record.arg);
+            break;
+            default:
+                fprintf(out, "{\"name\":\"unknown\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%" PRIu64
+                             ",\"pid\":1,\"tid\":1}", timestamp);
+            break;
+        }
+    });
+
+    fprintf(out, "\n]}\n");
+    fflush(out);
+    return written;
+}
+
+};
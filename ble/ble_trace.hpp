@@ -0,0 +1,139 @@
+/**
+ * @file   ble_trace.hpp
+ *
+ * @brief  Low overhead binary event tracing for the event dispatch path.
+ * @detail Tracepoints write fixed size records into a lock-free ring buffer. The buffer can be
+ *         dumped in binary form (see tools/ble_trace_to_chrome.py) or directly as Chrome trace
+ *         JSON. Tracing is enabled through CONFIG_BLE_REDUX_TRACE, when disabled the tracepoint
+ *         macros compile to nothing and their arguments are not evaluated.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_TRACE_HPP
+#define COMPONENTS_BLE_BLE_TRACE_HPP
+
+#include <cstdint>
+#include <cstdio>
+
+#include "sdkconfig.h"
+
+namespace BLE
+{
+
+class BLE_Trace
+{
+public:
+    enum class Type : uint8_t
+    {
+        EVENT_ARRIVAL_GATTS,
+        EVENT_ARRIVAL_GAP,
+        HANDLER_ENTER,
+        HANDLER_EXIT,
+        RESPONSE_SENT,
+        QUEUE_ENQUEUE,
+        QUEUE_DEQUEUE,
+    };
+
+    struct record_t
+    {
+        uint32_t    timestamp_us;
+        Type        type;
+        uint8_t     event;
+        uint16_t    handle;
+        uint16_t    connection_id;
+        uint16_t    reserved;
+        uint32_t    arg;
+    };
+
+    static_assert(sizeof(record_t) == 16, "Trace records are part of the dump format");
+
+
+    /**
+     * @brief RAII helper which records a handler entry on construction and exit on destruction.
+     */
+    class Scope
+    {
+    public:
+        Scope(uint8_t event, uint16_t handle, uint16_t connection_id, uint32_t arg)
+            : m_event(event), m_handle(handle), m_connection_id(connection_id), m_arg(arg)
+        {
+            record(Type::HANDLER_ENTER, m_event, m_handle, m_connection_id, m_arg);
+        }
+
+        ~Scope() { record(Type::HANDLER_EXIT, m_event, m_handle, m_connection_id, m_arg); }
+
+    private:
+        const uint8_t   m_event;
+        const uint16_t  m_handle;
+        const uint16_t  m_connection_id;
+        const uint32_t  m_arg;
+    };
+
+
+    /**
+     * @brief Appends a record to the trace buffer, overwriting the oldest record if it is full.
+     * @note This function is lock-free and safe to call from any task.
+     * @warning Use the BLE_TRACE macros instead so that the call is compiled out when tracing is
+     *          disabled.
+     */
+    static void record(Type type, uint8_t event, uint16_t handle, uint16_t connection_id,
+                       uint32_t arg);
+
+    /**
+     * @brief Pauses or resumes recording without discarding the buffer contents.
+     * @param [in] enabled Whether tracepoints should record.
+     */
+    static void enable(bool enabled);
+
+    /**
+     * @brief Discards all recorded events.
+     */
+    static void clear(void);
+
+    /**
+     * @brief Writes the buffer contents, oldest first, in the binary dump format.
+     * @detail The dump starts with a 16 byte header ("BLETRACE", u16 version, u16 record size,
+     *         u32 record count) followed by the records in little endian order.
+     * @note Recording should be paused while dumping, records written concurrently may be torn.
+     * @param [in] out The stream to write to, this may be a file or a UART opened through the VFS.
+     * @return The number of records written.
+     */
+    static size_t dump_binary(FILE* out);
+
+    /**
+     * @brief Writes the buffer contents as Chrome trace JSON (chrome://tracing, Perfetto).
+     * @note Recording should be paused while dumping, records written concurrently may be torn.
+     * @param [in] out The stream to write to.
+     * @return The number of records written.
+     */
+    static size_t dump_chrome(FILE* out);
+};
+
+};
+
+
+#ifdef CONFIG_BLE_REDUX_TRACE
+#define BLE_TRACE_CONCAT_INNER(A, B) A##B
+#define BLE_TRACE_CONCAT(A, B) BLE_TRACE_CONCAT_INNER(A, B)
+
+#define BLE_TRACE(TYPE, EVENT, HANDLE, CONN_ID, ARG)\
+    BLE::BLE_Trace::record(BLE::BLE_Trace::Type::TYPE, EVENT, HANDLE, CONN_ID, ARG)
+
+#define BLE_TRACE_SCOPE(EVENT, HANDLE, CONN_ID, ARG)\
+    BLE::BLE_Trace::Scope BLE_TRACE_CONCAT(ble_trace_scope_, __LINE__)(EVENT, HANDLE, CONN_ID, ARG)
+#else
+// The operands of sizeof are never evaluated, they only keep the arguments referenced.
+#define BLE_TRACE_DISCARD(EVENT, HANDLE, CONN_ID, ARG)\
+    do { (void) sizeof(EVENT); (void) sizeof(HANDLE); (void) sizeof(CONN_ID); (void) sizeof(ARG); }\
+    while (0)
+
+#define BLE_TRACE(TYPE, EVENT, HANDLE, CONN_ID, ARG) BLE_TRACE_DISCARD(EVENT, HANDLE, CONN_ID, ARG)
+#define BLE_TRACE_SCOPE(EVENT, HANDLE, CONN_ID, ARG) BLE_TRACE_DISCARD(EVENT, HANDLE, CONN_ID, ARG)
+#endif
+
+#endif // COMPONENTS_BLE_BLE_TRACE_HPP
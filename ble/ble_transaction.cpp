@@ -0,0 +1,373 @@
+/**
+ * @file   ble_transaction.cpp
+ *
+ * @brief  Bounded storage for prepared (queued) write transactions.
+ * @detail Prepared writes are buffered per connection and characteristic until the client
+ *         executes or cancels them. The manager enforces a global byte budget, a per connection
+ *         cap and a time-to-live so that a misbehaving client cannot pin heap indefinitely.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <algorithm>
+#include <cstdint>
+#include <optional>
+#include <utility>
+#include <vector>
+
+#include "esp_log.h"
+#include "esp_timer.h"
+
+#include "ble_transaction.hpp"
+#include "ble_utilities.hpp"
+
+namespace BLE
+{
+
+constexpr const char* LOG_TAG_BLE_TRANSACTION = "BLE Transaction";
+
+
+/***************************************************************************************************
+* Transaction Management
+***************************************************************************************************/
+/**
+ * @brief Buffers a Prepare Write Request.
+ * @detail Chunks are kept in the order they arrive and may overlap or arrive out of order, they
+ *         are only assembled when the transaction is committed. Expired transactions are evicted
+ *         before the limits are checked.
+ * @param [in] connection_id The connection the request arrived on.
+ * @param [in] handle The handle of the characteristic being written.
+ * @param [in] offset The offset of the chunk within the value.
+ * @param [in] data The chunk to be buffered.
+ * @param [in] length The length of the chunk.
+ * @return ESP_GATT_OK if the chunk was buffered, ESP_GATT_PREPARE_Q_FULL if it would exceed a
+ *         limit (the transaction is discarded) or ESP_GATT_INVALID_OFFSET if the value would grow
+ *         past the maximum attribute length. Once a transaction of the connection was discarded,
+ *         the error verify will report.
+ */
+esp_gatt_status_t
+BLE_Transaction_Manager::prepare(uint16_t connection_id, uint16_t handle, uint16_t offset,
+                                 const uint8_t* data, size_t length)
+{
+    int64_t now_us = esp_timer_get_time();
+    expire(now_us);
+
+    // The queue can no longer execute whole, nothing more of it is buffered until it is cancelled.
+    auto poisoned = m_poisoned.find(connection_id);
+    if (poisoned != m_poisoned.end())
+    {
+        m_metrics.rejected++;
+        return poisoned->second;
+    }
+
+    std::vector<transaction_t>& transactions = m_transactions[connection_id];
+    auto transaction = std::find_if(transactions.begin(), transactions.end(),
+                                    [handle](const transaction_t& t){ return t.handle == handle; });
+
+    if (transaction == transactions.end())
+    {
+        transactions.push_back({handle, {}, 0, now_us});
+        transaction = transactions.end() - 1;
+        m_metrics.started++;
+    }
+
+    if (offset + length > ATT_ATTRIBUTE_LENGTH_MAX)
+    {
+        erase(connection_id, transaction);
+        poison(connection_id, ESP_GATT_INVALID_ATTR_LEN);
+        m_metrics.rejected++;
+        return ESP_GATT_INVALID_OFFSET;
+    }
+
+    if ((m_metrics.bytes_in_use + length > m_limits.bytes_max) ||
+        (connection_bytes(connection_id) + length > m_limits.connection_bytes_max))
+    {
+        ESP_LOGW(LOG_TAG_BLE_TRANSACTION, "Prepared write rejected, connection: 0x%04X, handle: "
+                                          "0x%04X, in use: %u", connection_id, handle,
+                                          static_cast<unsigned>(m_metrics.bytes_in_use));
+        erase(connection_id, transaction);
+        poison(connection_id, ESP_GATT_PREPARE_Q_FULL);
+        m_metrics.rejected++;
+        return ESP_GATT_PREPARE_Q_FULL;
+    }
+
+    // Chunks are applied in the order they arrived when the transaction is committed, so that a
+    // later chunk overwrites the bytes an earlier one shares with it.
+    transaction->chunks.push_back({offset, std::vector<uint8_t>(data, data + length)});
+    transaction->bytes += length;
+    transaction->last_activity_us = now_us;
+
+    m_metrics.bytes_in_use += length;
+    m_metrics.bytes_peak = std::max(m_metrics.bytes_peak, m_metrics.bytes_in_use);
+
+    return ESP_GATT_OK;
+}
+
+
+/**
+ * @brief Checks that every transaction of a connection can be committed, before any of them is.
+ * @param [in] connection_id The connection of interest.
+ * @return ESP_GATT_OK if every value is covered by its chunks from offset 0 without gaps,
+ *         ESP_GATT_INVALID_OFFSET otherwise. ESP_GATT_PREPARE_Q_FULL if a transaction of the
+ *         connection expired or exceeded a limit, ESP_GATT_INVALID_ATTR_LEN if one would have grown
+ *         past the maximum attribute length, the rest of the queue is then incomplete.
+ */
+esp_gatt_status_t
+BLE_Transaction_Manager::verify(uint16_t connection_id) const
+{
+    auto poisoned = m_poisoned.find(connection_id);
+    if (poisoned != m_poisoned.end())
+        return poisoned->second;
+
+    auto connection = m_transactions.find(connection_id);
+    if (connection == m_transactions.end())
+        return ESP_GATT_OK;
+
+    for (const transaction_t& transaction : connection->second)
+    {
+        if (!coverage(transaction))
+            return ESP_GATT_INVALID_OFFSET;
+    }
+
+    return ESP_GATT_OK;
+}
+
+
+/**
+ * @brief Removes a transaction and hands over its value, assembled from its chunks in the order
+ *        they arrived.
+ * @param [in] connection_id The connection of interest.
+ * @param [in] handle The handle of the characteristic of interest.
+ * @return The value or std::nullopt if there is no such transaction or its chunks leave a gap, the
+ *         transaction is discarded in both cases.
+ */
+std::optional<std::vector<uint8_t>>
+BLE_Transaction_Manager::commit(uint16_t connection_id, uint16_t handle)
+{
+    if (!m_transactions.count(connection_id))
+        return {};
+
+    std::vector<transaction_t>& transactions = m_transactions[connection_id];
+    auto transaction = std::find_if(transactions.begin(), transactions.end(),
+                                    [handle](const transaction_t& t){ return t.handle == handle; });
+    if (transaction == transactions.end())
+        return {};
+
+    // Bytes no chunk wrote would otherwise be committed as zeros.
+    std::optional<size_t> length = coverage(*transaction);
+    if (!length)
+    {
+        erase(connection_id, transaction);
+        m_metrics.aborted++;
+        return {};
+    }
+
+    std::vector<uint8_t> data(*length);
+    for (const chunk_t& chunk : transaction->chunks)
+        std::copy(chunk.data.begin(), chunk.data.end(), data.begin() + chunk.offset);
+
+    erase(connection_id, transaction);
+    m_metrics.committed++;
+
+    return data;
+}
+
+
+/**
+ * @brief Discards a single transaction.
+ * @param [in] connection_id The connection of interest.
+ * @param [in] handle The handle of the characteristic of interest.
+ */
+void
+BLE_Transaction_Manager::abort(uint16_t connection_id, uint16_t handle)
+{
+    if (!m_transactions.count(connection_id))
+        return;
+
+    std::vector<transaction_t>& transactions = m_transactions[connection_id];
+    auto transaction = std::find_if(transactions.begin(), transactions.end(),
+                                    [handle](const transaction_t& t){ return t.handle == handle; });
+    if (transaction == transactions.end())
+        return;
+
+    erase(connection_id, transaction);
+    m_metrics.aborted++;
+}
+
+
+/**
+ * @brief Discards every transaction of a connection, for example when it disconnects or cancels its
+ *        queue, and clears the error of a previously discarded transaction.
+ * @param [in] connection_id The connection of interest.
+ */
+void
+BLE_Transaction_Manager::abort(uint16_t connection_id)
+{
+    m_poisoned.erase(connection_id);
+    if (!m_transactions.count(connection_id))
+        return;
+
+    for (const transaction_t& transaction : m_transactions[connection_id])
+    {
+        m_metrics.bytes_in_use -= transaction.bytes;
+        m_metrics.aborted++;
+    }
+
+    m_transactions.erase(connection_id);
+}
+
+
+/**
+ * @brief Retrieves the handles of every characteristic a connection has prepared writes for.
+ * @param [in] connection_id The connection of interest.
+ * @return The handles in the order their transactions were started.
+ */
+std::vector<uint16_t>
+BLE_Transaction_Manager::handles(uint16_t connection_id) const
+{
+    std::vector<uint16_t> handles;
+    auto connection = m_transactions.find(connection_id);
+    if (connection == m_transactions.end())
+        return handles;
+
+    for (const transaction_t& transaction : connection->second)
+        handles.push_back(transaction.handle);
+
+    return handles;
+}
+
+
+/**
+ * @brief Checks whether a transaction exists.
+ * @param [in] connection_id The connection of interest.
+ * @param [in] handle The handle of the characteristic of interest.
+ * @return True if a transaction is buffered, false otherwise.
+ */
+bool
+BLE_Transaction_Manager::ongoing(uint16_t connection_id, uint16_t handle) const
+{
+    auto connection = m_transactions.find(connection_id);
+    if (connection == m_transactions.end())
+        return false;
+
+    return std::any_of(connection->second.begin(), connection->second.end(),
+                       [handle](const transaction_t& t){ return t.handle == handle; });
+}
+
+
+/**
+ * @brief Replaces the limits, existing transactions are only checked on their next request.
+ * @param [in] limits The new limits.
+ */
+void
+BLE_Transaction_Manager::limits_set(const limits_t& limits)
+{
+    m_limits = limits;
+}
+
+
+/**
+ * @brief Retrieves the transaction counters.
+ * @return A copy of the counters.
+ */
+BLE_Transaction_Manager::metrics_t
+BLE_Transaction_Manager::metrics(void) const
+{
+    return m_metrics;
+}
+
+
+/***************************************************************************************************
+* Private Helpers
+***************************************************************************************************/
+std::optional<size_t>
+BLE_Transaction_Manager::coverage(const transaction_t& transaction)
+{
+    std::vector<std::pair<size_t, size_t>> ranges;
+    for (const chunk_t& chunk : transaction.chunks)
+        ranges.emplace_back(chunk.offset, chunk.offset + chunk.data.size());
+
+    std::sort(ranges.begin(), ranges.end());
+    size_t end = 0;
+    for (const auto& range : ranges)
+    {
+        if (range.first > end)
+            return {};
+
+        end = std::max(end, range.second);
+    }
+
+    return end;
+}
+
+
+void
+BLE_Transaction_Manager::expire(int64_t now_us)
+{
+    if (m_limits.ttl_ms == 0)
+        return;
+
+    int64_t deadline_us = now_us - (static_cast<int64_t>(m_limits.ttl_ms) * 1000);
+    for (auto connection = m_transactions.begin(); connection != m_transactions.end();)
+    {
+        std::vector<transaction_t>& transactions = connection->second;
+        for (auto transaction = transactions.begin(); transaction != transactions.end();)
+        {
+            if (transaction->last_activity_us >= deadline_us)
+            {
+                transaction++;
+                continue;
+            }
+
+            ESP_LOGW(LOG_TAG_BLE_TRANSACTION, "Prepared write expired, connection: 0x%04X, handle: "
+                                              "0x%04X", connection->first, transaction->handle);
+            m_metrics.bytes_in_use -= transaction->bytes;
+            m_metrics.expired++;
+            poison(connection->first, ESP_GATT_PREPARE_Q_FULL);
+            transaction = transactions.erase(transaction);
+        }
+
+        connection = transactions.empty() ? m_transactions.erase(connection) : ++connection;
+    }
+}
+
+
+void
+BLE_Transaction_Manager::erase(uint16_t connection_id,
+                               std::vector<transaction_t>::iterator transaction)
+{
+    std::vector<transaction_t>& transactions = m_transactions[connection_id];
+    m_metrics.bytes_in_use -= transaction->bytes;
+    transactions.erase(transaction);
+    if (transactions.empty())
+        m_transactions.erase(connection_id);
+}
+
+
+void
+BLE_Transaction_Manager::poison(uint16_t connection_id, esp_gatt_status_t status)
+{
+    // The first error is the one reported.
+    m_poisoned.emplace(connection_id, status);
+}
+
+
+size_t
+BLE_Transaction_Manager::connection_bytes(uint16_t connection_id) const
+{
+    auto connection = m_transactions.find(connection_id);
+    if (connection == m_transactions.end())
+        return 0;
+
+    size_t bytes = 0;
+    for (const transaction_t& transaction : connection->second)
+        bytes += transaction.bytes;
+
+    return bytes;
+}
+
+};
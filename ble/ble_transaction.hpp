@@ -0,0 +1,182 @@
+/**
+ * @file   ble_transaction.hpp
+ *
+ * @brief  Bounded storage for prepared (queued) write transactions.
+ * @detail Prepared writes are buffered per connection and characteristic until the client
+ *         executes or cancels them. The manager enforces a global byte budget, a per connection
+ *         cap and a time-to-live so that a misbehaving client cannot pin heap indefinitely.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#ifndef COMPONENTS_BLE_BLE_TRANSACTION_HPP
+#define COMPONENTS_BLE_BLE_TRANSACTION_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <unordered_map>
+#include <vector>
+
+#include "esp_gatt_defs.h"
+#include "sdkconfig.h"
+
+#ifndef CONFIG_BLE_REDUX_PREPARED_WRITE_BYTES_MAX
+#define CONFIG_BLE_REDUX_PREPARED_WRITE_BYTES_MAX 4096
+#endif
+
+#ifndef CONFIG_BLE_REDUX_PREPARED_WRITE_CONNECTION_BYTES_MAX
+#define CONFIG_BLE_REDUX_PREPARED_WRITE_CONNECTION_BYTES_MAX 1024
+#endif
+
+#ifndef CONFIG_BLE_REDUX_PREPARED_WRITE_TTL_MS
+#define CONFIG_BLE_REDUX_PREPARED_WRITE_TTL_MS 30000
+#endif
+
+namespace BLE
+{
+
+class BLE_Transaction_Manager
+{
+public:
+    struct limits_t
+    {
+        // The bytes buffered across all connections.
+        size_t      bytes_max = CONFIG_BLE_REDUX_PREPARED_WRITE_BYTES_MAX;
+        // The bytes buffered by a single connection, across all of its characteristics.
+        size_t      connection_bytes_max = CONFIG_BLE_REDUX_PREPARED_WRITE_CONNECTION_BYTES_MAX;
+        // Transactions without activity for this long are discarded, 0 disables expiry.
+        uint32_t    ttl_ms = CONFIG_BLE_REDUX_PREPARED_WRITE_TTL_MS;
+    };
+
+    struct metrics_t
+    {
+        uint32_t    started;
+        uint32_t    committed;
+        uint32_t    aborted;
+        uint32_t    expired;
+        uint32_t    rejected;
+        size_t      bytes_in_use;
+        size_t      bytes_peak;
+    };
+
+
+    /**
+     * @brief Buffers a Prepare Write Request.
+     * @detail Chunks are kept in the order they arrive and may overlap or arrive out of order,
+     *         they are only assembled when the transaction is committed. Expired transactions are
+     *         evicted before the limits are checked.
+     * @param [in] connection_id The connection the request arrived on.
+     * @param [in] handle The handle of the characteristic being written.
+     * @param [in] offset The offset of the chunk within the value.
+     * @param [in] data The chunk to be buffered.
+     * @param [in] length The length of the chunk.
+     * @return ESP_GATT_OK if the chunk was buffered, ESP_GATT_PREPARE_Q_FULL if it would exceed a
+     *         limit (the transaction is discarded) or ESP_GATT_INVALID_OFFSET if the value would
+     *         grow past the maximum attribute length. Once a transaction of the connection was
+     *         discarded, the error verify will report.
+     */
+    esp_gatt_status_t prepare(uint16_t connection_id, uint16_t handle, uint16_t offset,
+                              const uint8_t* data, size_t length);
+
+    /**
+     * @brief Checks that every transaction of a connection can be committed, before any of them is.
+     * @param [in] connection_id The connection of interest.
+     * @return ESP_GATT_OK if every value is covered by its chunks from offset 0 without gaps,
+     *         ESP_GATT_INVALID_OFFSET otherwise. ESP_GATT_PREPARE_Q_FULL if a transaction of the
+     *         connection expired or exceeded a limit, ESP_GATT_INVALID_ATTR_LEN if one would have
+     *         grown past the maximum attribute length, the rest of the queue is then incomplete.
+     */
+    esp_gatt_status_t verify(uint16_t connection_id) const;
+
+    /**
+     * @brief Removes a transaction and hands over its value, assembled from its chunks in the
+     *        order they arrived.
+     * @param [in] connection_id The connection of interest.
+     * @param [in] handle The handle of the characteristic of interest.
+     * @return The value or std::nullopt if there is no such transaction or its chunks leave a gap,
+     *         the transaction is discarded in both cases.
+     */
+    std::optional<std::vector<uint8_t>> commit(uint16_t connection_id, uint16_t handle);
+
+    /**
+     * @brief Discards a single transaction.
+     * @param [in] connection_id The connection of interest.
+     * @param [in] handle The handle of the characteristic of interest.
+     */
+    void abort(uint16_t connection_id, uint16_t handle);
+
+    /**
+     * @brief Discards every transaction of a connection, for example when it disconnects or cancels
+     *        its queue, and clears the error of a previously discarded transaction.
+     * @param [in] connection_id The connection of interest.
+     */
+    void abort(uint16_t connection_id);
+
+    /**
+     * @brief Retrieves the handles of every characteristic a connection has prepared writes for.
+     * @param [in] connection_id The connection of interest.
+     * @return The handles in the order their transactions were started.
+     */
+    std::vector<uint16_t> handles(uint16_t connection_id) const;
+
+    /**
+     * @brief Checks whether a transaction exists.
+     * @param [in] connection_id The connection of interest.
+     * @param [in] handle The handle of the characteristic of interest.
+     * @return True if a transaction is buffered, false otherwise.
+     */
+    bool ongoing(uint16_t connection_id, uint16_t handle) const;
+
+    /**
+     * @brief Replaces the limits, existing transactions are only checked on their next request.
+     * @param [in] limits The new limits.
+     */
+    void limits_set(const limits_t& limits);
+
+    /**
+     * @brief Retrieves the transaction counters.
+     * @return A copy of the counters.
+     */
+    metrics_t metrics(void) const;
+
+private:
+    struct chunk_t
+    {
+        uint16_t                offset;
+        std::vector<uint8_t>    data;
+    };
+
+    struct transaction_t
+    {
+        uint16_t                handle;
+        std::vector<chunk_t>    chunks;
+        // The bytes held by the chunks, overlapping chunks are counted in full.
+        size_t                  bytes;
+        int64_t                 last_activity_us;
+    };
+
+    using Transaction_Map = std::unordered_map<uint16_t, std::vector<transaction_t>>;
+
+
+    static std::optional<size_t> coverage(const transaction_t& transaction);
+    void expire(int64_t now_us);
+    void erase(uint16_t connection_id, std::vector<transaction_t>::iterator transaction);
+    void poison(uint16_t connection_id, esp_gatt_status_t status);
+    size_t connection_bytes(uint16_t connection_id) const;
+
+    Transaction_Map     m_transactions;
+    // The error the next Execute Write Request of a connection fails with, set when one of its
+    // transactions is discarded before it executes.
+    std::unordered_map<uint16_t, esp_gatt_status_t> m_poisoned;
+    limits_t            m_limits;
+    metrics_t           m_metrics = {};
+};
+
+};
+
+#endif // COMPONENTS_BLE_BLE_TRANSACTION_HPP
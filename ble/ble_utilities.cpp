@@ -0,0 +1,85 @@
+/**
+ * @file   ble_utilities.cpp
+ *
+ * @brief  ESP32 Bluetooth Low Energy utility functions and constants.
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cstdint>
+
+#include "esp_bt.h"
+#include "esp_bt_main.h"
+#include "esp_gatt_common_api.h"
+#include "esp_log.h"
+
+#include "ble_utilities.hpp"
+
+namespace BLE
+{
+
+constexpr const char* LOG_TAG_BLE_STACK = "BLE Stack";
+
+
+/**
+ * @brief Brings up the Bluetooth controller and the Bluedroid host in BLE mode.
+ * @detail Both the server and the client call this when they are started, whichever comes second
+ *         finds the stack already running and only updates the local MTU.
+ * @param [in] local_mtu The largest MTU this device accepts during an MTU exchange.
+ * @return True if the stack is running, false otherwise.
+ */
+bool
+stack_enable(uint16_t local_mtu)
+{
+    esp_err_t err;
+    if (esp_bluedroid_get_status() != ESP_BLUEDROID_STATUS_ENABLED)
+    {
+        esp_bt_controller_config_t bt_cfg = BT_CONTROLLER_INIT_CONFIG_DEFAULT();
+        err = esp_bt_controller_init(&bt_cfg);
+        if (err)
+        {
+            ESP_LOGE(LOG_TAG_BLE_STACK, "Enable controller failed: %s (%d)",
+                     esp_err_to_name(err), err);
+            return false;
+        }
+
+        err = esp_bt_controller_enable(ESP_BT_MODE_BLE);
+        if (err)
+        {
+            ESP_LOGE(LOG_TAG_BLE_STACK, "Enable controller failed: %s (%d)",
+                     esp_err_to_name(err), err);
+            return false;
+        }
+
+        err = esp_bluedroid_init();
+        if (err)
+        {
+            ESP_LOGE(LOG_TAG_BLE_STACK, "Init bluetooth failed: %s (%d)", esp_err_to_name(err),
+                     err);
+            return false;
+        }
+
+        err = esp_bluedroid_enable();
+        if (err)
+        {
+            ESP_LOGE(LOG_TAG_BLE_STACK, "Enable bluetooth failed: %s (%d)", esp_err_to_name(err),
+                     err);
+            return false;
+        }
+    }
+
+    err = esp_ble_gatt_set_local_mtu(local_mtu);
+    if (err)
+    {
+        ESP_LOGE(LOG_TAG_BLE_STACK, "Set local MTU failed: %s (%d)", esp_err_to_name(err), err);
+        return false;
+    }
+
+    return true;
+}
+
+};
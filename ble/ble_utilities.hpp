@@ -14,6 +14,7 @@
 #define COMPONENTS_BLE_BLE_UTILITIES_HPP
 
 #include <cstddef>
+#include <cstdint>
 
 // The Bluetooth v4.0 and v4.1 standards both define a maximum BLE data length of 27 bytes (newer
 // standards have increased this), of this 4 bytes go to the link layer L2CAP. Therefore we only
@@ -28,5 +29,23 @@ constexpr const size_t MTU_DEFAULT_BLE_SERVER = 512;
 // The Bluetooth v4.0 specification states that the data field must contain 1 byte for the opcode.
 constexpr const size_t ATT_FIELD_LENGTH_OPCODE = 1;
 
+// The Bluetooth specification limits the length of an attribute value to 512 bytes.
+constexpr const size_t ATT_ATTRIBUTE_LENGTH_MAX = 512;
+
+
+namespace BLE
+{
+
+/**
+ * @brief Brings up the Bluetooth controller and the Bluedroid host in BLE mode.
+ * @detail Both the server and the client call this when they are started, whichever comes second
+ *         finds the stack already running and only updates the local MTU.
+ * @param [in] local_mtu The largest MTU this device accepts during an MTU exchange.
+ * @return True if the stack is running, false otherwise.
+ */
+bool stack_enable(uint16_t local_mtu);
+
+};
+
 #endif // COMPONENTS_BLE_BLE_UTILITIES_HPP
 
@@ -17,6 +17,7 @@
 #include <cstdint>
 #include <vector>
 #include <algorithm>
+#include <utility>
 
 #include "ble_value.hpp"
 
@@ -30,87 +31,70 @@ BLE_Value::to_raw(void) const
 }
 
 
+/**
+ * @brief Replaces the serialized value, for example with the contents of a client write.
+ * @param [in] raw The new serialized value.
+ */
 void
-BLE_Value::transaction_write_start(uint16_t connection_id)
-{
-    m_transactions_write.insert_or_assign(connection_id, std::vector<uint8_t>());
-}
-
-bool
-BLE_Value::transaction_write_add(uint16_t connection_id, std::vector<uint8_t> data)
+BLE_Value::from_raw(std::vector<uint8_t> raw)
 {
-    if (!m_transactions_write.count(connection_id))
-        return false;
-
-    m_transactions_write[connection_id].insert(m_transactions_write[connection_id].end(),
-                                               data.begin(), data.end());
-    return true;
+    m_value = std::move(raw);
 }
 
-bool
-BLE_Value::transaction_write_commit(uint16_t connection_id)
-{
-    if (!m_transactions_write.count(connection_id))
-        return false;
-
-    m_value = m_transactions_write[connection_id];
-    m_transactions_write.erase(connection_id);
 
-    return true;
-}
-
-bool
-BLE_Value::transaction_write_ongoing(int16_t connection_id)
+/**
+ * @brief Replaces the serialized value with a copy of a byte buffer.
+ * @note The existing storage is reused when it is large enough, so repeated writes of the same
+ *       length do not allocate.
+ * @param [in] data The new serialized value.
+ * @param [in] length The length of the new value in bytes.
+ */
+void
+BLE_Value::from_raw(const uint8_t* data, size_t length)
 {
-    return m_transactions_write.count(connection_id) != 0;
+    m_value.assign(data, data + length);
 }
 
 
-void
-BLE_Value::transaction_read_start(uint16_t connection_id)
+/**
+ * @brief Copies part of the serialized value starting at an offset.
+ * @param [in] offset The offset of the first byte to copy, as found in an ATT Read Blob Request.
+ * @param [out] buffer The location the bytes are copied to.
+ * @param [in] max_length The maximum number of bytes to copy.
+ * @return The number of bytes copied, zero if the offset is at or past the end of the value.
+ */
+size_t
+BLE_Value::read(size_t offset, uint8_t* buffer, size_t max_length) const
 {
+    if (offset >= m_value.size())
+        return 0;
 
-    transaction_read_t transaction;
-    transaction.offset = 0;
-    transaction.value = m_value;
-    m_transactions_read.insert_or_assign(connection_id, transaction);
+    size_t length = std::min(max_length, m_value.size() - offset);
+    std::copy_n(m_value.begin() + offset, length, buffer);
+    return length;
 }
 
-std::vector<uint8_t>
-BLE_Value::transaction_read_advance(uint16_t connection_id, size_t max_length)
-{
-    if (!m_transactions_read.count(connection_id))
-        return {};
-
-    transaction_read_t& transaction = m_transactions_read[connection_id];
-    size_t length = std::min(max_length, transaction.value.size() - transaction.offset);
-
-    if (length == 0)
-        return {};
 
-    std::vector<uint8_t> ret(transaction.value.begin() + transaction.offset,
-                             transaction.value.begin() + transaction.offset + length);
-    transaction.offset += length;
-
-    return ret;
-}
-
-void
-BLE_Value::transaction_read_abort(uint16_t connection_id)
+/**
+ * @brief Retrieves the length of the serialized value.
+ * @return The length of the value in bytes.
+ */
+size_t
+BLE_Value::size(void) const
 {
-    if (!m_transactions_read.count(connection_id))
-        return;
-
-    m_transactions_read.erase(connection_id);
+    return m_value.size();
 }
 
-void
-BLE_Value::transaction_write_abort(uint16_t connection_id)
-{
-    if (!m_transactions_write.count(connection_id))
-        return;
 
-    m_transactions_write.erase(connection_id);
+/**
+ * @brief Retrieves the serialized value without copying it.
+ * @note The pointer is invalidated by any change to the value.
+ * @return A pointer to the first byte of the value.
+ */
+const uint8_t*
+BLE_Value::data(void) const
+{
+    return m_value.data();
 }
 
 };
@@ -21,7 +21,6 @@
 #include <cstdint>
 #include <functional>
 #include <type_traits>
-#include <unordered_map>
 #include <vector>
 
 #include "types.hpp"
@@ -73,36 +72,76 @@ public:
      * @param [in] value The desired value of type T to set.
      * @param [in] serializer A function capable of accepting the provided value of type T and
      *             convert it to an std::vector of uint8_ts.
+     * @return True if the serialized value changed, false otherwise.
      */
     template<typename T>
-    void value_set(T value, BLE_Value::Serializer<T> serializer);
+    bool value_set(T value, BLE_Value::Serializer<T> serializer);
 
     template<typename T>
     T value_get(BLE_Value::Deserializer<T> deserializer) const;
 
-    void transaction_write_start(uint16_t connection_id);
-    bool transaction_write_add(uint16_t connection_id, std::vector<uint8_t> data);
-    bool transaction_write_commit(uint16_t connection_id);
-    void transaction_write_abort(uint16_t connection_id);
-    bool transaction_write_ongoing(int16_t connection_id);
+    /**
+     * @brief Rewrites the serialized value in place.
+     * @detail The value is resized to the requested length, reusing its storage, and handed to the
+     *         function which writes the new contents directly, e.g. through a payload view.
+     * @tparam F A callable of signature void(uint8_t* data, size_t length).
+     * @param [in] length The length of the new value in bytes.
+     * @param [in] update The function writing the value.
+     */
+    template<typename F>
+    void value_update(size_t length, F update);
 
-    void transaction_read_start(uint16_t connection_id);
-    std::vector<uint8_t> transaction_read_advance(uint16_t connection_id, size_t max_len);
-    void transaction_read_abort(uint16_t connection_id);
+    /**
+     * @brief Reads the serialized value in place.
+     * @tparam F A callable of signature R(const uint8_t* data, size_t length).
+     * @param [in] view The function reading the value, the pointer is only valid during the call.
+     * @return The result of the function.
+     */
+    template<typename F>
+    auto value_view(F view) const;
+
+    /**
+     * @brief Copies part of the serialized value starting at an offset.
+     * @param [in] offset The offset of the first byte to copy, as found in an ATT Read Blob
+     *             Request.
+     * @param [out] buffer The location the bytes are copied to.
+     * @param [in] max_length The maximum number of bytes to copy.
+     * @return The number of bytes copied, zero if the offset is at or past the end of the value.
+     */
+    size_t read(size_t offset, uint8_t* buffer, size_t max_length) const;
+
+    /**
+     * @brief Retrieves the length of the serialized value.
+     * @return The length of the value in bytes.
+     */
+    size_t size(void) const;
+
+    /**
+     * @brief Retrieves the serialized value without copying it.
+     * @note The pointer is invalidated by any change to the value.
+     * @return A pointer to the first byte of the value.
+     */
+    const uint8_t* data(void) const;
 
     std::vector<uint8_t> to_raw(void) const;
 
-private:
-    struct transaction_read_t
-    {
-        std::vector<uint8_t> value;
-        size_t offset;
-    };
+    /**
+     * @brief Replaces the serialized value, for example with the contents of a client write.
+     * @param [in] raw The new serialized value.
+     */
+    void from_raw(std::vector<uint8_t> raw);
 
-    std::vector<uint8_t> m_value;
+    /**
+     * @brief Replaces the serialized value with a copy of a byte buffer.
+     * @note The existing storage is reused when it is large enough, so repeated writes of the same
+     *       length do not allocate.
+     * @param [in] data The new serialized value.
+     * @param [in] length The length of the new value in bytes.
+     */
+    void from_raw(const uint8_t* data, size_t length);
 
-    std::unordered_map<uint16_t, std::vector<uint8_t>> m_transactions_write;
-    std::unordered_map<uint16_t, transaction_read_t> m_transactions_read;
+private:
+    std::vector<uint8_t> m_value;
 };
 
 #include "ble_value.tpp"
@@ -67,12 +67,18 @@ BLE_Value::default_deserializer(std::vector<uint8_t> serialized_value)
  * @param [in] value The desired value of type T to set.
  * @param [in] serializer A function capable of accepting the provided value of type T and
  *             convert it to an std::vector of uint8_ts.
+ * @return True if the serialized value changed, false otherwise.
  */
 template<typename T>
-void
+bool
 BLE_Value::value_set(T value, BLE_Value::Serializer<T> serializer)
 {
-    m_value = serializer(value);
+    std::vector<uint8_t> serialized_value = serializer(value);
+    if (serialized_value == m_value)
+        return false;
+
+    m_value = std::move(serialized_value);
+    return true;
 }
 
 
@@ -83,5 +89,36 @@ BLE_Value::value_get(BLE_Value::Deserializer<T> deserializer) const
     return deserializer(m_value);
 }
 
+
+/**
+ * @brief Rewrites the serialized value in place.
+ * @detail The value is resized to the requested length, reusing its storage, and handed to the
+ *         function which writes the new contents directly, e.g. through a payload view.
+ * @tparam F A callable of signature void(uint8_t* data, size_t length).
+ * @param [in] length The length of the new value in bytes.
+ * @param [in] update The function writing the value.
+ */
+template<typename F>
+void
+BLE_Value::value_update(size_t length, F update)
+{
+    m_value.resize(length);
+    update(m_value.data(), length);
+}
+
+
+/**
+ * @brief Reads the serialized value in place.
+ * @tparam F A callable of signature R(const uint8_t* data, size_t length).
+ * @param [in] view The function reading the value, the pointer is only valid during the call.
+ * @return The result of the function.
+ */
+template<typename F>
+auto
+BLE_Value::value_view(F view) const
+{
+    return view(static_cast<const uint8_t*>(m_value.data()), m_value.size());
+}
+
 #endif // COMPONENTS_BLE_BLE_VALUE_TPP
 
@@ -44,6 +44,18 @@ UUID::UUID(const uint8_t* raw_uuid, size_t size)
 }
 
 
+UUID::UUID(const esp_bt_uuid_t& esp_uuid)
+{
+    // Remote databases may declare 16 and 32 bit UUIDs, these are relative to the base UUID.
+    if (esp_uuid.len == ESP_UUID_LEN_16)
+        m_uuid = esp_uuid.uuid.uuid16;
+    else if (esp_uuid.len == ESP_UUID_LEN_32)
+        m_uuid = esp_uuid.uuid.uuid32;
+    else
+        *this = UUID(esp_uuid.uuid.uuid128, ESP_UUID_LEN_128);
+}
+
+
 uint128_t
 UUID::to_128(void) const
 {
@@ -34,6 +34,7 @@ public:
     UUID(uint32_t uuid) : m_uuid(uuid) {}
     UUID(uint128_t uuid) : m_uuid(uuid) {}
     UUID(const uint8_t* raw_uuid, size_t size);
+    UUID(const esp_bt_uuid_t& esp_uuid);
     UUID(const UUID& uuid) : m_uuid(uuid.m_uuid) {}
 
     std::string to_string(void) const;
@@ -0,0 +1,239 @@
+#!/usr/bin/env python3
+#
+# Generates zero-copy C++ payload views from a payload schema. Each payload becomes a view class
+# template reading and writing its fields at fixed offsets of a byte buffer, see
+# ble/ble_payload.hpp.
+#
+# A schema lists payloads and their fields in order, one field per line:
+#
+#   # Comments start with '#'.
+#   payload Sensor_Reading
+#       temperature     int16               # Hundredths of a degree Celsius.
+#       pressure        uint32      big
+#       serial          bytes[6]
+#
+# Fields are little endian unless marked big, "payload <Name> big" changes the default of a
+# payload. Supported types are (u)int8/16/32/64, float32, float64 and bytes[N].
+#
+# Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+import argparse
+import os
+import re
+import sys
+
+TYPES = {
+    "uint8": ("uint8_t", 1), "int8": ("int8_t", 1),
+    "uint16": ("uint16_t", 2), "int16": ("int16_t", 2),
+    "uint32": ("uint32_t", 4), "int32": ("int32_t", 4),
+    "uint64": ("uint64_t", 8), "int64": ("int64_t", 8),
+    "float32": ("float", 4), "float64": ("double", 8),
+}
+ENDIANS = {"little": "LITTLE", "big": "BIG"}
+IDENTIFIER = re.compile(r"^[A-Za-z_][A-Za-z0-9_]*$")
+BYTES = re.compile(r"^bytes\[([0-9]+)\]$")
+
+
+class SchemaError(Exception):
+    pass
+
+
+def parse(text, path):
+    payloads = []
+    for number, line in enumerate(text.splitlines(), 1):
+        words = line.split("#", 1)[0].split()
+        if not words:
+            continue
+
+        def error(message):
+            return SchemaError("%s:%d: %s" % (path, number, message))
+
+        if words[0] == "payload":
+            if len(words) not in (2, 3) or not IDENTIFIER.match(words[1]):
+                raise error("expected 'payload <Name> [little|big]'")
+            endian = words[2] if len(words) == 3 else "little"
+            if endian not in ENDIANS:
+                raise error("unknown byte order '%s'" % endian)
+            if any(payload["name"] == words[1] for payload in payloads):
+                raise error("payload '%s' is defined twice" % words[1])
+            payloads.append({"name": words[1], "endian": endian, "fields": [], "length": 0})
+            continue
+
+        if not payloads:
+            raise error("field outside of a payload")
+        if len(words) not in (2, 3) or not IDENTIFIER.match(words[0]):
+            raise error("expected '<field> <type> [little|big]'")
+
+        payload = payloads[-1]
+        name, kind = words[0], words[1]
+        endian = words[2] if len(words) == 3 else payload["endian"]
+        if endian not in ENDIANS:
+            raise error("unknown byte order '%s'" % endian)
+        if any(field["name"] == name for field in payload["fields"]):
+            raise error("field '%s' is defined twice" % name)
+
+        array = BYTES.match(kind)
+        if array:
+            ctype, length = None, int(array.group(1))
+            if length == 0:
+                raise error("bytes fields must not be empty")
+        elif kind in TYPES:
+            ctype, length = TYPES[kind]
+        else:
+            raise error("unknown type '%s'" % kind)
+
+        payload["fields"].append({"name": name, "type": ctype, "length": length,
+                                  "offset": payload["length"], "endian": ENDIANS[endian]})
+        payload["length"] += length
+
+    for payload in payloads:
+        if not payload["fields"]:
+            raise SchemaError("%s: payload '%s' has no fields" % (path, payload["name"]))
+        if payload["length"] > 512:
+            raise SchemaError("%s: payload '%s' exceeds the 512 byte attribute limit"
+                              % (path, payload["name"]))
+
+    return payloads
+
+
+def generate_payload(payload):
+    name = payload["name"]
+    lines = [
+        "template<typename Byte>",
+        "class %s_Payload" % name,
+        "{",
+        "public:",
+        "    static_assert(std::is_same_v<std::remove_const_t<Byte>, uint8_t>,",
+        "                  \"Payload views are built on uint8_t or const uint8_t\");",
+        "",
+        "    static constexpr const size_t LENGTH = %d;" % payload["length"],
+    ]
+    for field in payload["fields"]:
+        lines.append("    static constexpr const size_t %s_OFFSET = %d;"
+                     % (field["name"].upper(), field["offset"]))
+        if field["type"] is None:
+            lines.append("    static constexpr const size_t %s_LENGTH = %d;"
+                         % (field["name"].upper(), field["length"]))
+
+    lines += [
+        "",
+        "",
+        "    // The buffer must hold at least LENGTH bytes, see from.",
+        "    explicit %s_Payload(Byte* data) : m_data(data) {}" % name,
+        "",
+        "    static std::optional<%s_Payload> from(Byte* data, size_t length)" % name,
+        "    {",
+        "        if (length < LENGTH)",
+        "            return std::nullopt;",
+        "",
+        "        return %s_Payload(data);" % name,
+        "    }",
+        "",
+        "    Byte* data(void) const { return m_data; }",
+    ]
+
+    for field in payload["fields"]:
+        offset = "%s_OFFSET" % field["name"].upper()
+        lines.append("")
+        if field["type"] is None:
+            lines += [
+                "    const uint8_t* %s_get(void) const { return m_data + %s; }"
+                % (field["name"], offset),
+                "",
+                "    template<typename B=Byte, typename=std::enable_if_t<!std::is_const_v<B>>>",
+                "    void %s_set(const uint8_t* value)" % field["name"],
+                "    {",
+                "        memcpy(m_data + %s, value, %s_LENGTH);" % (offset, field["name"].upper()),
+                "    }",
+            ]
+            continue
+
+        access = "%s, BLE::Endian::%s" % (field["type"], field["endian"])
+        lines += [
+            "    %s %s_get(void) const" % (field["type"], field["name"]),
+            "    {",
+            "        return BLE::payload_load<%s>(m_data + %s);" % (access, offset),
+            "    }",
+            "",
+            "    template<typename B=Byte, typename=std::enable_if_t<!std::is_const_v<B>>>",
+            "    void %s_set(%s value)" % (field["name"], field["type"]),
+            "    {",
+            "        BLE::payload_store<%s>(m_data + %s, value);" % (access, offset),
+            "    }",
+        ]
+
+    lines += [
+        "",
+        "private:",
+        "    Byte*   m_data;",
+        "};",
+        "",
+        "using %s_View = %s_Payload<const uint8_t>;" % (name, name),
+        "using %s_Mutable_View = %s_Payload<uint8_t>;" % (name, name),
+    ]
+    return "\n".join(lines)
+
+
+def generate(payloads, schema, namespace):
+    guard = "GENERATED_%s_HPP" % re.sub(r"[^A-Za-z0-9]", "_", os.path.basename(schema)).upper()
+    parts = [
+        "// Generated by tools/ble_payload_gen.py from %s, do not edit." % os.path.basename(schema),
+        "",
+        "#ifndef %s" % guard,
+        "#define %s" % guard,
+        "",
+        "#include <cstddef>",
+        "#include <cstdint>",
+        "#include <cstring>",
+        "#include <optional>",
+        "#include <type_traits>",
+        "",
+        "#include \"ble_payload.hpp\"",
+        "",
+    ]
+    if namespace:
+        parts += ["namespace %s" % namespace, "{", ""]
+
+    parts.append("\n\n\n".join(generate_payload(payload) for payload in payloads))
+
+    if namespace:
+        parts += ["", "};"]
+    parts += ["", "#endif // %s" % guard, ""]
+    return "\n".join(parts)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Generate C++ payload views from a schema")
+    parser.add_argument("schema", help="payload schema")
+    parser.add_argument("-o", "--output", help="output header (default: stdout)")
+    parser.add_argument("-n", "--namespace", help="namespace of the generated views")
+    args = parser.parse_args()
+
+    if args.namespace and not all(IDENTIFIER.match(part) for part in args.namespace.split("::")):
+        parser.error("invalid namespace '%s'" % args.namespace)
+
+    with open(args.schema) as schema:
+        try:
+            payloads = parse(schema.read(), args.schema)
+        except SchemaError as error:
+            sys.exit(str(error))
+
+    header = generate(payloads, args.schema, args.namespace)
+
+    # The header is only rewritten when it changes so that build steps do not rebuild its users.
+    if args.output:
+        if os.path.exists(args.output):
+            with open(args.output) as output:
+                if output.read() == header:
+                    return
+        with open(args.output, "w") as output:
+            output.write(header)
+    else:
+        sys.stdout.write(header)
+
+
+if __name__ == "__main__":
+    main()
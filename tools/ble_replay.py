@@ -0,0 +1,152 @@
+#!/usr/bin/env python3
+#
+# Host side of BLE::BLE_Replay. Summarises an event capture written by BLE_Replay::capture_start,
+# and compares the JSON reports written by BLE_Replay::report_json for two builds replaying the
+# same capture.
+#
+# Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+import argparse
+import collections
+import json
+import struct
+import sys
+
+CAPTURE_MAGIC = b"BLECAPTR"
+CAPTURE_VERSION = 1
+HEADER_FORMAT = "<8sHHHH"
+RECORD_FORMAT = "<IBBBBHH"
+RECORD_FLAG_TRUNCATED = 0x01
+SOURCE_GATTS, SOURCE_GAP = range(2)
+
+GATTS_EVENT_NAMES = [
+    "REG", "READ", "WRITE", "EXEC_WRITE", "MTU", "CONF", "UNREG", "CREATE", "ADD_INCL_SRVC",
+    "ADD_CHAR", "ADD_CHAR_DESCR", "DELETE", "START", "STOP", "CONNECT", "DISCONNECT", "OPEN",
+    "CANCEL_OPEN", "CLOSE", "LISTEN", "CONGEST", "RESPONSE", "CREAT_ATTR_TAB", "SET_ATTR_VAL",
+    "SEND_SERVICE_CHANGE",
+]
+
+GAP_EVENT_NAMES = [
+    "ADV_DATA_SET_COMPLETE", "SCAN_RSP_DATA_SET_COMPLETE", "SCAN_PARAM_SET_COMPLETE",
+    "SCAN_RESULT", "ADV_DATA_RAW_SET_COMPLETE", "SCAN_RSP_DATA_RAW_SET_COMPLETE",
+    "ADV_START_COMPLETE", "SCAN_START_COMPLETE", "AUTH_CMPL", "KEY", "SEC_REQ", "PASSKEY_NOTIF",
+    "PASSKEY_REQ", "OOB_REQ", "LOCAL_IR", "LOCAL_ER", "NC_REQ", "ADV_STOP_COMPLETE",
+    "SCAN_STOP_COMPLETE", "SET_STATIC_RAND_ADDR", "UPDATE_CONN_PARAMS",
+]
+
+# Lower is better for every compared metric.
+REPORT_METRICS = [
+    ("duration_us", lambda report: report["duration_us"]),
+    ("latency_p50_us", lambda report: report["latency_us"]["p50"]),
+    ("latency_p90_us", lambda report: report["latency_us"]["p90"]),
+    ("latency_p99_us", lambda report: report["latency_us"]["p99"]),
+    ("latency_max_us", lambda report: report["latency_us"]["max"]),
+    ("allocations", lambda report: report.get("allocations")),
+    ("heap_delta", lambda report: report["heap_delta"]),
+]
+
+
+def event_name(source, event):
+    names = GATTS_EVENT_NAMES if source == SOURCE_GATTS else GAP_EVENT_NAMES
+    prefix = "GATTS" if source == SOURCE_GATTS else "GAP"
+    return "%s_%s" % (prefix, names[event] if event < len(names) else "EVT_%d" % event)
+
+
+def read_records(data):
+    magic, version, gatts_length, gap_length, _ = struct.unpack_from(HEADER_FORMAT, data)
+    if magic != CAPTURE_MAGIC:
+        raise ValueError("Not a BLE event capture")
+    if version != CAPTURE_VERSION:
+        raise ValueError("Unsupported capture version %d" % version)
+
+    offset = struct.calcsize(HEADER_FORMAT)
+    record_length = struct.calcsize(RECORD_FORMAT)
+    while offset + record_length <= len(data):
+        record = struct.unpack_from(RECORD_FORMAT, data, offset)
+        delta_us, source, event, gatts_if, flags, param_length, value_length = record
+        offset += record_length + param_length + value_length
+        if offset > len(data):
+            # The capture was cut while a record was being written.
+            break
+        yield delta_us, source, event, flags, param_length, value_length
+
+
+def summary(args):
+    with open(args.capture, "rb") as capture:
+        data = capture.read()
+
+    counts = collections.Counter()
+    truncated = 0
+    elapsed_us = 0
+    records = 0
+    for delta_us, source, event, flags, _, _ in read_records(data):
+        counts[event_name(source, event)] += 1
+        truncated += bool(flags & RECORD_FLAG_TRUNCATED)
+        elapsed_us += delta_us
+        records += 1
+
+    result = {
+        "capture": args.capture,
+        "bytes": len(data),
+        "events": records,
+        "duration_s": round(elapsed_us / 1e6, 3),
+        "events_per_s": round(records / (elapsed_us / 1e6), 1) if elapsed_us else 0,
+        "bytes_per_event": round(len(data) / records, 1) if records else 0,
+        "truncated": truncated,
+        "by_event": dict(counts.most_common()),
+    }
+    json.dump(result, sys.stdout, indent=2)
+    sys.stdout.write("\n")
+
+
+def compare(args):
+    with open(args.baseline) as baseline, open(args.candidate) as candidate:
+        reports = json.load(baseline), json.load(candidate)
+
+    if reports[0]["events"] != reports[1]["events"]:
+        sys.stderr.write("warning: the reports replayed a different number of events\n")
+
+    regressed = False
+    print("%-16s %12s %12s %9s" % ("metric", "baseline", "candidate", "change"))
+    for name, metric in REPORT_METRICS:
+        before, after = metric(reports[0]), metric(reports[1])
+        if before is None or after is None:
+            continue
+
+        change = ((after - before) / abs(before) * 100.0) if before else 0.0
+        worse = (after > before) and (change > args.threshold)
+        regressed = regressed or worse
+        print("%-16s %12d %12d %+8.1f%%%s" % (name, before, after, change, " !" if worse else ""))
+
+    return 1 if regressed else 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Inspect BLE event captures and replay reports")
+    commands = parser.add_subparsers(dest="command", required=True)
+
+    parser_summary = commands.add_parser("summary", help="summarise an event capture")
+    parser_summary.add_argument("capture", help="capture written by BLE_Replay::capture_start")
+
+    parser_compare = commands.add_parser("compare", help="compare two replay reports")
+    parser_compare.add_argument("baseline", help="report of the baseline build")
+    parser_compare.add_argument("candidate", help="report of the candidate build")
+    parser_compare.add_argument("-t", "--threshold", type=float, default=10.0,
+                                help="percentage past which a metric counts as a regression "
+                                     "(default: 10)")
+    args = parser.parse_args()
+
+    try:
+        if args.command == "summary":
+            summary(args)
+            return 0
+        return compare(args)
+    except (OSError, ValueError, KeyError) as error:
+        sys.exit(str(error))
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,164 @@
+/**
+ * @file   ble_throughput_planner.cpp
+ *
+ * @brief  Host capacity planner built on the link throughput model.
+ * @detail Predicts the capacity of a link and the latency of a characteristic workload for every
+ *         combination of the given MTUs and connection intervals, next to the results of the event
+ *         simulation and the relative error between both, as JSON. Lists are comma separated, the
+ *         interval is given in units of 1.25 msec as in BLE_Server::connection_parameters_set.
+ *
+ *         g++ -std=c++17 -O2 -Ible tools/ble_throughput_planner.cpp ble/ble_throughput.cpp \
+ *             -o ble_throughput_planner
+ *         ./ble_throughput_planner --mtu 23,185,517 --interval 6,24,48 --length 200 --rate 20
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ble_throughput.hpp"
+
+using BLE::BLE_Throughput;
+
+constexpr const char* USAGE =
+    "Usage: %s [--mtu N,...] [--interval N,...] [--latency N] [--packets N] [--data-length N]\n"
+    "          [--phy 1m|2m] [--direction notify|write|write-no-response] [--length N]\n"
+    "          [--rate HZ] [--duration MS]\n";
+
+
+static std::vector<uint32_t>
+list_parse(const char* text)
+{
+    std::vector<uint32_t> values;
+    std::stringstream fields(text);
+    std::string field;
+    while (std::getline(fields, field, ','))
+        values.push_back(strtoul(field.c_str(), nullptr, 10));
+
+    return values;
+}
+
+
+static double
+error_relative(double model, double simulation)
+{
+    return simulation ? (model - simulation) / simulation : 0;
+}
+
+
+static void
+prediction_print(const char* name, const BLE_Throughput::prediction_t& prediction)
+{
+    fprintf(stdout, "\"%s\":{\"fits\":%s,\"fragments\":%u,\"values_per_second_max\":%.2f,"
+                    "\"goodput_max_bytes_per_second\":%.1f,\"utilization\":%.3f,\"stable\":%s",
+            name, prediction.fits ? "true" : "false", prediction.fragments,
+            prediction.values_per_second_max, prediction.goodput_max_bytes_per_second,
+            prediction.utilization, prediction.stable ? "true" : "false");
+    if (prediction.stable)
+        fprintf(stdout, ",\"latency_mean_us\":%u,\"latency_max_us\":%u",
+                prediction.latency_mean_us, prediction.latency_max_us);
+
+    fprintf(stdout, "}");
+}
+
+
+int
+main(int argc, char** argv)
+{
+    std::vector<uint32_t> mtus = {23, 185, 247, 517};
+    std::vector<uint32_t> intervals = {6, 24, 48};
+    BLE_Throughput::link_t link;
+    BLE_Throughput::workload_t workload;
+    uint32_t duration_ms = 60000;
+
+    for (int i = 1; i < argc; i++)
+    {
+        const char* option = argv[i];
+        const char* value = (i + 1 < argc) ? argv[++i] : nullptr;
+        if (!value)
+        {
+            fprintf(stderr, USAGE, argv[0]);
+            return 2;
+        }
+
+        if (!strcmp(option, "--mtu"))
+            mtus = list_parse(value);
+        else if (!strcmp(option, "--interval"))
+            intervals = list_parse(value);
+        else if (!strcmp(option, "--latency"))
+            link.latency = strtoul(value, nullptr, 10);
+        else if (!strcmp(option, "--packets"))
+            link.packets_per_event = strtoul(value, nullptr, 10);
+        else if (!strcmp(option, "--data-length"))
+            link.data_length = strtoul(value, nullptr, 10);
+        else if (!strcmp(option, "--phy") && (!strcmp(value, "1m") || !strcmp(value, "2m")))
+            link.phy = strcmp(value, "2m") ? BLE_Throughput::PHY::LE_1M
+                                           : BLE_Throughput::PHY::LE_2M;
+        else if (!strcmp(option, "--direction") && !strcmp(value, "notify"))
+            workload.direction = BLE_Throughput::Direction::NOTIFY;
+        else if (!strcmp(option, "--direction") && !strcmp(value, "write"))
+            workload.direction = BLE_Throughput::Direction::WRITE;
+        else if (!strcmp(option, "--direction") && !strcmp(value, "write-no-response"))
+            workload.direction = BLE_Throughput::Direction::WRITE_NO_RESPONSE;
+        else if (!strcmp(option, "--length"))
+            workload.value_length = strtoul(value, nullptr, 10);
+        else if (!strcmp(option, "--rate"))
+            workload.rate_hz = strtod(value, nullptr);
+        else if (!strcmp(option, "--duration"))
+            duration_ms = strtoul(value, nullptr, 10);
+        else
+        {
+            fprintf(stderr, USAGE, argv[0]);
+            return 2;
+        }
+    }
+
+    if (mtus.empty() || intervals.empty() || !link.packets_per_event)
+    {
+        fprintf(stderr, USAGE, argv[0]);
+        return 2;
+    }
+
+    fprintf(stdout, "{\"format\":\"esp32-ble-redux-throughput\",\"results\":[");
+    bool first = true;
+    for (uint32_t mtu : mtus)
+    {
+        for (uint32_t interval : intervals)
+        {
+            link.mtu = mtu;
+            link.interval = interval;
+            auto model = BLE_Throughput::predict(link, workload);
+            auto simulation = BLE_Throughput::simulate(link, workload, duration_ms);
+
+            fprintf(stdout, "%s\n{\"mtu\":%u,\"interval\":%u,\"interval_ms\":%.2f,",
+                    first ? "" : ",", mtu, interval,
+                    interval * BLE_Throughput::INTERVAL_UNIT_US / 1000.0);
+            prediction_print("model", model);
+            fprintf(stdout, ",");
+            prediction_print("simulation", simulation);
+            fprintf(stdout, ",\"error\":{\"values_per_second_max\":%.3f",
+                    error_relative(model.values_per_second_max,
+                                   simulation.values_per_second_max));
+            if (model.stable && simulation.stable)
+                fprintf(stdout, ",\"latency_mean_us\":%.3f,\"latency_max_us\":%.3f",
+                        error_relative(model.latency_mean_us, simulation.latency_mean_us),
+                        error_relative(model.latency_max_us, simulation.latency_max_us));
+
+            fprintf(stdout, "}}");
+            first = false;
+        }
+    }
+
+    fprintf(stdout, "\n]}\n");
+    return 0;
+}
@@ -0,0 +1,187 @@
+/**
+ * @file   ble_timeseries_bench.cpp
+ *
+ * @brief  Host benchmark of the time-series packer on recorded traces.
+ * @detail Packs a trace the way BLE_TimeSeries does for a set of MTUs, checks that every packet
+ *         unpacks to the original samples and reports the compression ratio and the samples per
+ *         packet as JSON. A trace is a CSV file with one sample per line, the timestamp followed
+ *         by the values; lines starting with '#' are skipped.
+ *
+ *         g++ -std=c++17 -O2 -Ible tools/ble_timeseries_bench.cpp -o ble_timeseries_bench
+ *         ./ble_timeseries_bench imu_100hz.csv 23 185 247 517
+ * @date   17/10/2026
+ * @author Zeyad Tamimi (ZeyadTamimi@Outlook.com)
+ * @copyright Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+ *            This Source Code Form is subject to the terms of the Mozilla Public
+ *            License, v. 2.0. If a copy of the MPL was not distributed with this
+ *            file, You can obtain one at http://mozilla.org/MPL/2.0/.
+ */
+
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "ble_timeseries_packer.hpp"
+
+using BLE::BLE_TimeSeries_Packer;
+using BLE::timeseries_sample_t;
+
+// Notifications carry the opcode and the handle ahead of the value.
+constexpr const size_t NOTIFICATION_OVERHEAD = 3;
+constexpr const size_t MTUS_DEFAULT[] = {23, 185, 247, 517};
+
+
+static bool
+trace_read(const char* path, std::vector<timeseries_sample_t>& samples, size_t& channels)
+{
+    std::ifstream file(path);
+    if (!file)
+        return false;
+
+    channels = 0;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || (line[0] == '#'))
+            continue;
+
+        std::stringstream fields(line);
+        std::string field;
+        timeseries_sample_t sample = {};
+        size_t column = 0;
+        while (std::getline(fields, field, ',') &&
+               (column <= BLE_TimeSeries_Packer::CHANNELS_MAX))
+        {
+            int64_t number = strtoll(field.c_str(), nullptr, 10);
+            if (column == 0)
+                sample.timestamp = static_cast<uint32_t>(number);
+            else
+                sample.values[column - 1] = static_cast<int32_t>(number);
+
+            column++;
+        }
+
+        if (column < 2)
+            continue;
+
+        channels = channels ? channels : column - 1;
+        samples.push_back(sample);
+    }
+
+    return !samples.empty();
+}
+
+
+static bool
+trace_pack(const std::vector<timeseries_sample_t>& samples, size_t channels, size_t mtu,
+           bool first)
+{
+    BLE_TimeSeries_Packer packer(channels);
+    std::vector<timeseries_sample_t> unpacked(BLE_TimeSeries_Packer::SAMPLES_MAX);
+    size_t packets = 0;
+    size_t bytes = 0;
+    size_t verified = 0;
+    size_t samples_max = 0;
+    bool valid = true;
+
+    auto packet_close = [&](){
+        size_t count = BLE_TimeSeries_Packer::unpack(packer.data(), packer.length(), channels,
+                                                     unpacked.data(), unpacked.size());
+        for (size_t i = 0; (i < count) && valid; i++)
+        {
+            const timeseries_sample_t& original = samples[verified + i];
+            valid = (unpacked[i].timestamp == original.timestamp) &&
+                    (memcmp(unpacked[i].values.data(), original.values.data(),
+                            channels * sizeof(int32_t)) == 0);
+        }
+
+        valid = valid && (count == packer.count());
+        verified += packer.count();
+        samples_max = std::max(samples_max, packer.count());
+        bytes += packer.length();
+        packets++;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    int64_t pack_ns = 0;
+    packer.begin(mtu - NOTIFICATION_OVERHEAD, 0);
+    for (size_t i = 0; (i < samples.size()) && valid; i++)
+    {
+        if (packer.append(samples[i]))
+            continue;
+
+        if (!packer.count())
+        {
+            fprintf(stderr, "A sample does not fit a packet at an MTU of %zu\n", mtu);
+            return false;
+        }
+
+        pack_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now() - start).count();
+        packet_close();
+        start = std::chrono::steady_clock::now();
+        packer.begin(mtu - NOTIFICATION_OVERHEAD, static_cast<uint8_t>(packets));
+        i--;
+    }
+
+    pack_ns += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now() - start).count();
+    if (packer.count())
+        packet_close();
+
+    size_t bytes_raw = samples.size() * packer.sample_length();
+    // What one notification per unpacked sample would cost on the air, ATT overhead included.
+    size_t bytes_unbatched = samples.size() * (packer.sample_length() + NOTIFICATION_OVERHEAD);
+    fprintf(stdout, "%s\n{\"mtu\":%zu,\"samples\":%zu,\"channels\":%zu,\"packets\":%zu,"
+                    "\"bytes\":%zu,\"bytes_raw\":%zu,\"compression_ratio\":%.3f,"
+                    "\"samples_per_packet\":%.2f,\"samples_per_packet_max\":%zu,"
+                    "\"air_bytes_saved\":%.3f,\"ns_per_sample\":%.1f,\"round_trip\":%s}",
+            first ? "" : ",", mtu, samples.size(), channels, packets, bytes, bytes_raw,
+            static_cast<double>(bytes_raw) / bytes,
+            static_cast<double>(samples.size()) / packets, samples_max,
+            1.0 - static_cast<double>(bytes + packets * NOTIFICATION_OVERHEAD) / bytes_unbatched,
+            static_cast<double>(pack_ns) / samples.size(), valid ? "true" : "false");
+
+    return valid;
+}
+
+
+int
+main(int argc, char** argv)
+{
+    if (argc < 2)
+    {
+        fprintf(stderr, "Usage: %s <trace.csv> [mtu...]\n", argv[0]);
+        return 2;
+    }
+
+    std::vector<timeseries_sample_t> samples;
+    size_t channels = 0;
+    if (!trace_read(argv[1], samples, channels))
+    {
+        fprintf(stderr, "Could not read a trace from %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<size_t> mtus;
+    for (int i = 2; i < argc; i++)
+        mtus.push_back(strtoul(argv[i], nullptr, 10));
+
+    if (mtus.empty())
+        mtus.assign(std::begin(MTUS_DEFAULT), std::end(MTUS_DEFAULT));
+
+    bool valid = true;
+    fprintf(stdout, "{\"format\":\"esp32-ble-redux-timeseries\",\"trace\":\"%s\",\"results\":[",
+            argv[1]);
+    for (size_t i = 0; i < mtus.size(); i++)
+        valid = trace_pack(samples, channels, mtus[i], i == 0) && valid;
+
+    fprintf(stdout, "]}\n");
+    return valid ? 0 : 1;
+}
@@ -0,0 +1,96 @@
+#!/usr/bin/env python3
+#
+# Converts a binary trace dump produced by BLE::BLE_Trace::dump_binary into Chrome trace JSON which
+# can be loaded by chrome://tracing or https://ui.perfetto.dev.
+#
+# Copyright (c) 2019 Zeyad Tamimi. All rights reserved.
+# This Source Code Form is subject to the terms of the Mozilla Public
+# License, v. 2.0. If a copy of the MPL was not distributed with this
+# file, You can obtain one at http://mozilla.org/MPL/2.0/.
+
+import argparse
+import json
+import struct
+import sys
+
+TRACE_MAGIC = b"BLETRACE"
+TRACE_VERSION = 1
+HEADER_FORMAT = "<8sHHI"
+RECORD_FORMAT = "<IBBHHHI"
+
+(EVENT_ARRIVAL_GATTS, EVENT_ARRIVAL_GAP, HANDLER_ENTER, HANDLER_EXIT, RESPONSE_SENT,
+ QUEUE_ENQUEUE, QUEUE_DEQUEUE) = range(7)
+
+GATTS_EVENT_NAMES = [
+    "REG", "READ", "WRITE", "EXEC_WRITE", "MTU", "CONF", "UNREG", "CREATE", "ADD_INCL_SRVC",
+    "ADD_CHAR", "ADD_CHAR_DESCR", "DELETE", "START", "STOP", "CONNECT", "DISCONNECT", "OPEN",
+    "CANCEL_OPEN", "CLOSE", "LISTEN", "CONGEST", "RESPONSE", "CREAT_ATTR_TAB", "SET_ATTR_VAL",
+    "SEND_SERVICE_CHANGE",
+]
+
+
+def read_records(data):
+    magic, version, record_size, count = struct.unpack_from(HEADER_FORMAT, data)
+    if magic != TRACE_MAGIC:
+        raise ValueError("Not a BLE trace dump")
+    if version != TRACE_VERSION or record_size != struct.calcsize(RECORD_FORMAT):
+        raise ValueError("Unsupported trace dump version %d" % version)
+
+    offset = struct.calcsize(HEADER_FORMAT)
+    for i in range(count):
+        yield struct.unpack_from(RECORD_FORMAT, data, offset + (i * record_size))
+
+
+def to_chrome(records):
+    events = []
+    previous = None
+    epoch = 0
+    for timestamp, kind, event, handle, conn_id, _, arg in records:
+        # Timestamps are truncated to 32 bits on the device.
+        if previous is not None and timestamp < previous:
+            epoch += 1 << 32
+        previous = timestamp
+        ts = epoch + timestamp
+
+        if kind != EVENT_ARRIVAL_GAP and event < len(GATTS_EVENT_NAMES):
+            name = GATTS_EVENT_NAMES[event]
+        else:
+            name = "EVT_%d" % event
+
+        common = {"ts": ts, "pid": 1, "tid": 1}
+        if kind in (EVENT_ARRIVAL_GATTS, EVENT_ARRIVAL_GAP):
+            events.append(dict(common, name=name, ph="i", s="t",
+                               cat="gap" if kind == EVENT_ARRIVAL_GAP else "gatts",
+                               args={"arg": arg}))
+        elif kind in (HANDLER_ENTER, HANDLER_EXIT):
+            events.append(dict(common, name="%s %04X" % (name, handle), cat="handler",
+                               ph="B" if kind == HANDLER_ENTER else "E",
+                               args={"conn_id": conn_id, "arg": arg}))
+        elif kind == RESPONSE_SENT:
+            events.append(dict(common, name="response %04X" % handle, cat="response", ph="i",
+                               s="t", args={"conn_id": conn_id, "status": arg}))
+        elif kind in (QUEUE_ENQUEUE, QUEUE_DEQUEUE):
+            events.append({"name": "queue %04X" % handle, "cat": "queue", "ph": "C", "ts": ts,
+                           "pid": 1, "args": {"depth": arg}})
+
+    return {"displayTimeUnit": "ns", "traceEvents": events}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Convert a BLE trace dump to Chrome trace JSON")
+    parser.add_argument("dump", help="binary dump written by BLE_Trace::dump_binary")
+    parser.add_argument("-o", "--output", help="output file (default: stdout)")
+    args = parser.parse_args()
+
+    with open(args.dump, "rb") as dump:
+        trace = to_chrome(read_records(dump.read()))
+
+    if args.output:
+        with open(args.output, "w") as output:
+            json.dump(trace, output)
+    else:
+        json.dump(trace, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()